@@ -266,6 +266,75 @@ size_t HardwareSerial::write9(uint16_t c, bool cmd)
   return 1;
 }
 
+size_t HardwareSerial::readBlock9(uint16_t *dst, size_t max)
+{
+#if (SERIAL_RX_BUFFER_SIZE>256)
+  uint8_t oldSREG = SREG;
+  cli();
+#endif
+  rx_buffer_index_t head = _rx_buffer_head;
+#if (SERIAL_RX_BUFFER_SIZE>256)
+  SREG = oldSREG;
+#endif
+  rx_buffer_index_t tail = _rx_buffer_tail;
+  size_t n = 0;
+
+  while (tail != head && n < max) {
+    dst[n++] = _rx_buffer[tail];
+    tail = (rx_buffer_index_t)(tail + 1) % SERIAL_RX_BUFFER_SIZE;
+  }
+  _rx_buffer_tail = tail;
+  return n;
+}
+
+size_t HardwareSerial::writeBlock(const void *src, bool wide, size_t n, bool firstIsCommand)
+{
+  tx_buffer_index_t head = _tx_buffer_head;
+  size_t done = 0;
+
+  while (done < n) {
+#if (SERIAL_TX_BUFFER_SIZE>256)
+    uint8_t oldSREG = SREG;
+    cli();
+#endif
+    tx_buffer_index_t tail = _tx_buffer_tail;
+#if (SERIAL_TX_BUFFER_SIZE>256)
+    SREG = oldSREG;
+#endif
+    tx_buffer_index_t room = (SERIAL_TX_BUFFER_SIZE + tail - head - 1) % SERIAL_TX_BUFFER_SIZE;
+    if (room == 0) {
+      // same as write9: poll the data register ourselves when interrupts are off
+      if (bit_is_clear(SREG, SREG_I) && bit_is_set(*_ucsra, UDRE0))
+        _tx_udr_empty_irq();
+      continue;
+    }
+    if (room > n - done)
+      room = n - done;
+    while (room--) {
+      unsigned int c = wide ? ((const uint16_t *)src)[done] : ((const uint8_t *)src)[done];
+      if (done == 0 && firstIsCommand)
+        c |= 0x100;
+      _tx_buffer[head] = c;
+      head = (tx_buffer_index_t)(head + 1) % SERIAL_TX_BUFFER_SIZE;
+      done++;
+    }
+    _tx_buffer_head = head;
+    sbi(*_ucsrb, UDRIE0);
+    _written = true;
+  }
+  return n;
+}
+
+size_t HardwareSerial::writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand)
+{
+  return writeBlock(src, true, n, firstIsCommand);
+}
+
+size_t HardwareSerial::writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand)
+{
+  return writeBlock(src, false, n, firstIsCommand);
+}
+
 size_t HardwareSerial::write(uint8_t c)
 {
   return write9(c);
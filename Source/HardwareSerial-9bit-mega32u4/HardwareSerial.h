@@ -34,13 +34,31 @@
 
 //struct ring_buffer;
 
+// Ring buffer sizes per port, same names as HardwareSerial9bit: set
+// SERIAL1_RX_BUFFER_SIZE / SERIAL1_TX_BUFFER_SIZE here or with -D, for
+// example 256 for the UM6 at 115200 bauds or 128 for a SeaTalk reception.
+// The buffers are members of the class, so all the instances get the same
+// SERIAL_RX/TX_BUFFER_SIZE: on the 32u4 the only USART is Serial1 (Serial
+// is the USB CDC) and its sizes are used; an unused Serial1 is not linked
+// in at all (see Serial1_available in HardwareSerial.cpp).
 #if !(defined(SERIAL_TX_BUFFER_SIZE) && defined(SERIAL_RX_BUFFER_SIZE))
 #if (RAMEND < 1000)
-#define SERIAL_TX_BUFFER_SIZE 16
-#define SERIAL_RX_BUFFER_SIZE 16
+#define SERIAL_BUFFER_SIZE 16
 #else
-#define SERIAL_TX_BUFFER_SIZE 64
-#define SERIAL_RX_BUFFER_SIZE 64
+#define SERIAL_BUFFER_SIZE 64
+#endif
+#ifndef SERIAL1_RX_BUFFER_SIZE
+#define SERIAL1_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL1_TX_BUFFER_SIZE
+#define SERIAL1_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#if defined(UBRR1H) && !defined(UBRR0H) && !defined(UBRRH) && !defined(UBRR2H)
+#define SERIAL_RX_BUFFER_SIZE SERIAL1_RX_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE SERIAL1_TX_BUFFER_SIZE
+#else
+#define SERIAL_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#define SERIAL_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
 #endif
 #endif
 #if (SERIAL_TX_BUFFER_SIZE>256)
@@ -100,6 +118,7 @@ class HardwareSerial : public Stream
     bool _use9Bits;
 // Has any byte been written to the UART since begin()
     bool _written;
+    size_t writeBlock(const void *src, bool wide, size_t n, bool firstIsCommand);
 
     volatile rx_buffer_index_t _rx_buffer_head;
     volatile rx_buffer_index_t _rx_buffer_tail;
@@ -127,6 +146,12 @@ class HardwareSerial : public Stream
     virtual void flush(void);
     virtual size_t write(uint8_t);
     virtual size_t write9(uint16_t, bool cmd = false); //put false as default as only leading byte is set at 0x1xx
+    // whole spans: one head/tail snapshot and one index update per call instead of per symbol.
+    // readBlock9 copies up to max received symbols, without waiting.
+    // writeBlock9 waits for room like write9, firstIsCommand sets the 9th bit of src[0].
+    size_t readBlock9(uint16_t *dst, size_t max);
+    size_t writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand = false);
+    size_t writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand = false);
      //rewriting of write funct for different value
 	inline virtual size_t write(uint8_t c, bool b){return write9(c,b);};
     //support 9 bit seatalk
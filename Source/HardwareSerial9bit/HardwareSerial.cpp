@@ -39,55 +39,162 @@
 // using a ring buffer (I think), in which head is the index of the location
 // to which to write the next incoming character and tail is the index of the
 // location from which to read.
-#if (RAMEND < 1000)
-  #define SERIAL_BUFFER_SIZE 16
-#else
-  #define SERIAL_BUFFER_SIZE 64
-#endif
+// Each ring has its own size (SERIALn_RX/TX_BUFFER_SIZE in HardwareSerial.h),
+// the descriptor points to its storage and keeps the index mask.
 
+// 9 bit characters: the low 8 bits in buffer, the 9th bit of slot i in bit i
+// of the bitmap bit9, 9/8 bytes per character instead of 2.
+// Only the producer (ISR for rx, write9() for tx) writes bit9, so the
+// read-modify-write of a bitmap byte cannot lose a bit of another slot.
 struct ring_buffer
 {
-  unsigned int buffer[SERIAL_BUFFER_SIZE];
-  volatile unsigned int head;
-  volatile unsigned int tail;
+  uint8_t *buffer;
+  uint8_t *bit9;
+  uint8_t mask;          // size - 1
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  frame_queue *frames;   // rx only: framing mode when not NULL
+  serial_stats *stats;   // rx only
 };
 
+#define SERIAL_RING(name, size) \
+  static uint8_t name##_data[size]; \
+  static uint8_t name##_bit9[(size) / 8]; \
+  ring_buffer name = { name##_data, name##_bit9, (size) - 1, 0, 0, 0, 0 }
+
+#define SERIAL_RX_RING(name, size) \
+  static uint8_t name##_data[size]; \
+  static uint8_t name##_bit9[(size) / 8]; \
+  static serial_stats name##_stats; \
+  ring_buffer name = { name##_data, name##_bit9, (size) - 1, 0, 0, 0, &name##_stats }
+
 #if defined(USBCON)
-  ring_buffer rx_buffer = { { 0 }, 0, 0};
-  ring_buffer tx_buffer = { { 0 }, 0, 0};
+  SERIAL_RX_RING(rx_buffer, SERIAL_BUFFER_SIZE);
+  SERIAL_RING(tx_buffer, SERIAL_BUFFER_SIZE);
 #endif
-#if defined(UBRRH) || defined(UBRR0H)
-  ring_buffer rx_buffer  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer  =  { { 0 }, 0, 0 };
+#if defined(SERIAL0_ENABLED)
+  SERIAL_RX_RING(rx_buffer, SERIAL0_RX_BUFFER_SIZE);
+  SERIAL_RING(tx_buffer, SERIAL0_TX_BUFFER_SIZE);
 #endif
-#if defined(UBRR1H)
-  ring_buffer rx_buffer1  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer1  =  { { 0 }, 0, 0 };
+#if defined(SERIAL1_ENABLED)
+  SERIAL_RX_RING(rx_buffer1, SERIAL1_RX_BUFFER_SIZE);
+  SERIAL_RING(tx_buffer1, SERIAL1_TX_BUFFER_SIZE);
 #endif
-#if defined(UBRR2H)
-  ring_buffer rx_buffer2  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer2  =  { { 0 }, 0, 0 };
+#if defined(SERIAL2_ENABLED)
+  SERIAL_RX_RING(rx_buffer2, SERIAL2_RX_BUFFER_SIZE);
+  SERIAL_RING(tx_buffer2, SERIAL2_TX_BUFFER_SIZE);
 #endif
-#if defined(UBRR3H)
-  ring_buffer rx_buffer3  =  { { 0 }, 0, 0 };
-  ring_buffer tx_buffer3  =  { { 0 }, 0, 0 };
+#if defined(SERIAL3_ENABLED)
+  SERIAL_RX_RING(rx_buffer3, SERIAL3_RX_BUFFER_SIZE);
+  SERIAL_RING(tx_buffer3, SERIAL3_TX_BUFFER_SIZE);
 #endif
 
-inline void store_char(unsigned int c, ring_buffer *buffer)
+// UCSRnA error flags, at the same place on every AVR USART (PE on the
+// oldest parts, UPEn on the others). They describe the character waiting
+// in UDRn and must be read before it.
+#define SERIAL_FE   _BV(4)
+#define SERIAL_DOR  _BV(3)
+#define SERIAL_UPE  _BV(2)
+
+// write the 9 bit character c in slot i
+inline void put_char(ring_buffer *buffer, uint8_t i, unsigned int c)
+{
+  uint8_t mask = 1 << (i & 7);
+
+  buffer->buffer[i] = c;
+  if (c & 0x100)
+    buffer->bit9[i >> 3] |= mask;
+  else
+    buffer->bit9[i >> 3] &= ~mask;
+}
+
+// read the 9 bit character in slot i
+inline unsigned int get_char(ring_buffer *buffer, uint8_t i)
 {
-  int i = (unsigned int)(buffer->head + 1) % SERIAL_BUFFER_SIZE;
+  unsigned int c = buffer->buffer[i];
+
+  if (buffer->bit9[i >> 3] & (1 << (i & 7)))
+    c |= 0x100;
+  return c;
+}
+
+// framing mode: build the datagram in place in the free slot frame[head],
+// the main loop only sees it once head moves
+inline void store_frame(unsigned int c, frame_queue *q)
+{
+  seatalk_frame *f = &q->frame[q->head];
+
+  if (c & 0x100) {
+    if (q->pos)
+      q->truncated++;
+    q->pos = 0;
+    if (c == SEATALK_FRAME_NOISE) {
+      q->discarded++;
+      return;
+    }
+    if (((q->head + 1) & SEATALK_FRAME_MASK) == q->tail) {
+      // no free slot: the characters of this datagram count as discarded
+      q->dropped++;
+      return;
+    }
+    f->us = micros();
+    f->data[0] = c;
+    q->pos = 1;
+    return;
+  }
+  if (q->pos == 0) {
+    q->discarded++;
+    return;
+  }
+  f->data[q->pos++] = c;
+  if (q->pos == 2)
+    q->expected = (c & 0x0F) + 3;
+  if (q->pos == q->expected) {
+    f->len = q->pos;
+    q->pos = 0;
+    q->head = (q->head + 1) & SEATALK_FRAME_MASK;
+  }
+}
+
+// the character is kept even when flagged: the SeaTalk decoders resync on
+// the next command character anyway
+inline void store_char(unsigned int c, uint8_t status, ring_buffer *buffer)
+{
+  serial_stats *stats = buffer->stats;
+
+  if (status & (SERIAL_FE | SERIAL_DOR | SERIAL_UPE)) {
+    if (status & SERIAL_DOR)
+      stats->overruns++;
+    if (status & SERIAL_FE)
+      stats->framing++;
+    if (status & SERIAL_UPE)
+      stats->parity++;
+  }
+
+  if (buffer->frames) {
+    store_frame(c, buffer->frames);
+    return;
+  }
+
+  uint8_t i = (buffer->head + 1) & buffer->mask;
 
   // if we should be storing the received character into the location
   // just before the tail (meaning that the head would advance to the
   // current location of the tail), we're about to overflow the buffer
   // and so we don't write the character or advance the head.
   if (i != buffer->tail) {
-    buffer->buffer[buffer->head] = c;
+    put_char(buffer, buffer->head, c);
     buffer->head = i;
+    uint8_t used = (uint8_t)(i - buffer->tail) & buffer->mask;
+    if (used > stats->high_water)
+      stats->high_water = used;
+  } else {
+    stats->overflows++;
   }
 }
 
-#if !defined(USART0_RX_vect) && defined(USART0_RXC_vect)
+#if defined(SERIAL0_ENABLED)
+#if !defined(USART0_RX_vect) && defined(USART1_RX_vect)
 // do nothing - on the 32u4 the first USART is USART1
 #else
 #if !defined(USART_RX_vect) && !defined(USART0_RXC_vect) && \
@@ -111,60 +218,70 @@ inline void store_char(unsigned int c, ring_buffer *buffer)
 #endif
   {
   #if defined(UDR0)
+  uint8_t status = UCSR0A;
   unsigned int c = (UCSR0B & _BV (RXB80)) << 7;
     c |=  UDR0;
   #elif defined(UDR)
+  uint8_t status = UCSRA;
   unsigned int c = (UCSRB & _BV (RXB8)) << 7;
     c |=  UDR;
   #else
     #error UDR not defined
   #endif
-    store_char(c, &rx_buffer);
+    store_char(c, status, &rx_buffer);
   }
 #endif
 #endif
+#endif
 
-#if defined(USART0_RXC_vect)
+#if defined(USART1_RX_vect) && defined(SERIAL1_ENABLED)
   void serialEvent1() __attribute__((weak));
   void serialEvent1() {}
   #define serialEvent1_implemented
-  SIGNAL(USART0_RXC_vect)
+  SIGNAL(USART1_RX_vect)
   {
+  uint8_t status = UCSR1A;
   unsigned int c = (UCSR1B & _BV (RXB81)) << 7;
     c |=  UDR1;
-    store_char(c, &rx_buffer1);
+    store_char(c, status, &rx_buffer1);
   }
 #elif defined(USART1_RXC_vect)
   #error USART1_RXC_vect
 #endif
 
+#if defined(SERIAL2_ENABLED)
 #if defined(USART2_RX_vect) && defined(UDR2)
   void serialEvent2() __attribute__((weak));
   void serialEvent2() {}
   #define serialEvent2_implemented
   SIGNAL(USART2_RX_vect)
   {
+  uint8_t status = UCSR2A;
   unsigned int c = (UCSR2B & _BV (RXB82)) << 7;
     c |=  UDR2;
-    store_char(c, &rx_buffer2);
+    store_char(c, status, &rx_buffer2);
   }
 #elif defined(USART2_RX_vect)
   #error USART2_RX_vect
 #endif
+#endif
 
+#if defined(SERIAL3_ENABLED)
 #if defined(USART3_RX_vect) && defined(UDR3)
   void serialEvent3() __attribute__((weak));
   void serialEvent3() {}
   #define serialEvent3_implemented
   SIGNAL(USART3_RX_vect)
   {
+  uint8_t status = UCSR3A;
   unsigned int c = (UCSR3B & _BV (RXB83)) << 7;
     c |=  UDR3;
-    store_char(c, &rx_buffer3);
+    store_char(c, status, &rx_buffer3);
   }
 #elif defined(USART3_RX_vect)
   #error USART3_RX_vect
 #endif
+#endif
 
 void serialEventRun(void)
 {
@@ -183,6 +300,7 @@ void serialEventRun(void)
 }
 
 
+#if defined(SERIAL0_ENABLED)
 #if !defined(USART0_UDRE_vect) && defined(USART1_UDRE_vect)
 // do nothing - on the 32u4 the first USART is USART1
 #else
@@ -209,8 +327,8 @@ ISR(USART_UDRE_vect)
   }
   else {
     // There is more data in the output buffer. Send the next byte
-    unsigned int c = tx_buffer.buffer[tx_buffer.tail];
-    tx_buffer.tail = (tx_buffer.tail + 1) % SERIAL_BUFFER_SIZE;
+    unsigned int c = get_char(&tx_buffer, tx_buffer.tail);
+    tx_buffer.tail = (tx_buffer.tail + 1) & (SERIAL0_TX_BUFFER_SIZE - 1);
 	
   #if defined(UDR0)
     UCSR0B &= ~_BV (TXB80);  // clear 9th bit
@@ -229,8 +347,9 @@ ISR(USART_UDRE_vect)
 }
 #endif
 #endif
+#endif
 
-#ifdef USART1_UDRE_vect
+#if defined(USART1_UDRE_vect) && defined(SERIAL1_ENABLED)
 ISR(USART1_UDRE_vect)
 {
   if (tx_buffer1.head == tx_buffer1.tail) {
@@ -239,8 +358,8 @@ ISR(USART1_UDRE_vect)
   }
   else {
     // There is more data in the output buffer. Send the next byte
-    unsigned int c = tx_buffer1.buffer[tx_buffer1.tail];
-    tx_buffer1.tail = (tx_buffer1.tail + 1) % SERIAL_BUFFER_SIZE;
+    unsigned int c = get_char(&tx_buffer1, tx_buffer1.tail);
+    tx_buffer1.tail = (tx_buffer1.tail + 1) & (SERIAL1_TX_BUFFER_SIZE - 1);
 	
     UCSR1B &= ~_BV (TXB81);  // clear 9th bit
     if (c & 0x0100)     // if 9th bit in "c" set, set 9th bit
@@ -250,7 +369,7 @@ ISR(USART1_UDRE_vect)
 }
 #endif
 
-#ifdef USART2_UDRE_vect
+#if defined(USART2_UDRE_vect) && defined(SERIAL2_ENABLED)
 ISR(USART2_UDRE_vect)
 {
   if (tx_buffer2.head == tx_buffer2.tail) {
@@ -259,8 +378,8 @@ ISR(USART2_UDRE_vect)
   }
   else {
     // There is more data in the output buffer. Send the next byte
-    unsigned int c = tx_buffer2.buffer[tx_buffer2.tail];
-    tx_buffer2.tail = (tx_buffer2.tail + 1) % SERIAL_BUFFER_SIZE;
+    unsigned int c = get_char(&tx_buffer2, tx_buffer2.tail);
+    tx_buffer2.tail = (tx_buffer2.tail + 1) & (SERIAL2_TX_BUFFER_SIZE - 1);
 	
     UCSR2B &= ~_BV (TXB82);  // clear 9th bit
     if (c & 0x0100)     // if 9th bit in "c" set, set 9th bit
@@ -270,7 +389,7 @@ ISR(USART2_UDRE_vect)
 }
 #endif
 
-#ifdef USART3_UDRE_vect
+#if defined(USART3_UDRE_vect) && defined(SERIAL3_ENABLED)
 ISR(USART3_UDRE_vect)
 {
   if (tx_buffer3.head == tx_buffer3.tail) {
@@ -279,8 +398,8 @@ ISR(USART3_UDRE_vect)
   }
   else {
     // There is more data in the output buffer. Send the next byte
-    unsigned int c = tx_buffer3.buffer[tx_buffer3.tail];
-    tx_buffer3.tail = (tx_buffer3.tail + 1) % SERIAL_BUFFER_SIZE;
+    unsigned int c = get_char(&tx_buffer3, tx_buffer3.tail);
+    tx_buffer3.tail = (tx_buffer3.tail + 1) & (SERIAL3_TX_BUFFER_SIZE - 1);
 	
     UCSR3B &= ~_BV (TXB83);  // clear 9th bit
     if (c & 0x0100)     // if 9th bit in "c" set, set 9th bit
@@ -382,35 +501,95 @@ void HardwareSerial::end()
 
 int HardwareSerial::available(void)
 {
-  return (unsigned int)(SERIAL_BUFFER_SIZE + _rx_buffer->head - _rx_buffer->tail) % SERIAL_BUFFER_SIZE;
+  return (uint8_t)(_rx_buffer->head - _rx_buffer->tail) & _rx_buffer->mask;
 }
 
 int HardwareSerial::peek(void)
 {
-  if (_rx_buffer->head == _rx_buffer->tail) {
+  uint8_t tail = _rx_buffer->tail;
+
+  if (_rx_buffer->head == tail) {
     return -1;
   } else {
     if (_use9Bits)
-      return _rx_buffer->buffer[_rx_buffer->tail];
+      return get_char(_rx_buffer, tail);
     else
-      return _rx_buffer->buffer[_rx_buffer->tail] & 0xFF;
+      return _rx_buffer->buffer[tail];
   }
 }
 
 int HardwareSerial::read(void)
 {
+  uint8_t tail = _rx_buffer->tail;
+
   // if the head isn't ahead of the tail, we don't have any characters
-  if (_rx_buffer->head == _rx_buffer->tail) {
+  if (_rx_buffer->head == tail) {
     return -1;
   } else {
-    unsigned int c = _rx_buffer->buffer[_rx_buffer->tail];
-    _rx_buffer->tail = (unsigned int)(_rx_buffer->tail + 1) % SERIAL_BUFFER_SIZE;
-    if (!_use9Bits)
-      c &= 0xFF;
+    unsigned int c = _use9Bits ? get_char(_rx_buffer, tail) : _rx_buffer->buffer[tail];
+    _rx_buffer->tail = (tail + 1) & _rx_buffer->mask;
     return c;
   }
 }
 
+void HardwareSerial::beginFrames(frame_queue *q)
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  if (q) {
+    q->head = q->tail = 0;
+    q->pos = 0;
+    q->dropped = q->truncated = q->discarded = 0;
+  }
+  _rx_buffer->frames = q;
+  _rx_buffer->head = _rx_buffer->tail;
+  SREG = oldSREG;
+}
+
+int HardwareSerial::availableFrames(void)
+{
+  frame_queue *q = _rx_buffer->frames;
+
+  if (q == NULL)
+    return 0;
+  return (uint8_t)(q->head - q->tail) & SEATALK_FRAME_MASK;
+}
+
+int HardwareSerial::readFrame(uint8_t *data, unsigned long *us)
+{
+  frame_queue *q = _rx_buffer->frames;
+  uint8_t tail, len;
+
+  if (q == NULL || q->head == (tail = q->tail))
+    return 0;
+  // the ISR does not touch frame[tail] until tail moves
+  len = q->frame[tail].len;
+  memcpy(data, q->frame[tail].data, len);
+  if (us)
+    *us = q->frame[tail].us;
+  q->tail = (tail + 1) & SEATALK_FRAME_MASK;
+  return len;
+}
+
+void HardwareSerial::getStats(serial_stats *out)
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  *out = *_rx_buffer->stats;
+  SREG = oldSREG;
+}
+
+void HardwareSerial::clearStats(void)
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  memset((void *)_rx_buffer->stats, 0, sizeof(serial_stats));
+  SREG = oldSREG;
+}
+
 void HardwareSerial::flush()
 {
   while (_tx_buffer->head != _tx_buffer->tail)
@@ -419,7 +598,8 @@ void HardwareSerial::flush()
 
 size_t HardwareSerial::write9(uint16_t c, bool cmd)
 {
-  int i = (_tx_buffer->head + 1) % SERIAL_BUFFER_SIZE;
+  uint8_t head = _tx_buffer->head;
+  uint8_t i = (head + 1) & _tx_buffer->mask;
 	
   // If the output buffer is full, there's nothing for it other than to 
   // wait for the interrupt handler to empty it a bit
@@ -427,7 +607,7 @@ size_t HardwareSerial::write9(uint16_t c, bool cmd)
   while (i == _tx_buffer->tail)
     ;
   //we add the leading 1 to be sure
-  _tx_buffer->buffer[_tx_buffer->head] = (cmd ? c|0x100 : c);
+  put_char(_tx_buffer, head, cmd ? c|0x100 : c);
   _tx_buffer->head = i;
 	
   sbi(*_ucsrb, _udrie);
@@ -435,6 +615,58 @@ size_t HardwareSerial::write9(uint16_t c, bool cmd)
   return 1;  
 }
 
+size_t HardwareSerial::readBlock9(uint16_t *dst, size_t max)
+{
+  uint8_t mask = _rx_buffer->mask;
+  uint8_t head = _rx_buffer->head;   // the ISR only moves head forward
+  uint8_t tail = _rx_buffer->tail;
+  size_t n = 0;
+
+  while (tail != head && n < max) {
+    dst[n++] = _use9Bits ? get_char(_rx_buffer, tail) : _rx_buffer->buffer[tail];
+    tail = (tail + 1) & mask;
+  }
+  _rx_buffer->tail = tail;
+  return n;
+}
+
+size_t HardwareSerial::writeBlock(const void *src, bool wide, size_t n, bool firstIsCommand)
+{
+  uint8_t mask = _tx_buffer->mask;
+  uint8_t head = _tx_buffer->head;
+  size_t done = 0;
+
+  while (done < n) {
+    // free slots, the ISR only moves tail forward; wait like write9 when full
+    uint8_t room = (uint8_t)(_tx_buffer->tail - head - 1) & mask;
+    if (room == 0)
+      continue;
+    if (room > n - done)
+      room = n - done;
+    while (room--) {
+      unsigned int c = wide ? ((const uint16_t *)src)[done] : ((const uint8_t *)src)[done];
+      if (done == 0 && firstIsCommand)
+        c |= 0x100;
+      put_char(_tx_buffer, head, c);
+      head = (head + 1) & mask;
+      done++;
+    }
+    _tx_buffer->head = head;
+    sbi(*_ucsrb, _udrie);
+  }
+  return n;
+}
+
+size_t HardwareSerial::writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand)
+{
+  return writeBlock(src, true, n, firstIsCommand);
+}
+
+size_t HardwareSerial::writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand)
+{
+  return writeBlock(src, false, n, firstIsCommand);
+}
+
 size_t HardwareSerial::write(uint8_t c)
 {
   return write9(c);
@@ -447,23 +679,25 @@ HardwareSerial::operator bool() {
 
 // Preinstantiate Objects //////////////////////////////////////////////////////
 
-#if defined(UBRRH) && defined(UBRRL)
+#if defined(SERIAL0_ENABLED) && defined(UBRRH) && defined(UBRRL)
   HardwareSerial Serial(&rx_buffer, &tx_buffer, &UBRRH, &UBRRL, &UCSRA, &UCSRB, &UCSRC, &UDR, RXEN, TXEN, RXCIE, UDRIE, U2X, UCSZ2);
-#elif defined(UBRR0H) && defined(UBRR0L)
+#elif defined(SERIAL0_ENABLED) && defined(UBRR0H) && defined(UBRR0L)
   HardwareSerial Serial(&rx_buffer, &tx_buffer, &UBRR0H, &UBRR0L, &UCSR0A, &UCSR0B, &UCSR0C, &UDR0, RXEN0, TXEN0, RXCIE0, UDRIE0, U2X0, UCSZ02);
 #elif defined(USBCON)
   // do nothing - Serial object and buffers are initialized in CDC code
+#elif defined(UBRRH) || defined(UBRR0H)
+  // port 0 left out, both sizes at 0
 #else
   #error no serial port defined  (port 0)
 #endif
 
-#if defined(UBRR1H)
+#if defined(SERIAL1_ENABLED)
   HardwareSerial Serial1(&rx_buffer1, &tx_buffer1, &UBRR1H, &UBRR1L, &UCSR1A, &UCSR1B, &UCSR1C, &UDR1, RXEN1, TXEN1, RXCIE1, UDRIE1, U2X1, UCSZ12);
 #endif
-#if defined(UBRR2H)
+#if defined(SERIAL2_ENABLED)
   HardwareSerial Serial2(&rx_buffer2, &tx_buffer2, &UBRR2H, &UBRR2L, &UCSR2A, &UCSR2B, &UCSR2C, &UDR2, RXEN2, TXEN2, RXCIE2, UDRIE2, U2X2, UCSZ22);
 #endif
-#if defined(UBRR3H)
+#if defined(SERIAL3_ENABLED)
   HardwareSerial Serial3(&rx_buffer3, &tx_buffer3, &UBRR3H, &UBRR3L, &UCSR3A, &UCSR3B, &UCSR3C, &UDR3, RXEN3, TXEN3, RXCIE3, UDRIE3, U2X3, UCSZ32);
 #endif
 
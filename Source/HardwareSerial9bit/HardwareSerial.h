@@ -30,8 +30,128 @@
 
 #include "Stream.h"
 
+// Ring buffer sizes, per port and per direction: a power of two from 8 to
+// 256 (index wrap with a mask, 8 bit indexes read and written atomically by
+// the ISR and the sketch). A port with both sizes at 0 is left out: no
+// buffers, no interrupt handlers, no SerialN object.
+// They can be set here or with -D on the command line, for example on a
+// Mega wired like compass_heading and Seatalk_api (Serial1 writes the bus,
+// Serial2 reads it back, our echoes included; the idle detector is also
+// jumpered to RX2):
+//   SERIAL2_RX_BUFFER_SIZE 128   SeaTalk reception, whole datagrams during a CAN stall
+//   SERIAL2_TX_BUFFER_SIZE 8     never written
+//   SERIAL1_RX_BUFFER_SIZE 8     never read
+//   SERIAL1_TX_BUFFER_SIZE 32    SeaTalk emission, a whole datagram (18 symbols) at once
+//   SERIAL3_RX_BUFFER_SIZE 0     unused
+//   SERIAL3_TX_BUFFER_SIZE 0
+// and on the UM6 board SERIAL1_RX_BUFFER_SIZE 256 at 115200 bauds.
+#if (RAMEND < 1000)
+  #define SERIAL_BUFFER_SIZE 16
+#else
+  #define SERIAL_BUFFER_SIZE 64
+#endif
+
+#ifndef SERIAL0_RX_BUFFER_SIZE
+  #define SERIAL0_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL0_TX_BUFFER_SIZE
+  #define SERIAL0_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL1_RX_BUFFER_SIZE
+  #define SERIAL1_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL1_TX_BUFFER_SIZE
+  #define SERIAL1_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL2_RX_BUFFER_SIZE
+  #define SERIAL2_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL2_TX_BUFFER_SIZE
+  #define SERIAL2_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL3_RX_BUFFER_SIZE
+  #define SERIAL3_RX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+#ifndef SERIAL3_TX_BUFFER_SIZE
+  #define SERIAL3_TX_BUFFER_SIZE SERIAL_BUFFER_SIZE
+#endif
+
+#define SERIAL_SIZE_OK(n) ((n) >= 8 && (n) <= 256 && ((n) & ((n) - 1)) == 0)
+#define SERIAL_SIZES_OK(rx, tx) (((rx) == 0 && (tx) == 0) || (SERIAL_SIZE_OK(rx) && SERIAL_SIZE_OK(tx)))
+
+#if !SERIAL_SIZES_OK(SERIAL0_RX_BUFFER_SIZE, SERIAL0_TX_BUFFER_SIZE) || \
+    !SERIAL_SIZES_OK(SERIAL1_RX_BUFFER_SIZE, SERIAL1_TX_BUFFER_SIZE) || \
+    !SERIAL_SIZES_OK(SERIAL2_RX_BUFFER_SIZE, SERIAL2_TX_BUFFER_SIZE) || \
+    !SERIAL_SIZES_OK(SERIAL3_RX_BUFFER_SIZE, SERIAL3_TX_BUFFER_SIZE)
+  #error SERIALn_RX/TX_BUFFER_SIZE must be powers of two between 8 and 256, or both 0
+#endif
+
+#if (defined(UBRRH) || defined(UBRR0H)) && SERIAL0_RX_BUFFER_SIZE > 0
+  #define SERIAL0_ENABLED
+#endif
+#if defined(UBRR1H) && SERIAL1_RX_BUFFER_SIZE > 0
+  #define SERIAL1_ENABLED
+#endif
+#if defined(UBRR2H) && SERIAL2_RX_BUFFER_SIZE > 0
+  #define SERIAL2_ENABLED
+#endif
+#if defined(UBRR3H) && SERIAL3_RX_BUFFER_SIZE > 0
+  #define SERIAL3_ENABLED
+#endif
+
 struct ring_buffer;
 
+// SeaTalk datagram framing in the receive interrupt, optional: a port stays
+// a plain symbol stream until beginFrames() gives it a frame_queue.
+// The ISR starts a datagram on a character with the 9th bit set, notes its
+// arrival time with micros() (end of the command character: it started
+// about 2.3ms earlier at 4800 bauds), takes the length from the low nibble
+// of the second character and publishes the datagram once complete.
+#define HARDWARESERIAL_FRAMES
+#define SEATALK_FRAME_MAX 18
+#define SEATALK_FRAME_QUEUE 8
+#define SEATALK_FRAME_MASK (SEATALK_FRAME_QUEUE - 1)
+#define SEATALK_FRAME_NOISE 0x1FF
+
+#if (SEATALK_FRAME_QUEUE & SEATALK_FRAME_MASK)
+  #error SEATALK_FRAME_QUEUE must be a power of two
+#endif
+
+struct seatalk_frame
+{
+  unsigned long us;
+  uint8_t len;
+  uint8_t data[SEATALK_FRAME_MAX];
+};
+
+struct frame_queue
+{
+  seatalk_frame frame[SEATALK_FRAME_QUEUE];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  uint8_t pos;                // characters of the datagram being received in frame[head]
+  uint8_t expected;
+  // wrapping counters, written by the ISR only
+  volatile uint8_t dropped;   // datagrams lost, queue full
+  volatile uint8_t truncated; // datagrams cut by the next command character
+  volatile uint8_t discarded; // characters outside a datagram (beginning not seen, 0x1FF noise)
+};
+
+// Receive counters, per port, written by the RX ISR only (wrapping).
+// overflows and high_water concern the ring buffer, not the framing mode
+// (see frame_queue.dropped). Parity is off in 9N1: parity stays at 0 on a
+// SeaTalk port.
+#define HARDWARESERIAL_STATS
+
+struct serial_stats
+{
+  uint16_t overflows;  // characters lost, ring buffer full
+  uint16_t overruns;   // DOR: character lost in the USART, the ISR came too late
+  uint16_t framing;    // FE: no stop bit (collision, noise, wrong speed)
+  uint16_t parity;     // UPE
+  uint8_t high_water;  // most characters waiting in the ring buffer since clearStats()
+};
+
 class HardwareSerial : public Stream
 {
   private:
@@ -50,6 +170,7 @@ class HardwareSerial : public Stream
     uint8_t _u2x;
     uint8_t _ucsz2;
     bool _use9Bits;
+    size_t writeBlock(const void *src, bool wide, size_t n, bool firstIsCommand);
   public:
     HardwareSerial(ring_buffer *rx_buffer, ring_buffer *tx_buffer,
       volatile uint8_t *ubrrh, volatile uint8_t *ubrrl,
@@ -64,6 +185,22 @@ class HardwareSerial : public Stream
     virtual void flush(void);
     virtual size_t write(uint8_t);
     virtual size_t write9(uint16_t, bool cmd = false); //put false as default as only leading byte is set at 0x1xx
+    // whole spans: one head/tail snapshot and one index update per call instead of per symbol.
+    // readBlock9 copies up to max received symbols (9th bit in 0x100), without waiting.
+    // writeBlock9 waits for room like write9, the 9th bit comes from each symbol,
+    // firstIsCommand forces it on src[0] (the SeaTalk command character).
+    size_t readBlock9(uint16_t *dst, size_t max);
+    size_t writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand = false);
+    size_t writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand = false);
+    // framing mode: q receives the datagrams instead of the ring buffer, NULL goes back to symbols
+    void beginFrames(frame_queue *q);
+    int availableFrames(void);
+    // copy the oldest datagram in data (SEATALK_FRAME_MAX bytes), its arrival time in *us,
+    // return its length or 0 if none
+    int readFrame(uint8_t *data, unsigned long *us = 0);
+    // consistent copy of the receive counters, and reset
+    void getStats(serial_stats *out);
+    void clearStats(void);
     using Print::write; // pull in write(str) and write(buf, size) from Print
     operator bool();
 	
@@ -103,19 +240,19 @@ class HardwareSerial : public Stream
     }
 };
 
-#if defined(UBRRH) || defined(UBRR0H)
+#if defined(SERIAL0_ENABLED)
   extern HardwareSerial Serial;
 #elif defined(USBCON)
   #include "USBAPI.h"
   //extern HardwareSerial Serial_;  
 #endif
-#if defined(UBRR1H)
+#if defined(SERIAL1_ENABLED)
   extern HardwareSerial Serial1;
 #endif
-#if defined(UBRR2H)
+#if defined(SERIAL2_ENABLED)
   extern HardwareSerial Serial2;
 #endif
-#if defined(UBRR3H)
+#if defined(SERIAL3_ENABLED)
   extern HardwareSerial Serial3;
 #endif
 
@@ -67,6 +67,7 @@ struct ring_buffer
   unsigned char buffer9[SERIAL_BUFFER_BITS];
   volatile unsigned int head;
   volatile unsigned int tail;
+  frame_queue *frames;   // rx only: framing mode when not NULL
 };
 
 #if defined(USBCON)
@@ -108,6 +109,44 @@ inline uint8_t get_9( ring_buffer *buffer)
 }
 
 
+// framing mode: build the datagram in place in the free slot frame[head],
+// the main loop only sees it once head moves
+inline void store_frame(unsigned int c, frame_queue *q)
+{
+  seatalk_frame *f = &q->frame[q->head];
+
+  if (c & 0x100) {
+    if (q->pos)
+      q->truncated++;
+    q->pos = 0;
+    if (c == SEATALK_FRAME_NOISE) {
+      q->discarded++;
+      return;
+    }
+    if (((q->head + 1) & SEATALK_FRAME_MASK) == q->tail) {
+      // no free slot: the characters of this datagram count as discarded
+      q->dropped++;
+      return;
+    }
+    f->us = micros();
+    f->data[0] = c;
+    q->pos = 1;
+    return;
+  }
+  if (q->pos == 0) {
+    q->discarded++;
+    return;
+  }
+  f->data[q->pos++] = c;
+  if (q->pos == 2)
+    q->expected = (c & 0x0F) + 3;
+  if (q->pos == q->expected) {
+    f->len = q->pos;
+    q->pos = 0;
+    q->head = (q->head + 1) & SEATALK_FRAME_MASK;
+  }
+}
+
 inline void store_char(unsigned char c, ring_buffer *buffer)
 {
   int i = (unsigned int)(buffer->head + 1) % SERIAL_BUFFER_SIZE;
@@ -180,6 +219,12 @@ inline void store_char(unsigned char c, ring_buffer *buffer)
 
       d=UDR1;//lecture du registre APRES le 9bit
 
+      if(rx_buffer1.frames) //mode trame: datagramme seatalk reconstitue ici
+      {
+          store_frame(((c!=0)?0x100:0)|d, rx_buffer1.frames);
+          return;
+      }
+
      if(UCSR1B&0b100) //si configure en 9 bit
       {
           store_9(c>0, &rx_buffer1);
@@ -206,6 +251,12 @@ inline void store_char(unsigned char c, ring_buffer *buffer)
 
       d=UDR2;//lecture du registre APRES le 9bit
 
+      if(rx_buffer2.frames) //mode trame: datagramme seatalk reconstitue ici
+      {
+          store_frame(((c!=0)?0x100:0)|d, rx_buffer2.frames);
+          return;
+      }
+
      if(UCSR2B&0b100) //si configure en 9 bit
       {
           store_9(c, &rx_buffer2);
@@ -233,9 +284,15 @@ inline void store_char(unsigned char c, ring_buffer *buffer)
 
       d=UDR3;//lecture du registre APRES le 9bit
 
+      if(rx_buffer3.frames) //mode trame: datagramme seatalk reconstitue ici
+      {
+          store_frame(((c!=0)?0x100:0)|d, rx_buffer3.frames);
+          return;
+      }
+
      if(UCSR3B&0b100) //si configure en 9 bit
       {
-          store_9(c,x, &rx_buffe3);
+          store_9(c, &rx_buffer3);
       }
       store_char(d, &rx_buffer3);
 
@@ -625,6 +682,107 @@ size_t HardwareSerial::write9(uint8_t c, bool p)
 
 
 
+size_t HardwareSerial::readBlock9(uint16_t *dst, size_t max)
+{
+  unsigned int head = _rx_buffer->head; //l'interruption ne fait qu'avancer head
+  unsigned int tail = _rx_buffer->tail;
+  bool nine = (*_ucsrb & 0b100) != 0;
+  size_t n = 0;
+
+  while (tail != head && n < max) {
+    uint16_t c = _rx_buffer->buffer[tail];
+    if (nine && (_rx_buffer->buffer9[tail >> 3] & (1 << (tail & 7))))
+      c |= 0x100;
+    dst[n++] = c;
+    tail = (tail + 1) % SERIAL_BUFFER_SIZE;
+  }
+  _rx_buffer->tail = tail;
+  return n;
+}
+
+size_t HardwareSerial::writeBlock(const void *src, bool wide, size_t n, bool firstIsCommand)
+{
+  unsigned int head = _tx_buffer->head;
+  size_t done = 0;
+
+  while (done < n) {
+    //place libre, l'interruption ne fait qu'avancer tail; on attend comme write9 si le buffer est plein
+    unsigned int room = (SERIAL_BUFFER_SIZE + _tx_buffer->tail - head - 1) % SERIAL_BUFFER_SIZE;
+    if (room == 0)
+      continue;
+    if (room > n - done)
+      room = n - done;
+    while (room--) {
+      uint16_t c = wide ? ((const uint16_t *)src)[done] : ((const uint8_t *)src)[done];
+      uint8_t mask = 1 << (head & 7);
+      if (done == 0 && firstIsCommand)
+        c |= 0x100;
+      _tx_buffer->buffer[head] = c;
+      if (c & 0x100)
+        _tx_buffer->buffer9[head >> 3] |= mask;
+      else
+        _tx_buffer->buffer9[head >> 3] &= ~mask;
+      head = (head + 1) % SERIAL_BUFFER_SIZE;
+      done++;
+    }
+    _tx_buffer->head = head;
+    sbi(*_ucsrb, _udrie);
+    transmitting = true;
+    sbi(*_ucsra, TXC0);
+  }
+  return n;
+}
+
+size_t HardwareSerial::writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand)
+{
+  return writeBlock(src, true, n, firstIsCommand);
+}
+
+size_t HardwareSerial::writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand)
+{
+  return writeBlock(src, false, n, firstIsCommand);
+}
+
+void HardwareSerial::beginFrames(frame_queue *q)
+{
+  uint8_t oldSREG = SREG;
+
+  cli();
+  if (q) {
+    q->head = q->tail = 0;
+    q->pos = 0;
+    q->dropped = q->truncated = q->discarded = 0;
+  }
+  _rx_buffer->frames = q;
+  _rx_buffer->head = _rx_buffer->tail;
+  SREG = oldSREG;
+}
+
+int HardwareSerial::availableFrames(void)
+{
+  frame_queue *q = _rx_buffer->frames;
+
+  if (q == NULL)
+    return 0;
+  return (uint8_t)(q->head - q->tail) & SEATALK_FRAME_MASK;
+}
+
+int HardwareSerial::readFrame(uint8_t *data, unsigned long *us)
+{
+  frame_queue *q = _rx_buffer->frames;
+  uint8_t tail, len;
+
+  if (q == NULL || q->head == (tail = q->tail))
+    return 0;
+  // the ISR does not touch frame[tail] until tail moves
+  len = q->frame[tail].len;
+  memcpy(data, q->frame[tail].data, len);
+  if (us)
+    *us = q->frame[tail].us;
+  q->tail = (tail + 1) & SEATALK_FRAME_MASK;
+  return len;
+}
+
 HardwareSerial::operator bool() {
 	return true;
 }
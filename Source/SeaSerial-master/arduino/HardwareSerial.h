@@ -30,6 +30,42 @@
 
 struct ring_buffer;
 
+// SeaTalk datagram framing in the receive interrupt, optional: a port stays
+// a plain symbol stream until beginFrames() gives it a frame_queue.
+// The ISR starts a datagram on a character with the 9th bit set, notes its
+// arrival time with micros() (end of the command character: it started
+// about 2.3ms earlier at 4800 bauds), takes the length from the low nibble
+// of the second character and publishes the datagram once complete.
+#define HARDWARESERIAL_FRAMES
+#define SEATALK_FRAME_MAX 18
+#define SEATALK_FRAME_QUEUE 8
+#define SEATALK_FRAME_MASK (SEATALK_FRAME_QUEUE - 1)
+#define SEATALK_FRAME_NOISE 0x1FF
+
+#if (SEATALK_FRAME_QUEUE & SEATALK_FRAME_MASK)
+  #error SEATALK_FRAME_QUEUE must be a power of two
+#endif
+
+struct seatalk_frame
+{
+  unsigned long us;
+  uint8_t len;
+  uint8_t data[SEATALK_FRAME_MAX];
+};
+
+struct frame_queue
+{
+  seatalk_frame frame[SEATALK_FRAME_QUEUE];
+  volatile uint8_t head;
+  volatile uint8_t tail;
+  uint8_t pos;                // characters of the datagram being received in frame[head]
+  uint8_t expected;
+  // wrapping counters, written by the ISR only
+  volatile uint8_t dropped;   // datagrams lost, queue full
+  volatile uint8_t truncated; // datagrams cut by the next command character
+  volatile uint8_t discarded; // characters outside a datagram (beginning not seen, 0x1FF noise)
+};
+
 class HardwareSerial : public Stream
 {
   private:
@@ -47,6 +83,7 @@ class HardwareSerial : public Stream
     uint8_t _udrie;
     uint8_t _u2x;
     bool transmitting;
+    size_t writeBlock(const void *src, bool wide, size_t n, bool firstIsCommand);
 
   public:
     HardwareSerial(ring_buffer *rx_buffer, ring_buffer *tx_buffer,
@@ -66,6 +103,19 @@ class HardwareSerial : public Stream
 
 
     virtual size_t write9(uint8_t c, bool p);
+    // whole spans: one head/tail snapshot and one index update per call instead of per symbol.
+    // readBlock9 copies up to max received symbols (9th bit in 0x100), without waiting.
+    // writeBlock9 waits for room like write9, the 9th bit comes from each symbol,
+    // firstIsCommand forces it on src[0] (the SeaTalk command character).
+    size_t readBlock9(uint16_t *dst, size_t max);
+    size_t writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand = false);
+    size_t writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand = false);
+    // framing mode: q receives the datagrams instead of the ring buffer, NULL goes back to symbols
+    void beginFrames(frame_queue *q);
+    int availableFrames(void);
+    // copy the oldest datagram in data (SEATALK_FRAME_MAX bytes), its arrival time in *us,
+    // return its length or 0 if none
+    int readFrame(uint8_t *data, unsigned long *us = 0);
     virtual size_t write(uint8_t);
     inline virtual size_t write(uint8_t c, bool b){return write9(c,b);};
     //support 9 bit seatalk
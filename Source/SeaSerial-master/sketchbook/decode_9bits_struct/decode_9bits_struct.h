@@ -31,72 +31,140 @@
 struct auto_param_t
 {
     //autopilot parameters
-  volatile uint8_t rudder_gain; // [1-9]
-  volatile uint8_t counter_rudder; // [1-9]
-  volatile uint8_t rudder_limit; // [10-40]
-  volatile uint8_t turn_rate_speed; // [1-30]
-  volatile uint8_t speed; // [4-60]
-  volatile uint8_t off_course_limit; // [15-40]
-  volatile uint8_t trim; // [0-4]
-  volatile uint8_t power_steer; // On/OFF
-  volatile uint8_t drive_type; // {3,4,5} 
-  volatile uint8_t rudder_damping; //[1-9]
-  volatile int8_t variations;// [-30-30]
-  volatile uint8_t auto_adapt; // 0=Off, 1=North, 2=South
-  volatile uint8_t auto_adapt_latitude; // [0-80]
-  volatile bool auto_release; //on/off
-  volatile int8_t rudder_alignement; // [-7-7]
-  volatile uint8_t wind_trim; // [1-9]
-  volatile uint8_t response; // [1-9]
-  volatile uint8_t boat_type; //1=disp,2=semi-displ,3=plan,4=stern,5=work,6=sail
+  uint8_t rudder_gain; // [1-9]
+  uint8_t counter_rudder; // [1-9]
+  uint8_t rudder_limit; // [10-40]
+  uint8_t turn_rate_speed; // [1-30]
+  uint8_t speed; // [4-60]
+  uint8_t off_course_limit; // [15-40]
+  uint8_t trim; // [0-4]
+  uint8_t power_steer; // On/OFF
+  uint8_t drive_type; // {3,4,5} 
+  uint8_t rudder_damping; //[1-9]
+  int8_t variations;// [-30-30]
+  uint8_t auto_adapt; // 0=Off, 1=North, 2=South
+  uint8_t auto_adapt_latitude; // [0-80]
+  bool auto_release; //on/off
+  int8_t rudder_alignement; // [-7-7]
+  uint8_t wind_trim; // [1-9]
+  uint8_t response; // [1-9]
+  uint8_t boat_type; //1=disp,2=semi-displ,3=plan,4=stern,5=work,6=sail
   
   
   
-  volatile bool cal_lock; //on/off
-  volatile uint8_t tack_angle; //[40-125   
+  bool cal_lock; //on/off
+  uint8_t tack_angle; //[40-125   
 };
 
+//field groups, each one has its own timestamp in data_t::stamp
+#define GROUP_WIND 0      //apparent wind, wind alarms
+#define GROUP_DEPTH 1     //depth, water temperature
+#define GROUP_LOG 2       //water speed, trip, total
+#define GROUP_GPS 3       //position, ground speed and course, date and time
+#define GROUP_PILOT 4     //compass heading, rudder, autopilot state and parameters
+#define GROUP_STATUS 5    //alarms, lamps, flags
+#define NB_GROUPS 6
+
+//fixed point: angles in 1/10 degres, positions in 1/1000 minute (negative: south, west)
+//no volatile: the fields are only written between snapshot_write_begin/end
 struct data_t
 {
-  volatile float truewindspeed; //knots
-  volatile float apparentwindspeed; //knots
-  volatile float truewindangle; //degres
-  volatile float apparentwindangle; //knots/degres
-  volatile float depthwater; //meter
-  volatile float waterspeed; //knots
-  volatile float groundspeed; //knots
-  volatile float angle; // degres
-  volatile float trip, total; // in Nautile Milles
-  volatile float watertemp; //celsius
-  volatile float speeds1, speeds2; //knots
-  volatile uint8_t date_y,date_m,date_d; //dd/mm/yy
-  volatile uint8_t time_h, time_m, time_s; //GMT
-  volatile uint8_t lamp_intensity; //0,1,2 or 4
-  volatile bool mob_disable; //man over board
-  volatile uint8_t alarms; //various alarms
-  volatile uint8_t wind_alarms; //alarms on true/apparent wind, 
-                                // angle/speed, high or low
-                                
-  volatile float raw_latitude, raw_longitude; //degres
-  volatile float latitude, longitude; //degres
-  volatile float magnetic_course; // degres
-  volatile uint8_t n_sat; //number of satelites
-  volatile float compass_heading; //degres
-  volatile bool rudder_turning; //true: right, false: left
-  volatile bool turning; //true: right, false: left
-  volatile uint8_t autopilot_mode; // &1: automode &2: standbymode  &4: vane mode, &8: trackmod
-  volatile float autopilot_course;
-  volatile int rudder_direction; //degres (negatif: left) (positif: right)
-  volatile int rudder_gain;
-  volatile float stear_reference;
-  volatile bool st40_mode;//1=AUto mode, 0 locked mode
-  volatile bool temp_sensor_error; //
-  volatile uint8_t mil_sp_unit;
+  uint16_t apparentwindangle; //1/10 degres
+  uint16_t apparentwindspeed; //1/10 knots
+  uint8_t wind_alarms; //alarms on true/apparent wind, 
+                       // angle/speed, high or low
+
+  uint16_t depthwater; //cm
+  int16_t watertemp; //1/10 celsius
+
+  uint16_t waterspeed; //1/100 knots
+  uint16_t speeds1, speeds2; //1/100 knots
+  uint32_t trip; //1/100 nautical miles
+  uint32_t total; //1/10 nautical miles
+  uint8_t mil_sp_unit;
+
+  int32_t latitude, longitude; //1/1000 minute
+  uint16_t groundspeed; //1/100 knots
+  uint16_t magnetic_course; //1/10 degres
+  uint8_t date_y,date_m,date_d; //dd/mm/yy
+  uint8_t time_h, time_m, time_s; //GMT
+  uint8_t n_sat; //number of satelites
+
+  uint16_t compass_heading; //1/10 degres
+  uint16_t autopilot_course; //1/10 degres
+  uint16_t stear_reference; //1/10 degres
+  int8_t rudder_direction; //degres (negatif: left) (positif: right)
+  uint8_t rudder_gain;
+  uint8_t autopilot_mode; // &1: automode &2: standbymode  &4: vane mode, &8: trackmod
   auto_param_t autopilot;
-  //volatile uint8_t
-   
+
+  uint8_t alarms; //various alarms
+  uint8_t flags; //FLAG_xxx
+  uint8_t lamp_intensity; //0,1,2 or 3
+
+  uint8_t valid; //1 << GROUP_xxx: group received at least once
+  uint16_t stamp[NB_GROUPS]; //millis() >> STAMP_SHIFT of the last update
+};
+
+//stamps in 64ms units: 16 bits wrap after 70 minutes
+#define STAMP_SHIFT 6
+
+//age of a group in ms, now = millis()
+inline unsigned long group_age(const data_t& data, uint8_t group, unsigned long now)
+{
+  return ((unsigned long) (uint16_t) ((now >> STAMP_SHIFT) - data.stamp[group])) << STAMP_SHIFT;
+}
+
+/*
+* Sequence lock around data_t: one writer (the decoder), any number of readers,
+* none of them disables interrupts.
+* The writer makes seq odd, writes, makes it even again. A reader copies the
+* data and keeps the copy only if seq was even and did not change meanwhile.
+*/
+struct snapshot_t
+{
+  volatile uint8_t seq;
+  data_t data;
 };
 
+#define SNAPSHOT_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+inline void snapshot_write_begin(snapshot_t& s)
+{
+  s.seq++;
+  SNAPSHOT_BARRIER();
+}
+
+inline void snapshot_write_end(snapshot_t& s)
+{
+  SNAPSHOT_BARRIER();
+  s.seq++;
+}
+
+//one attempt, false if the writer was in the middle of an update: to be used
+//from an interrupt, which cannot wait for the writer it interrupted
+inline bool snapshot_try_read(const snapshot_t& s, data_t& out)
+{
+  uint8_t seq = s.seq;
+  if(seq & 1) return false;
+  SNAPSHOT_BARRIER();
+  memcpy(&out, &s.data, sizeof(out));
+  SNAPSHOT_BARRIER();
+  return s.seq == seq;
+}
+
+//retry until a consistent copy, when the writer can interrupt the reader
+inline void snapshot_read(const snapshot_t& s, data_t& out)
+{
+  while(!snapshot_try_read(s, out));
+}
+
+//1/1000 minute -> 1e-7 degres, the unit of the CAN frames
+inline int32_t min1000_to_e7(int32_t x)
+{
+  return x / 3 * 500 + x % 3 * 500 / 3;
+}
+
 
 float km_to_nm(float km)
 {
@@ -128,6 +196,13 @@ float mi_to_nm(float mph)
 #define ALARM_OFF_COURSE (1<<6)
 #define ALARM_WIND_SHIFT (1<<7)
 
+//on flags
+#define FLAG_TEMP_SENSOR_ERROR (1<<0)
+#define FLAG_MOB (1<<1) //man over board
+#define FLAG_RUDDER_TURNING (1<<2) //true: right, false: left
+#define FLAG_TURNING (1<<3) //true: right, false: left
+#define FLAG_ST40_AUTO (1<<4) //1=AUto mode, 0 locked mode
+
 //on mil_sp_unit
 #define UNIT_NM 0
 #define UNIT_SM 1
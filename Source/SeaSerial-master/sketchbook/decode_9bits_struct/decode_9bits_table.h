@@ -0,0 +1,295 @@
+/**
+	Romain Le Forestier
+ decodage des datagrammes SeaTalk par une table en PROGMEM au lieu d'un switch
+ une entree par commande (octet 0, trie pour la recherche dichotomique) avec la longueur attendue
+ (quartet bas de l'octet 1), le groupe de champs qu'elle met a jour et une suite d'operations:
+	- un terme ajoute a l'accumulateur: ((champ >> shr) & mask) * mul << shl, le champ etant un quartet,
+	  un octet ou un mot de 16 bits (poids faible ou poids fort en premier)
+	- une constante ajoutee a l'accumulateur
+	- SCALE: accumulateur * mul / 4096, pour les changements d'unite qui ne tombent pas juste
+	- IF: si (octet & mask) != valeur, les operations sont sautees jusqu'au STORE suivant compris
+	- NEG: si (octet & mask) == valeur, l'accumulateur change de signe
+	- STORE: ecrit l'accumulateur dans un champ de data_t (8, 16 ou 32 bits, bool, ou un bit d'un
+	  octet) puis le remet a 0
+ tout est en virgule fixe (unites dans decode_9bits_struct.h), les termes font la mise a l'echelle
+ l'ecriture se fait sous le verrou de sequence de snapshot_t, datagramme par datagramme
+ les formules sont celles de http://www.thomasknauf.de/seatalk.htm
+ a inclure une seule fois (depuis le .ino), comme decode_9bits_struct.h
+*/
+
+#ifndef DECODE_9BITS_TABLE_H
+#define DECODE_9BITS_TABLE_H
+
+#include <stddef.h>
+#include "decode_9bits_struct.h"
+
+//operation: quartet haut, index de l'octet dans le datagramme: quartet bas
+#define ST_NIBH   0x00 //quartet haut de l'octet
+#define ST_NIBL   0x10 //quartet bas de l'octet
+#define ST_BYTE   0x20
+#define ST_WORD   0x30 //octet i + octet i+1 * 256
+#define ST_WORDBE 0x40 //octet i * 256 + octet i+1
+#define ST_CONST  0x50
+#define ST_IF     0x60
+#define ST_NEG    0x70
+#define ST_STORE  0x80 //quartet bas: type du champ
+#define ST_SCALE  0x90
+
+//type du champ pour ST_STORE, les types signes s'ecrivent comme les non signes
+#define ST_U8    0
+#define ST_BOOL  1
+#define ST_U16   2
+#define ST_U32   3
+#define ST_BIT   4
+
+//pour ST_SCALE, en 1/4096
+#define SC_FEET10_CM 12485 //1/10 pied -> cm
+#define SC_MS_KNOT   7962  //m/s -> noeud
+
+struct st_op
+{
+  uint8_t code;
+  uint8_t a;    //mask du terme, de IF/NEG, ou position du champ pour STORE
+  uint8_t b;    //shr << 5 | shl du terme, valeur de IF/NEG, bit pour STORE
+  uint16_t mul; //multiplicateur du terme ou de SCALE, valeur (signee) de ST_CONST
+};
+
+struct st_datagram
+{
+  uint8_t cmd;
+  uint8_t len;  //groupe << 4 | longueur
+  uint8_t count;
+  const st_op *ops;
+};
+
+//data_t est adresse sur un octet
+static_assert(sizeof(data_t) <= 256, "data_t trop grand pour la table de decodage");
+
+#define T(kind, i, mask, shr, shl, mul) { (uint8_t) ((kind) | (i)), mask, (uint8_t) (((shr) << 5) | (shl)), mul }
+#define N(kind, i) T(kind, i, 0, 0, 0, 1)
+#define K(v) { ST_CONST, 0, 0, (uint16_t) (v) }
+#define SCALE(v) { ST_SCALE, 0, 0, v }
+#define IF(i, mask, v) { ST_IF | (i), mask, v, 0 }
+#define NEG(i, mask, v) { ST_NEG | (i), mask, v, 0 }
+#define STORE(type, field, b) { ST_STORE | (type), (uint8_t) offsetof(data_t, field), b, 0 }
+#define DATAGRAM(cmd, group, len, ops) { cmd, (group) << 4 | (len), sizeof(ops) / sizeof(ops[0]), ops }
+
+//cap en 1/10 degre: (U & 0x3) * 90 + (VW & 0x3F) * 2 + 1 par bit de U & 0xC
+#define COMPASS(store) T(ST_NIBH, 1, 0x3, 0, 0, 900), T(ST_BYTE, 2, 0x3F, 0, 0, 20), T(ST_NIBH, 1, 1, 2, 0, 10), \
+                       T(ST_NIBH, 1, 1, 3, 0, 10), store
+
+//profondeur XXXX/10 pied et alarmes
+static const st_op st_op_00[] PROGMEM = {
+  N(ST_WORD, 3), SCALE(SC_FEET10_CM), STORE(ST_U16, depthwater, 0),
+  T(ST_NIBH, 2, 0x8, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_ANCHOR_ALARAM),
+  T(ST_NIBH, 2, 0x4, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_METRIC_DISPLAY),
+  T(ST_NIBH, 2, 0x2, 0, 0, 1), STORE(ST_BIT, alarms, ALARAM_UNUSED),
+  T(ST_NIBL, 2, 0x4, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_TRANSDUCTER_DEFECTIVE),
+  T(ST_NIBL, 2, 0x2, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_DEPTH),
+  T(ST_NIBL, 2, 0x1, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_SHALLOW_DEPTH) };
+//angle du vent apparent XXYY/2
+static const st_op st_op_10[] PROGMEM = { T(ST_WORDBE, 2, 0, 0, 0, 5), STORE(ST_U16, apparentwindangle, 0) };
+//vitesse du vent apparent (XX & 0x7F) + Y/10, en m/s si XX & 0x80
+static const st_op st_op_11[] PROGMEM = {
+  IF(2, 0x80, 0x00), T(ST_BYTE, 2, 0x7F, 0, 0, 10), N(ST_NIBL, 3), STORE(ST_U16, apparentwindspeed, 0),
+  IF(2, 0x80, 0x80), T(ST_BYTE, 2, 0x7F, 0, 0, 10), N(ST_NIBL, 3), SCALE(SC_MS_KNOT),
+  STORE(ST_U16, apparentwindspeed, 0) };
+static const st_op st_op_20[] PROGMEM = { T(ST_WORD, 2, 0, 0, 0, 10), STORE(ST_U16, waterspeed, 0) };
+static const st_op st_op_21[] PROGMEM = { N(ST_WORD, 2), T(ST_NIBL, 4, 0, 0, 16, 1), STORE(ST_U32, trip, 0) };
+static const st_op st_op_22[] PROGMEM = { N(ST_WORD, 2), STORE(ST_U32, total, 0) };
+//temperature de l'eau, capteur debranche si Z & 4
+static const st_op st_op_23[] PROGMEM = {
+  IF(1, 0x40, 0x00), T(ST_BYTE, 2, 0, 0, 0, 10), STORE(ST_U16, watertemp, 0),
+  T(ST_NIBH, 1, 0x4, 0, 0, 1), STORE(ST_BIT, flags, FLAG_TEMP_SENSOR_ERROR) };
+static const st_op st_op_24[] PROGMEM = {
+  IF(4, 0xFF, 0x00), K(UNIT_NM), STORE(ST_U8, mil_sp_unit, 0),
+  IF(4, 0xFF, 0x06), K(UNIT_SM), STORE(ST_U8, mil_sp_unit, 0),
+  IF(4, 0xFF, 0x86), K(UNIT_KM), STORE(ST_U8, mil_sp_unit, 0) };
+//total (XX + YY * 256 + Z * 65536) / 10 (Knauf ecrit 4096 mais donne un max de 104857.5), trip (UUVV + W * 65536) / 100
+static const st_op st_op_25[] PROGMEM = {
+  N(ST_WORD, 2), T(ST_NIBH, 1, 0, 0, 16, 1), STORE(ST_U32, total, 0),
+  N(ST_WORD, 4), T(ST_NIBL, 6, 0, 0, 16, 1), STORE(ST_U32, trip, 0) };
+//vitesse du capteur 1 si D & 4, moyenne sauf si le calcul est arrete (E & 1)
+static const st_op st_op_26[] PROGMEM = {
+  IF(6, 0x40, 0x40), N(ST_WORD, 2), STORE(ST_U16, speeds1, 0),
+  IF(6, 0x01, 0x00), N(ST_WORD, 4), STORE(ST_U16, speeds2, 0) };
+static const st_op st_op_27[] PROGMEM = { N(ST_WORD, 2), K(-100), STORE(ST_U16, watertemp, 0) };
+//eclairage 0x0, 0x4, 0x8 ou 0xC -> 0 a 3
+static const st_op st_op_30[] PROGMEM = { T(ST_BYTE, 2, 0x3, 2, 0, 1), STORE(ST_U8, lamp_intensity, 0) };
+//fin de l'homme a la mer
+static const st_op st_op_36[] PROGMEM = { K(0), STORE(ST_BIT, flags, FLAG_MOB) };
+//XX degre + (YYYY & 0x7FFF) / 100 minute, sud si YYYY & 0x8000
+static const st_op st_op_50[] PROGMEM = {
+  T(ST_BYTE, 2, 0, 0, 0, 60000), T(ST_BYTE, 3, 0, 0, 0, 10), T(ST_BYTE, 4, 0x7F, 0, 8, 10), NEG(4, 0x80, 0x80),
+  STORE(ST_U32, latitude, 0) };
+//est si YYYY & 0x8000
+static const st_op st_op_51[] PROGMEM = {
+  T(ST_BYTE, 2, 0, 0, 0, 60000), T(ST_BYTE, 3, 0, 0, 0, 10), T(ST_BYTE, 4, 0x7F, 0, 8, 10), NEG(4, 0x80, 0x00),
+  STORE(ST_U32, longitude, 0) };
+static const st_op st_op_52[] PROGMEM = { T(ST_WORD, 2, 0, 0, 0, 10), STORE(ST_U16, groundspeed, 0) };
+//route magnetique (U & 0x3) * 90 + (VW & 0x3F) * 2 + (U & 0xC) / 8
+static const st_op st_op_53[] PROGMEM = {
+  T(ST_NIBH, 1, 0x3, 0, 0, 900), T(ST_BYTE, 2, 0x3F, 0, 0, 20), T(ST_NIBH, 1, 0x3, 2, 0, 5),
+  STORE(ST_U16, magnetic_course, 0) };
+//heure GMT: secondes RST & 0x3F, minutes RS >> 2, heures HH
+static const st_op st_op_54[] PROGMEM = {
+  N(ST_NIBH, 1), T(ST_BYTE, 2, 0x3, 0, 4, 1), STORE(ST_U8, time_s, 0),
+  T(ST_BYTE, 2, 0x3F, 2, 0, 1), STORE(ST_U8, time_m, 0),
+  N(ST_BYTE, 3), STORE(ST_U8, time_h, 0) };
+static const st_op st_op_56[] PROGMEM = {
+  N(ST_NIBH, 1), STORE(ST_U8, date_m, 0),
+  N(ST_BYTE, 2), STORE(ST_U8, date_d, 0),
+  N(ST_BYTE, 3), STORE(ST_U8, date_y, 0) };
+static const st_op st_op_57[] PROGMEM = { N(ST_NIBH, 1), STORE(ST_U8, n_sat, 0) };
+//position du gps LA degre + XXYY / 1000 minute, sud si Z & 1, LO degre + QQRR / 1000 minute, est si Z & 2
+static const st_op st_op_58[] PROGMEM = {
+  T(ST_BYTE, 2, 0, 0, 0, 60000), N(ST_WORDBE, 3), NEG(1, 0x10, 0x10), STORE(ST_U32, latitude, 0),
+  T(ST_BYTE, 5, 0, 0, 0, 60000), N(ST_WORDBE, 6), NEG(1, 0x20, 0x00), STORE(ST_U32, longitude, 0) };
+static const st_op st_op_66[] PROGMEM = { N(ST_BYTE, 2), STORE(ST_U8, wind_alarms, 0) };
+//cap compas, cap du pilote (V & 0xC) * 90 / 4 + XY / 2, mode, alarmes, barre
+static const st_op st_op_84[] PROGMEM = {
+  COMPASS(STORE(ST_U16, compass_heading, 0)),
+  T(ST_NIBH, 1, 0x8, 0, 0, 1), STORE(ST_BIT, flags, FLAG_RUDDER_TURNING),
+  T(ST_BYTE, 2, 0x3, 6, 0, 900), T(ST_BYTE, 3, 0, 0, 0, 5), STORE(ST_U16, autopilot_course, 0),
+  T(ST_NIBL, 4, 0, 0, 0, 1), STORE(ST_U8, autopilot_mode, 0),
+  T(ST_BYTE, 5, 0x4, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_OFF_COURSE),
+  T(ST_BYTE, 5, 0x8, 0, 0, 1), STORE(ST_BIT, alarms, ALARM_WIND_SHIFT),
+  N(ST_BYTE, 6), STORE(ST_U8, rudder_direction, 0) };
+//parametre WW du pilote
+#define AUTOPILOT(w, type, field) IF(2, 0xFF, w), N(ST_BYTE, 3), STORE(type, autopilot.field, 0)
+static const st_op st_op_88[] PROGMEM = {
+  AUTOPILOT(0x01, ST_U8, rudder_gain),
+  AUTOPILOT(0x02, ST_U8, counter_rudder),
+  AUTOPILOT(0x03, ST_U8, rudder_limit),
+  AUTOPILOT(0x04, ST_U8, turn_rate_speed),
+  AUTOPILOT(0x05, ST_U8, speed),
+  AUTOPILOT(0x06, ST_U8, off_course_limit),
+  AUTOPILOT(0x07, ST_U8, trim),
+  AUTOPILOT(0x09, ST_U8, power_steer),
+  AUTOPILOT(0x0A, ST_U8, drive_type),
+  AUTOPILOT(0x0B, ST_U8, rudder_damping),
+  AUTOPILOT(0x0C, ST_U8, variations),
+  AUTOPILOT(0x0D, ST_U8, auto_adapt),
+  AUTOPILOT(0x0E, ST_U8, auto_adapt_latitude),
+  AUTOPILOT(0x0F, ST_BOOL, auto_release),
+  AUTOPILOT(0x10, ST_U8, rudder_alignement),
+  AUTOPILOT(0x11, ST_U8, wind_trim),
+  AUTOPILOT(0x12, ST_U8, response),
+  AUTOPILOT(0x13, ST_U8, boat_type),
+  AUTOPILOT(0x15, ST_BOOL, cal_lock),
+  AUTOPILOT(0x1D, ST_U8, tack_angle) };
+//cap du ST40 (U & 0x3) * 90 + (VW & 0x3F) * 2 + (U & 0xC) / 2, reference de barre, mode
+static const st_op st_op_89[] PROGMEM = {
+  T(ST_NIBH, 1, 0x3, 0, 0, 900), T(ST_BYTE, 2, 0x3F, 0, 0, 20), T(ST_NIBH, 1, 0x3, 2, 0, 20),
+  STORE(ST_U16, compass_heading, 0),
+  T(ST_BYTE, 2, 0x3, 6, 0, 900), T(ST_BYTE, 3, 0, 0, 0, 5), STORE(ST_U16, stear_reference, 0),
+  T(ST_NIBL, 4, 0x2, 0, 0, 1), STORE(ST_BIT, flags, FLAG_ST40_AUTO) };
+static const st_op st_op_90[] PROGMEM = { N(ST_BYTE, 2), STORE(ST_U8, rudder_gain, 0) };
+//cap compas, sens de rotation et barre
+static const st_op st_op_9C[] PROGMEM = {
+  COMPASS(STORE(ST_U16, compass_heading, 0)),
+  T(ST_NIBH, 1, 0x8, 0, 0, 1), STORE(ST_BIT, flags, FLAG_TURNING),
+  N(ST_BYTE, 3), STORE(ST_U8, rudder_direction, 0) };
+
+//trie par commande
+static const st_datagram st_datagrams[] PROGMEM = {
+  DATAGRAM(0x00, GROUP_DEPTH, 2, st_op_00),
+  DATAGRAM(0x10, GROUP_WIND, 1, st_op_10),
+  DATAGRAM(0x11, GROUP_WIND, 1, st_op_11),
+  DATAGRAM(0x20, GROUP_LOG, 1, st_op_20),
+  DATAGRAM(0x21, GROUP_LOG, 2, st_op_21),
+  DATAGRAM(0x22, GROUP_LOG, 2, st_op_22),
+  DATAGRAM(0x23, GROUP_DEPTH, 1, st_op_23),
+  DATAGRAM(0x24, GROUP_LOG, 2, st_op_24),
+  DATAGRAM(0x25, GROUP_LOG, 4, st_op_25),
+  DATAGRAM(0x26, GROUP_LOG, 4, st_op_26),
+  DATAGRAM(0x27, GROUP_DEPTH, 1, st_op_27),
+  DATAGRAM(0x30, GROUP_STATUS, 0, st_op_30),
+  DATAGRAM(0x36, GROUP_STATUS, 0, st_op_36),
+  DATAGRAM(0x50, GROUP_GPS, 2, st_op_50),
+  DATAGRAM(0x51, GROUP_GPS, 2, st_op_51),
+  DATAGRAM(0x52, GROUP_GPS, 1, st_op_52),
+  DATAGRAM(0x53, GROUP_GPS, 0, st_op_53),
+  DATAGRAM(0x54, GROUP_GPS, 1, st_op_54),
+  DATAGRAM(0x56, GROUP_GPS, 1, st_op_56),
+  DATAGRAM(0x57, GROUP_GPS, 0, st_op_57),
+  DATAGRAM(0x58, GROUP_GPS, 5, st_op_58),
+  { 0x59, GROUP_STATUS << 4 | 2, 0, NULL }, //compte a rebours du ST60, rien a garder
+  DATAGRAM(0x66, GROUP_WIND, 0, st_op_66),
+  DATAGRAM(0x84, GROUP_PILOT, 6, st_op_84),
+  DATAGRAM(0x88, GROUP_PILOT, 3, st_op_88),
+  DATAGRAM(0x89, GROUP_PILOT, 2, st_op_89),
+  DATAGRAM(0x90, GROUP_PILOT, 0, st_op_90),
+  DATAGRAM(0x9C, GROUP_PILOT, 1, st_op_9C) };
+
+#define ST_NB_DATAGRAMS (sizeof(st_datagrams) / sizeof(st_datagrams[0]))
+
+//decode frame dans la copie partagee, now = millis()
+//retourne la commande ou -1 si elle est inconnue ou la longueur fausse
+static int decode_table(snapshot_t& snapshot, const uint8_t *frame, unsigned long now)
+{
+  st_datagram d;
+  st_op op;
+  uint8_t lo = 0, hi = ST_NB_DATAGRAMS, mid, cmd = frame[0], group;
+  int32_t acc = 0, raw;
+  bool skip = false;
+  uint8_t *p;
+
+  while(lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if(pgm_read_byte(&st_datagrams[mid].cmd) < cmd) lo = mid + 1;
+    else hi = mid;
+  }
+  if(lo == ST_NB_DATAGRAMS) return -1;
+  memcpy_P(&d, &st_datagrams[lo], sizeof(d));
+  if(d.cmd != cmd || (d.len & 0x0F) != (frame[1] & 0x0F)) return -1;
+  group = d.len >> 4;
+
+  snapshot_write_begin(snapshot);
+  for(uint8_t k = 0; k < d.count; k++)
+  {
+    //operations sautees par IF: seul le code est lu
+    if(skip)
+    {
+      if((pgm_read_byte(&d.ops[k].code) & 0xF0) == ST_STORE) skip = false;
+      continue;
+    }
+    memcpy_P(&op, &d.ops[k], sizeof(op));
+    const uint8_t *f = frame + (op.code & 0x0F);
+    uint8_t kind = op.code & 0xF0;
+    switch(kind)
+    {
+      case ST_NIBH: raw = f[0] >> 4; break;
+      case ST_NIBL: raw = f[0] & 0x0F; break;
+      case ST_BYTE: raw = f[0]; break;
+      case ST_WORD: raw = f[0] | ((uint16_t) f[1] << 8); break;
+      case ST_WORDBE: raw = ((uint16_t) f[0] << 8) | f[1]; break;
+      case ST_CONST: acc += (int16_t) op.mul; continue;
+      case ST_SCALE: acc = (acc * op.mul + 2048) >> 12; continue;
+      case ST_IF: skip = (f[0] & op.a) != op.b; continue;
+      case ST_NEG: if((f[0] & op.a) == op.b) acc = -acc; continue;
+      default: //ST_STORE
+        p = (uint8_t *) &snapshot.data + op.a;
+        switch(op.code & 0x0F)
+        {
+          case ST_U8: *p = (uint8_t) acc; break;
+          case ST_BOOL: *p = acc != 0; break;
+          case ST_U16: *(uint16_t *) p = (uint16_t) acc; break;
+          case ST_U32: *(uint32_t *) p = (uint32_t) acc; break;
+          case ST_BIT: if(acc) *p |= op.b; else *p &= ~op.b; break;
+        }
+        acc = 0;
+        continue;
+    }
+    raw >>= op.b >> 5;
+    if(op.a) raw &= op.a;
+    acc += (raw * op.mul) << (op.b & 0x1F);
+  }
+  snapshot.data.stamp[group] = (uint16_t) (now >> STAMP_SHIFT);
+  snapshot.data.valid |= 1 << group;
+  snapshot_write_end(snapshot);
+  return cmd;
+}
+
+#endif
@@ -28,29 +28,96 @@
 SeaSerial::SeaSerial(HardwareSerial& s,uint16_t bauds, uint16_t flag) : serial(s)
 {
   size=0;
+  rx_pos=0;
+  rx_size=0;
+  rx_last=0;
+  rx_start=0;
+  time=0;
+  framed=false;
+  discarded=0;
+  resyncs=0;
+  timeouts=0;
   serial.begin(4800,SERIAL_9N1);
 }
 
+/*
+* Abandon the partial datagram
+*/
+void SeaSerial::drop()
+{
+  discarded+=rx_pos;
+  rx_pos=0;
+}
 
 /*
-* Read the next frame from serial
+* Read the characters already received, without waiting.
+* Return the size of the datagram when one is complete (then available with
+* get_frame() until the next complete one, its arrival time with get_time()),
+* 0 otherwise.
+* A character with the command bit always starts a new datagram, so a
+* truncated datagram or noise costs only itself.
 */
-size_t SeaSerial::next_frame()
+size_t SeaSerial::poll()
 {
-    size=19; //max size + 1
-    int i=0;
-   while(i!=(size))
+#ifdef HARDWARESERIAL_FRAMES
+  if(framed)
+  {
+    int n=serial.readFrame(frame,&time);
+    if(n>0) size=n;
+    return n>0?n:0;
+  }
+#endif
+  while(serial.available())
+  {
+    uint16_t c=serial.read(); //Next 9 bit charater
+    rx_last=micros();
+    if(c&0x100)
     {
-        if(serial.available())
-        {
-          uint16_t c=serial.read(); //Next 9 bit charater
-          if(i==0 &&  (c&0x100 )==0) continue; //Beginning of the datagram
-          else if(i==1)    size=(c&0x0f)+3; //Size is the lowest part of second character
-          frame[i]=(uint8_t)c;
-          i++;
-        }
+      if(rx_pos)
+      {
+        resyncs++;
+        drop();
+      }
+      if(c==SEASERIAL_NOISE)
+      {
+        discarded++;
+        continue;
+      }
     }
-    return size;
+    else if(rx_pos==0)
+    {
+      discarded++; //Beginning of the datagram not seen
+      continue;
+    }
+    if(rx_pos==0) rx_start=rx_last;
+    if(rx_pos==1) rx_size=(c&0x0f)+3; //Size is the lowest part of second character
+    rx[rx_pos++]=(uint8_t)c;
+    if(rx_pos>1 && rx_pos==rx_size)
+    {
+      memcpy(frame,rx,rx_size);
+      size=rx_size;
+      time=rx_start;
+      rx_pos=0;
+      return size;
+    }
+  }
+  // Only once the buffer is empty: characters waiting since a late call are not late
+  if(rx_pos && micros()-rx_last>SEASERIAL_CHAR_TIMEOUT_US)
+  {
+    timeouts++;
+    drop();
+  }
+  return 0;
+}
+
+/*
+* Read the next frame from serial, wait until it is complete
+*/
+size_t SeaSerial::next_frame()
+{
+  size_t n;
+  while((n=poll())==0);
+  return n;
 }
 
 /*
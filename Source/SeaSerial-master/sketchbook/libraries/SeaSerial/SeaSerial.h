@@ -22,17 +22,45 @@
 
 #include <HardwareSerial.h>
 
+#define SEASERIAL_MAX_FRAME 18
+// 0x1FF is not a command: line noise seen on the ST6002 bus
+#define SEASERIAL_NOISE 0x1FF
+// Max gap between two characters of a datagram: a character lasts 11 bits
+// (2.3ms) at 4800 bauds, talkers send a datagram back to back
+#define SEASERIAL_CHAR_TIMEOUT_US 10000UL
+
 class SeaSerial
 {
   private:
-    uint8_t frame[18];
+    uint8_t frame[SEASERIAL_MAX_FRAME];
     size_t size;
     HardwareSerial& serial;
 
+    // Partial datagram, kept between calls to poll()
+    uint8_t rx[SEASERIAL_MAX_FRAME];
+    uint8_t rx_pos;
+    uint8_t rx_size;
+    unsigned long rx_last;
+    unsigned long rx_start; // micros() at the command character of the datagram in rx
+    unsigned long time;     // same, for the datagram in frame
+    bool framed;            // datagrams framed by the receive interrupt
+
+    void drop();
 
   public:
+    // Statistics, since power up
+    uint16_t discarded; // characters thrown away (no command yet, noise, truncated datagram)
+    uint16_t resyncs;   // partial datagrams abandoned on a command character
+    uint16_t timeouts;  // partial datagrams abandoned after SEASERIAL_CHAR_TIMEOUT_US
+
     SeaSerial(HardwareSerial& =Serial1,uint16_t bauds=4800, uint16_t=SERIAL_9N1);
+    size_t poll();
     size_t next_frame();
+#ifdef HARDWARESERIAL_FRAMES
+    // Let the receive interrupt frame the datagrams in q (see HardwareSerial::beginFrames)
+    void use_frames(frame_queue& q) { serial.beginFrames(&q); framed=true; }
+#endif
+    unsigned long get_time() { return time; }
     size_t get_size();
     char* get_frame();
     void write_frame();
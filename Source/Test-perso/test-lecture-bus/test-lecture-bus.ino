@@ -1,25 +1,49 @@
 //Programme permettant de lire  le message seatalk,
 //nécessite une carte arduino mega 
 //la librairie Hardwareserial modifié doit etre installer
+//l'interruption de reception decoupe les datagrammes (mode trame): on affiche l'heure d'arrivee
+//de la commande en us, l'ecart avec le datagramme precedent puis les octets
+
+frame_queue trames;
+unsigned long precedent = 0;
+uint8_t perdus = 0, coupes = 0;
 
 void setup() {
   // put your setup code here, to run once:
   Serial.begin(9600);
   Serial2.begin(4800, SERIAL_9N1);
+  Serial2.beginFrames(&trames);
 }
 
 void loop() {
   // put your main code here, to run repeatedly:
-  int c;
+  uint8_t data[SEATALK_FRAME_MAX];
+  unsigned long us;
+  int n, i;
   
-  if(Serial2.available())
+  n = Serial2.readFrame(data, &us);
+  if(n > 0)
   {
-    c = Serial2.read();
-    if(c >= 0x100)
+    Serial.print(us);
+    Serial.print(" +");
+    Serial.print(us - precedent);
+    Serial.print(" :");
+    precedent = us;
+    for(i = 0; i < n; i++)
     {
-      Serial.println("");
+      Serial.print(" ");
+      Serial.print(data[i], HEX);
     }
-     Serial.print(c,HEX);
-     Serial.print(" ");
+    Serial.println("");
+  }
+  //datagrammes perdus (file pleine) ou coupes par la commande suivante
+  if(trames.dropped != perdus || trames.truncated != coupes)
+  {
+    perdus = trames.dropped;
+    coupes = trames.truncated;
+    Serial.print("perdus ");
+    Serial.print(perdus);
+    Serial.print(" coupes ");
+    Serial.println(coupes);
   }
 }
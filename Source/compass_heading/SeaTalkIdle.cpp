@@ -0,0 +1,202 @@
+#include "Arduino.h"
+#include "SeaTalkIdle.h"
+
+#define SEATALK_IDLE_MAX_AGE 0x40000000UL  //au dela (9 minutes) le repos n'augmente plus: pas de retour a 0 a 2^32
+
+static SeaTalk_Idle * capture = NULL;
+
+#if defined(TIMER5_CAPT_vect)
+static volatile unsigned int overflows = 0;
+
+//date sur 32 bits d'une valeur du timer, interruptions coupees: un debordement pas encore compte
+//s'est produit avant une valeur basse
+static unsigned long stamp(unsigned int t)
+{
+	unsigned int high = overflows;
+	if((TIFR5 & _BV(TOV5)) && t < 0x8000)
+	{
+		high++;
+	}
+	return ((unsigned long) high << 16) | t;
+}
+
+ISR(TIMER5_CAPT_vect)
+{
+	unsigned long t = stamp(ICR5);
+	if(capture != NULL)
+	{
+		capture->edge(t);
+	}
+}
+
+ISR(TIMER5_OVF_vect)
+{
+	overflows++;
+	if(capture != NULL)
+	{
+		capture->age(stamp(TCNT5));
+	}
+}
+#endif
+
+SeaTalk_Idle::SeaTalk_Idle()
+	: chars(0), last_start(0), started(false)
+{
+	clear_histogram();
+}
+
+bool SeaTalk_Idle::begin(void)
+{
+#if defined(TIMER5_CAPT_vect)
+	uint8_t oldSREG = SREG;
+	pinMode(48, INPUT);
+	cli();
+	TCCR5A = 0;
+	TCCR5B = _BV(ICNC5) | _BV(CS51);   //filtre, front descendant, horloge / 8
+	TCNT5 = 0;
+	overflows = 0;
+	TIFR5 = _BV(ICF5) | _BV(TOV5);
+	//ligne au repos depuis un caractere fictif qui vient de finir
+	last_start = stamp(0) - SEATALK_IDLE_CHAR_TICKS;
+	started = false;
+	capture = this;
+	TIMSK5 = _BV(ICIE5) | _BV(TOIE5);
+	SREG = oldSREG;
+	return true;
+#else
+	last_start = now_ticks() - SEATALK_IDLE_CHAR_TICKS;
+	started = false;
+	capture = this;
+	return false;
+#endif
+}
+
+unsigned long SeaTalk_Idle::now_ticks(void)
+{
+#if defined(TIMER5_CAPT_vect)
+	uint8_t oldSREG = SREG;
+	unsigned long t;
+	cli();
+	t = stamp(TCNT5);
+	SREG = oldSREG;
+	return t;
+#else
+	return micros() * SEATALK_IDLE_TICK_PER_US;
+#endif
+}
+
+void SeaTalk_Idle::age(unsigned long ticks)
+{
+	if(ticks - last_start > SEATALK_IDLE_MAX_AGE)
+	{
+		last_start = ticks - SEATALK_IDLE_MAX_AGE;
+	}
+}
+
+void SeaTalk_Idle::edge(unsigned long ticks)
+{
+	unsigned long gap, bits;
+	unsigned char bin;
+
+	//front dans le caractere en cours
+	if(ticks - last_start < SEATALK_IDLE_START_TICKS)
+	{
+		return;
+	}
+	//bit de start: repos depuis la fin du caractere precedent
+	gap = ticks - last_start - SEATALK_IDLE_CHAR_TICKS;
+	if((long) gap < 0)
+	{
+		gap = 0;                      //start un peu en avance sur 11 bits: horloges des emetteurs
+	}
+	last_start = ticks;
+	chars++;
+	if(!started)
+	{
+		started = true;
+		return;
+	}
+	if(gap >= 1024UL * SEATALK_IDLE_BIT_TICKS)
+	{
+		bin = SEATALK_IDLE_HISTO - 1;
+	}
+	else
+	{
+		bits = ((gap + SEATALK_IDLE_BIT_TICKS / 2) * 157) >> 16;  //gap / 417 arrondi, sans division
+		if(bits < 8)
+		{
+			bin = bits;
+		}
+		else
+		{
+			for(bin = 5; bits > 1; bits >>= 1)
+			{
+				bin++;
+			}
+		}
+	}
+	if(histogram[bin] != 0xFFFF)
+	{
+		histogram[bin]++;
+	}
+}
+
+unsigned long SeaTalk_Idle::idle_us(void)
+{
+	unsigned long now = now_ticks();
+	unsigned long since;
+	uint8_t oldSREG = SREG;
+
+	cli();
+	since = now - last_start;
+	SREG = oldSREG;
+	if(since <= SEATALK_IDLE_CHAR_TICKS || (long) since < 0)
+	{
+		return 0;
+	}
+	return (since - SEATALK_IDLE_CHAR_TICKS) / SEATALK_IDLE_TICK_PER_US;
+}
+
+unsigned int SeaTalk_Idle::bin_bits(unsigned char bin)
+{
+	if(bin < 8)
+	{
+		return bin;
+	}
+	return 1U << (bin - 5);
+}
+
+void SeaTalk_Idle::clear_histogram(void)
+{
+	unsigned char i;
+	uint8_t oldSREG = SREG;
+
+	cli();
+	for(i = 0; i < SEATALK_IDLE_HISTO; i++)
+	{
+		histogram[i] = 0;
+	}
+	SREG = oldSREG;
+}
+
+void SeaTalk_Idle::print_histogram(HardwareSerial * debug)
+{
+	unsigned char i;
+	unsigned int n;
+	uint8_t oldSREG;
+
+	for(i = 0; i < SEATALK_IDLE_HISTO; i++)
+	{
+		oldSREG = SREG;
+		cli();
+		n = histogram[i];
+		SREG = oldSREG;
+		if(n == 0)
+		{
+			continue;
+		}
+		debug->print(bin_bits(i));
+		debug->print(i == SEATALK_IDLE_HISTO - 1 ? "+ bits: " : " bits: ");
+		debug->println(n);
+	}
+}
@@ -0,0 +1,65 @@
+/**
+*	Romain Le Forestier
+*	Seatalk - arduino
+*	repos de la ligne SeaTalk mesure par la capture du timer 5 de la Mega (ICP5, broche 48)
+**/
+
+//la broche 48 (ICP5, PL1) n'est reliee a rien sur la carte: il faut un cavalier entre la broche 48 et la
+//broche de reception du bus (RX2, broche 17, PH0, apres l'optocoupleur)
+//sans cavalier aucun front n'est capture et idle_us() voit la ligne toujours au repos: begin() ne peut pas
+//le savoir, c'est SeaTalk_TX qui le detecte (octets lus sans bit de start capture) et n'utilise plus le detecteur
+//chaque front descendant est capture a 0,5us pres; un front a plus de 10 bits du dernier bit de start
+//est le bit de start d'un nouveau caractere, qui finit 11 bits plus tard (start, 8 bits, commande, stop):
+//le repos est le temps depuis la fin du bit de stop du dernier caractere, sans attendre que loop()
+//ait lu les octets
+//le timer 5 n'est plus disponible (Servo l'utilise en premier sur la Mega)
+//
+//exemple d'utilisation:
+//	SeaTalk_Idle ligne;
+//	ligne.begin();
+//	seatalk_tx.set_idle(&ligne);     //SeaTalk_TX emet des que le repos atteint SEATALK_IDLE_US
+//	ligne.print_histogram(&Serial);  //repos mesures entre deux caracteres, pour regler SEATALK_IDLE_US
+
+#ifndef _SEATALKIDLE_
+#define _SEATALKIDLE_
+
+#include <HardwareSerial.h>
+
+#define SEATALK_IDLE_TICK_PER_US 2                     //timer 5 a 16MHz / 8
+#define SEATALK_IDLE_BIT_TICKS 417                     //1 bit a 4800 bauds
+#define SEATALK_IDLE_CHAR_TICKS 4583                   //11 bits
+#define SEATALK_IDLE_START_TICKS (10 * SEATALK_IDLE_BIT_TICKS) //dernier front possible d'un caractere: 9 bits apres le start
+#define SEATALK_IDLE_HISTO 16                          //cases de l'histogramme
+
+class SeaTalk_Idle
+{
+	public:
+		SeaTalk_Idle();
+		//timer 5 en capture sur front descendant, false si la carte n'a pas de timer 5
+		bool begin(void);
+		//temps depuis la fin du dernier caractere en microseconde, 0 si un caractere est en cours
+		unsigned long idle_us(void);
+
+		//repos entre deux caracteres, en bits: cases 0 a 7 pour 0 a 7 bits (0: caracteres colles,
+		//dans un datagramme), puis 8-15, 16-31 ... 512-1023, 1024 et plus (entre deux rafales)
+		volatile unsigned int histogram[SEATALK_IDLE_HISTO];
+		//borne basse de la case en bits
+		static unsigned int bin_bits(unsigned char bin);
+		void clear_histogram(void);
+		void print_histogram(HardwareSerial * debug);
+
+		volatile unsigned long chars;  //bits de start vus
+
+		//front descendant a la date ticks (1/SEATALK_IDLE_TICK_PER_US us), appele par l'isr de capture
+		void edge(unsigned long ticks);
+		//debordement du timer: un long repos ne repasse pas par 0 quand la date fait le tour des 32 bits
+		void age(unsigned long ticks);
+		//date courante dans la meme unite
+		static unsigned long now_ticks(void);
+
+	private:
+		volatile unsigned long last_start;
+		volatile bool started;         //au moins un caractere depuis begin(): le repos suivant va dans l'histogramme
+};
+
+#endif
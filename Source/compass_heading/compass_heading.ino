@@ -1,7 +1,16 @@
+#include "SeaTalkIdle.h"
 
 const int led = 13;
 boolean state = false;
 
+//repos du bus avant d'emettre: 10 bits a 4800 bauds (SEATALK_IDLE_US de Seatalk_api)
+#define REPOS_US (10 * 208)
+//repos mesure par le timer 5: cavalier a ajouter entre la broche 48 et RX2 (broche 17)
+//sans cavalier le detecteur voit la ligne toujours au repos, la date du dernier octet lu garde la main
+SeaTalk_Idle ligne;
+boolean ligne_ok = false;
+unsigned long derniere_lecture = 0;
+
 void setup() 
 {
   volatile 
@@ -11,6 +20,7 @@ void setup()
   Serial1.begin(4800, SERIAL_9N1);
   Serial2.begin(4800, SERIAL_9N1);
   while(!Serial1){};
+  ligne_ok = ligne.begin();
   
   pinMode(led, OUTPUT);
   digitalWrite(led, LOW);
@@ -45,6 +55,7 @@ void loop()
   {
       volatile uint16_t c_lecture;
       c_lecture = Serial2.read();
+      derniere_lecture = micros();
 	  if (c_lecture >= 0x100)
 	  {
 		Serial.println("");
@@ -52,8 +63,10 @@ void loop()
       Serial.print(c_lecture,HEX);
       Serial.print(' ');
   }
-  //on emet toute les seconde et seulement quand le bus est libre
-  if(timer_emit <= time && Serial2.available() ==  0)
+  //on emet toute les seconde et seulement quand le bus est libre: rien en attente, REPOS_US depuis le
+  //dernier octet lu et depuis la fin du dernier bit de stop vu par le detecteur
+  if(timer_emit <= time && Serial2.available() ==  0 && micros() - derniere_lecture >= REPOS_US
+     && (!ligne_ok || ligne.idle_us() >= REPOS_US))
   {
     uint16_t c_ecriture, c_lecture;
     timer_emit = timer_emit + 1000;
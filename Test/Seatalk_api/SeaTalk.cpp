@@ -2,188 +2,137 @@
 #include "SeaTalk.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 SeaTalk_API::SeaTalk_API()
+	: line(NULL)
 {
 }
 
+void SeaTalk_API::set_idle(SeaTalk_Idle * detector)
+{
+	line = detector;
+}
+
 //on a besoin d'un pointeur ver le port serie utilise pour envoyer les valeurs
 //buffout est un buffer suffisament gros pour enregistrer tout les message qui on circuler avant l'envoi du message
 int SeaTalk_API::send_bouton_value(HardwareSerial * serial_write, HardwareSerial * serial_read, int val, char buffout[])
 {
-	int i,j;
-	//on test que le port soit libre avant d'envoyer le message
-	//si message dans le buffer available != 0
-	if((*serial_read).available() != 0)
+	//on attend que le bus soit libre avant d'envoyer le message: plus aucun octet depuis SEATALK_IDLE_US
+	//(10 bits a 4800 bauds, 2,08 millisecond), les octets lus sont gardes dans buffout
+	//on compte depuis la lecture du dernier octet; avec le detecteur de repos il faut en plus SEATALK_IDLE_US
+	//depuis la fin du bit de stop, un caractere pas encore lu retarde l'envoi
+	unsigned int readchar = 0;
+	unsigned long last = micros();
+	while((line != NULL && line->idle_us() < SEATALK_IDLE_US) || micros() - last < SEATALK_IDLE_US)
 	{
-		unsigned int readchar = 0;
-		//si il ne l'ai pas, on vide le cache de message et on attend 10/4800 s soi 2,08 millisecond
-		//pour que le bus soit considÃƒÂ©rÃƒÂ© comme libre
-		unsigned char libre = 0;
-		while(!libre)
+		if((*serial_read).available() != 0)
 		{
-			buffout[readchar] = (*serial_read).read(); //on lit un char du buffer pour le vider
+			buffout[readchar] = (*serial_read).read();
 			readchar++;
-			//si plus de char dans le buffer, le bus est libre
-			if((*serial_read).available() == 0)
-			{
-				//on attend 2ms pour que le bus soit considerer comme libre
-				delay(2);
-				//si le bus est encore libre, on peux commencer a emetre
-				if((*serial_read).available() == 0)
-				{
-					libre = 1;
-					buffout[readchar] = '\0';
-				}
-			}
+			last = micros();
 		}
 	}
-	if(val < 0)
+	buffout[readchar] = '\0';
+	//touche par touche, chacune choisie pour finir avec le moins de touches
+	int rest = val;
+	while(rest != 0)
 	{
-		val = val * -1; //on convertie la valeur negative en positive
-		for(i=0; i < (val/10); i++)
+		int key = SeaTalk_Pilot::next_key(rest);
+		int res;
+		switch(key)
 		{
-			if(send_bouton_m10(serial_write, serial_read) == -1)
-			{
-				return i*10;
-			}
+			case -10: res = send_bouton_m10(serial_write, serial_read); break;
+			case -1: res = send_bouton_m1(serial_write, serial_read); break;
+			case 1: res = send_bouton_p1(serial_write, serial_read); break;
+			default: res = send_bouton_p10(serial_write, serial_read); break;
 		}
-		for(j=0; j < (val%10); j++)
+		if(res == -1)
 		{
-			if(send_bouton_m1(serial_write, serial_read) == -1)
-			{
-				return (i*10) + j;
-			}
+			return val - rest;
 		}
+		rest -= key;
 	}
-	else
+	return val;
+}
+
+//envoi bloquant d'une touche, on attend l'echo des 4 octets au plus le temps de les emettre plus SEATALK_ECHO_US
+//pour ne plus bloquer le noeud si l'echo est perdu
+static int send_key(HardwareSerial * serial_write, HardwareSerial * serial_read, unsigned char key)
+{
+	uint16_t c[] = {SeaTalk_Keystroke, 0x11, key, (uint16_t) (~key & 0xFF)};
+	unsigned long start;
+	int i;
+	//on envoi les 4 char de la trame d'un coup
+	serial_write->writeBlock9(c, 4, true);
+	start = micros();
+	//on attend de recevoir la trame que l'on a envoyer.
+	for(i = 0; i < 4; i++)
 	{
-		for(i=0; i < (val/10); i++)
+		while(!serial_read->available())
 		{
-			if(send_bouton_p10(serial_write, serial_read) == -1)
-      {
-        return i*10;
-      }
+			if(micros() - start > 4 * SEATALK_CHAR_US + SEATALK_ECHO_US)
+			{
+				return -1;
+			}
 		}
-		for(j=0; j < (val%10); j++)
+		if((unsigned char) serial_read->read() != c[i])
 		{
-			if(send_bouton_p1(serial_write, serial_read) == -1)
-     {
-        return (i*10) + j;
-     }
+			return -1;
 		}
 	}
+	return 0;
 }
 
 //-1
 int SeaTalk_API::send_bouton_m1(HardwareSerial * serial_write, HardwareSerial * serial_read)
 {
-	uint16_t c[] = {0x86,0x11, 0x05, 0xFA};
-	volatile int i = 0;
-	//on envoi les 4 char de la trame
-	for(i=0; i< 4; i++)
-	{
-		serial_write->write9(c[i] , ( i == 0));
-	}
-	//on attend de reÃƒÂ§evoire la trame que l'on a envoyer.
-	while(!serial_read->available()){};
-	for(i = 0; i < 4; i++)
-	{
-		volatile unsigned char r = serial_read->read();
-		if( r != c[i])
-		{
-			return -1;
-		}
-	}
-	return 0;
-	
+	return send_key(serial_write, serial_read, SeaTalk_Key_M1);
 }
 //-10
 int SeaTalk_API::send_bouton_m10(HardwareSerial * serial_write, HardwareSerial * serial_read)
 {
-	uint16_t c[] = {0x86,0x11, 0x06, 0xF9};
-	volatile int i = 0;
-	//on envoi les 4 char de la trame
-	for(i=0; i< 4; i++)
-	{
-		serial_write->write9(c[i] , ( i == 0));
-	}
-	//on attend de reÃƒÂ§evoire la trame que l'on a envoyer.
-	while(!serial_read->available()){};
-	for(i = 0; i < 4; i++)
-	{
-		volatile unsigned char r = serial_read->read();
-		if( r != c[i])
-		{
-			return -1;
-		}
-	}
-	return 0;
+	return send_key(serial_write, serial_read, SeaTalk_Key_M10);
 }
 //+1
 int SeaTalk_API::send_bouton_p1(HardwareSerial * serial_write, HardwareSerial * serial_read)
 {
-	uint16_t c[] = {0x86,0x11, 0x07, 0xF8};
-	volatile int i = 0;
-	//on envoi les 4 char de la trame
-	for(i=0; i< 4; i++)
-	{
-		serial_write->write9(c[i] , ( i == 0));
-	}
-	//on attend de reÃƒÂ§evoire la trame que l'on a envoyer.
-	while(!serial_read->available()){};
-	for(i = 0; i < 4; i++)
-	{
-		volatile unsigned char r = serial_read->read();
-		if( r != c[i])
-		{
-			return -1;
-		}
-	}
-	return 0;
+	return send_key(serial_write, serial_read, SeaTalk_Key_P1);
 }
 //+10
 int SeaTalk_API::send_bouton_p10(HardwareSerial * serial_write, HardwareSerial * serial_read)
 {	
-	uint16_t c[] = {0x86,0x11, 0x08, 0xF7};
-	volatile int i = 0;
-	//on envoi les 4 char de la trame
-	for(i=0; i< 4; i++)
-	{
-		serial_write->write9(c[i] , ( i == 0));
-	}
-	//on attend de reÃƒÂ§evoire la trame que l'on a envoyer.
-	while(!serial_read->available()){};
-	for(i = 0; i < 4; i++)
-	{
-		volatile unsigned char r = serial_read->read();
-		if( r != c[i])
-		{
-			return -1;
-		}
-	}
+	return send_key(serial_write, serial_read, SeaTalk_Key_P10);
 }
 
 
 //9C  U1  VW  RR    Compass heading and Rudder position 
 //trame pour la direction du compas et de la barre, 9c id du message uvw pour la direction, 1 octet suplementaire, rr pour la barre
-void SeaTalk_API::send_heading_rudder(HardwareSerial * serial_write, HardwareSerial * serial_read, int heading, int rudder)
+static void heading_rudder_datagram(unsigned char c[4], int heading, int rudder)
 {
-	uint16_t c;
-	uint16_t vw, u_low, u_hight;
+	unsigned char vw, u_low, u_hight;
 	u_low = heading/90; 
 	vw = (heading%90)/2;
 	u_hight = (heading%90)%2;
 	
-	c = 0x9C;
-	(*serial_write).write9(c ,true);
-	
-	c = ((u_hight<<2 + u_low) << 4) + 0x01;
-	(*serial_write).write9(c ,false);
-	
-	(*serial_write).write9(vw , false);
-	//
-	(*serial_write).write9((uint16_t)rudder & 0x00FF ,false);
+	c[0] = SeaTalk_Heading_Rudder;
+	c[1] = (((u_hight<<2) + u_low) << 4) + 0x01;
+	c[2] = vw;
+	c[3] = (unsigned char) rudder;
+}
+
+void SeaTalk_API::send_heading_rudder(HardwareSerial * serial_write, HardwareSerial * serial_read, int heading, int rudder)
+{
+	unsigned char c[4];
+	heading_rudder_datagram(c, heading, rudder);
+	serial_write->writeBlock9(c, 4, true);
+}
+
+bool SeaTalk_API::send_heading_rudder(SeaTalk_TX * tx, int heading, int rudder)
+{
+	unsigned char c[4];
+	heading_rudder_datagram(c, heading, rudder);
+	return tx->send_datagram(c, 4);
 }
 
 //si la trame emise par le bus seatalk correspond a "9C  U1  VW  RR" ou "84  U6  VW  XY 0Z 0M RR SS TT"
@@ -250,7 +199,9 @@ void SeaTalk_API::read_serial_heading_rudder(char * buff, int* heading, int* rud
 	}
 }
 
-void SeaTalk_API::read_seatalk_input(HardwareSerial * serial_read,unsigned char * buff,HardwareSerial * debug)
+//meme code pour un HardwareSerial et pour la file de reception d'un SeaTalk_TX
+template<class SOURCE>
+static void read_input(SOURCE * serial_read,unsigned char * buff,HardwareSerial * debug)
 {
 	unsigned int i = 0;
 	unsigned int nb_char = 3; 
@@ -300,4 +251,394 @@ void SeaTalk_API::read_seatalk_input(HardwareSerial * serial_read,unsigned char
   buff[i] = '\0';
 }
 
+void SeaTalk_API::read_seatalk_input(HardwareSerial * serial_read,unsigned char * buff,HardwareSerial * debug)
+{
+#ifdef HARDWARESERIAL_FRAMES
+	//port en mode trame (HardwareSerial::beginFrames): l'interruption a deja decoupe le datagramme
+	int n = serial_read->readFrame(buff);
+	if(n > 0)
+	{
+		buff[n] = '\0';
+		return;
+	}
+#endif
+	read_input(serial_read, buff, debug);
+}
+
+void SeaTalk_API::read_seatalk_input(SeaTalk_TX * serial_read,unsigned char * buff,HardwareSerial * debug)
+{
+	read_input(serial_read, buff, debug);
+}
+
+//etat de l'emetteur
+#define ST_TX_IDLE 0        //rien en cours, on attend le repos de la ligne
+#define ST_TX_ECHO 1        //datagramme entier dans l'uart, on compare chaque echo a son arrivee
+#define ST_TX_DRAIN 2       //collision: on laisse partir les octets deja dans l'uart et on jette leur echo
+
+SeaTalk_TX::SeaTalk_TX(HardwareSerial * serial_write, HardwareSerial * serial_read)
+	: collisions(0), echo_timeouts(0), failed(0), rx_overflow(0), idle_failures(0),
+	  serial_write(serial_write), serial_read(serial_read), queue_head(0), queue_tail(0), next_ticket(0),
+	  state(ST_TX_IDLE), echo_pos(0), drain_slot(0), retry(0), deadline(0), backoff_until(0), last_rx(0), line(NULL), line_chars(0), line_credit(0), line_misses(0),
+	  rx_head(0), rx_tail(0)
+{
+	memset(status, SEATALK_TX_OK, sizeof(status));
+}
+
+bool SeaTalk_TX::send_datagram(const unsigned char datagram[], unsigned char len, unsigned char * ticket)
+{
+	unsigned char head = queue_head;
+	unsigned char next = (head + 1) & SEATALK_TX_QUEUE_MASK;
+	unsigned char t;
+
+	if(len == 0 || len > SEATALK_MAX_DATAGRAM || next == queue_tail)
+	{
+		return false;
+	}
+	memcpy(queue[head], datagram, len);
+	queue_len[head] = len;
+	t = next_ticket++;
+	queue_ticket[head] = t;
+	status[t & SEATALK_TX_STATUS_MASK] = SEATALK_TX_PENDING;
+	queue_head = next;
+	if(ticket != NULL)
+	{
+		*ticket = t;
+	}
+	return true;
+}
+
+bool SeaTalk_TX::send_bouton(unsigned char key, unsigned char * ticket)
+{
+	const unsigned char datagram[] = {SeaTalk_Keystroke, 0x11, key, (unsigned char) ~key};
+	return send_datagram(datagram, sizeof(datagram), ticket);
+}
+
+unsigned char SeaTalk_TX::poll(void)
+{
+	unsigned long now = micros();
+	uint16_t block[SEATALK_TX_READ_BLOCK];
+	size_t n, i;
+	unsigned int nread = 0;
+
+	//tout ce qui est arrive depuis le dernier appel: nos echos ou le trafic des autres, par paquets
+	while((n = serial_read->readBlock9(block, SEATALK_TX_READ_BLOCK)) > 0)
+	{
+		last_rx = now;
+		nread += n;
+		for(i = 0; i < n; i++)
+		{
+			//l'etat peut changer au milieu du paquet: fin de l'echo, collision
+			if(state == ST_TX_ECHO)
+			{
+				echo(block[i], now);
+			}
+			else if(state == ST_TX_DRAIN)
+			{
+				drain(block[i]);
+			}
+			else
+			{
+				store_rx(block[i]);
+			}
+		}
+	}
+	//une fois par poll(): les octets encore en attente ont eu leur bit de start capture avant ce point
+	if(line != NULL && nread > 0)
+	{
+		check_line(nread);
+	}
+
+	if(state != ST_TX_IDLE && (long) (now - deadline) > 0)
+	{
+		if(state != ST_TX_DRAIN)
+		{
+			echo_timeouts++;
+			retry_later(now);
+		}
+		state = ST_TX_IDLE;
+	}
+
+	//on ne parle que sur une ligne au repos, et apres l'attente aleatoire d'une collision
+	//tout le datagramme part d'un coup: les octets se suivent sans trou, quelle que soit la duree de loop(),
+	//un autre appareil ne peut pas prendre le bus au milieu (le port d'emission doit avoir
+	//SEATALK_MAX_DATAGRAM places libres, sinon writeBlock9 attend)
+	if(state == ST_TX_IDLE && queue_head != queue_tail && (long) (now - backoff_until) >= 0
+			&& idle_us() >= SEATALK_IDLE_US)
+	{
+		serial_write->writeBlock9(queue[queue_tail], queue_len[queue_tail], true);
+		echo_pos = 0;
+		state = ST_TX_ECHO;
+		deadline = now + queue_len[queue_tail] * SEATALK_CHAR_US + SEATALK_ECHO_US;
+	}
+	return pending();
+}
+
+//compare l'octet recu au prochain octet emis
+void SeaTalk_TX::echo(uint16_t c, unsigned long now)
+{
+	unsigned char * datagram = queue[queue_tail];
+	unsigned char len = queue_len[queue_tail];
+	uint16_t expected = datagram[echo_pos] | (echo_pos == 0 ? 0x100 : 0);
+
+	if(c != expected)
+	{
+		//un autre appareil parlait en meme temps: son octet est pour les lecteurs
+		collisions++;
+		store_rx(c);
+		if(echo_pos + 1 < len)
+		{
+			//les octets suivants sont deja dans l'uart, leur echo arrive quand meme
+			//finish() peut liberer l'emplacement mais send_datagram ne le reprend pas tant que
+			//queue_tail n'a pas avance de nouveau, donc pas avant la fin du drain
+			state = ST_TX_DRAIN;
+			drain_slot = queue_tail;
+			echo_pos++;
+			deadline = now + (len - echo_pos) * SEATALK_CHAR_US + SEATALK_ECHO_US;
+		}
+		else
+		{
+			state = ST_TX_IDLE;
+		}
+		retry_later(now);
+		return;
+	}
+	echo_pos++;
+	if(echo_pos == len)
+	{
+		finish(SEATALK_TX_OK);
+	}
+}
+
+//octet recu pendant le drain: un octet par octet encore emis, notre propre echo est jete,
+//le reste (l'autre appareil, ou un melange des deux) est pour les lecteurs
+void SeaTalk_TX::drain(uint16_t c)
+{
+	if(c != queue[drain_slot][echo_pos])
+	{
+		store_rx(c);
+	}
+	echo_pos++;
+	if(echo_pos >= queue_len[drain_slot])
+	{
+		state = ST_TX_IDLE;
+	}
+}
+
+void SeaTalk_TX::retry_later(unsigned long now)
+{
+	retry++;
+	if(retry > SEATALK_TX_RETRY)
+	{
+		failed++;
+		finish(SEATALK_TX_FAILED);
+		return;
+	}
+	backoff_until = now + (unsigned long) random(SEATALK_BACKOFF_SLOTS) * SEATALK_CHAR_US;
+}
+
+void SeaTalk_TX::finish(unsigned char result)
+{
+	status[queue_ticket[queue_tail] & SEATALK_TX_STATUS_MASK] = result;
+	queue_tail = (queue_tail + 1) & SEATALK_TX_QUEUE_MASK;
+	retry = 0;
+	if(state != ST_TX_DRAIN)
+	{
+		state = ST_TX_IDLE;
+	}
+}
+
+unsigned char SeaTalk_TX::get_status(unsigned char ticket)
+{
+	return status[ticket & SEATALK_TX_STATUS_MASK];
+}
+
+unsigned char SeaTalk_TX::pending(void)
+{
+	return (queue_head - queue_tail) & SEATALK_TX_QUEUE_MASK;
+}
+
+//le plus court des deux repos: un octet vu par poll() bloque l'emission meme si le detecteur ne voit rien
+unsigned long SeaTalk_TX::idle_us(void)
+{
+	unsigned long since_rx = micros() - last_rx;
+	unsigned long since_stop;
+	if(line != NULL)
+	{
+		since_stop = line->idle_us();
+		if(since_stop < since_rx)
+		{
+			return since_stop;
+		}
+	}
+	return since_rx;
+}
+
+void SeaTalk_TX::set_idle(SeaTalk_Idle * detector)
+{
+	uint8_t oldSREG = SREG;
+	line = detector;
+	line_misses = 0;
+	line_credit = 0;
+	if(line != NULL)
+	{
+		cli();
+		line_chars = line->chars;
+		SREG = oldSREG;
+	}
+}
+
+//chaque octet lu a eu son bit de start capture avant la fin de sa reception: les octets lus ne peuvent pas
+//depasser les bits de start captures, sinon la broche 48 ne voit pas la ligne (cavalier absent) et le
+//detecteur annoncerait un repos permanent
+//un retard de loop() ne compte pas: les octets en attente sont couverts par leurs bits de start deja vus
+void SeaTalk_TX::check_line(unsigned int nread)
+{
+	unsigned long c;
+	uint8_t oldSREG = SREG;
+	cli();
+	c = line->chars;
+	SREG = oldSREG;
+	line_credit += c - line_chars;
+	line_chars = c;
+	if(nread <= line_credit)
+	{
+		line_credit -= nread;
+		line_misses = 0;
+		return;
+	}
+	//octets arrives avant set_idle(), ou detecteur aveugle
+	line_credit = 0;
+	line_misses++;
+	if(line_misses >= SEATALK_IDLE_MISSES)
+	{
+		idle_failures++;
+		line = NULL;
+	}
+}
+
+void SeaTalk_TX::store_rx(uint16_t c)
+{
+	unsigned char next = (rx_head + 1) & SEATALK_RX_MASK;
+	if(next == rx_tail)
+	{
+		rx_overflow++;
+		return;
+	}
+	rx[rx_head] = c;
+	rx_head = next;
+}
+
+int SeaTalk_TX::available(void)
+{
+	return (rx_head - rx_tail) & SEATALK_RX_MASK;
+}
+
+int SeaTalk_TX::read(void)
+{
+	uint16_t c;
+	if(rx_head == rx_tail)
+	{
+		return -1;
+	}
+	c = rx[rx_tail];
+	rx_tail = (rx_tail + 1) & SEATALK_RX_MASK;
+	return c;
+}
+
+SeaTalk_Pilot::SeaTalk_Pilot(SeaTalk_TX * tx)
+	: keystrokes(0), saved(0), failed(0), tx(tx), target_value(0), applied_value(0), inflight(0), ticket(0)
+{
+}
+
+//a = q * 10 + r: q dizaines et r unites, ou q + 1 dizaines et 10 - r unites dans l'autre sens
+//on depasse seulement si c'est plus court (r > 5), les dizaines partent en premier
+int SeaTalk_Pilot::next_key(long delta)
+{
+	long a = delta < 0 ? -delta : delta;
+	int sign = delta < 0 ? -1 : 1;
+	if(a == 0)
+	{
+		return 0;
+	}
+	if(a >= 10 || a % 10 > 5)
+	{
+		return 10 * sign;
+	}
+	return sign;
+}
+
+unsigned int SeaTalk_Pilot::key_count(long delta)
+{
+	long a = delta < 0 ? -delta : delta;
+	unsigned int r = a % 10;
+	return r > 5 ? a / 10 + 1 + (10 - r) : a / 10 + r;
+}
+
+void SeaTalk_Pilot::add_delta(int delta)
+{
+	set_target(target_value + delta);
+}
+
+void SeaTalk_Pilot::set_target(long target)
+{
+	//touches prevues avant et apres la nouvelle consigne, la touche en cours ne peut plus etre annulee
+	long before = target_value - applied_value - inflight;
+	long after = target - applied_value - inflight;
+	unsigned int nb_before = key_count(before) + key_count(target - target_value);
+	unsigned int nb_after = key_count(after);
+	if(nb_before > nb_after)
+	{
+		saved += nb_before - nb_after;
+	}
+	target_value = target;
+}
+
+void SeaTalk_Pilot::reset(void)
+{
+	target_value = applied_value + inflight;
+}
+
+void SeaTalk_Pilot::poll(void)
+{
+	int key;
+
+	if(inflight != 0)
+	{
+		switch(tx->get_status(ticket))
+		{
+			case SEATALK_TX_OK:
+				applied_value += inflight;
+				inflight = 0;
+			break;
+			case SEATALK_TX_FAILED:
+				//la touche n'est pas passee, elle sera recalculee avec la consigne
+				failed++;
+				inflight = 0;
+			break;
+			default:
+			return;
+		}
+	}
+	key = next_key(target_value - applied_value);
+	if(key == 0)
+	{
+		return;
+	}
+	switch(key)
+	{
+		case -10: key = tx->send_bouton(SeaTalk_Key_M10, &ticket) ? key : 0; break;
+		case -1: key = tx->send_bouton(SeaTalk_Key_M1, &ticket) ? key : 0; break;
+		case 1: key = tx->send_bouton(SeaTalk_Key_P1, &ticket) ? key : 0; break;
+		default: key = tx->send_bouton(SeaTalk_Key_P10, &ticket) ? key : 0; break;
+	}
+	if(key != 0)
+	{
+		inflight = key;
+		keystrokes++;
+	}
+}
 
+long SeaTalk_Pilot::outstanding(void)
+{
+	return target_value - applied_value;
+}
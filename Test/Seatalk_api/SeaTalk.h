@@ -8,17 +8,159 @@
 #define _SEATALKAPI_
 
 #include <HardwareSerial.h>
+#include "SeaTalkIdle.h"
 
 #define SeaTalk_Heading_Rudder 0x9C //identifiant d'une trame Serial pour le heading et le rudder
 #define SeaTalk_Autopilote_Heading_Rudder 0x84
 
+//touches du pilote: datagramme 86 11 KK ~KK
+#define SeaTalk_Keystroke 0x86
+#define SeaTalk_Key_M1 0x05
+#define SeaTalk_Key_M10 0x06
+#define SeaTalk_Key_P1 0x07
+#define SeaTalk_Key_P10 0x08
+
+//temps sur le bus a 4800 bauds: start + 8 bits + bit de commande + stop
+#define SEATALK_BIT_US 208
+#define SEATALK_CHAR_US (11 * SEATALK_BIT_US)
+#define SEATALK_IDLE_US (10 * SEATALK_BIT_US)          //ligne au repos avant d'emettre (l'ancien delay(2))
+#define SEATALK_ECHO_US (3 * SEATALK_CHAR_US)          //delai max entre l'ecriture et l'echo d'un octet
+#define SEATALK_MAX_DATAGRAM 18                        //3 octets + 15 au plus
+
+//emission asynchrone
+#define SEATALK_TX_QUEUE_SIZE 8                        //puissance de 2
+#define SEATALK_TX_QUEUE_MASK (SEATALK_TX_QUEUE_SIZE - 1)
+#define SEATALK_TX_STATUS_SIZE 16                      //puissance de 2, derniers tickets memorises
+#define SEATALK_TX_STATUS_MASK (SEATALK_TX_STATUS_SIZE - 1)
+#define SEATALK_RX_SIZE 64                             //puissance de 2, octets des autres appareils
+#define SEATALK_RX_MASK (SEATALK_RX_SIZE - 1)
+#define SEATALK_TX_RETRY 5                             //essais apres une collision ou un echo perdu
+#define SEATALK_BACKOFF_SLOTS 8                        //attente aleatoire de 0 a 7 octets en plus du repos
+#define SEATALK_TX_READ_BLOCK 8                        //symboles lus d'un coup par poll()
+#define SEATALK_IDLE_MISSES 3                          //poll() de suite avec plus d'octets lus que de bits de start
+                                                       //captures: detecteur abandonne
+
+//etat d'un ticket
+#define SEATALK_TX_PENDING 0
+#define SEATALK_TX_OK 1
+#define SEATALK_TX_FAILED 2
+
+//emetteur SeaTalk sans attente active
+//les datagrammes sont mis en file, poll() les emet d'un seul bloc quand la ligne est au repos depuis
+//SEATALK_IDLE_US, verifie l'echo de chaque octet au fur et a mesure et reessaie apres une attente aleatoire
+//en cas de collision
+//poll() lit tout le port de reception: les octets des autres appareils sont gardes pour available()/read()
+//le repos de la ligne est mesure depuis la date de reception vue par poll(), qui est posterieure a la
+//reception reelle: le repos est sous-estime, jamais sur-estime; avec un SeaTalk_Idle (set_idle) on prend
+//le plus court des deux, un caractere en cours sur la ligne retarde aussi l'emission
+class SeaTalk_TX
+{
+	public:
+		SeaTalk_TX(HardwareSerial * serial_write, HardwareSerial * serial_read);
+		//ajoute un datagramme (le premier octet est la commande), retourne false si la file est pleine
+		bool send_datagram(const unsigned char datagram[], unsigned char len, unsigned char * ticket = NULL);
+		bool send_bouton(unsigned char key, unsigned char * ticket = NULL);
+		//a appeler a chaque tour de loop(), ne bloque jamais; retourne le nombre de datagrammes en attente
+		unsigned char poll(void);
+		//SEATALK_TX_PENDING, SEATALK_TX_OK ou SEATALK_TX_FAILED
+		unsigned char get_status(unsigned char ticket);
+		unsigned char pending(void);
+		//temps depuis le dernier octet recu, en microseconde
+		unsigned long idle_us(void);
+		//repos mesure aussi par le timer de capture, NULL pour revenir a poll() seul
+		void set_idle(SeaTalk_Idle * detector);
+
+		//octets recus des autres appareils, avec le 9eme bit, comme HardwareSerial
+		int available(void);
+		int read(void);
+
+		unsigned int collisions;      //echo different de l'octet emis
+		unsigned int echo_timeouts;   //echo pas recu a temps
+		unsigned int failed;          //datagrammes abandonnes apres SEATALK_TX_RETRY essais
+		unsigned int rx_overflow;     //octets des autres appareils perdus, file pleine
+		unsigned int idle_failures;   //detecteur abandonne: plus d'octets lus que de bits de start captures
+
+	private:
+		HardwareSerial * serial_write;
+		HardwareSerial * serial_read;
+
+		unsigned char queue[SEATALK_TX_QUEUE_SIZE][SEATALK_MAX_DATAGRAM];
+		unsigned char queue_len[SEATALK_TX_QUEUE_SIZE];
+		unsigned char queue_ticket[SEATALK_TX_QUEUE_SIZE];
+		unsigned char queue_head, queue_tail;
+		unsigned char status[SEATALK_TX_STATUS_SIZE];
+		unsigned char next_ticket;
+
+		unsigned char state;
+		unsigned char echo_pos;       //prochain octet dont on attend l'echo
+		unsigned char drain_slot;     //datagramme dont les derniers octets partent apres une collision
+		unsigned char retry;
+		unsigned long deadline;       //date limite de l'echo attendu
+		unsigned long backoff_until;
+		unsigned long last_rx;
+		SeaTalk_Idle * line;
+		unsigned long line_chars;     //chars du detecteur a la derniere verification
+		unsigned long line_credit;    //bits de start captures dont l'octet n'a pas encore ete lu
+		unsigned char line_misses;
+
+		uint16_t rx[SEATALK_RX_SIZE];
+		unsigned char rx_head, rx_tail;
+
+		void store_rx(uint16_t c);
+		void echo(uint16_t c, unsigned long now);
+		void drain(uint16_t c);
+		void retry_later(unsigned long now);
+		void finish(unsigned char result);
+		void check_line(unsigned int nread);
+};
+
+//consigne de cap du pilote, envoyee en touches -1 -10 +1 +10 par un SeaTalk_TX
+//une seule touche est sur le bus a la fois: une nouvelle consigne remplace tout ce qui n'est pas encore parti
+//et chaque touche est choisie pour atteindre la consigne avec le moins de touches (+19 = +10 +10 -1)
+class SeaTalk_Pilot
+{
+	public:
+		SeaTalk_Pilot(SeaTalk_TX * tx);
+		//variation de cap en degree, s'ajoute a ce qui reste a envoyer
+		void add_delta(int delta);
+		//variation totale depuis reset() en degree, remplace ce qui reste a envoyer
+		void set_target(long target);
+		void reset(void);
+		//a appeler apres SeaTalk_TX::poll(), ne bloque jamais
+		void poll(void);
+		//degree restant a envoyer, touche en cours comprise
+		long outstanding(void);
+		//degree dont l'echo a ete verifie
+		long applied(void) { return applied_value; }
+
+		//touche suivante pour une variation delta: +-1, +-10 ou 0
+		static int next_key(long delta);
+		//nombre minimum de touches pour une variation delta
+		static unsigned int key_count(long delta);
+
+		unsigned int keystrokes;      //touches emises
+		unsigned int saved;           //touches evitees par la fusion des consignes
+		unsigned int failed;          //touches abandonnees par SeaTalk_TX, renvoyees ensuite
+
+	private:
+		SeaTalk_TX * tx;
+		long target_value;
+		long applied_value;
+		int inflight;                 //touche sur le bus, 0 si aucune
+		unsigned char ticket;
+};
+
 class SeaTalk_API
 {
 	public:
     SeaTalk_API();
-		//on a besoin d'un pointeur ver le port serie utilise pour envoyer les valeurs, retourne la valeur envoyer,
+		//send_bouton_value attend le repos mesure par detector au lieu de la date de lecture
+		void set_idle(SeaTalk_Idle * detector);
+		//on a besoin d'un pointeur ver le port serie utilise pour envoyer les valeurs, retourne la valeur envoyer (signee),
+		//avec le moins de touches possible (SeaTalk_Pilot::next_key)
 		//si la valeur de retour est diffÃ¯Â¿Â½rente de la valeur envoyer, c'est qu'il y a eu une erreur de transmition
 		int send_bouton_value(HardwareSerial * serial_write, HardwareSerial * serial_read, int val, char buffout[]);
+		//les send_bouton_xx attendent l'echo au plus le temps d'emettre 4 octets + SEATALK_ECHO_US, -1 si il n'arrive pas
 		//-1
 		int send_bouton_m1(HardwareSerial * serial_write, HardwareSerial * serial_read);
 		//-10
@@ -29,11 +171,18 @@ class SeaTalk_API
 		int send_bouton_p10(HardwareSerial * serial_write, HardwareSerial * serial_read);
 		
 		void send_heading_rudder(HardwareSerial * serial_write, HardwareSerial * serial_read, int heading, int rudder);
+		//met le datagramme dans la file de l'emetteur, false si elle est pleine
+		bool send_heading_rudder(SeaTalk_TX * tx, int heading, int rudder);
 		void read_seatalk_heading_rudder(char * buff, boolean parsed, int* heading, int* rudder);
 		void read_serial_heading_rudder(char * buff, int* heading, int* rudder);
 		//char we gonna loose 9bits, but not needed, we put in buf only command,
 		//buff have to be big enought to store a long seatalk tram => 22 char 3 mandatory and up to 18 more + end string char
 		void read_seatalk_input(HardwareSerial * serial_read,unsigned char buff[],HardwareSerial * debug); 
+		//meme lecture quand le port de reception appartient a un SeaTalk_TX
+		void read_seatalk_input(SeaTalk_TX * serial_read,unsigned char buff[],HardwareSerial * debug); 
+
+	private:
+		SeaTalk_Idle * line;
 };
 
 #endif
@@ -5,16 +5,26 @@ const int led = 13;
 boolean state = false;
 
 SeaTalk_API seatalk_api;
+//Serial1 emet sur le bus, Serial2 le relit: l'emetteur lit tout Serial2, loop() lit a travers lui
+SeaTalk_TX seatalk_tx(&Serial1, &Serial2);
+//variations de cap envoyees par le PC sur Serial, une par ligne ("-37"), fusionnees avec celles pas encore parties
+SeaTalk_Pilot pilot(&seatalk_tx);
+//repos du bus mesure par le timer 5: cavalier a ajouter entre la broche 48 et RX2 (broche 17)
+//'h' sur Serial affiche l'histogramme des repos et les erreurs de reception de Serial2
+SeaTalk_Idle ligne;
 
 void setup() 
 {
-  volatile 
-    uint16_t tab[] = {0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00,0x00};
-  volatile unsigned int i;
+  //83  07  XX  00  00  00  00  00  80  00  00 Sent by course computer.
+  const uint16_t tab[] = {0x83,0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x80,0x00,0x00};
   Serial.begin(115200);
   Serial1.begin(4800, SERIAL_9N1);
   Serial2.begin(4800, SERIAL_9N1);
   while(!Serial1){};
+  if(ligne.begin())
+  {
+    seatalk_tx.set_idle(&ligne);
+  }
   
   pinMode(led, OUTPUT);
   digitalWrite(led, LOW);
@@ -23,13 +33,7 @@ void setup()
  if(Serial2.available() ==  0)
  {
   volatile uint16_t c;
-  //83  07  XX  00  00  00  00  00  80  00  00 Sent by course computer.
-  c = 0x83;
-  Serial1.write9(c, true);
-  for(i=0; i< 10; i++)
-  {
-    Serial1.write9(tab[i], false);
-  }
+  Serial1.writeBlock9(tab, sizeof(tab) / sizeof(tab[0]), true);
   while(Serial2.available() <=  0){}; //wait for buffer to fill
   while(Serial2.available() > 0)
   {
@@ -47,7 +51,49 @@ void loop()
   static boolean tempo = false;
   volatile unsigned int time = millis();
 
-  if(Serial2.available())
+  //emission en cours et lecture du bus, ne bloque jamais
+  seatalk_tx.poll();
+  pilot.poll();
+
+  static int consigne = 0;
+  static boolean negatif = false;
+  while(Serial.available())
+  {
+    char c = Serial.read();
+    if(c == '-')
+      negatif = true;
+    else if(c >= '0' && c <= '9')
+      consigne = consigne * 10 + (c - '0');
+    else if(c == 'h')
+    {
+      Serial.print(ligne.chars);
+      Serial.println(" caracteres, repos entre deux caracteres:");
+      if(seatalk_tx.idle_failures != 0)
+        Serial.println("detecteur abandonne: octets recus sans bit de start capture, cavalier 48-17 absent?");
+      ligne.print_histogram(&Serial);
+#ifdef HARDWARESERIAL_STATS
+      //erreurs de reception du bus: buffer plein, usart debordee, bit de stop absent (collision)
+      serial_stats stats;
+      Serial2.getStats(&stats);
+      Serial.print("perdus buffer ");
+      Serial.print(stats.overflows);
+      Serial.print(", perdus usart ");
+      Serial.print(stats.overruns);
+      Serial.print(", bit de stop ");
+      Serial.print(stats.framing);
+      Serial.print(", remplissage max ");
+      Serial.println(stats.high_water);
+#endif
+    }
+    else if(c == '\n')
+    {
+      pilot.add_delta(negatif ? -consigne : consigne);
+      consigne = 0;
+      negatif = false;
+    }
+  }
+
+  if(seatalk_tx.available())
   {/*
       volatile uint16_t c_lecture;
       c_lecture = Serial2.read();
@@ -60,7 +106,7 @@ void loop()
 	  */
 	 unsigned char buff[230];
    int i = 0;
-	 seatalk_api.read_seatalk_input(&Serial2,buff,&Serial);
+	 seatalk_api.read_seatalk_input(&seatalk_tx,buff,&Serial);
 		while(buff[i] != '\0')
     {
       //Serial.print(buff[i],HEX);
@@ -74,13 +120,14 @@ void loop()
 		}
 		
   }
-  //on emet toute les seconde et seulement quand le bus est libre
-  if(timer_emit <= time && Serial2.available() ==  0)
+  //on emet toute les seconde, seatalk_tx attend que le bus soit libre
+  if(timer_emit <= time)
   {
-    uint16_t c;
     timer_emit = timer_emit + 1000;
-    seatalk_api.send_heading_rudder(&Serial1, &Serial2, 68, -2);
-    Serial.println(" ");  
+    if(!seatalk_api.send_heading_rudder(&seatalk_tx, 68, -2))
+    {
+      Serial.println("file seatalk pleine");
+    }
   }
   
    if(timer_led <= time)
@@ -22,10 +22,12 @@
 #define DATA_BUFF_LEN 16 
 
 #define BAUD 115200 
+#define DIAG_PERIODE_MS 1000 //compteurs d'erreur de Serial1 sur le bus CAN
 
 #include "mcp_can.h"
 #include <SPI.h>
 #include "parseCan.h"
+#include "canSchema.h"
 
 byte aPacketData[DATA_BUFF_LEN]; 
 
@@ -57,6 +59,7 @@ typedef struct {
 UM6_PacketStruct UM6_Packet; 
 
 const int SPI_CS_PIN = 9;
+const int CAN_INT_PIN = 2; //broche INT du MCP2515
 const int led = 13;
 boolean state = false;
 
@@ -96,6 +99,8 @@ START_INIT:
         delay(100);
         goto START_INIT;
     }
+    //les trames partent depuis l'interruption TXnIF, loop() ne bloque plus sur le bus CAN
+    CAN.enableTxInterrupt(CAN_INT_PIN);
 }
 
          
@@ -169,6 +174,8 @@ void loop(){
 	}
       
      
+    SendDiag();
+
     time2 = millis();
     if(time2 > time )
     {  
@@ -220,10 +227,9 @@ void SendData(){
            time += 300;   
 		   //debogage via usb
 		 
-		 parser.intToUChar(buff, 0, phi.in);
-		 parser.intToUChar(buff, 2, theta.in);
-		 parser.intToUChar(buff, 4, psi.in);
-		CAN.sendMsgBuf(MSG_IMU_PHI_THETA_PSI, 0, 8, buff);
+		 CanMsgImu::pack(buff, phi.in, theta.in, psi.in);
+		//si la file est pleine la trame est perdue, une nouvelle part 300ms plus tard
+		CAN.sendMsgBufAsync(CanMsgImu::id, 0, CanMsgImu::dlc, buff);
                 /*
 		 Serial.print("PHI = "); 
 		 Serial.print(phi.in); 
@@ -242,10 +248,8 @@ void SendData(){
 		   Serial.println(buff[5], HEX); 
 		*/
 		 
-		 parser.intToUChar(buff2, 0, girX.in);
-		 parser.intToUChar(buff2, 2, girY.in);
-		 parser.intToUChar(buff2, 4, girZ.in);
-		  CAN.sendMsgBuf(MSG_GYRO_X_Y_Z, 0, 8, buff2);
+		 CanMsgGyro::pack(buff2, girX.in, girY.in, girZ.in);
+		  CAN.sendMsgBufAsync(CanMsgGyro::id, 0, CanMsgGyro::dlc, buff2);
 		 /*
 		 Serial.print(" girX = "); 
 		 Serial.print(girX.in); 
@@ -258,3 +262,23 @@ void SendData(){
     }
 }
 
+//compteurs d'erreur de reception de Serial1 (UM6 a 115200 bauds), pour dimensionner SERIAL1_RX_BUFFER_SIZE
+//seulement avec le coeur HardwareSerial9bit
+void SendDiag(){
+#ifdef HARDWARESERIAL_STATS
+	static unsigned long diagNext = 0;
+	unsigned char buff[8];
+	serial_stats stats;
+
+	if((long) (millis() - diagNext) < 0)
+		return;
+	Serial1.getStats(&stats);
+	CanMsgSerialDiag::pack(buff, 1, stats.high_water, stats.overflows, stats.overruns,
+			(unsigned char) stats.framing, (unsigned char) stats.parity);
+	//file d'emission pleine: on reessaie au prochain tour de loop(), avec des compteurs a jour
+	if(CAN.sendMsgBufAsync(CanMsgSerialDiag::id, 0, CanMsgSerialDiag::dlc, buff) != CAN_OK)
+		return;
+	//depuis maintenant et pas depuis la derniere echeance: pas de rafale de rattrapage au demarrage
+	diagNext = millis() + DIAG_PERIODE_MS;
+#endif
+}
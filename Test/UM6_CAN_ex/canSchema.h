@@ -0,0 +1,370 @@
+/**
+	Romain Le Forestier
+ description a la compilation des trames CAN
+ chaque identifiant de parseCan.h a un descripteur qui donne le type, la position et l'echelle
+ de chacun de ses champs, le compilateur genere alors le code de decoupage et de reconstruction
+ sans boucle ni test (tout est inline), et verifie que la trame tient dans les 8 octets du bus CAN
+*/
+
+//exemple d'utilisation:
+//	unsigned char buff[8];
+//	CanMsgImu::pack(buff, phi, theta, psi);
+//	CAN.sendMsgBuf(CanMsgImu::id, 0, CanMsgImu::dlc, buff);
+//	...
+//	int psi = CanMsgImu::psi::unpack(buff);
+
+#ifndef _CANSCHEMA_
+#define _CANSCHEMA_
+
+#include <stdint.h>
+#include <string.h>
+#include "parseCan.h"
+
+#define CAN_SCHEMA_MAX_DLC 8 //un message CAN transporte au plus 8 octets
+
+//type des champs
+//les entiers sont stockes octet de poid fort en premier (meme format que ParseCan::intToUChar)
+//les float sont copies octet par octet (meme format que ParseCan::floatToUChar)
+
+struct CanInt8
+{
+	typedef signed char value_type;
+	enum { size = 1 };
+	static inline void put(unsigned char buff[], value_type val) { buff[0] = (unsigned char) val; }
+	static inline value_type get(const unsigned char buff[]) { return (value_type) buff[0]; }
+};
+
+struct CanUInt8
+{
+	typedef unsigned char value_type;
+	enum { size = 1 };
+	static inline void put(unsigned char buff[], value_type val) { buff[0] = val; }
+	static inline value_type get(const unsigned char buff[]) { return buff[0]; }
+};
+
+struct CanInt16
+{
+	typedef int value_type;
+	enum { size = 2 };
+	static inline void put(unsigned char buff[], value_type val)
+	{
+		buff[0] = (unsigned char) (val >> 8);
+		buff[1] = (unsigned char) val;
+	}
+	static inline value_type get(const unsigned char buff[])
+	{
+		return (int16_t) (((uint16_t) buff[0] << 8) | buff[1]);
+	}
+};
+
+struct CanUInt16
+{
+	typedef unsigned int value_type;
+	enum { size = 2 };
+	static inline void put(unsigned char buff[], value_type val)
+	{
+		buff[0] = (unsigned char) (val >> 8);
+		buff[1] = (unsigned char) val;
+	}
+	static inline value_type get(const unsigned char buff[])
+	{
+		return ((uint16_t) buff[0] << 8) | buff[1];
+	}
+};
+
+struct CanInt32
+{
+	typedef long value_type;
+	enum { size = 4 };
+	static inline void put(unsigned char buff[], value_type val)
+	{
+		buff[0] = (unsigned char) (val >> 24);
+		buff[1] = (unsigned char) (val >> 16);
+		buff[2] = (unsigned char) (val >> 8);
+		buff[3] = (unsigned char) val;
+	}
+	static inline value_type get(const unsigned char buff[])
+	{
+		return (int32_t) (((uint32_t) buff[0] << 24) | ((uint32_t) buff[1] << 16)
+				| ((uint16_t) buff[2] << 8) | buff[3]);
+	}
+};
+
+struct CanFloat
+{
+	typedef float value_type;
+	enum { size = 4 };
+	static inline void put(unsigned char buff[], value_type val) { memcpy(buff, &val, 4); }
+	static inline value_type get(const unsigned char buff[])
+	{
+		value_type val;
+		memcpy(&val, buff, 4);
+		return val;
+	}
+};
+
+//un champ: type, position du premier octet dans la trame et echelle
+//valeur physique = valeur brute * SCALE_NUM / SCALE_DEN
+template<class TYPE, unsigned char OFFSET, long SCALE_NUM = 1, long SCALE_DEN = 1>
+struct CanField
+{
+	typedef TYPE type;
+	typedef typename TYPE::value_type value_type;
+	enum { offset = OFFSET, size = TYPE::size, end = OFFSET + TYPE::size };
+
+	static_assert(SCALE_DEN != 0, "echelle invalide");
+
+	static inline void pack(unsigned char buff[], value_type val) { TYPE::put(buff + OFFSET, val); }
+	static inline value_type unpack(const unsigned char buff[]) { return TYPE::get(buff + OFFSET); }
+
+	//conversion vers l'unite physique, calcule a la compilation quand l'echelle vaut 1
+	static inline float toPhysical(value_type val) { return (float) val * SCALE_NUM / SCALE_DEN; }
+};
+
+//verification de la disposition des champs: chaque champ commence apres la fin du precedent
+template<unsigned char PREV_END, class... FIELDS>
+struct CanLayout;
+
+template<unsigned char PREV_END>
+struct CanLayout<PREV_END>
+{
+	enum { end = PREV_END };
+};
+
+template<unsigned char PREV_END, class FIRST, class... REST>
+struct CanLayout<PREV_END, FIRST, REST...>
+{
+	static_assert(FIRST::offset >= PREV_END, "deux champs de la trame se chevauchent");
+	enum { end = CanLayout<FIRST::end, REST...>::end };
+};
+
+//descripteur d'un message: identifiant CAN et liste ordonnee des champs
+//chaque champ n'est ecrit qu'une fois, dans une structure CanMsgXxxFields dont le message herite:
+//pack() et dlc utilisent les memes types que CanMsgXxx::champ::unpack()
+template<unsigned long ID, class... FIELDS>
+struct CanMessage
+{
+	enum { dlc = CanLayout<0, FIELDS...>::end };
+	static const unsigned long id = ID;
+
+	static_assert(dlc <= CAN_SCHEMA_MAX_DLC, "la trame depasse les 8 octets d'un message CAN");
+
+	//ecrit tous les champs dans buff, dans l'ordre de la declaration
+	static inline void pack(unsigned char buff[], typename FIELDS::value_type... values)
+	{
+		int unused[] = { (FIELDS::pack(buff, values), 0)... };
+		(void) unused;
+	}
+};
+
+//descripteurs des trames de parseCan.h
+
+//Tram Gps
+struct CanMsgGprmcLatLongFields
+{
+	typedef CanField<CanFloat, 0> latitude;  //degree, negatif au sud
+	typedef CanField<CanFloat, 4> longitude; //degree, negatif a l'ouest
+};
+
+struct CanMsgGprmcLatLong : CanMsgGprmcLatLongFields, CanMessage<MSG_GPRMC_LAT_LONG,
+	CanMsgGprmcLatLongFields::latitude,
+	CanMsgGprmcLatLongFields::longitude>
+{
+};
+
+//version 2 de la trame de position, independante du format des float de l'AVR
+//on decode avec des decalages et des additions sur tout les noeuds (et sur le PC)
+struct CanMsgGprmcLatLongE7Fields
+{
+	typedef CanField<CanInt32, 0, 1, 10000000L> latitude;  //1e-7 degree, negatif au sud
+	typedef CanField<CanInt32, 4, 1, 10000000L> longitude; //1e-7 degree, negatif a l'ouest
+};
+
+struct CanMsgGprmcLatLongE7 : CanMsgGprmcLatLongE7Fields, CanMessage<MSG_GPRMC_LAT_LONG_E7,
+	CanMsgGprmcLatLongE7Fields::latitude,
+	CanMsgGprmcLatLongE7Fields::longitude>
+{
+};
+
+//position a l'estime publiee a 20Hz par le noeud GPS, voir deadReckoning.h
+struct CanMsgEstimeLatLongFields
+{
+	typedef CanField<CanInt32, 0, 1, 10000000L> latitude;  //1e-7 degree, negatif au sud
+	typedef CanField<CanInt32, 4, 1, 10000000L> longitude; //1e-7 degree, negatif a l'ouest
+};
+
+struct CanMsgEstimeLatLong : CanMsgEstimeLatLongFields, CanMessage<MSG_ESTIME_LAT_LONG,
+	CanMsgEstimeLatLongFields::latitude,
+	CanMsgEstimeLatLongFields::longitude>
+{
+};
+
+struct CanMsgEstimeQualiteFields
+{
+	typedef CanField<CanUInt8, 0> sequence;          //meme valeur que la MSG_ESTIME_LAT_LONG qui precede
+	typedef CanField<CanUInt8, 1> quality;           //DR_QUALITE_xxx de deadReckoning.h, 0: ne pas utiliser
+	typedef CanField<CanUInt8, 2, 1, 10> fixAge;     //age du dernier fix en 1/10 seconde, 255 au dela
+	typedef CanField<CanInt16, 3, 1, 10> course;     //cap fond estime en 1/10 degree
+	typedef CanField<CanInt16, 5, 1, 100> speed;     //vitesse fond en 1/100 noeud
+	typedef CanField<CanUInt8, 7, 1, 10> correction; //ecart restant a resorber vers le fix en 1/10 metre, 255 au dela
+};
+
+struct CanMsgEstimeQualite : CanMsgEstimeQualiteFields, CanMessage<MSG_ESTIME_QUALITE,
+	CanMsgEstimeQualiteFields::sequence,
+	CanMsgEstimeQualiteFields::quality,
+	CanMsgEstimeQualiteFields::fixAge,
+	CanMsgEstimeQualiteFields::course,
+	CanMsgEstimeQualiteFields::speed,
+	CanMsgEstimeQualiteFields::correction>
+{
+};
+
+struct CanMsgGprmcVitDateFields
+{
+	typedef CanField<CanFloat, 0> speed; //noeud
+	typedef CanField<CanUInt8, 4> day;
+	typedef CanField<CanUInt8, 5> month;
+	typedef CanField<CanUInt8, 6> year;  //2 dernier chiffres
+};
+
+struct CanMsgGprmcVitDate : CanMsgGprmcVitDateFields, CanMessage<MSG_GPRMC_VIT_DATE,
+	CanMsgGprmcVitDateFields::speed,
+	CanMsgGprmcVitDateFields::day,
+	CanMsgGprmcVitDateFields::month,
+	CanMsgGprmcVitDateFields::year>
+{
+};
+
+struct CanMsgGpggaAltPrecFields
+{
+	typedef CanField<CanFloat, 0> altitude;         //metre au dessus du niveau de la mer
+	typedef CanField<CanUInt8, 4, 1, 10> accuracy;  //precision horizontale en dixieme
+	typedef CanField<CanUInt8, 5> nbSat;            //nombre de satellites
+};
+
+struct CanMsgGpggaAltPrec : CanMsgGpggaAltPrecFields, CanMessage<MSG_GPGGA_ALT_PREC,
+	CanMsgGpggaAltPrecFields::altitude,
+	CanMsgGpggaAltPrecFields::accuracy,
+	CanMsgGpggaAltPrecFields::nbSat>
+{
+};
+
+//Tram instruments
+struct CanMsgHdgCapFields
+{
+	typedef CanField<CanInt16, 0, 1, 10> heading;   //cap magnetique en 1/10 degree
+	typedef CanField<CanInt16, 2, 1, 10> deviation; //1/10 degree, negatif a l'ouest
+	typedef CanField<CanInt16, 4, 1, 10> variation; //1/10 degree, negatif a l'ouest
+};
+
+struct CanMsgHdgCap : CanMsgHdgCapFields, CanMessage<MSG_HDG_CAP,
+	CanMsgHdgCapFields::heading,
+	CanMsgHdgCapFields::deviation,
+	CanMsgHdgCapFields::variation>
+{
+};
+
+struct CanMsgMwvVentFields
+{
+	typedef CanField<CanInt16, 0, 1, 10> angle; //1/10 degree par rapport a l'etrave
+	typedef CanField<CanInt16, 2, 1, 10> speed; //1/10 de l'unite
+	typedef CanField<CanUInt8, 4> reference;    //'R' apparent, 'T' vrai
+	typedef CanField<CanUInt8, 5> unit;         //'K' km/h, 'M' m/s, 'N' noeud
+};
+
+struct CanMsgMwvVent : CanMsgMwvVentFields, CanMessage<MSG_MWV_VENT,
+	CanMsgMwvVentFields::angle,
+	CanMsgMwvVentFields::speed,
+	CanMsgMwvVentFields::reference,
+	CanMsgMwvVentFields::unit>
+{
+};
+
+struct CanMsgDptProfondeurFields
+{
+	typedef CanField<CanInt32, 0, 1, 100> depth;  //cm sous le capteur
+	typedef CanField<CanInt16, 4, 1, 100> offset; //cm, positif vers la surface, negatif vers la quille
+};
+
+struct CanMsgDptProfondeur : CanMsgDptProfondeurFields, CanMessage<MSG_DPT_PROFONDEUR,
+	CanMsgDptProfondeurFields::depth,
+	CanMsgDptProfondeurFields::offset>
+{
+};
+
+//Tram IMU (accelerometre)
+struct CanMsgImuFields
+{
+	typedef CanField<CanInt16, 0> phi;   //roulis en degree
+	typedef CanField<CanInt16, 2> theta; //tangage en degree
+	typedef CanField<CanInt16, 4> psi;   //lacet en degree
+};
+
+struct CanMsgImu : CanMsgImuFields, CanMessage<MSG_IMU_PHI_THETA_PSI,
+	CanMsgImuFields::phi,
+	CanMsgImuFields::theta,
+	CanMsgImuFields::psi>
+{
+};
+
+struct CanMsgGyroFields
+{
+	typedef CanField<CanInt16, 0> x; //degree par seconde
+	typedef CanField<CanInt16, 2> y;
+	typedef CanField<CanInt16, 4> z;
+};
+
+struct CanMsgGyro : CanMsgGyroFields, CanMessage<MSG_GYRO_X_Y_Z,
+	CanMsgGyroFields::x,
+	CanMsgGyroFields::y,
+	CanMsgGyroFields::z>
+{
+};
+
+//Tram Seatalk
+struct CanMsgSeatalkBoutonFields
+{
+	typedef CanField<CanInt16, 0> value; //variation de cap demandee en degree
+};
+
+struct CanMsgSeatalkBouton : CanMsgSeatalkBoutonFields, CanMessage<MSG_SETALK_BOUTON,
+	CanMsgSeatalkBoutonFields::value>
+{
+};
+
+struct CanMsgHeadingRudderFields
+{
+	typedef CanField<CanInt16, 0> heading; //degree
+	typedef CanField<CanInt16, 2> rudder;  //degree, negatif a babord
+};
+
+struct CanMsgHeadingRudder : CanMsgHeadingRudderFields, CanMessage<MSG_HEADING_RUDDER,
+	CanMsgHeadingRudderFields::heading,
+	CanMsgHeadingRudderFields::rudder>
+{
+};
+
+//Tram diagnostic
+//compteurs cumules depuis le demarrage du noeud, ils font le tour: le recepteur fait la difference
+//entre deux trames
+struct CanMsgSerialDiagFields
+{
+	typedef CanField<CanUInt8, 0> port;       //numero du port serie, 0 pour Serial
+	typedef CanField<CanUInt8, 1> highWater;  //plus grand remplissage du buffer de reception depuis le demarrage
+	typedef CanField<CanUInt16, 2> overflows; //caracteres perdus, buffer de reception plein
+	typedef CanField<CanUInt16, 4> overruns;  //caracteres perdus dans l'USART (DOR), interruption trop tardive
+	typedef CanField<CanUInt8, 6> framing;    //erreurs de bit de stop (FE), octet de poid faible
+	typedef CanField<CanUInt8, 7> parity;     //erreurs de parite (UPE), octet de poid faible
+};
+
+struct CanMsgSerialDiag : CanMsgSerialDiagFields, CanMessage<MSG_SERIAL_DIAG,
+	CanMsgSerialDiagFields::port,
+	CanMsgSerialDiagFields::highWater,
+	CanMsgSerialDiagFields::overflows,
+	CanMsgSerialDiagFields::overruns,
+	CanMsgSerialDiagFields::framing,
+	CanMsgSerialDiagFields::parity>
+{
+};
+
+#endif
@@ -27,6 +27,24 @@
 
 #define MAX_CHAR_IN_MESSAGE 8
 
+typedef struct
+{
+    INT32U  id;                                                         /* can id                       */
+    INT8U   ext;                                                        /* 1 = 29 bit id                */
+    INT8U   rtr;                                                        /* remote request               */
+    INT8U   dlc;                                                        /* data length                  */
+    INT8U   data[MAX_CHAR_IN_MESSAGE];                                  /* data                         */
+    INT32U  timestamp;                                                  /* micros() at reception        */
+} CAN_FRAME;
+
+typedef struct
+{
+    INT32U  bytes;                                                      /* spi bytes transferred        */
+    INT32U  selects;                                                    /* chip select cycles           */
+    INT32U  rxFrames;                                                   /* frames read from RXBn        */
+    INT32U  txFrames;                                                   /* frames loaded in TXBn        */
+} CAN_SPI_STATS;
+
 class MCP_CAN
 {
     private:
@@ -41,6 +59,35 @@ class MCP_CAN
     INT8U   m_nfilhit;
     INT8U   SPICS;
 
+    INT8U   m_nIntMode;                                                 /* MCP_INTMODE_RX/TX            */
+    CAN_FRAME m_rxRing[MCP_RX_RING_SIZE];                               /* filled by the isr            */
+    volatile INT8U  m_rxHead;                                           /* written by the isr only      */
+    volatile INT8U  m_rxTail;                                           /* written by popFrame only     */
+    volatile INT16U m_rxOverflow;                                       /* frames lost, ring full       */
+    volatile INT16U m_hwOverflow;                                       /* frames lost by the mcp2515   */
+
+    CAN_FRAME m_txQueue[MCP_TX_QUEUE_SIZE];                             /* waiting for a tx buffer      */
+    INT8U   m_txQueueTicket[MCP_TX_QUEUE_SIZE];
+    INT32U  m_txQueueTime[MCP_TX_QUEUE_SIZE];                           /* millis() when queued         */
+    volatile INT8U  m_txHead;                                           /* written by sendMsgBufAsync   */
+    volatile INT8U  m_txTail;                                           /* written by loadTxBuffers     */
+    INT8U   m_txBusy;                                                   /* bit n: TXBn loaded by us     */
+    INT8U   m_txBufTicket[MCP_N_TXBUFFERS];                             /* ticket loaded in each TXBn   */
+    INT8U   m_txNextTicket;
+    volatile INT8U  m_txStatus[MCP_TX_STATUS_SIZE];                     /* CAN_TXPENDING, OK or TXFAILED*/
+    INT32U  m_txBufStart[MCP_N_TXBUFFERS];                              /* millis() when queued, TXBn   */
+    INT8U   m_txErrOff;                                                 /* MERRF interrupt off          */
+    volatile INT16U m_txErrors;                                         /* MERRF with TXERR             */
+    volatile INT16U m_txAborted;                                        /* frames given up, timeout     */
+
+    INT8U   m_nFastSpi;                                                 /* READ RX / LOAD TX / RTS      */
+#if MCP_SPI_ACCOUNTING
+    volatile CAN_SPI_STATS m_spiStats;
+#endif
+
+    static MCP_CAN *m_pIntInstance;                                     /* instance served by the isr   */
+    static void isrInt(void);
+
 /*
 *  mcp2515 driver function 
 */
@@ -80,10 +127,18 @@ private:
                                     INT8U* ext,
                                     INT32U* id );
 
-    void mcp2515_write_canMsg( const INT8U buffer_sidh_addr );          /* write can msg                */
-    void mcp2515_read_canMsg( const INT8U buffer_sidh_addr);            /* read can msg                 */
     void mcp2515_start_transmit(const INT8U mcp_addr);                  /* start transmit               */
     INT8U mcp2515_getNextFreeTXBuf(INT8U *txbuf_n);                     /* get Next free txbuf          */
+    void mcp2515_id_to_buf(const INT8U ext, const INT32U id, INT8U tbufdata[]); /* id -> SIDH..EID0 */
+    void mcp2515_buf_to_id(const INT8U tbufdata[], INT8U* ext, INT32U* id);     /* SIDH..EID0 -> id */
+    void mcp2515_read_frame(const INT8U buffer_sidh_addr, CAN_FRAME *frame); /* read can msg in a frame */
+    void mcp2515_write_frame(const INT8U buffer_sidh_addr, const CAN_FRAME *frame); /* write a frame     */
+    INT8U attachIntPin(INT8U intPin, INT8U mode);                       /* set up the INT pin isr       */
+    void serviceInterrupt(void);                                        /* isr: rx ring and tx queue    */
+    void loadTxBuffers(void);                                           /* tx queue -> free TXBn        */
+    void abortStaleTx(void);                                            /* free TXBn after timeout      */
+    void serviceTxError(void);                                          /* isr: MERRF                   */
+    INT8U queueFrame(const CAN_FRAME *frame, INT8U *ticket);            /* add a frame to the tx queue  */
 
 /*
 *  can operator function
@@ -111,6 +166,22 @@ public:
     INT32U getCanId(void);                                          /* get can id when receive      */
     INT8U isRemoteRequest(void);                                    /* get RR flag when receive     */
     INT8U isExtendedFrame(void);                                    /* did we recieve 29bit frame?  */
+
+    INT8U enableRxInterrupt(INT8U intPin);                          /* rx by INT pin into the ring  */
+    INT8U popFrame(CAN_FRAME *frame);                               /* read a frame from the ring   */
+    INT16U getRxOverflow(void);                                     /* frames lost, ring full       */
+    INT16U getHwOverflow(void);                                     /* frames lost by the mcp2515   */
+
+    INT8U enableTxInterrupt(INT8U intPin);                          /* tx completion by INT pin     */
+    INT8U sendMsgBufAsync(INT32U id, INT8U ext, INT8U len, INT8U *buf, INT8U *ticket = NULL); /* queue a frame */
+    INT8U getTxStatus(INT8U ticket);                                /* CAN_TXPENDING, OK, TXFAILED  */
+    INT8U getTxPending(void);                                       /* frames not yet on the bus    */
+    INT16U getTxErrors(void);                                       /* transmit error bursts        */
+    INT16U getTxAborted(void);                                      /* frames given up, timeout     */
+
+    void setFastSpi(INT8U on);                                      /* 0: READ/WRITE/BITMOD only    */
+    void getSpiStats(CAN_SPI_STATS *stats);                         /* needs MCP_SPI_ACCOUNTING     */
+    void resetSpiStats(void);
 };
 
 #endif
@@ -0,0 +1,208 @@
+//calcul des masques et des filtres d'acceptation du MCP2515
+//un identifiant passe si (id & mask) == (filt & mask) pour un des filtres du buffer
+//RXB0: mask 0 et filtres 0, 1 / RXB1: mask 1 et filtres 2, 3, 4, 5
+
+//verification sur PC avec les identifiants de parseCan.h: Test/linux/canfilter_test.cpp
+
+#include "canFilter.h"
+
+#define CAN_FILTER_FULL_STD 0x7FFUL      //11 bits
+#define CAN_FILTER_FULL_EXT 0x1FFFFFFFUL //29 bits
+
+//nombre de bits a 1
+static unsigned char nbBits(unsigned long val)
+{
+	unsigned char nb = 0;
+	while(val)
+	{
+		val &= val - 1;
+		nb++;
+	}
+	return nb;
+}
+
+//nombre de valeurs differentes de id & mask dans le groupe
+static unsigned char nbDistinct(const unsigned long ids[], unsigned char n, unsigned long mask)
+{
+	unsigned char nb = 0;
+	unsigned char i, j;
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < i; j++)
+			if(((ids[i] ^ ids[j]) & mask) == 0)
+				break;
+		if(j == i)
+			nb++;
+	}
+	return nb;
+}
+
+//choisit le masque d'un buffer pour que les identifiants du groupe tiennent dans nbFilt filtres
+//on enleve un par un le bit du masque qui reduit le plus le nombre de filtres necessaires
+//seuls les bits qui changent d'un identifiant a l'autre sont candidats
+//retourne le nombre de filtres differents, les filtres en trop sont des copies du premier
+static unsigned char solveGroup(const unsigned long ids[], unsigned char n, unsigned char nbFilt,
+		unsigned long full, unsigned long &mask, unsigned long filt[])
+{
+	unsigned long diff = 0, bit, best;
+	unsigned char nb, bestNb, i, j;
+
+	mask = full;
+	for(i = 1; i < n; i++)
+		diff |= ids[i] ^ ids[0];
+
+	nb = nbDistinct(ids, n, mask);
+	while(nb > nbFilt)
+	{
+		best = 0;
+		bestNb = 0;
+		for(bit = 1; bit & full; bit <<= 1)
+		{
+			if(!(bit & mask & diff))
+				continue;
+			i = nbDistinct(ids, n, mask & ~bit);
+			if(best == 0 || i < bestNb) //pas de valeur sentinelle: n peut aller jusqu'a 255
+			{
+				bestNb = i;
+				best = bit;
+			}
+		}
+		mask &= ~best;
+		nb = bestNb;
+	}
+
+	nb = 0;
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < nb; j++)
+			if(filt[j] == (ids[i] & mask))
+				break;
+		if(j == nb)
+			filt[nb++] = ids[i] & mask;
+	}
+	for(i = nb; i < nbFilt; i++)
+		filt[i] = filt[0];
+	return nb;
+}
+
+//nombre d'identifiants acceptes par les deux buffers, sans compter deux fois ceux acceptes par les deux
+static unsigned long nbAccepted(unsigned long full, unsigned long mask0, const unsigned long filt0[], unsigned char nb0,
+		unsigned long mask1, const unsigned long filt1[], unsigned char nb1)
+{
+	unsigned char width = nbBits(full);
+	unsigned long total;
+	unsigned char i, j;
+
+	total = ((unsigned long) nb0 << (width - nbBits(mask0))) + ((unsigned long) nb1 << (width - nbBits(mask1)));
+	for(i = 0; i < nb0; i++)
+		for(j = 0; j < nb1; j++)
+			if(((filt0[i] ^ filt1[j]) & mask0 & mask1) == 0)
+				total -= 1UL << (width - nbBits(mask0 | mask1));
+	return total;
+}
+
+bool canFilterSolve(const unsigned long ids[], unsigned char n, unsigned char ext, CanFilterConfig &cfg)
+{
+	unsigned long full = ext ? CAN_FILTER_FULL_EXT : CAN_FILTER_FULL_STD;
+	unsigned long wanted[CAN_FILTER_MAX_ID];
+	unsigned long rest[CAN_FILTER_MAX_ID];
+	unsigned long filt0[2], filt1[4], mask1, accepted;
+	unsigned char nbWanted = 0, nbRest, nb0, nb1;
+	unsigned char i, j, k;
+	bool found = false;
+
+	cfg.ext = ext ? 1 : 0;
+	cfg.accepted = 0xFFFFFFFFUL;
+
+	//trop d'identifiants pour chercher lesquels mettre dans RXB0: RXB1 prend tout avec un seul masque
+	//et ses 4 filtres, RXB0 recopie son masque et ses premiers filtres et ne laisse rien passer de plus
+	if(n > CAN_FILTER_MAX_ID)
+	{
+		nb1 = solveGroup(ids, n, 4, full, mask1, filt1);
+		nb0 = nb1 < 2 ? nb1 : 2;
+		cfg.mask[0] = cfg.mask[1] = mask1;
+		cfg.filt[0] = filt1[0];
+		cfg.filt[1] = filt1[nb0 - 1];
+		for(k = 0; k < 4; k++)
+			cfg.filt[2 + k] = filt1[k];
+		cfg.accepted = nbAccepted(full, mask1, cfg.filt, nb0, mask1, filt1, nb1);
+		nbWanted = nbDistinct(ids, n, full);
+		cfg.falsePositive = cfg.accepted - nbWanted;
+		cfg.falsePositiveRate = (float) cfg.falsePositive / (float) (full + 1 - nbWanted);
+		return cfg.falsePositive == 0;
+	}
+
+	//identifiants sans doublon
+	for(i = 0; i < n; i++)
+	{
+		for(j = 0; j < nbWanted; j++)
+			if(wanted[j] == (ids[i] & full))
+				break;
+		if(j == nbWanted)
+			wanted[nbWanted++] = ids[i] & full;
+	}
+	if(nbWanted == 0)
+		wanted[0] = 0; //personne a ecouter: seul l'identifiant 0 passe
+
+	//RXB0 prend 0, 1 ou 2 identifiants exacts (i, j), RXB1 se debrouille avec le reste et 4 filtres
+	//i == j: un seul identifiant dans RXB0, i == nbWanted: aucun
+	for(i = 0; i <= nbWanted && !found; i++)
+	{
+		for(j = i; j <= nbWanted && !found; j++)
+		{
+			if(j == nbWanted && i != nbWanted)
+				continue;
+			nbRest = 0;
+			for(k = 0; k < nbWanted; k++)
+				if(k != i && k != j)
+					rest[nbRest++] = wanted[k];
+
+			if(i == nbWanted)          //RXB0 vide, il ne laisse passer qu'un identifiant demande
+			{
+				filt0[0] = filt0[1] = wanted[0];
+				nb0 = 1;
+			}
+			else
+			{
+				filt0[0] = wanted[i];
+				filt0[1] = wanted[j];
+				nb0 = (i == j) ? 1 : 2;
+			}
+
+			if(nbRest == 0)            //RXB1 vide
+			{
+				mask1 = full;
+				filt1[0] = filt1[1] = filt1[2] = filt1[3] = filt0[0];
+				nb1 = 1;
+			}
+			else
+				nb1 = solveGroup(rest, nbRest, 4, full, mask1, filt1);
+
+			accepted = nbAccepted(full, full, filt0, nb0, mask1, filt1, nb1);
+			if(accepted < cfg.accepted)
+			{
+				cfg.accepted = accepted;
+				cfg.mask[0] = full;
+				cfg.mask[1] = mask1;
+				cfg.filt[0] = filt0[0];
+				cfg.filt[1] = filt0[1];
+				for(k = 0; k < 4; k++)
+					cfg.filt[2 + k] = filt1[k];
+				found = (accepted <= nbWanted);
+			}
+		}
+	}
+
+	cfg.falsePositive = cfg.accepted - nbWanted;
+	cfg.falsePositiveRate = (float) cfg.falsePositive / (float) (full + 1 - nbWanted);
+	return cfg.falsePositive == 0;
+}
+
+bool canFilterAccept(const CanFilterConfig &cfg, unsigned long id)
+{
+	unsigned char i;
+	for(i = 0; i < CAN_FILTER_NB_FILT; i++)
+		if(((id ^ cfg.filt[i]) & cfg.mask[i < 2 ? 0 : 1]) == 0)
+			return true;
+	return false;
+}
@@ -0,0 +1,54 @@
+/**
+	Romain Le Forestier
+ calcul des masques et des filtres d'acceptation du MCP2515
+ un noeud donne la liste des identifiants CAN qu'il traite, canFilterSolve choisit les 2 masques
+ et les 6 filtres pour que le MCP2515 jette le reste du trafic sans interruption ni lecture SPI
+ ne depend pas d'arduino: se compile aussi sur PC pour verifier une configuration
+*/
+
+//exemple d'utilisation:
+//	const unsigned long ids[] = { MSG_IMU_PHI_THETA_PSI, MSG_GYRO_X_Y_Z };
+//	CanFilterConfig cfg;
+//	canFilterSolve(ids, 2, CAN_STDID, cfg);
+//	canFilterApply(CAN, cfg);
+
+#ifndef _CANFILTER_
+#define _CANFILTER_
+
+#define CAN_FILTER_NB_MASK 2  //mask 0 pour RXB0, mask 1 pour RXB1
+#define CAN_FILTER_NB_FILT 6  //filtres 0 et 1 pour RXB0, 2 a 5 pour RXB1
+#define CAN_FILTER_MAX_ID 16  //au dela un seul masque pour tout, la recherche serait trop longue sur l'AVR
+
+struct CanFilterConfig
+{
+	unsigned char ext;                         //1: identifiants 29 bits
+	unsigned long mask[CAN_FILTER_NB_MASK];
+	unsigned long filt[CAN_FILTER_NB_FILT];
+	unsigned long accepted;                    //nombre d'identifiants que le MCP2515 laisse passer
+	unsigned long falsePositive;               //dont identifiants non demandes
+	float falsePositiveRate;                   //falsePositive / nombre d'identifiants non demandes
+};
+
+//cherche la configuration qui laisse passer le moins d'identifiants non demandes
+//retourne true si seul les identifiants demandes passent
+//recherche gloutonne, a appeler dans setup(): quelques ms pour une dizaine d'identifiants
+bool canFilterSolve(const unsigned long ids[], unsigned char n, unsigned char ext, CanFilterConfig &cfg);
+
+//true si le MCP2515 configure avec cfg laisse passer id
+bool canFilterAccept(const CanFilterConfig &cfg, unsigned long id);
+
+//ecrit la configuration dans le controleur (MCP_CAN ou toute classe avec init_Mask/init_Filt)
+//retourne 0 si tout les registres ont ete ecrits
+template<class CAN>
+unsigned char canFilterApply(CAN &can, const CanFilterConfig &cfg)
+{
+	unsigned char res = 0;
+	unsigned char i;
+	for(i = 0; i < CAN_FILTER_NB_MASK; i++)
+		res |= can.init_Mask(i, cfg.ext, cfg.mask[i]);
+	for(i = 0; i < CAN_FILTER_NB_FILT; i++)
+		res |= can.init_Filt(i, cfg.ext, cfg.filt[i]);
+	return res;
+}
+
+#endif
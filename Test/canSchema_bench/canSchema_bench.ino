@@ -0,0 +1,81 @@
+//mesure du temps de decoupage/reconstruction d'une trame CAN
+//compare les fonctions de ParseCan avec les descripteurs de canSchema.h
+//le resultat est affiche sur Serial1 en microseconde pour NB_ITERATION trames
+//meme mesure sur PC: Test/linux/canschema_bench.cpp
+
+#include "parseCan.h"
+#include "canSchema.h"
+
+#define NB_ITERATION 1000
+
+ParseCan parser(true);
+
+//volatile pour que le compilateur ne supprime pas les calculs
+volatile int phi = 12, theta = -3, psi = 271;
+volatile float latitude = 48.399500, longitude = -4.508204;
+volatile long sink = 0;
+
+void print_result(const char* name, unsigned long t)
+{
+  Serial1.print(name);
+  Serial1.print(": ");
+  Serial1.print(t);
+  Serial1.print("us / ");
+  Serial1.print(NB_ITERATION);
+  Serial1.println(" trames");
+}
+
+void setup()
+{
+  Serial1.begin(115200);
+  while (!Serial1) {
+    ; // wait for Serial1 port to connect. Needed for Leonardo only
+  }
+}
+
+void loop()
+{
+  unsigned char buff[8];
+  unsigned long t;
+  int i;
+
+  //trame IMU, 3 entiers
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    parser.intToUChar(buff, 0, phi);
+    parser.intToUChar(buff, 2, theta);
+    parser.intToUChar(buff, 4, psi);
+    sink += parser.ucharToInt(buff, 0) + parser.ucharToInt(buff, 2) + parser.ucharToInt(buff, 4);
+  }
+  print_result("ParseCan IMU", micros() - t);
+
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    CanMsgImu::pack(buff, phi, theta, psi);
+    sink += CanMsgImu::phi::unpack(buff) + CanMsgImu::theta::unpack(buff) + CanMsgImu::psi::unpack(buff);
+  }
+  print_result("canSchema IMU", micros() - t);
+
+  //trame GPS, 2 float
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    parser.floatToUChar(buff, 0, latitude);
+    parser.floatToUChar(buff, 4, longitude);
+    sink += (parser.ucharToFloat(buff, 0) > parser.ucharToFloat(buff, 4));
+  }
+  print_result("ParseCan GPS", micros() - t);
+
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    CanMsgGprmcLatLong::pack(buff, latitude, longitude);
+    sink += (CanMsgGprmcLatLong::latitude::unpack(buff) > CanMsgGprmcLatLong::longitude::unpack(buff));
+  }
+  print_result("canSchema GPS", micros() - t);
+
+  Serial1.println("");
+  delay(2000);
+}
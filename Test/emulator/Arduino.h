@@ -0,0 +1,181 @@
+/**
+	Romain Le Forestier
+ Arduino.h pour PC: juste ce que mcp_can.cpp, les exemples et les decodeurs SeaTalk utilisent
+ le temps est virtuel (avance avec les transferts SPI, delay() et le bus), les interruptions
+ INT du MCP2515 sont simulees par mcp2515_emu.cpp, la reception des ports serie par feed()
+*/
+
+#ifndef _ARDUINO_HOST_
+#define _ARDUINO_HOST_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW  0
+#define INPUT  0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define DEC 10
+#define HEX 16
+#define SERIAL_9N1 1
+#define HOST_SERIAL_BUFFER 64 //SERIAL_BUFFER_SIZE du HardwareSerial 9 bits
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+long random(long max);
+
+//interruptions externes, numerotation de la leonardo (broche 3 -> 0, 2 -> 1, 0 -> 2, 1 -> 3, 7 -> 4)
+int digitalPinToInterrupt(uint8_t pin);
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode);
+void detachInterrupt(uint8_t irq);
+
+//bit I du registre d'etat, SREG = old relance les interruptions en attente comme sur l'AVR
+struct SregHost
+{
+	operator uint8_t() const;
+	SregHost &operator=(uint8_t val);
+};
+extern SregHost SREG;
+void cli(void);
+void sei(void);
+#define noInterrupts() cli()
+#define interrupts() sei()
+
+//pas de memoire programme separee sur PC
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t *) (p))
+#define memcpy_P memcpy
+
+//Serial et Serial1 ecrivent sur out (la sortie standard par defaut)
+//la reception est une file de symboles 9 bits remplie par feed(), comme par l'isr de l'uart;
+//pump est appele a chaque available()/read() pour que le programme de test livre les symboles dont
+//l'heure virtuelle est arrivee
+//les symboles emis par write9/writeBlock9 (9eme bit en 0x100) vont dans une file d'emission que le
+//programme de test vide avec sent()/takeSent(), pour les renvoyer en echo comme le bus SeaTalk
+class HostSerial
+{
+	public:
+		HostSerial() : out(stdout), pump(NULL), rxOverflow(0), lastTag(0), nbRead(0), txOverflow(0), rxHead(0), rxTail(0), txHead(0), txTail(0) {}
+		void begin(unsigned long baud, int config = 0) { (void) baud; (void) config; }
+		operator bool() const { return true; }
+		int available(void)
+		{
+			if(pump != NULL)
+				pump();
+			return (rxHead - rxTail) & (HOST_SERIAL_BUFFER - 1);
+		}
+		int read(void)
+		{
+			uint16_t c;
+			if(pump != NULL)
+				pump();
+			if(rxHead == rxTail)
+				return -1;
+			c = rx[rxTail];
+			lastTag = rxTag[rxTail];
+			rxTail = (rxTail + 1) & (HOST_SERIAL_BUFFER - 1);
+			nbRead++;
+			return c;
+		}
+		//symbole recu, tag est rendu par lastTag quand il est lu
+		void feed(uint16_t c, unsigned long tag = 0)
+		{
+			unsigned int next = (rxHead + 1) & (HOST_SERIAL_BUFFER - 1);
+			if(next == rxTail)
+			{
+				rxOverflow++;
+				return;
+			}
+			rx[rxHead] = c;
+			rxTag[rxHead] = tag;
+			rxHead = next;
+		}
+		size_t write(const char *s) { return fprintf(out, "%s", s); }
+		size_t write9(uint16_t c, bool cmd = false)
+		{
+			unsigned int next = (txHead + 1) & (HOST_SERIAL_BUFFER - 1);
+			if(next == txTail)
+			{
+				txOverflow++;
+				return 1;
+			}
+			tx[txHead] = (c & 0x1FF) | (cmd ? 0x100 : 0);
+			txHead = next;
+			return 1;
+		}
+		size_t writeBlock9(const uint16_t *src, size_t n, bool firstIsCommand = false)
+		{
+			size_t i;
+			for(i = 0; i < n; i++)
+				write9(src[i], i == 0 && firstIsCommand);
+			return n;
+		}
+		size_t writeBlock9(const uint8_t *src, size_t n, bool firstIsCommand = false)
+		{
+			size_t i;
+			for(i = 0; i < n; i++)
+				write9(src[i], i == 0 && firstIsCommand);
+			return n;
+		}
+		//symboles emis pas encore repris par le programme de test
+		int sent(void) { return (txHead - txTail) & (HOST_SERIAL_BUFFER - 1); }
+		int takeSent(void)
+		{
+			uint16_t c;
+			if(txHead == txTail)
+				return -1;
+			c = tx[txTail];
+			txTail = (txTail + 1) & (HOST_SERIAL_BUFFER - 1);
+			return c;
+		}
+		//comme la version arduino: ne prend que ce qui est deja arrive
+		size_t readBlock9(uint16_t *dst, size_t max)
+		{
+			size_t n = 0;
+			while(n < max && available() > 0)
+				dst[n++] = read();
+			return n;
+		}
+		size_t print(const char *s) { return fprintf(out, "%s", s); }
+		size_t print(char c) { return fprintf(out, "%c", c); }
+		size_t print(long n, int base = DEC) { return fprintf(out, base == HEX ? "%lX" : "%ld", n); }
+		size_t print(unsigned long n, int base = DEC) { return fprintf(out, base == HEX ? "%lX" : "%lu", n); }
+		size_t print(int n, int base = DEC) { return print((long) n, base); }
+		size_t print(unsigned int n, int base = DEC) { return print((unsigned long) n, base); }
+		size_t print(unsigned char n, int base = DEC) { return print((unsigned long) n, base); }
+		size_t print(double n, int digits = 2) { return fprintf(out, "%.*f", digits, n); }
+		size_t println(void) { return fprintf(out, "\n"); }
+		template<class T> size_t println(T val) { size_t n = print(val); return n + println(); }
+		template<class T> size_t println(T val, int fmt) { size_t n = print(val, fmt); return n + println(); }
+
+		FILE *out;
+		void (*pump)(void);
+		unsigned long rxOverflow;   //symboles perdus, file pleine
+		unsigned long lastTag;      //tag du dernier symbole lu
+		unsigned long nbRead;
+		unsigned long txOverflow;   //symboles emis perdus, file d'emission pleine
+
+	private:
+		uint16_t rx[HOST_SERIAL_BUFFER];
+		unsigned long rxTag[HOST_SERIAL_BUFFER];
+		unsigned int rxHead, rxTail;
+		uint16_t tx[HOST_SERIAL_BUFFER];
+		unsigned int txHead, txTail;
+};
+extern HostSerial Serial;
+extern HostSerial Serial1;
+
+#endif
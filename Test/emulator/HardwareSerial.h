@@ -0,0 +1,11 @@
+//HardwareSerial.h pour PC: les ports serie sont des HostSerial (Arduino.h)
+//permet de compiler SeaTalk.cpp et SeaSerial.cpp tels quels
+
+#ifndef _HARDWARESERIAL_HOST_
+#define _HARDWARESERIAL_HOST_
+
+#include "Arduino.h"
+
+typedef HostSerial HardwareSerial;
+
+#endif
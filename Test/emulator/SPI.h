@@ -0,0 +1,35 @@
+/**
+	Romain Le Forestier
+ SPI.h pour PC: les octets vont au MCP2515 emule dont la broche CS est a l'etat bas
+*/
+
+#ifndef _SPI_HOST_
+#define _SPI_HOST_
+
+#include "Arduino.h"
+
+#define SPI_HAS_TRANSACTION 1
+
+#define MSBFIRST 1
+#define SPI_MODE0 0
+
+class SPISettings
+{
+	public:
+		SPISettings(uint32_t clock = 4000000, uint8_t bitOrder = MSBFIRST, uint8_t dataMode = SPI_MODE0)
+			: clock(clock) { (void) bitOrder; (void) dataMode; }
+		uint32_t clock;
+};
+
+class SPIClass
+{
+	public:
+		void begin(void) {}
+		void beginTransaction(SPISettings settings);
+		void endTransaction(void);
+		void usingInterrupt(uint8_t irq);
+		uint8_t transfer(uint8_t data);
+};
+extern SPIClass SPI;
+
+#endif
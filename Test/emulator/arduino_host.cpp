@@ -0,0 +1,249 @@
+//fonctions d'Arduino.h et SPI.h pour PC, reliees aux MCP2515 emules
+//temps virtuel en nanoseconde: un octet SPI dure 8 periodes de l'horloge SPI, delay() avance d'autant,
+//le bus est mis a jour a chaque avance et les fronts descendants de INT appellent l'isr attachee
+
+#include "Arduino.h"
+#include "SPI.h"
+#include "mcp2515_emu.h"
+
+#define HOST_NB_IRQ 5
+
+HostSerial Serial;
+HostSerial Serial1;
+SPIClass SPI;
+SregHost SREG;
+
+static uint64_t nowNs = 0;
+static Mcp2515Emu *nodes[EMU_MAX_NODES];
+static uint8_t nbNodes = 0;
+static CanBusEmu *buses[EMU_MAX_NODES];
+static uint8_t nbBuses = 0;
+static Mcp2515Emu *selected = NULL;
+
+static bool iflag = true;            //bit I de SREG
+static bool inIsr = false;
+static bool inByte = false;          //octet SPI en cours
+static void (*isrs[HOST_NB_IRQ])(void);
+static bool pending[HOST_NB_IRQ];
+static bool intHigh[EMU_MAX_NODES];
+static uint8_t spiMask = 0;          //irq masquees pendant une transaction (SPI.usingInterrupt)
+static bool inTransaction = false;
+static unsigned long spiClock = 4000000UL;
+
+void emuRegisterNode(Mcp2515Emu *node)
+{
+	if(nbNodes < EMU_MAX_NODES)
+	{
+		intHigh[nbNodes] = true;
+		nodes[nbNodes++] = node;
+	}
+}
+
+void emuRegisterBus(CanBusEmu *bus)
+{
+	if(nbBuses < EMU_MAX_NODES)
+		buses[nbBuses++] = bus;
+}
+
+uint64_t emuNowNs(void)
+{
+	return nowNs;
+}
+
+//appelle les isr dont le front est arrive, avec les interruptions coupees comme sur l'AVR
+static void dispatch(void)
+{
+	bool again = true;
+	int irq;
+
+	while(again && iflag && !inIsr && !inByte)
+	{
+		again = false;
+		for(irq = 0; irq < HOST_NB_IRQ; irq++)
+		{
+			if(!pending[irq] || isrs[irq] == NULL)
+				continue;
+			if(inTransaction && (spiMask & (1 << irq)))
+				continue;
+			pending[irq] = false;
+			inIsr = true;
+			iflag = false;
+			isrs[irq]();
+			iflag = true;
+			inIsr = false;
+			again = true;
+		}
+	}
+}
+
+//fronts descendants sur les broches INT
+static void checkInt(void)
+{
+	uint8_t i;
+	int irq;
+	bool level;
+
+	for(i = 0; i < nbNodes; i++)
+	{
+		level = nodes[i]->intLevel();
+		if(intHigh[i] && !level && nodes[i]->intPin() != EMU_NO_PIN)
+		{
+			irq = digitalPinToInterrupt(nodes[i]->intPin());
+			if(irq >= 0)
+				pending[irq] = true;
+		}
+		intHigh[i] = level;
+	}
+}
+
+void emuAdvanceNs(uint64_t ns)
+{
+	uint8_t i;
+	nowNs += ns;
+	for(i = 0; i < nbBuses; i++)
+		buses[i]->process(nowNs);
+	checkInt();
+	dispatch();
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	(void) pin;
+	(void) mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t val)
+{
+	uint8_t i;
+	for(i = 0; i < nbNodes; i++)
+	{
+		if(nodes[i]->csPin() != pin)
+			continue;
+		if(val == LOW && selected != nodes[i])
+		{
+			selected = nodes[i];
+			nodes[i]->select();
+		}
+		else if(val == HIGH && selected == nodes[i])
+		{
+			selected = NULL;
+			nodes[i]->unselect();
+			checkInt();
+		}
+	}
+}
+
+int digitalRead(uint8_t pin)
+{
+	uint8_t i;
+	for(i = 0; i < nbNodes; i++)
+		if(nodes[i]->intPin() == pin)
+			return nodes[i]->intLevel() ? HIGH : LOW;
+	return LOW;
+}
+
+unsigned long millis(void)
+{
+	return (unsigned long) (nowNs / 1000000ULL);
+}
+
+unsigned long micros(void)
+{
+	return (unsigned long) (nowNs / 1000ULL);
+}
+
+void delay(unsigned long ms)
+{
+	emuAdvanceNs((uint64_t) ms * 1000000ULL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	emuAdvanceNs((uint64_t) us * 1000ULL);
+}
+
+//meme suite a chaque execution, pour que les bancs soient reproductibles
+long random(long max)
+{
+	static uint32_t state = 1;
+	state = state * 1103515245UL + 12345UL;
+	return max > 0 ? (long) ((state >> 8) % (uint32_t) max) : 0;
+}
+
+int digitalPinToInterrupt(uint8_t pin)
+{
+	switch(pin)
+	{
+		case 3: return 0;
+		case 2: return 1;
+		case 0: return 2;
+		case 1: return 3;
+		case 7: return 4;
+	}
+	return -1;
+}
+
+void attachInterrupt(uint8_t irq, void (*isr)(void), int mode)
+{
+	(void) mode; //le MCP2515 ne fait que des fronts descendants
+	if(irq < HOST_NB_IRQ)
+		isrs[irq] = isr;
+}
+
+void detachInterrupt(uint8_t irq)
+{
+	if(irq < HOST_NB_IRQ)
+		isrs[irq] = NULL;
+}
+
+SregHost::operator uint8_t() const
+{
+	return iflag ? 0x80 : 0;
+}
+
+SregHost &SregHost::operator=(uint8_t val)
+{
+	iflag = (val & 0x80) != 0;
+	dispatch();
+	return *this;
+}
+
+void cli(void)
+{
+	iflag = false;
+}
+
+void sei(void)
+{
+	iflag = true;
+	dispatch();
+}
+
+void SPIClass::beginTransaction(SPISettings settings)
+{
+	spiClock = settings.clock;
+	inTransaction = true;
+}
+
+void SPIClass::endTransaction(void)
+{
+	inTransaction = false;
+	dispatch();
+}
+
+void SPIClass::usingInterrupt(uint8_t irq)
+{
+	if(irq < 8)
+		spiMask |= 1 << irq;
+}
+
+uint8_t SPIClass::transfer(uint8_t data)
+{
+	uint8_t ret = selected != NULL ? selected->transfer(data) : 0xFF;
+	//le transfert dure 8 periodes d'horloge, l'isr ne peut pas couper l'octet
+	inByte = true;
+	emuAdvanceNs(8ULL * 1000000000ULL / spiClock);
+	inByte = false;
+	dispatch();
+	return ret;
+}
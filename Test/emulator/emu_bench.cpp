@@ -0,0 +1,144 @@
+//banc de mesure de mcp_can.cpp (copie de UM6_CAN_ex, sans modification) sur MCP2515 emules
+//deux noeuds sur le meme bus a 500kbit/s: un emetteur (CS 9, INT 3) et un recepteur (CS 10, INT 2)
+//affiche les transactions SPI par operation et l'occupation du bus
+//compilation: g++ -O2 -I. -I../UM6_CAN_ex -o emu_bench emu_bench.cpp mcp2515_emu.cpp arduino_host.cpp ../UM6_CAN_ex/mcp_can.cpp
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "SPI.h"
+#include "mcp2515_emu.h"
+#include "mcp_can.h"
+
+#define NB_TRAME 200
+
+static const char *instrName[EMU_NB_INSTR] = { "RESET", "READ", "WRITE", "BITMOD", "READ STATUS",
+	"RX STATUS", "LOAD TX", "RTS", "READ RX" };
+
+CanBusEmu bus;
+Mcp2515Emu chipTx(9, 3, bus);
+Mcp2515Emu chipRx(10, 2, bus);
+MCP_CAN canTx(9);
+MCP_CAN canRx(10);
+
+static void printStats(const char *name, const EmuSpiStats &stats, unsigned long nb)
+{
+	int i;
+	printf("  %-10s %6.1f octets/trame %5.2f CS/trame  (", name, (double) stats.bytes / nb, (double) stats.selects / nb);
+	for(i = 0; i < EMU_NB_INSTR; i++)
+		if(stats.instr[i])
+			printf(" %s:%.2f", instrName[i], (double) stats.instr[i] / nb);
+	printf(" )\n");
+}
+
+//mode du recepteur par BIT MODIFY de CANCTRL, hors de MCP_CAN: en configuration il n'acquitte plus
+static void setRxMode(unsigned char mode)
+{
+	digitalWrite(10, LOW);
+	SPI.transfer(0x05);
+	SPI.transfer(0x0F);
+	SPI.transfer(0xE0);
+	SPI.transfer(mode);
+	digitalWrite(10, HIGH);
+}
+
+//le recepteur lit par interruption, l'emetteur envoie NB_TRAME trames a la suite
+static void bench(const char *name, unsigned char fast)
+{
+	unsigned char buff[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	CAN_FRAME frame;
+	uint64_t start, busyStart;
+	unsigned long nbRx = 0;
+	int i;
+
+	canTx.setFastSpi(fast);
+	canRx.setFastSpi(fast);
+	while(canRx.popFrame(&frame) == CAN_OK)
+		;
+	chipTx.resetStats();
+	chipRx.resetStats();
+	start = emuNowNs();
+	busyStart = bus.busyNs;
+
+	for(i = 0; i < NB_TRAME; i++)
+	{
+		canTx.sendMsgBuf(0x50 + (i & 1), 0, 8, buff);
+		while(canRx.popFrame(&frame) == CAN_OK)
+			nbRx++;
+	}
+	delay(1);
+	while(canRx.popFrame(&frame) == CAN_OK)
+		nbRx++;
+
+	printf("%s: %lu trames recues, %lu perdues, bus occupe a %.0f%%, %.0fus/trame\n", name, nbRx,
+		(unsigned long) canRx.getRxOverflow() + canRx.getHwOverflow(),
+		100.0 * bus.occupancy(start, emuNowNs(), busyStart), (double) (emuNowNs() - start) / 1000.0 / NB_TRAME);
+	printStats("emission", chipTx.stats, NB_TRAME);
+	printStats("reception", chipRx.stats, nbRx ? nbRx : 1);
+}
+
+int main()
+{
+	EmuFrame frame = { 0x50, 0, 0, 8, { 1, 2, 3, 4, 5, 6, 7, 8 } };
+
+	if(canTx.begin(CAN_500KBPS) != CAN_OK || canRx.begin(CAN_500KBPS) != CAN_OK)
+	{
+		printf("init MCP2515 emule en echec\n");
+		return 1;
+	}
+	printf("bit: %luns, trame standard de 8 octets: %u bits\n", chipTx.bitTimeNs(), CanBusEmu::frameBits(frame));
+
+	canRx.enableRxInterrupt(2);
+	bench("sendMsgBuf, READ/WRITE/BIT MODIFY", 0);
+	bench("sendMsgBuf, READ RX/LOAD TX/RTS", 1);
+
+	//une seule instance de MCP_CAN a l'isr (m_pIntInstance): l'emission passe en interruption,
+	//le recepteur ne sert plus qu'a acquitter
+	canTx.enableTxInterrupt(3);
+	{
+		unsigned char buff[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+		uint64_t start = emuNowNs(), busyStart = bus.busyNs;
+		unsigned long frames = bus.frames;
+		int i;
+
+		chipTx.resetStats();
+		for(i = 0; i < NB_TRAME; i++)
+		{
+			while(canTx.sendMsgBufAsync(0x50, 0, 8, buff) != CAN_OK)
+				delayMicroseconds(10); //file pleine, loop() ferait autre chose
+		}
+		while(canTx.getTxPending())
+			delayMicroseconds(10);
+		printf("sendMsgBufAsync, emission par TXnIF: %lu trames, bus occupe a %.0f%%, %.0fus/trame\n", bus.frames - frames,
+			100.0 * bus.occupancy(start, emuNowNs(), busyStart), (double) (emuNowNs() - start) / 1000.0 / NB_TRAME);
+		printStats("emission", chipTx.stats, NB_TRAME);
+	}
+
+	//emetteur seul sur le bus: personne n'acquitte, les trames chargees sont abandonnees apres
+	//MCP_TX_TIMEOUT_MS et la file ne reste pas pleine
+	{
+		unsigned char buff[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+		INT8U tickets[MCP_TX_QUEUE_SIZE], ok;
+		unsigned long frames = bus.frames;
+		int i, nb = 0, failed = 0;
+
+		setRxMode(0x80);
+		for(i = 0; i < MCP_TX_QUEUE_SIZE + 2; i++)
+			if(canTx.sendMsgBufAsync(0x50, 0, 8, buff, &tickets[nb]) == CAN_OK)
+				nb++;
+		delay(MCP_TX_TIMEOUT_MS * 3);
+		for(i = 0; i < nb; i++)
+			if(canTx.getTxStatus(tickets[i]) == CAN_TXFAILED)
+				failed++;
+		printf("noeud seul: %d trames en file, %d abandonnees (%u), %u rafales d'erreur, %u en attente, %lu acquittees\n",
+			nb, failed, canTx.getTxAborted(), canTx.getTxErrors(), canTx.getTxPending(), bus.frames - frames);
+
+		setRxMode(0x00);
+		canTx.sendMsgBufAsync(0x50, 0, 8, buff, &ok);
+		delay(10);
+		printf("recepteur revenu: trame %s, %u en attente\n", canTx.getTxStatus(ok) == CAN_OK ? "acquittee" : "perdue",
+			canTx.getTxPending());
+		if(failed != nb || canTx.getTxStatus(ok) != CAN_OK)
+			return 1;
+	}
+	return 0;
+}
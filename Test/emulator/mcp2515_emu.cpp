@@ -0,0 +1,697 @@
+//emulation du MCP2515 (registres, buffers, filtres, modes) et du bus CAN qui relie plusieurs circuits
+//les adresses et les bits sont ceux de la datasheet Microchip DS20001801
+
+#include <string.h>
+#include "mcp2515_emu.h"
+
+//registres
+#define REG_CANSTAT  0x0E
+#define REG_CANCTRL  0x0F
+#define REG_TEC      0x1C
+#define REG_REC      0x1D
+#define REG_RXM0SIDH 0x20
+#define REG_RXM1SIDH 0x24
+#define REG_CNF3     0x28
+#define REG_CNF2     0x29
+#define REG_CNF1     0x2A
+#define REG_CANINTE  0x2B
+#define REG_CANINTF  0x2C
+#define REG_EFLG     0x2D
+#define REG_TXB0CTRL 0x30
+#define REG_RXB0CTRL 0x60
+#define REG_RXB1CTRL 0x70
+
+#define TXB_CTRL(n)  (REG_TXB0CTRL + ((n) << 4))
+#define RXB_CTRL(n)  (REG_RXB0CTRL + ((n) << 4))
+
+//bits
+#define MODE_MASK    0xE0
+#define MODE_NORMAL  0x00
+#define MODE_SLEEP   0x20
+#define MODE_LOOP    0x40
+#define MODE_LISTEN  0x60
+#define MODE_CONFIG  0x80
+#define TXREQ        0x08
+#define ABTF         0x40
+#define MLOA         0x20
+#define TXERR        0x10
+#define MERRF        0x80
+#define TXP_MASK     0x03
+#define RX0IF        0x01
+#define RX1IF        0x02
+#define TX0IF        0x04
+#define ERRIF        0x20
+#define RX0OVR       0x40
+#define RX1OVR       0x80
+#define TXEP         0x10
+#define TXWAR        0x04
+#define EWARN        0x01
+#define EXIDE        0x08 //dans SIDL
+#define SRR          0x10 //dans RXBnSIDL, trame standard de requete
+#define RTR          0x40 //dans DLC
+#define RXRTR        0x08 //dans RXBnCTRL
+#define BUKT         0x04 //dans RXB0CTRL
+#define RXM_ANY      0x60
+
+//etats de l'instruction SPI
+enum { ST_CMD, ST_READ_ADDR, ST_READ, ST_WRITE_ADDR, ST_WRITE, ST_BM_ADDR, ST_BM_MASK, ST_BM_DATA,
+	ST_STATUS, ST_RX_STATUS, ST_DONE };
+
+//adresses des filtres: RXF0, RXF1, RXF2, RXF3, RXF4, RXF5
+static const uint8_t filtAddr[6] = { 0x00, 0x04, 0x08, 0x10, 0x14, 0x18 };
+
+static uint32_t sidOf(const uint8_t r[]) { return ((uint32_t) r[0] << 3) | (r[1] >> 5); }
+static uint32_t eidOf(const uint8_t r[]) { return ((uint32_t) (r[1] & 0x03) << 16) | ((uint32_t) r[2] << 8) | r[3]; }
+
+Mcp2515Emu::Mcp2515Emu(uint8_t csPin, uint8_t intPin, CanBusEmu &bus, unsigned long oscHz)
+	: m_csPin(csPin), m_intPin(intPin), m_oscHz(oscHz), m_bus(bus)
+{
+	reset();
+	resetStats();
+	m_state = ST_DONE;
+	m_rxClear = 0;
+	bus.attach(this);
+	emuRegisterNode(this);
+}
+
+void Mcp2515Emu::resetStats(void)
+{
+	memset(&stats, 0, sizeof(stats));
+}
+
+//etat apres la mise sous tension ou l'instruction RESET: mode configuration, tout a 0
+void Mcp2515Emu::reset(void)
+{
+	memset(m_reg, 0, sizeof(m_reg));
+	m_reg[REG_CANCTRL] = 0x87;
+	m_reg[REG_CANSTAT] = MODE_CONFIG;
+	m_txReqTime[0] = m_txReqTime[1] = m_txReqTime[2] = 0;
+	m_abortReq[0] = m_abortReq[1] = m_abortReq[2] = false;
+}
+
+//CANSTAT et CANCTRL se lisent a toutes les adresses xE et xF
+uint8_t Mcp2515Emu::readReg(uint8_t addr) const
+{
+	addr &= 0x7F;
+	if((addr & 0x0F) == 0x0E)
+		return m_reg[REG_CANSTAT];
+	if((addr & 0x0F) == 0x0F)
+		return m_reg[REG_CANCTRL];
+	return m_reg[addr];
+}
+
+void Mcp2515Emu::writeReg(uint8_t addr, uint8_t val)
+{
+	int n;
+	addr &= 0x7F;
+
+	if((addr & 0x0F) == 0x0E)
+		return; //CANSTAT en lecture seule
+
+	if((addr & 0x0F) == 0x0F)
+	{
+		//le changement de mode est immediat, le bus n'a pas de trame a finir
+		m_reg[REG_CANCTRL] = val;
+		m_reg[REG_CANSTAT] = (m_reg[REG_CANSTAT] & ~MODE_MASK) | (val & MODE_MASK);
+		return;
+	}
+
+	if(addr == TXB_CTRL(0) || addr == TXB_CTRL(1) || addr == TXB_CTRL(2))
+	{
+		n = (addr - REG_TXB0CTRL) >> 4;
+		if((val & TXREQ) && !(m_reg[addr] & TXREQ))
+		{
+			m_txReqTime[n] = emuNowNs();
+			m_reg[addr] &= ~(ABTF | MLOA | TXERR);
+		}
+		if(!(val & TXREQ) && (m_reg[addr] & TXREQ))
+		{
+			//abandon: la trame en cours sur le bus va jusqu'au bout, TXREQ tombe a la fin
+			if(m_bus.sending(this, n))
+			{
+				m_abortReq[n] = true;
+				val |= TXREQ;
+			}
+			else
+				m_reg[addr] |= ABTF;
+		}
+		m_reg[addr] = (m_reg[addr] & ~(TXREQ | TXP_MASK)) | (val & (TXREQ | TXP_MASK));
+		return;
+	}
+
+	switch(addr)
+	{
+		case REG_EFLG: //seul les bits de debordement s'effacent
+			m_reg[addr] = (m_reg[addr] & ~(RX0OVR | RX1OVR)) | (val & m_reg[addr] & (RX0OVR | RX1OVR));
+			return;
+		case REG_RXB0CTRL:
+			m_reg[addr] = (m_reg[addr] & ~(RXM_ANY | BUKT)) | (val & (RXM_ANY | BUKT));
+			return;
+		case REG_RXB1CTRL:
+			m_reg[addr] = (m_reg[addr] & ~RXM_ANY) | (val & RXM_ANY);
+			return;
+		case REG_TEC:
+		case REG_REC:
+			return;
+	}
+	m_reg[addr] = val;
+}
+
+uint8_t Mcp2515Emu::readStatus(void) const
+{
+	uint8_t intf = m_reg[REG_CANINTF];
+	uint8_t st = intf & (RX0IF | RX1IF);
+	int n;
+	for(n = 0; n < 3; n++)
+	{
+		if(m_reg[TXB_CTRL(n)] & TXREQ)
+			st |= 0x04 << (2 * n);
+		if(intf & (TX0IF << n))
+			st |= 0x08 << (2 * n);
+	}
+	return st;
+}
+
+uint8_t Mcp2515Emu::rxStatus(void) const
+{
+	uint8_t intf = m_reg[REG_CANINTF];
+	uint8_t st = 0;
+	int rxb;
+
+	if(intf & RX0IF)
+		st |= 0x40;
+	if(intf & RX1IF)
+		st |= 0x80;
+	if(!(intf & (RX0IF | RX1IF)))
+		return st;
+	rxb = (intf & RX0IF) ? 0 : 1;
+	if(m_reg[RXB_CTRL(rxb) + 2] & EXIDE)
+		st |= 0x10;
+	if(m_reg[RXB_CTRL(rxb)] & RXRTR)
+		st |= 0x08;
+	st |= (rxb == 0) ? (m_reg[RXB_CTRL(0)] & 0x01) : (m_reg[RXB_CTRL(1)] & 0x07);
+	return st;
+}
+
+bool Mcp2515Emu::intLevel(void) const
+{
+	return (m_reg[REG_CANINTE] & m_reg[REG_CANINTF]) == 0;
+}
+
+void Mcp2515Emu::select(void)
+{
+	stats.selects++;
+	m_state = ST_CMD;
+	m_rxClear = 0;
+}
+
+//READ RX BUFFER efface RXnIF quand CS remonte
+void Mcp2515Emu::unselect(void)
+{
+	if(m_rxClear)
+		m_reg[REG_CANINTF] &= ~m_rxClear;
+	m_rxClear = 0;
+	m_state = ST_DONE;
+}
+
+uint8_t Mcp2515Emu::transfer(uint8_t data)
+{
+	uint8_t ret = 0;
+	int n;
+
+	stats.bytes++;
+	switch(m_state)
+	{
+		case ST_CMD:
+			m_state = ST_DONE;
+			if(data == 0xC0)
+			{
+				stats.instr[EMU_RESET]++;
+				reset();
+			}
+			else if(data == 0x03)
+			{
+				stats.instr[EMU_READ]++;
+				m_state = ST_READ_ADDR;
+			}
+			else if(data == 0x02)
+			{
+				stats.instr[EMU_WRITE]++;
+				m_state = ST_WRITE_ADDR;
+			}
+			else if(data == 0x05)
+			{
+				stats.instr[EMU_BITMOD]++;
+				m_state = ST_BM_ADDR;
+			}
+			else if(data == 0xA0)
+			{
+				stats.instr[EMU_READ_STATUS]++;
+				m_state = ST_STATUS;
+			}
+			else if(data == 0xB0)
+			{
+				stats.instr[EMU_RX_STATUS]++;
+				m_state = ST_RX_STATUS;
+			}
+			else if((data & 0xF8) == 0x40 && (data & 0x07) <= 5)
+			{
+				//LOAD TX BUFFER: 0x40 TXB0SIDH, 0x41 TXB0D0, 0x42 TXB1SIDH...
+				stats.instr[EMU_LOAD_TX]++;
+				m_addr = TXB_CTRL((data & 0x07) >> 1) + ((data & 0x01) ? 6 : 1);
+				m_state = ST_WRITE;
+			}
+			else if((data & 0xF8) == 0x80)
+			{
+				stats.instr[EMU_RTS]++;
+				for(n = 0; n < 3; n++)
+					if(data & (1 << n))
+						writeReg(TXB_CTRL(n), m_reg[TXB_CTRL(n)] | TXREQ);
+			}
+			else if((data & 0xF9) == 0x90)
+			{
+				//READ RX BUFFER: 0x90 RXB0SIDH, 0x92 RXB0D0, 0x94 RXB1SIDH, 0x96 RXB1D0
+				stats.instr[EMU_READ_RX]++;
+				n = (data >> 2) & 0x01;
+				m_addr = RXB_CTRL(n) + ((data & 0x02) ? 6 : 1);
+				m_rxClear = n ? RX1IF : RX0IF;
+				m_state = ST_READ;
+			}
+			break;
+		case ST_READ_ADDR:
+			m_addr = data;
+			m_state = ST_READ;
+			break;
+		case ST_READ:
+			ret = readReg(m_addr);
+			m_addr = (m_addr + 1) & 0x7F;
+			break;
+		case ST_WRITE_ADDR:
+			m_addr = data;
+			m_state = ST_WRITE;
+			break;
+		case ST_WRITE:
+			writeReg(m_addr, data);
+			m_addr = (m_addr + 1) & 0x7F;
+			break;
+		case ST_BM_ADDR:
+			m_addr = data;
+			m_state = ST_BM_MASK;
+			break;
+		case ST_BM_MASK:
+			m_mask = data;
+			m_state = ST_BM_DATA;
+			break;
+		case ST_BM_DATA:
+			writeReg(m_addr, (readReg(m_addr) & ~m_mask) | (data & m_mask));
+			m_state = ST_DONE;
+			break;
+		case ST_STATUS:
+			ret = readStatus(); //l'octet est repete tant que CS reste bas
+			break;
+		case ST_RX_STATUS:
+			ret = rxStatus();
+			break;
+		default:
+			break;
+	}
+	return ret;
+}
+
+uint8_t Mcp2515Emu::mode(void) const
+{
+	return m_reg[REG_CANSTAT] & MODE_MASK;
+}
+
+//Tbit = (SyncSeg + PropSeg + PS1 + PS2) * 2 * (BRP + 1) / Fosc
+unsigned long Mcp2515Emu::bitTimeNs(void) const
+{
+	unsigned long brp = (m_reg[REG_CNF1] & 0x3F) + 1;
+	unsigned long ntq = 1 + ((m_reg[REG_CNF2] & 0x07) + 1) + (((m_reg[REG_CNF2] >> 3) & 0x07) + 1)
+			+ ((m_reg[REG_CNF3] & 0x07) + 1);
+	return (unsigned long) ((uint64_t) 2 * brp * ntq * 1000000000ULL / m_oscHz);
+}
+
+//buffer pret a emettre: priorite TXP la plus haute, puis le numero de buffer le plus grand
+int Mcp2515Emu::nextTx(uint64_t &reqTimeNs) const
+{
+	int n, best = -1;
+	for(n = 0; n < 3; n++)
+	{
+		if(!(m_reg[TXB_CTRL(n)] & TXREQ))
+			continue;
+		if(best < 0 || (m_reg[TXB_CTRL(n)] & TXP_MASK) >= (m_reg[TXB_CTRL(best)] & TXP_MASK))
+			best = n;
+	}
+	if(best >= 0)
+		reqTimeNs = m_txReqTime[best];
+	return best;
+}
+
+void Mcp2515Emu::txFrame(int txb, EmuFrame &frame) const
+{
+	const uint8_t *r = &m_reg[TXB_CTRL(txb) + 1];
+	frame.ext = (r[1] & EXIDE) ? 1 : 0;
+	frame.id = frame.ext ? (sidOf(r) << 18) | eidOf(r) : sidOf(r);
+	frame.rtr = (r[4] & RTR) ? 1 : 0;
+	frame.dlc = r[4] & 0x0F;
+	if(frame.dlc > 8)
+		frame.dlc = 8;
+	memcpy(frame.data, &r[5], frame.dlc);
+}
+
+void Mcp2515Emu::txDone(int txb)
+{
+	m_reg[TXB_CTRL(txb)] &= ~(TXREQ | TXERR);
+	m_abortReq[txb] = false;
+	m_reg[REG_CANINTF] |= TX0IF << txb;
+	if(m_reg[REG_TEC])
+		m_reg[REG_TEC]--;
+}
+
+//erreur d'acquittement: TXERR et MERRF, le circuit reessaie sauf abandon demande pendant la trame
+//le compteur ne monte plus une fois en erreur passive
+void Mcp2515Emu::txNoAck(int txb)
+{
+	m_reg[TXB_CTRL(txb)] |= TXERR;
+	m_reg[REG_CANINTF] |= MERRF;
+	if(m_abortReq[txb])
+	{
+		m_reg[TXB_CTRL(txb)] = (m_reg[TXB_CTRL(txb)] & ~TXREQ) | ABTF;
+		m_abortReq[txb] = false;
+	}
+	if(m_reg[REG_TEC] < 128)
+		m_reg[REG_TEC] += 8;
+	if(m_reg[REG_TEC] >= 96)
+		m_reg[REG_EFLG] |= TXWAR | EWARN;
+	if(m_reg[REG_TEC] >= 128)
+		m_reg[REG_EFLG] |= TXEP;
+}
+
+//un filtre accepte la trame si les bits du masque sont egaux, et si le type (standard/etendu) est le meme
+//en standard les bits EID du masque comparent les 2 premiers octets de donnees
+bool Mcp2515Emu::match(uint8_t fAddr, uint8_t mAddr, const EmuFrame &frame) const
+{
+	const uint8_t *f = &m_reg[fAddr];
+	const uint8_t *m = &m_reg[mAddr];
+
+	if(((f[1] & EXIDE) ? 1 : 0) != frame.ext)
+		return false;
+	if(frame.ext)
+	{
+		uint32_t fid = (sidOf(f) << 18) | eidOf(f);
+		uint32_t mid = (sidOf(m) << 18) | eidOf(m);
+		return ((frame.id ^ fid) & mid) == 0;
+	}
+	if(((frame.id ^ sidOf(f)) & sidOf(m)) != 0)
+		return false;
+	if(frame.dlc > 0 && ((frame.data[0] ^ f[2]) & m[2]) != 0)
+		return false;
+	if(frame.dlc > 1 && ((frame.data[1] ^ f[3]) & m[3]) != 0)
+		return false;
+	return true;
+}
+
+void Mcp2515Emu::store(uint8_t rxb, uint8_t filhit, const EmuFrame &frame)
+{
+	uint8_t *r = &m_reg[RXB_CTRL(rxb)];
+	uint32_t sid = frame.ext ? frame.id >> 18 : frame.id;
+
+	r[0] = (r[0] & (rxb == 0 ? (RXM_ANY | BUKT) : RXM_ANY)) | (frame.rtr ? RXRTR : 0) | filhit;
+	r[1] = (uint8_t) (sid >> 3);
+	r[2] = (uint8_t) ((sid & 0x07) << 5);
+	if(frame.ext)
+	{
+		r[2] |= EXIDE | ((frame.id >> 16) & 0x03);
+		r[3] = (uint8_t) (frame.id >> 8);
+		r[4] = (uint8_t) frame.id;
+		r[5] = frame.dlc | (frame.rtr ? RTR : 0);
+	}
+	else
+	{
+		r[2] |= frame.rtr ? SRR : 0;
+		r[3] = 0;
+		r[4] = 0;
+		r[5] = frame.dlc;
+	}
+	memcpy(&r[6], frame.data, frame.dlc);
+	m_reg[REG_CANINTF] |= rxb == 0 ? RX0IF : RX1IF;
+}
+
+void Mcp2515Emu::rxFrame(const EmuFrame &frame)
+{
+	uint8_t md = mode();
+	int n;
+
+	if(md != MODE_NORMAL && md != MODE_LISTEN && md != MODE_LOOP)
+		return;
+
+	//RXB0: masque 0, filtres 0 et 1
+	for(n = 0; n < 2; n++)
+	{
+		if((m_reg[REG_RXB0CTRL] & RXM_ANY) != RXM_ANY && !match(filtAddr[n], REG_RXM0SIDH, frame))
+			continue;
+		if(!(m_reg[REG_CANINTF] & RX0IF))
+			store(0, n, frame);
+		else if((m_reg[REG_RXB0CTRL] & BUKT) && !(m_reg[REG_CANINTF] & RX1IF))
+			store(1, n, frame); //rollover: FILHIT 0 ou 1 dans RXB1
+		else
+		{
+			m_reg[REG_EFLG] |= RX0OVR;
+			m_reg[REG_CANINTF] |= ERRIF;
+		}
+		return;
+	}
+
+	//RXB1: masque 1, filtres 2 a 5
+	for(n = 2; n < 6; n++)
+	{
+		if((m_reg[REG_RXB1CTRL] & RXM_ANY) != RXM_ANY && !match(filtAddr[n], REG_RXM1SIDH, frame))
+			continue;
+		if(!(m_reg[REG_CANINTF] & RX1IF))
+			store(1, n, frame);
+		else
+		{
+			m_reg[REG_EFLG] |= RX1OVR;
+			m_reg[REG_CANINTF] |= ERRIF;
+		}
+		return;
+	}
+}
+
+//bus
+
+CanBusEmu::CanBusEmu()
+{
+	m_nbNodes = 0;
+	m_busFreeAt = 0;
+	m_inflight = false;
+	m_processing = false;
+	resetStats();
+	emuRegisterBus(this);
+}
+
+void CanBusEmu::attach(Mcp2515Emu *node)
+{
+	if(m_nbNodes < EMU_MAX_NODES)
+		m_nodes[m_nbNodes++] = node;
+}
+
+void CanBusEmu::resetStats(void)
+{
+	frames = 0;
+	errors = 0;
+	bits = 0;
+	busyNs = 0;
+}
+
+float CanBusEmu::occupancy(uint64_t sinceNs, uint64_t nowNs, uint64_t busyAtStartNs) const
+{
+	if(nowNs <= sinceNs)
+		return 0;
+	return (float) (busyNs - busyAtStartNs) / (float) (nowNs - sinceNs);
+}
+
+//SOF jusqu'au CRC avec bourrage (un bit inverse apres 5 bits egaux), puis delimiteur, ACK, EOF et IFS
+unsigned int CanBusEmu::frameBits(const EmuFrame &frame)
+{
+	uint8_t stream[128];
+	unsigned int n = 0, i, run, stuffed;
+	uint16_t crc = 0;
+	uint8_t last;
+	int b;
+
+	#define PUSH(val, nb) for(b = (nb) - 1; b >= 0; b--) stream[n++] = ((val) >> b) & 1
+	PUSH(0, 1);                                   //SOF
+	if(frame.ext)
+	{
+		PUSH(frame.id >> 18, 11);
+		PUSH(1, 1);                               //SRR
+		PUSH(1, 1);                               //IDE
+		PUSH(frame.id & 0x3FFFF, 18);
+		PUSH(frame.rtr, 1);
+		PUSH(0, 2);                               //r1 r0
+	}
+	else
+	{
+		PUSH(frame.id, 11);
+		PUSH(frame.rtr, 1);
+		PUSH(0, 2);                               //IDE r0
+	}
+	PUSH(frame.dlc, 4);
+	if(!frame.rtr)
+		for(i = 0; i < frame.dlc; i++)
+			PUSH(frame.data[i], 8);
+
+	for(i = 0; i < n; i++)                        //CRC-15 CAN, polynome 0x4599
+	{
+		uint8_t nxt = stream[i] ^ ((crc >> 14) & 1);
+		crc = (crc << 1) & 0x7FFF;
+		if(nxt)
+			crc ^= 0x4599;
+	}
+	PUSH(crc, 15);
+	#undef PUSH
+
+	stuffed = 0;
+	run = 1;
+	last = stream[0];
+	for(i = 1; i < n; i++)
+	{
+		if(stream[i] == last)
+		{
+			run++;
+			if(run == 5)
+			{
+				stuffed++;
+				last = !last; //le bit de bourrage compte dans la suite
+				run = 1;
+			}
+		}
+		else
+		{
+			last = stream[i];
+			run = 1;
+		}
+	}
+	return n + stuffed + 1 + 2 + 7 + 3;
+}
+
+//cle d'arbitrage: le bit dominant (0) gagne, une trame standard passe avant une etendue de meme SID
+static uint32_t arbitrationKey(const EmuFrame &frame)
+{
+	if(frame.ext)
+		return ((frame.id >> 18) << 21) | (1UL << 20) | (1UL << 19) | ((frame.id & 0x3FFFF) << 1) | frame.rtr;
+	return (frame.id << 21) | ((uint32_t) frame.rtr << 20);
+}
+
+bool CanBusEmu::sending(const Mcp2515Emu *node, int txb) const
+{
+	return m_inflight && m_sender == node && m_senderTxb == txb;
+}
+
+void CanBusEmu::process(uint64_t nowNs)
+{
+	uint64_t t0, req, minReq;
+	uint32_t key, bestKey;
+	int i, txb, best, bestTxb;
+	bool acked;
+	EmuFrame frame;
+
+	if(m_processing)
+		return;
+	m_processing = true;
+
+	//mode loopback: la trame revient au circuit sans passer sur le bus
+	for(i = 0; i < m_nbNodes; i++)
+	{
+		if(m_nodes[i]->mode() != MODE_LOOP)
+			continue;
+		while((txb = m_nodes[i]->nextTx(req)) >= 0)
+		{
+			m_nodes[i]->txFrame(txb, frame);
+			m_nodes[i]->rxFrame(frame);
+			m_nodes[i]->txDone(txb);
+		}
+	}
+
+	while(1)
+	{
+		if(m_inflight)
+		{
+			if(m_inflightEnd > nowNs)
+				break;
+			acked = false;
+			for(i = 0; i < m_nbNodes; i++)
+			{
+				if(m_nodes[i] == m_sender)
+					continue;
+				m_nodes[i]->rxFrame(m_frame);
+				if(m_nodes[i]->mode() == MODE_NORMAL)
+					acked = true;
+			}
+			bits += frameBits(m_frame);
+			busyNs += m_inflightEnd - m_busFreeAt;
+			if(acked)
+			{
+				frames++;
+				m_sender->txDone(m_senderTxb);
+			}
+			else
+			{
+				errors++;
+				m_sender->txNoAck(m_senderTxb); //TXREQ reste a 1, le circuit reessaie
+			}
+			m_busFreeAt = m_inflightEnd;
+			m_inflight = false;
+			continue;
+		}
+
+		//arbitrage entre les trames demandees avant que le bus soit libre
+		minReq = 0;
+		best = -1;
+		for(i = 0; i < m_nbNodes; i++)
+		{
+			if(m_nodes[i]->mode() != MODE_NORMAL)
+				continue;
+			if(m_nodes[i]->nextTx(req) < 0)
+				continue;
+			if(best < 0 || req < minReq)
+				minReq = req;
+			best = i;
+		}
+		if(best < 0)
+			break;
+		t0 = minReq > m_busFreeAt ? minReq : m_busFreeAt;
+		if(t0 > nowNs)
+			break;
+
+		best = -1;
+		bestKey = 0;
+		bestTxb = -1;
+		for(i = 0; i < m_nbNodes; i++)
+		{
+			if(m_nodes[i]->mode() != MODE_NORMAL)
+				continue;
+			txb = m_nodes[i]->nextTx(req);
+			if(txb < 0 || req > t0)
+				continue;
+			m_nodes[i]->txFrame(txb, frame);
+			key = arbitrationKey(frame);
+			if(best < 0 || key < bestKey)
+			{
+				best = i;
+				bestKey = key;
+				bestTxb = txb;
+				m_frame = frame;
+			}
+		}
+		m_sender = m_nodes[best];
+		m_senderTxb = bestTxb;
+		m_busFreeAt = t0;
+		m_inflightEnd = t0 + (uint64_t) frameBits(m_frame) * m_sender->bitTimeNs();
+		m_inflight = true;
+	}
+
+	m_processing = false;
+}
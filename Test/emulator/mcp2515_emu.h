@@ -0,0 +1,143 @@
+/**
+	Romain Le Forestier
+ emulation du MCP2515 au niveau des registres, pour compiler mcp_can.cpp sans modification sur PC
+ chaque Mcp2515Emu est branche sur une broche CS (et eventuellement INT), les octets de SPI.transfer
+ vont au circuit dont le CS est a l'etat bas
+ les circuits d'un meme CanBusEmu se partagent le bus: arbitrage sur l'identifiant, acquittement,
+ duree des trames avec le bourrage de bits, au debit programme dans CNF1/2/3
+ on compte les octets SPI et les cycles de CS de chaque circuit et le temps d'occupation du bus
+*/
+
+//exemple d'utilisation:
+//	CanBusEmu bus;
+//	Mcp2515Emu chipA(9, 0xFF, bus);   //CS sur la broche 9, INT non cable
+//	Mcp2515Emu chipB(10, 2, bus);     //CS sur la broche 10, INT sur la broche 2
+//	MCP_CAN canA(9), canB(10);
+//	...
+//	printf("%lu octets SPI\n", chipA.stats.bytes);
+
+#ifndef _MCP2515_EMU_
+#define _MCP2515_EMU_
+
+#include <stdint.h>
+
+#define EMU_MAX_NODES 8
+#define EMU_NO_PIN 0xFF
+
+//instructions SPI comptees separement
+enum EmuInstr
+{
+	EMU_RESET = 0,
+	EMU_READ,
+	EMU_WRITE,
+	EMU_BITMOD,
+	EMU_READ_STATUS,
+	EMU_RX_STATUS,
+	EMU_LOAD_TX,
+	EMU_RTS,
+	EMU_READ_RX,
+	EMU_NB_INSTR
+};
+
+struct EmuSpiStats
+{
+	unsigned long selects;               //cycles de chip select
+	unsigned long bytes;                 //octets transferes
+	unsigned long instr[EMU_NB_INSTR];   //nombre de chaque instruction
+};
+
+struct EmuFrame
+{
+	uint32_t id;
+	uint8_t ext;
+	uint8_t rtr;
+	uint8_t dlc;
+	uint8_t data[8];
+};
+
+class CanBusEmu;
+
+class Mcp2515Emu
+{
+	public:
+		Mcp2515Emu(uint8_t csPin, uint8_t intPin, CanBusEmu &bus, unsigned long oscHz = 16000000UL);
+
+		EmuSpiStats stats;
+		void resetStats(void);
+
+		//cote SPI, appele par Arduino.h/SPI.h pour PC
+		uint8_t csPin(void) const { return m_csPin; }
+		uint8_t intPin(void) const { return m_intPin; }
+		void select(void);
+		void unselect(void);
+		uint8_t transfer(uint8_t data);
+		bool intLevel(void) const;           //HIGH tant qu'aucun drapeau autorise n'est leve
+
+		//cote bus, appele par CanBusEmu
+		uint8_t mode(void) const;            //MODE_NORMAL, MODE_CONFIG...
+		unsigned long bitTimeNs(void) const; //duree d'un bit d'apres CNF1/2/3
+		int nextTx(uint64_t &reqTimeNs) const; //buffer a emettre, -1 si aucun
+		void txFrame(int txb, EmuFrame &frame) const;
+		void txDone(int txb);
+		void txNoAck(int txb);
+		void rxFrame(const EmuFrame &frame);
+
+		uint8_t reg(uint8_t addr) const { return readReg(addr); }
+
+	private:
+		uint8_t m_reg[128];
+		uint64_t m_txReqTime[3];
+		bool m_abortReq[3];                  //TXREQ efface pendant que la trame est sur le bus
+		uint8_t m_csPin, m_intPin;
+		unsigned long m_oscHz;
+		CanBusEmu &m_bus;
+
+		//etat de l'instruction SPI en cours
+		uint8_t m_state, m_addr, m_mask, m_rxClear;
+
+		void reset(void);
+		uint8_t readReg(uint8_t addr) const;
+		void writeReg(uint8_t addr, uint8_t val);
+		uint8_t readStatus(void) const;
+		uint8_t rxStatus(void) const;
+		bool match(uint8_t filtAddr, uint8_t maskAddr, const EmuFrame &frame) const;
+		void store(uint8_t rxb, uint8_t filhit, const EmuFrame &frame);
+};
+
+class CanBusEmu
+{
+	public:
+		CanBusEmu();
+
+		void attach(Mcp2515Emu *node);
+		void process(uint64_t nowNs);        //fait avancer le bus jusqu'a nowNs
+
+		unsigned long frames;                //trames acquittees
+		unsigned long errors;                //trames sans acquittement
+		unsigned long bits;                  //bits emis, bourrage compris
+		uint64_t busyNs;                     //temps d'occupation du bus
+		void resetStats(void);
+		float occupancy(uint64_t sinceNs, uint64_t nowNs, uint64_t busyAtStartNs) const;
+
+		static unsigned int frameBits(const EmuFrame &frame); //longueur d'une trame sur le bus
+		bool sending(const Mcp2515Emu *node, int txb) const;  //trame de ce buffer en cours sur le bus
+
+	private:
+		Mcp2515Emu *m_nodes[EMU_MAX_NODES];
+		uint8_t m_nbNodes;
+		uint64_t m_busFreeAt;
+		bool m_inflight;
+		Mcp2515Emu *m_sender;
+		int m_senderTxb;
+		EmuFrame m_frame;
+		uint64_t m_inflightEnd;
+		bool m_processing;
+};
+
+//liens avec Arduino.h pour PC (arduino_host.cpp)
+void emuRegisterNode(Mcp2515Emu *node);
+void emuRegisterBus(CanBusEmu *bus);
+uint64_t emuNowNs(void);
+void emuAdvanceNs(uint64_t ns);
+
+#endif
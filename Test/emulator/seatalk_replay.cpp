@@ -0,0 +1,327 @@
+//rejoue les enregistrements du bus SeaTalk (symboles 9 bits en hexa separes par des espaces, une ligne par
+//lecture, comme Document/dump_lecture_st6002.txt et Source/compass_heading/DumpTrameReçus.txt)
+//a travers SeaSerial::poll et SeaTalk_API::read_seatalk_input, avec une horloge virtuelle
+//	seatalk_replay [-v vitesse] [-r repetition] [-g repos_us] dump...
+//vitesse: 1 a 1000 fois le temps reel, 0 = aussi vite que possible (defaut)
+//les symboles d'une ligne se suivent a 4800 bauds (11 bits), repos_us de silence entre deux lignes
+//les datagrammes rendus sont compares au decoupage de reference fait ici: valides, faux (fin d'un datagramme
+//de reference mais octets differents), resynchro (rendu ailleurs qu'a la fin d'un datagramme: morceau,
+//decalage), manques; latence = temps virtuel entre l'arrivee du dernier symbole et le retour du decodeur
+//(nulle a vitesse maximale: le symbole suivant n'arrive que port vide)
+//compilation: g++ -O2 -I. -I../Seatalk_api -I../../Source/SeaSerial-master/sketchbook/libraries/SeaSerial -o seatalk_replay seatalk_replay.cpp arduino_host.cpp mcp2515_emu.cpp ../Seatalk_api/SeaTalk.cpp ../Seatalk_api/SeaTalkIdle.cpp ../../Source/SeaSerial-master/sketchbook/libraries/SeaSerial/SeaSerial.cpp
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <vector>
+#include "Arduino.h"
+#include "mcp2515_emu.h"
+#include "SeaTalk.h"
+#include "SeaSerial.h"
+
+#define REPLAY_CHAR_NS 2291667ULL   //11 bits a 4800 bauds
+#define REPLAY_NOISE 0x1FF          //pas de commande 0xFF: parasite sur la ligne
+
+struct Symbol
+{
+	uint64_t ns;
+	uint16_t c;
+};
+
+struct Result
+{
+	unsigned long valid;
+	unsigned long wrong;
+	unsigned long resync;
+	double latencySum;
+	double latencyMax;
+	double wallS;
+	unsigned long overflow;
+};
+
+struct ReplayEnd {};
+
+static std::vector<Symbol> symbols;
+static std::map<unsigned long, std::vector<uint8_t> > refEnd; //indice du dernier symbole -> datagramme
+static unsigned long refNoise = 0, refTruncated = 0, refOrphan = 0;
+static size_t nextSymbol = 0;
+static double speed = 0;
+static double wallStart;
+static uint64_t baseNs;             //l'horloge virtuelle ne recule pas: chaque passe part de baseNs
+static HostSerial port;
+static HostSerial quiet;
+
+static double wallS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static bool loadDump(const char *path, uint64_t gapNs, uint64_t &t)
+{
+	FILE *f = fopen(path, "r");
+	char line[1024], *tok, *end;
+	unsigned long v;
+
+	if(f == NULL)
+	{
+		perror(path);
+		return false;
+	}
+	while(fgets(line, sizeof(line), f) != NULL)
+	{
+		bool any = false;
+		for(tok = strtok(line, " \t\r\n"); tok != NULL; tok = strtok(NULL, " \t\r\n"))
+		{
+			v = strtoul(tok, &end, 16);
+			if(*end != '\0' || v > 0x1FF)
+				continue;
+			Symbol s = { t, (uint16_t) v };
+			symbols.push_back(s);
+			t += REPLAY_CHAR_NS;
+			any = true;
+		}
+		if(any)
+			t += gapNs;
+	}
+	fclose(f);
+	return true;
+}
+
+//decoupage de reference: un datagramme commence au bit de commande, sa taille est dans le 2eme octet
+static void reference(void)
+{
+	std::vector<uint8_t> cur;
+	unsigned int expected = 0;
+	size_t i;
+
+	for(i = 0; i < symbols.size(); i++)
+	{
+		uint16_t c = symbols[i].c;
+		if(c & 0x100)
+		{
+			if(!cur.empty())
+				refTruncated++;
+			cur.clear();
+			if(c == REPLAY_NOISE)
+			{
+				refNoise++;
+				continue;
+			}
+			cur.push_back((uint8_t) c);
+			expected = 0;
+			continue;
+		}
+		if(cur.empty())
+		{
+			refOrphan++;
+			continue;
+		}
+		cur.push_back((uint8_t) c);
+		if(cur.size() == 2)
+			expected = (c & 0x0F) + 3;
+		if(expected != 0 && cur.size() == expected)
+		{
+			refEnd[i] = cur;
+			cur.clear();
+		}
+	}
+}
+
+//heure virtuelle: suit l'horloge murale multipliee par speed, ou saute au prochain symbole si speed = 0
+static uint64_t virtualNow(void)
+{
+	return baseNs + (uint64_t) ((wallS() - wallStart) * speed * 1e9);
+}
+
+//livre au port les symboles dont l'heure est arrivee, comme l'isr de reception
+static void pump(void)
+{
+	uint64_t now;
+
+	if(speed == 0)
+	{
+		if(port.available() == 0 && nextSymbol < symbols.size())
+		{
+			if(baseNs + symbols[nextSymbol].ns > emuNowNs())
+				emuAdvanceNs(baseNs + symbols[nextSymbol].ns - emuNowNs());
+			port.feed(symbols[nextSymbol].c, nextSymbol);
+			nextSymbol++;
+		}
+	}
+	else
+	{
+		now = virtualNow();
+		if(now > emuNowNs())
+			emuAdvanceNs(now - emuNowNs());
+		while(nextSymbol < symbols.size() && baseNs + symbols[nextSymbol].ns <= now)
+		{
+			port.feed(symbols[nextSymbol].c, nextSymbol);
+			nextSymbol++;
+		}
+	}
+	if(nextSymbol >= symbols.size() && port.available() == 0)
+		throw ReplayEnd();
+}
+
+//pump() rappelle available(): on coupe la recursion
+static void pumpOnce(void)
+{
+	port.pump = NULL;
+	try
+	{
+		pump();
+	}
+	catch(...)
+	{
+		port.pump = pumpOnce;
+		throw;
+	}
+	port.pump = pumpOnce;
+}
+
+static void check(Result &r, const uint8_t *frame, size_t size, uint64_t nowNs)
+{
+	std::map<unsigned long, std::vector<uint8_t> >::const_iterator it = refEnd.find(port.lastTag);
+	double latency;
+
+	if(it == refEnd.end())
+	{
+		r.resync++;
+		return;
+	}
+	if(it->second.size() != size || memcmp(&it->second[0], frame, size) != 0)
+	{
+		r.wrong++;
+		return;
+	}
+	r.valid++;
+	latency = nowNs > baseNs + symbols[port.lastTag].ns ? (nowNs - baseNs - symbols[port.lastTag].ns) / 1000.0 : 0;
+	r.latencySum += latency;
+	if(latency > r.latencyMax)
+		r.latencyMax = latency;
+}
+
+static void start(void)
+{
+	port.pump = NULL;
+	while(port.available() > 0)
+		port.read();
+	port.rxOverflow = 0;
+	nextSymbol = 0;
+	baseNs = emuNowNs();
+	wallStart = wallS();
+	port.pump = pumpOnce;
+}
+
+static void replaySeaSerial(Result &r)
+{
+	SeaSerial sea(port);
+	size_t size;
+	double t0 = wallS();
+
+	start();
+	try
+	{
+		for(;;)
+		{
+			size = sea.poll();
+			if(size != 0)
+				check(r, (const uint8_t *) sea.get_frame(), size, speed > 0 ? virtualNow() : emuNowNs());
+		}
+	}
+	catch(ReplayEnd &)
+	{
+	}
+	r.wallS = wallS() - t0;
+	r.overflow = port.rxOverflow;
+	printf("SeaSerial: %u octets jetes, %u resynchro, %u depassements du delai entre caracteres\n", sea.discarded,
+			sea.resyncs, sea.timeouts);
+}
+
+static void replayReadInput(Result &r)
+{
+	SeaTalk_API api;
+	unsigned char buff[32];
+	unsigned long before;
+	size_t size;
+	double t0 = wallS();
+
+	start();
+	try
+	{
+		for(;;)
+		{
+			before = port.nbRead;
+			buff[0] = buff[1] = 0;
+			api.read_seatalk_input(&port, buff, &quiet);
+			if(port.nbRead == before)
+				continue;
+			//datagramme complet ou morceau rendu parce que le port etait vide
+			size = (buff[1] & 0x0F) + 3;
+			check(r, buff, size, speed > 0 ? virtualNow() : emuNowNs());
+		}
+	}
+	catch(ReplayEnd &)
+	{
+	}
+	r.wallS = wallS() - t0;
+	r.overflow = port.rxOverflow;
+}
+
+static void print(const char *name, const Result &r, double busS)
+{
+	printf("%-32s %5lu valides, %5lu faux, %5lu resynchro, %5lu manques, %lu debordements, %.1f datagrammes/s sur le bus\n",
+			name, r.valid, r.wrong, r.resync, refEnd.size() > r.valid ? (unsigned long) refEnd.size() - r.valid : 0,
+			r.overflow, r.valid / busS);
+	printf("%-32s latence moyenne %.1fus max %.1fus, decodage %.0f symboles/s (horloge murale)\n", "",
+			r.valid ? r.latencySum / r.valid : 0, r.latencyMax, symbols.size() / r.wallS);
+}
+
+int main(int argc, char **argv)
+{
+	uint64_t t = 0, gapNs = 2083000ULL;
+	unsigned long repeat = 1, k;
+	double busS;
+	Result r1 = Result(), r2 = Result();
+	int i, nbDump = 0;
+
+	quiet.out = fopen("/dev/null", "w");
+	for(i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "-v") == 0 && i + 1 < argc)
+			speed = atof(argv[++i]);
+		else if(strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+			repeat = strtoul(argv[++i], NULL, 10);
+		else if(strcmp(argv[i], "-g") == 0 && i + 1 < argc)
+			gapNs = strtoull(argv[++i], NULL, 10) * 1000ULL;
+		else
+		{
+			for(k = 0; k < repeat; k++)
+				if(!loadDump(argv[i], gapNs, t))
+					return 1;
+			nbDump++;
+		}
+	}
+	if(nbDump == 0 || symbols.empty())
+	{
+		fprintf(stderr, "usage: %s [-v vitesse] [-r repetition] [-g repos_us] dump...\n", argv[0]);
+		return 1;
+	}
+	reference();
+	busS = (symbols.back().ns + REPLAY_CHAR_NS) / 1e9;
+	printf("%lu symboles, %.2fs de bus, reference: %lu datagrammes, %lu coupes, %lu parasites 1FF, %lu octets orphelins\n",
+			(unsigned long) symbols.size(), busS, (unsigned long) refEnd.size(), refTruncated, refNoise, refOrphan);
+	if(speed > 0)
+		printf("vitesse x%g\n", speed);
+	else
+		printf("vitesse maximale\n");
+
+	replaySeaSerial(r1);
+	print("SeaSerial::poll", r1, busS);
+	replayReadInput(r2);
+	print("SeaTalk_API::read_seatalk_input", r2, busS);
+	return 0;
+}
@@ -0,0 +1,262 @@
+//verification sur PC de l'emetteur SeaTalk (SeaTalk_TX) avec un bus en boucle: tout ce qui est ecrit sur le
+//port d'emission revient en echo sur le port de reception, un caractere tous les SEATALK_CHAR_US, avec au
+//besoin un symbole remplace par celui d'un autre appareil (collision) ou rien du tout (echo perdu)
+//cas: emission propre, collision sur la commande, collision sur une donnee puis drain, echo perdu,
+//abandon apres SEATALK_TX_RETRY essais
+//avec un detecteur de repos (SeaTalk_Idle, fronts donnes a la main, pas de timer 5 sur PC): un octet lu par
+//poll() bloque l'emission meme si le detecteur voit la ligne au repos, un detecteur aveugle (sans cavalier)
+//est abandonne, un retard de loop() avec des octets en attente ne l'est pas
+//pilote (SeaTalk_Pilot): key_count/next_key compares au minimum de touches trouve par recherche en largeur
+//pour |delta| <= 360, et consigne -37 puis +42 30ms plus tard a travers le bus en boucle
+//compilation: g++ -O2 -I. -I../Seatalk_api -o seatalk_tx_test seatalk_tx_test.cpp arduino_host.cpp mcp2515_emu.cpp ../Seatalk_api/SeaTalk.cpp ../Seatalk_api/SeaTalkIdle.cpp
+//retourne 0 si tout est bon
+
+#include <stdio.h>
+#include "Arduino.h"
+#include "SeaTalk.h"
+
+#define ECHO_AUCUN -1              //pas de collision
+#define ECHO_PERDU -2              //rien ne revient
+#define PILOTE_MAX 360             //variations de cap verifiees
+#define PILOTE_MARGE 20            //la recherche peut depasser la cible d'une dizaine
+
+static HostSerial ecrit, lu;       //Serial1 emet sur le bus, Serial2 le relit
+static int err = 0;
+
+static void verifie(bool ok, const char *nom, const char *quoi)
+{
+	if(!ok)
+	{
+		printf("%s: erreur, %s\n", nom, quoi);
+		err++;
+	}
+}
+
+//le bus renvoie ce qui a ete emis, le symbole d'indice colle remplace par autre
+static void bus(SeaTalk_TX &tx, int colle, uint16_t autre)
+{
+	int c, k = 0;
+	while((c = ecrit.takeSent()) >= 0)
+	{
+		if(colle == ECHO_PERDU)
+			continue;
+		delayMicroseconds(SEATALK_CHAR_US);
+		lu.feed(k == colle ? autre : (uint16_t) c);
+		k++;
+		tx.poll();
+	}
+}
+
+//poll() jusqu'a ce que le datagramme parte (repos de la ligne, attente aleatoire), nombre de symboles emis
+//par le poll() qui l'a ecrit, 0 si rien n'est parti en 100ms
+static int emission(SeaTalk_TX &tx)
+{
+	int i;
+	for(i = 0; i < 100 && ecrit.sent() == 0; i++)
+	{
+		delay(1);
+		tx.poll();
+	}
+	return ecrit.sent();
+}
+
+static void touche(SeaTalk_TX &tx, unsigned char key, unsigned char *ticket)
+{
+	delay(10);
+	tx.poll();
+	tx.send_bouton(key, ticket);
+}
+
+//nombre minimum de touches +-1 +-10 pour chaque variation, recherche en largeur depuis 0
+static void minimum(int nb[])
+{
+	static const int keys[] = { 1, -1, 10, -10 };
+	static int file[2 * (PILOTE_MAX + PILOTE_MARGE) + 1];
+	int debut = 0, fin = 0, d, k, v;
+	for(d = 0; d <= 2 * (PILOTE_MAX + PILOTE_MARGE); d++)
+		nb[d] = -1;
+	nb[PILOTE_MAX + PILOTE_MARGE] = 0;
+	file[fin++] = 0;
+	while(debut < fin)
+	{
+		d = file[debut++];
+		for(k = 0; k < 4; k++)
+		{
+			v = d + keys[k];
+			if(v < -(PILOTE_MAX + PILOTE_MARGE) || v > PILOTE_MAX + PILOTE_MARGE
+					|| nb[v + PILOTE_MAX + PILOTE_MARGE] >= 0)
+				continue;
+			nb[v + PILOTE_MAX + PILOTE_MARGE] = nb[d + PILOTE_MAX + PILOTE_MARGE] + 1;
+			file[fin++] = v;
+		}
+	}
+}
+
+//un caractere de temps: le bus renvoie le prochain symbole emis, puis un tour de loop()
+static void tour_pilote(SeaTalk_TX &tx, SeaTalk_Pilot &pilot)
+{
+	int c;
+	delayMicroseconds(SEATALK_CHAR_US);
+	if((c = ecrit.takeSent()) >= 0)
+		lu.feed(c);
+	tx.poll();
+	pilot.poll();
+}
+
+static void pilote(void)
+{
+	static int nb[2 * (PILOTE_MAX + PILOTE_MARGE) + 1];
+	SeaTalk_TX tx(&ecrit, &lu);
+	SeaTalk_Pilot pilot(&tx);
+	unsigned long debut;
+	long d, reste;
+	int n, key, faux = 0;
+
+	minimum(nb);
+	for(d = -PILOTE_MAX; d <= PILOTE_MAX; d++)
+	{
+		//key_count est le minimum, et next_key suivi jusqu'au bout l'atteint
+		n = 0;
+		for(reste = d; reste != 0 && n <= nb[d + PILOTE_MAX + PILOTE_MARGE]; reste -= key, n++)
+		{
+			key = SeaTalk_Pilot::next_key(reste);
+			if(key != 1 && key != -1 && key != 10 && key != -10)
+				break;
+		}
+		if((int) SeaTalk_Pilot::key_count(d) != nb[d + PILOTE_MAX + PILOTE_MARGE] || reste != 0
+				|| n != nb[d + PILOTE_MAX + PILOTE_MARGE])
+		{
+			if(faux++ < 5)
+				printf("pilote: erreur pour %ld: key_count %u, next_key %d touches, minimum %d\n", d,
+						SeaTalk_Pilot::key_count(d), n, nb[d + PILOTE_MAX + PILOTE_MARGE]);
+			err++;
+		}
+	}
+
+	//-37 puis +42 30ms plus tard: la touche sur le bus part au bout, le reste est recalcule pour +5
+	delay(10);
+	pilot.add_delta(-37);
+	debut = millis();
+	while(millis() - debut < 30)
+		tour_pilote(tx, pilot);
+	pilot.add_delta(42);
+	while(millis() - debut < 2000 && (pilot.outstanding() != 0 || tx.pending() != 0))
+		tour_pilote(tx, pilot);
+	printf("pilote: -37 puis +42, %ld applique, %u touches, %u evitees\n", pilot.applied(), pilot.keystrokes,
+			pilot.saved);
+	verifie(pilot.applied() == 5 && pilot.outstanding() == 0, "pilote", "cap final faux");
+	verifie(pilot.keystrokes == 11 && pilot.saved == 2 && pilot.failed == 0, "pilote", "touches");
+}
+
+int main()
+{
+	SeaTalk_TX tx(&ecrit, &lu);
+	unsigned char t;
+	int i;
+
+	//emission propre: les 4 octets partent ensemble, l'echo les valide, rien pour les lecteurs
+	touche(tx, SeaTalk_Key_P1, &t);
+	verifie(emission(tx) == 4, "propre", "datagramme pas ecrit d'un seul bloc");
+	bus(tx, ECHO_AUCUN, 0);
+	verifie(tx.get_status(t) == SEATALK_TX_OK, "propre", "ticket pas OK");
+	verifie(tx.available() == 0, "propre", "notre echo donne aux lecteurs");
+
+	//collision sur la commande: la commande de l'autre est pour les lecteurs, nos 3 octets deja dans
+	//l'uart sont jetes, le datagramme repart apres l'attente
+	touche(tx, SeaTalk_Key_M1, &t);
+	emission(tx);
+	bus(tx, 0, 0x184);
+	verifie(tx.get_status(t) == SEATALK_TX_PENDING, "collision commande", "ticket pas en attente");
+	verifie(tx.collisions == 1, "collision commande", "collision pas comptee");
+	verifie(tx.available() == 1 && tx.read() == 0x184, "collision commande", "octets recus faux");
+	verifie(emission(tx) == 4, "collision commande", "pas de nouvel essai");
+	bus(tx, ECHO_AUCUN, 0);
+	verifie(tx.get_status(t) == SEATALK_TX_OK, "collision commande", "nouvel essai pas OK");
+
+	//collision sur une donnee: l'octet melange est pour les lecteurs, l'echo de la derniere donnee est jete
+	touche(tx, SeaTalk_Key_P10, &t);
+	emission(tx);
+	bus(tx, 2, 0x99);
+	verifie(tx.collisions == 2, "collision donnee", "collision pas comptee");
+	verifie(tx.available() == 1 && tx.read() == 0x99, "collision donnee", "drain: echo pas jete");
+	verifie(emission(tx) == 4, "collision donnee", "pas de nouvel essai");
+	bus(tx, ECHO_AUCUN, 0);
+	verifie(tx.get_status(t) == SEATALK_TX_OK, "collision donnee", "nouvel essai pas OK");
+
+	//echo perdu: le delai passe, le datagramme repart
+	touche(tx, SeaTalk_Key_M10, &t);
+	emission(tx);
+	bus(tx, ECHO_PERDU, 0);
+	delay(50);
+	tx.poll();
+	verifie(tx.echo_timeouts == 1, "echo perdu", "delai pas compte");
+	verifie(tx.get_status(t) == SEATALK_TX_PENDING, "echo perdu", "ticket pas en attente");
+	verifie(emission(tx) == 4, "echo perdu", "pas de nouvel essai");
+	bus(tx, ECHO_AUCUN, 0);
+	verifie(tx.get_status(t) == SEATALK_TX_OK, "echo perdu", "nouvel essai pas OK");
+
+	//collision a chaque essai: abandon apres le premier essai et SEATALK_TX_RETRY nouveaux essais
+	touche(tx, SeaTalk_Key_P1, &t);
+	for(i = 0; i <= SEATALK_TX_RETRY; i++)
+	{
+		verifie(emission(tx) == 4, "abandon", "essai pas emis");
+		bus(tx, 0, 0x184);
+		while(tx.available())
+			tx.read();
+	}
+	verifie(tx.get_status(t) == SEATALK_TX_FAILED, "abandon", "ticket pas FAILED");
+	verifie(tx.failed == 1 && tx.pending() == 0, "abandon", "datagramme encore en file");
+	verifie(emission(tx) == 0, "abandon", "essai de trop");
+
+	//detecteur aveugle: il voit la ligne au repos, l'octet lu par poll() doit quand meme bloquer
+	SeaTalk_TX tx2(&ecrit, &lu);
+	SeaTalk_Idle aveugle;
+	aveugle.begin();
+	tx2.set_idle(&aveugle);
+	delay(100);
+	verifie(tx2.idle_us() >= SEATALK_IDLE_US, "detecteur aveugle", "ligne pas au repos");
+	lu.feed(0x120);
+	tx2.poll();
+	verifie(tx2.idle_us() < SEATALK_IDLE_US, "detecteur aveugle", "octet lu par poll() ignore");
+	for(i = 0; i < SEATALK_IDLE_MISSES - 1; i++)
+	{
+		delay(5);
+		lu.feed(0x20);
+		tx2.poll();
+	}
+	verifie(tx2.idle_failures == 1, "detecteur aveugle", "detecteur pas abandonne");
+	while(tx2.available())
+		tx2.read();
+
+	//retard de loop(): 32 caracteres captures puis lus d'un seul poll(), en 4 paquets de readBlock9
+	SeaTalk_TX tx3(&ecrit, &lu);
+	SeaTalk_Idle cable;
+	unsigned long t0;
+	cable.begin();
+	tx3.set_idle(&cable);
+	delay(200);
+	t0 = SeaTalk_Idle::now_ticks() - 40 * SEATALK_IDLE_CHAR_TICKS;
+	for(i = 0; i < 32; i++)
+	{
+		cable.edge(t0 + i * SEATALK_IDLE_CHAR_TICKS);
+		lu.feed(0x20);
+	}
+	tx3.poll();
+	verifie(cable.chars == 32 && tx3.idle_failures == 0, "retard de loop()", "detecteur abandonne a tort");
+	//puis un caractere a la fois
+	for(i = 0; i < 8; i++)
+	{
+		delay(5);
+		cable.edge(SeaTalk_Idle::now_ticks());
+		lu.feed(0x20);
+		tx3.poll();
+	}
+	verifie(tx3.idle_failures == 0, "detecteur cable", "detecteur abandonne a tort");
+
+	pilote();
+
+	printf("collisions %u, echos perdus %u, abandons %u, debordements %u\n", tx.collisions, tx.echo_timeouts,
+			tx.failed, tx.rx_overflow);
+	printf("%d erreur(s)\n", err);
+	return err != 0;
+}
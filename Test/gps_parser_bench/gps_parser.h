@@ -0,0 +1,378 @@
+/**
+	Romain Le Forestier
+ parser pour nema gps data
+*/
+
+#ifndef GPS_PARSER_h
+#define GPS_PARSER_h
+
+#include <Arduino.h>
+#include <stddef.h>
+
+#define NMEALenght 80 //nmea by design is 80 char max per line
+
+/*
+* $GPRMC,225446,A,4916.45,N,12311.12,W,000.5,054.7,191194,020.3,E*68
+field Name -> 0 -> $GPRMC
+field Heure Fixe -> 1 -> 225446 -> 22H 54mn 46s
+field gps signal valide -> 2 -> A -> A = ok | V = Warning
+field Latitude -> 3 -> 4916.45 -> 49 deg. 16.45 min
+field -> 4 -> N -> N = north
+field lognitude -> 5 -> 12311.12 -> 123 deg. 11.12 min
+field -> 6 -> W -> W = west
+field vitesse -> 7 -> 000.5 -> 000.5 = vitesse sol, Knots
+field cap -> 8 -> 054.7 -> cap (vrai)
+field date fixe -> 9 -> 191194 -> Date du fix 19 Novembre 1994
+field -> 10 -> 020.3 -> Déclinaison Magnetique 20.3 deg Est
+field cheksum -> 11 -> E*68 -> cheksum 68
+*/
+typedef struct {
+  char valide; 
+  //latitude data
+  char latInd;     //indicateur de latitude N=nord, S=sud
+  char latDeg[3] = "00";  //degree from 0 to 90
+  char latMn[9] = "00000000";   //minute, 5 decimales
+  
+  //longitude data
+  char longInd;  //indicateur de longitude E=est, W=ouest
+  char longDeg[4] = "000";  //degree from 0 to 180
+  char longMn[9] = "00000000";   //minute, 5 decimales
+  
+  //date
+  char day[3] = "00";
+  char month[3] = "00";
+  char year[3] = "00"; //seule les 2 dernier chiffres de l'annee
+  
+  //time utc
+  char hour[3] = "00";
+  char minute[3] = "00";
+  char second[3] = "00";
+  
+  char speed[6] = "00000"; //vitesse en noeud
+  }GPRMC_frame;
+  
+  //valeur a 0 par defaut au cas ou la trame est non valide
+typedef struct {
+  bool valide; 
+  //latitude data
+  float latitude=0.0;
+  long latitudeE7=0; //latitude en 1e-7 degree, calculee sans virgule flottante
+  
+  //longitude data
+  float longitude=0.0;
+  long longitudeE7=0; //longitude en 1e-7 degree
+  
+  //date
+  unsigned char day = 0;
+  unsigned char month = 0;
+  unsigned char year = 0;
+  
+  //time utc
+  unsigned char hour= 0;
+  unsigned char minute = 0;
+  unsigned char second= 0;
+  
+  float speed = 0; //vitesse en noeud
+  unsigned int speedCentiKnot = 0; //vitesse en 1/100 noeud, arrondie au plus proche
+  unsigned int course = 0; //cap fond vrai en 1/10 degree, rempli seulement par NMEA_STREAM
+  }GPRMC_data;
+  
+/*
+*  $GPGGA,123519,4807.038,N,01131.324,E,1,08,0.9,545.4,M,46.9,M, , *42
+*
+* 01 -> 123519 = Acquisition du FIX à 12:35:19 UTC
+* 02 -> 4807.038 = Latitude 48 deg 07.038'
+* 03 -> N = north
+* 04 -> 01131.324 = Longitude 11 deg 31.324'
+* 05 -> E = East
+* 06 -> 1 = Fix qualification : (0 = non valide, 1 = Fix GPS, 2 = Fix DGPS)
+* 07 -> 08 = Nombre de satellites en pousuite.
+* 08 -> 0.9 = Précision horizontale ou DOP (Horizontal dilution of position) Dilution horizontale.
+* 09 -> 545.4= Altitude, au dessus du MSL (mean see level) niveau moyen des Océans.
+* 10 -> M = en metre
+* 11 -> 46.9 = Correction de la hauteur de la géoïde en Metres par raport à l'ellipsoîde WGS84 (MSL).
+* 12 -> M = en metre
+* 13 -> (Champ vide) = nombre de secondes écoulées depuis la dernière mise à jour DGPS.
+* 14 -> (Champ vide) = Identification de la station DGPS.
+* 15 -> 42 = Checksum
+*  Non représentés CR et LF.
+*/
+  typedef struct {
+  char valide = '0'; //qualification du fix, '0' = non valide
+  //latitude data
+  char latInd;     //indicateur de latitude N=nord, S=sud
+  char latDeg[3] = "00";  //degree from 0 to 90
+  char latMn[8] = "0000000";   //minute
+  
+  //longitude data
+  char longInd;  //indicateur de longitude E=est, W=ouest
+  char longDeg[4] = "000";  //degree from 0 to 180
+  char longMn[8] = "0000000";   //minute
+  
+  //time utc
+  char hour[3] = "00";
+  char minute[3] = "00";
+  char second[3] = "00";
+  
+  char nbSat[3] = "00"; //Satellites are in view
+  char accuracy[4] = "000"; //Relative accuracy of horizontal position
+  
+  char altitude[6] = "00000"; // altitude above mean sea level
+  char altitudeUnite; // altitude unite mesure (meter)
+  
+  }GPGGA_frame;
+  
+  //valeur a 0 par defaut au cas ou la trame est non valide
+typedef struct {
+  unsigned char fix = 0; //0 = non valide, 1 = Fix GPS, 2 = Fix DGPS
+  long latitudeE7 = 0; //latitude en 1e-7 degree
+  long longitudeE7 = 0; //longitude en 1e-7 degree
+  
+  //time utc
+  unsigned char hour = 0;
+  unsigned char minute = 0;
+  unsigned char second = 0;
+  
+  unsigned char nbSat = 0;
+  unsigned int accuracy = 0; //precision horizontale en 1/10
+  long altitude = 0; //altitude en decimetre
+  }GPGGA_data;
+
+
+class GPS_PARSER
+{
+	public:
+        GPS_PARSER(boolean init);
+		void parseGPRMC(const char buffer[], GPRMC_frame *data); //parse a gprmc sentence
+		void parseGPGGA(const char buffer[], GPGGA_frame *data);	//parse a gpgga sentence
+		void getNemaField(const char buffIn[], char field[], const unsigned char fieldNb); // get the field number from NMEA sentence
+		boolean isGPRMC(const char buffer[]);
+		boolean isGPGGA(const char buffer[]);
+		
+		void convertGprmcFrame(GPRMC_frame *data, GPRMC_data *val);
+		//comme convertGprmcFrame mais sans virgule flottante: seuls les champs entiers de val sont remplis
+		void convertGprmcFrameInt(GPRMC_frame *data, GPRMC_data *val);
+		void convertGpggaFrame(GPGGA_frame *data, GPGGA_data *val); //sans virgule flottante
+		//convertie les champs degree/minute de la trame en 1e-7 degree, ind est N, S, E ou W
+		static long convertPositionE7(const char deg[], const char mn[], char ind);
+		//convertie un nombre decimal en entier avec decimals chiffres apres la virgule, arrondi au plus proche
+		static long convertFixedPoint(const char txt[], unsigned char decimals);
+		
+        private:
+                boolean init;
+};
+
+/*
+* $GPVTG,054.7,T,034.4,M,005.5,N,010.2,K*48
+* 1 -> cap fond vrai, 3 -> cap fond magnetique, 5 -> vitesse en noeud, 7 -> vitesse en km/h
+*/
+typedef struct {
+  unsigned int courseTrue = 0; //cap fond vrai en 1/10 degree
+  unsigned int courseMag = 0; //cap fond magnetique en 1/10 degree
+  unsigned int speedCentiKnot = 0; //vitesse fond en 1/100 noeud
+  unsigned int speedKmh = 0; //vitesse fond en 1/10 km/h
+  }VTG_data;
+
+/*
+* $GPGSA,A,3,04,05,,09,12,,,24,,,,,2.5,1.3,2.1*39
+* 1 -> A = auto | M = manuel, 2 -> 1 = pas de fix, 2 = 2D, 3 = 3D, 3 a 14 -> satellites utilises
+* 15 -> PDOP, 16 -> HDOP, 17 -> VDOP
+*/
+typedef struct {
+  char mode = 0;
+  unsigned char fixType = 0;
+  unsigned char nbSat = 0; //nombre de satellites utilises pour le fix
+  unsigned int pdop = 0; //en 1/10
+  unsigned int hdop = 0;
+  unsigned int vdop = 0;
+  }GSA_data;
+
+/*
+* $GPGSV,3,1,11,03,03,111,00,04,15,270,00,06,01,010,00,13,06,292,00*74
+* 1 -> nombre de phrases, 2 -> numero de la phrase, 3 -> satellites visibles
+* puis 4 satellites: numero, elevation, azimut, rapport signal/bruit
+*/
+typedef struct {
+  unsigned char prn;
+  unsigned char elevation; //degree
+  unsigned int azimuth; //degree
+  unsigned char snr; //dB, 0 si le satellite n'est pas suivi
+  }GSV_sat;
+
+typedef struct {
+  unsigned char nbMsg = 0;
+  unsigned char msgNb = 0;
+  unsigned char nbSatView = 0;
+  GSV_sat sat[4]; //satellites de cette phrase, prn = 0 pour les places vides
+  }GSV_data;
+
+/*
+* $HCHDG,98.3,0.0,E,12.6,W*57
+* 1 -> cap magnetique, 2 -> deviation, 3 -> E/W, 4 -> declinaison, 5 -> E/W
+*/
+typedef struct {
+  unsigned int heading = 0; //cap magnetique du compas en 1/10 degree
+  int deviation = 0; //1/10 degree, negatif a l'ouest
+  int variation = 0; //1/10 degree, negatif a l'ouest
+  }HDG_data;
+
+/*
+* $WIMWV,214.8,R,0.1,K,A*28
+* 1 -> angle du vent, 2 -> R = apparent | T = vrai, 3 -> vitesse, 4 -> unite K/M/N, 5 -> A = valide
+*/
+typedef struct {
+  unsigned int angle = 0; //1/10 degree par rapport a l'etrave
+  char reference = 0;
+  unsigned int speed = 0; //1/10 de l'unite
+  char unit = 0; //K = km/h, M = m/s, N = noeud
+  bool valide = false;
+  }MWV_data;
+
+/*
+* $SDDPT,76.1,0.5,100*5A
+* 1 -> profondeur sous le capteur en metre, 2 -> decalage du capteur, 3 -> echelle
+*/
+typedef struct {
+  long depth = 0; //cm
+  int offset = 0; //cm, positif entre capteur et surface, negatif entre capteur et quille
+  unsigned int range = 0; //m
+  }DPT_data;
+
+/*
+* $GPZDA,201530.00,04,07,2002,00,00*60
+* 1 -> heure utc, 2 -> jour, 3 -> mois, 4 -> annee, 5 -> fuseau heure, 6 -> fuseau minute
+*/
+typedef struct {
+  unsigned char hour = 0;
+  unsigned char minute = 0;
+  unsigned char second = 0;
+  unsigned char day = 0;
+  unsigned char month = 0;
+  unsigned int year = 0; //4 chiffres
+  signed char zoneHour = 0;
+  unsigned char zoneMinute = 0;
+  }ZDA_data;
+
+//phrases reconnues par NMEA_STREAM::feed, dans l'ordre de la table de gps_parser.cpp
+#define NMEA_NONE 0
+#define NMEA_GPRMC 1
+#define NMEA_GPGGA 2
+#define NMEA_VTG 3
+#define NMEA_GSA 4
+#define NMEA_GSV 5
+#define NMEA_HDG 6
+#define NMEA_MWV 7
+#define NMEA_DPT 8
+#define NMEA_ZDA 9
+#define NMEA_NB_SENTENCE 9
+
+//identifiant sur 32 bits des 5 lettres apres le '$', 6 bits par lettre
+#define NMEA_ID(a, b, c, d, e) (((unsigned long) ((a) & 0x3F) << 24) | ((unsigned long) ((b) & 0x3F) << 18) \
+	| ((unsigned long) ((c) & 0x3F) << 12) | (((d) & 0x3F) << 6) | ((e) & 0x3F))
+#define NMEA_TALKER_MASK 0x3FFC0000UL //les 2 lettres de l'emetteur dans NMEA_ID (GP, GN, HC, WI...)
+
+//description d'un champ: numero, conversion, parametre et destination dans la structure *_data
+//la conversion est dans les 4 bits de poid fort de kind, la taille de la destination dans les 4 autres
+typedef struct {
+  unsigned char index;
+  unsigned char kind;
+  unsigned char param;
+  unsigned char offset;
+  }NmeaField;
+
+#define NMEA_K_HMS   0x10 //hhmmss vers 3 unsigned char consecutifs
+#define NMEA_K_DMY   0x20 //ddmmyy vers 3 unsigned char consecutifs
+#define NMEA_K_LAT   0x30 //ddmm.mmmmm vers 1e-7 degree
+#define NMEA_K_LON   0x40 //dddmm.mmmmm vers 1e-7 degree
+#define NMEA_K_CHAR  0x50 //premier caractere
+#define NMEA_K_BOOL  0x60 //vrai si le premier caractere est param
+#define NMEA_K_FIX   0x70 //nombre a param decimales, arrondi comme convertFixedPoint
+#define NMEA_K_SIGN  0x80 //change le signe de la destination si le caractere est param (S, W)
+#define NMEA_K_COUNT 0x90 //compte les champs non vides
+
+#define NMEA_FIELD(index, kind, param, type, member) \
+	{ index, (unsigned char) ((kind) | sizeof(((type *) 0)->member)), param, (unsigned char) offsetof(type, member) }
+
+typedef struct {
+  unsigned long id; //NMEA_ID sans l'emetteur
+  const NmeaField *fields; //en PROGMEM, tries par numero de champ
+  unsigned char nbFields;
+  unsigned char size; //taille de la structure *_data
+  }NmeaSentence;
+
+/*
+* parser nmea caractere par caractere, sans tampon de ligne: on lui donne chaque octet recu de Serial1,
+* le checksum *hh est calcule au fil de l'eau et les champs sont convertis en binaire des leur lecture
+* chaque phrase est decrite par une table de champs en PROGMEM (gps_parser.cpp), un seul moteur les lit
+* toutes; seules les phrases attachees a une structure sont decodees, les autres sont sautees
+*
+*   GPRMC_data rmc;
+*   HDG_data hdg;
+*   stream.attach(&rmc);
+*   stream.attach(&hdg);
+*   while(Serial1.available() > 0)
+*     if(stream.feed(Serial1.read()) == NMEA_GPRMC)
+*       utiliser rmc
+*
+* la structure est remplie pendant la lecture: elle n'est valable que quand feed retourne sa phrase,
+* et jusqu'au '$' suivant de la meme phrase
+* l'emetteur n'est pas verifie (GP, GN, II...), talker() le donne pour la derniere phrase
+*/
+class NMEA_STREAM
+{
+	public:
+		NMEA_STREAM();
+		unsigned char feed(char c); //NMEA_GPRMC, NMEA_HDG... quand une phrase se termine avec un checksum correct
+		
+		void attach(GPRMC_data *data) { dest[NMEA_GPRMC - 1] = data; }
+		void attach(GPGGA_data *data) { dest[NMEA_GPGGA - 1] = data; }
+		void attach(VTG_data *data) { dest[NMEA_VTG - 1] = data; }
+		void attach(GSA_data *data) { dest[NMEA_GSA - 1] = data; }
+		void attach(GSV_data *data) { dest[NMEA_GSV - 1] = data; }
+		void attach(HDG_data *data) { dest[NMEA_HDG - 1] = data; }
+		void attach(MWV_data *data) { dest[NMEA_MWV - 1] = data; }
+		void attach(DPT_data *data) { dest[NMEA_DPT - 1] = data; }
+		void attach(ZDA_data *data) { dest[NMEA_ZDA - 1] = data; }
+		void detach(unsigned char sentence);
+		
+		unsigned int talker() const { return (unsigned int) ((id & NMEA_TALKER_MASK) >> 18); }
+		
+		unsigned int checksumErrors; //phrases reconnues rejetees (checksum faux ou absent)
+		
+	private:
+		void *dest[NMEA_NB_SENTENCE];
+		
+		unsigned char state;
+		unsigned char sentence;      //NMEA_GPRMC... ou NMEA_NONE pour une phrase ignoree
+		unsigned char field;         //numero du champ, 0 = identifiant
+		unsigned char fieldPos;
+		unsigned char checksum;
+		unsigned char checksumRx;
+		unsigned long id;
+		
+		//description du champ en cours, copiee de la PROGMEM
+		NmeaField desc;
+		const NmeaField *nextField;
+		unsigned char nbFieldLeft;
+		unsigned char *data;
+		
+		//champ numerique en cours
+		long value;
+		long degree;
+		unsigned char nbDecimal;
+		bool decimal;
+		bool negative;
+		bool roundUp;
+		
+		void startSentence(void);
+		bool findSentence(void);
+		void nextDesc(void);
+		void fieldChar(char c);
+		void fieldEnd(void);
+		void position(char c, unsigned char degDigits);
+		void number(char c, unsigned char decimals);
+		long positionE7(void);
+		long fixedPoint(unsigned char decimals);
+};
+
+#endif
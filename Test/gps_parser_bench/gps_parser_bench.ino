@@ -0,0 +1,121 @@
+//mesure du temps de conversion d'une trame GPRMC sur la carte
+//compare la conversion d'origine (atof et division en float, recopiee ici) a convertGprmcFrame,
+//convertGprmcFrameInt (entiers seulement) et au parser NMEA_STREAM qui lit la phrase caractere par caractere
+//le resultat est affiche sur Serial1 en microseconde et en cycles pour NB_ITERATION conversions
+//la version PC est dans ../linux/gps_convert.cpp
+
+#include "gps_parser.h"
+
+#define NB_ITERATION 1000
+
+const char sentence[] = "$GPRMC,023934.00,A,4823.97002,N,00430.49225,W,0.636,,120615,,,D*64\r\n";
+
+GPS_PARSER parser(true);
+NMEA_STREAM stream;
+GPRMC_frame frame;
+GPRMC_data rmc;
+
+//volatile pour que le compilateur ne supprime pas les calculs
+volatile long sink = 0;
+
+//convertGprmcFrame d'origine, recopiee telle quelle: c'est la reference atof / float des mesures
+static void convertGprmcFrameFloat(GPRMC_frame *frame, GPRMC_data *data)
+{
+	float degree;
+	float minute;
+	//si les donnees ne sont pas valide on quite la fonction, les valeur par defaut de data étant a 0
+	if(! (data->valide = (frame->valide == 'A')))
+		return;
+	
+	degree = atof (frame->latDeg);
+	minute = atof (frame->latMn);
+	data->latitude = (frame->latInd == 'N' ? degree + minute/60.0 : 0 - (degree + minute/60));
+	
+	degree = atof (frame->longDeg);
+	minute = atof (frame->longMn);
+	data->longitude = (frame->longInd == 'E' ? degree + minute/60.0 : 0 - (degree + minute/60)); 
+	//date
+	data->day = ((frame->day[0] - '0') * 10)+(frame->day[1] - '0');
+	data->month = ((frame->month[0] - '0') * 10)+(frame->month[1] - '0');
+	data->year = ((frame->year[0] - '0') * 10)+(frame->year[1] - '0');
+  
+  //time utc
+	data->hour = ((frame->hour[0] - '0')* 10)+(frame->hour[1] - '0');
+	data->minute = ((frame->minute[0] - '0')* 10)+(frame->minute[1] - '0');
+	data->second = ((frame->second[0] - '0')* 10)+(frame->second[1] - '0');
+  //vittesse en noeud
+	data->speed = atof(frame->speed);
+	
+	return;
+}
+
+void print_result(const char* name, unsigned long t)
+{
+  Serial1.print(name);
+  Serial1.print(": ");
+  Serial1.print(t);
+  Serial1.print("us / ");
+  Serial1.print(NB_ITERATION);
+  Serial1.print(" conversions, ");
+  Serial1.print(t * (F_CPU / 1000000UL) / NB_ITERATION);
+  Serial1.println(" cycles par conversion");
+}
+
+void setup()
+{
+  Serial1.begin(115200);
+  while (!Serial1) {
+    ; // wait for Serial1 port to connect. Needed for Leonardo only
+  }
+  parser.parseGPRMC(sentence, &frame);
+  stream.attach(&rmc);
+}
+
+void loop()
+{
+  GPRMC_data data;
+  unsigned long t;
+  int i;
+  const char *p;
+
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    convertGprmcFrameFloat(&frame, &data);
+    sink += (long) data.latitude + (long) data.speed;
+  }
+  print_result("origine (atof, float)", micros() - t);
+
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    parser.convertGprmcFrame(&frame, &data);
+    sink += data.latitudeE7 + (long) data.speed;
+  }
+  print_result("convertGprmcFrame", micros() - t);
+
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    parser.convertGprmcFrameInt(&frame, &data);
+    sink += data.latitudeE7 + data.speedCentiKnot;
+  }
+  print_result("convertGprmcFrameInt", micros() - t);
+
+  //phrase complete: decoupage, checksum et conversion
+  t = micros();
+  for(i = 0; i < NB_ITERATION; i++)
+  {
+    for(p = sentence; *p != '\0'; p++)
+    {
+      if(stream.feed(*p) == NMEA_GPRMC)
+      {
+        sink += rmc.latitudeE7;
+      }
+    }
+  }
+  print_result("NMEA_STREAM", micros() - t);
+
+  Serial1.println("");
+  delay(2000);
+}
@@ -0,0 +1,143 @@
+//verification sur PC du solveur de masques et filtres du MCP2515 (canFilter.cpp) avec les identifiants de parseCan.h
+//pour chaque liste: tout les identifiants demandes passent, canFilterAccept sur les 2048 identifiants standards
+//donne exactement cfg.accepted identifiants, et si canFilterSolve dit exact seuls les identifiants demandes passent
+//compilation: g++ -O2 -I. -I.. -o canfilter_test canfilter_test.cpp ../canFilter.cpp
+//(mcp_can.h de linux pour CAN_STDID et CAN_EXTID, rien n'est envoye sur le bus)
+//retourne 0 si tout est bon
+
+#include <stdio.h>
+#include "parseCan.h"
+#include "canFilter.h"
+#include "mcp_can.h"
+
+#define NB_STD_ID 0x800
+
+//noeud de reception gps/accelero (receive_gps_accelero_ex)
+static const unsigned long idsReception[] = { MSG_GPRMC_LAT_LONG, MSG_GPRMC_LAT_LONG_E7, MSG_GPRMC_VIT_DATE,
+		MSG_GYRO_X_Y_Z, MSG_IMU_PHI_THETA_PSI };
+//version PC du noeud de reception (linux/receive_can), avec le diagnostic du port serie
+static const unsigned long idsReceiveCan[] = { MSG_GPRMC_LAT_LONG, MSG_GPRMC_LAT_LONG_E7, MSG_GPRMC_VIT_DATE,
+		MSG_GYRO_X_Y_Z, MSG_IMU_PHI_THETA_PSI, MSG_SERIAL_DIAG };
+//noeud gps (send_nmea_GPS_ex): l'UM6 pour l'estime
+static const unsigned long idsGps[] = { MSG_IMU_PHI_THETA_PSI, MSG_GYRO_X_Y_Z };
+//noeud seatalk
+static const unsigned long idsSeatalk[] = { MSG_SETALK_BOUTON, MSG_HEADING_RUDDER };
+//tout les identifiants de parseCan.h
+static const unsigned long idsTous[] = { MSG_GPRMC_LAT_LONG, MSG_GPRMC_VIT_DATE, MSG_GPGGA_ALT_PREC,
+		MSG_GPRMC_LAT_LONG_E7, MSG_ESTIME_LAT_LONG, MSG_ESTIME_QUALITE, MSG_HDG_CAP, MSG_MWV_VENT,
+		MSG_DPT_PROFONDEUR, MSG_IMU_PHI_THETA_PSI, MSG_GYRO_X_Y_Z, MSG_SETALK_BOUTON, MSG_HEADING_RUDDER,
+		MSG_SERIAL_DIAG };
+
+static bool demande(const unsigned long ids[], unsigned char n, unsigned long id)
+{
+	unsigned char i;
+	for(i = 0; i < n; i++)
+		if(ids[i] == id)
+			return true;
+	return false;
+}
+
+//nbAttendu: nombre d'identifiants qui doivent passer, 0 si le solveur n'a pas a etre exact
+static int verifie(const char *nom, const unsigned long ids[], unsigned char n, unsigned long nbAttendu)
+{
+	CanFilterConfig cfg;
+	unsigned long id, nbPasse = 0, nbFaux = 0;
+	unsigned char i;
+	int err = 0;
+	bool exact = canFilterSolve(ids, n, CAN_STDID, cfg);
+
+	for(i = 0; i < n; i++)
+	{
+		if(!canFilterAccept(cfg, ids[i]))
+		{
+			printf("%s: erreur, 0x%lx demande mais refuse\n", nom, ids[i]);
+			err++;
+		}
+	}
+	for(id = 0; id < NB_STD_ID; id++)
+	{
+		if(!canFilterAccept(cfg, id))
+			continue;
+		nbPasse++;
+		if(!demande(ids, n, id))
+			nbFaux++;
+	}
+	if(nbPasse != cfg.accepted || nbFaux != cfg.falsePositive)
+	{
+		printf("%s: erreur, %lu passent dont %lu non demandes, le solveur annonce %lu et %lu\n",
+				nom, nbPasse, nbFaux, cfg.accepted, cfg.falsePositive);
+		err++;
+	}
+	if(exact != (nbFaux == 0))
+	{
+		printf("%s: erreur, canFilterSolve retourne %d avec %lu non demandes\n", nom, exact, nbFaux);
+		err++;
+	}
+	if(nbAttendu != 0 && nbPasse != nbAttendu)
+	{
+		printf("%s: erreur, %lu passent au lieu de %lu\n", nom, nbPasse, nbAttendu);
+		err++;
+	}
+	printf("%-26s %2u demandes, %4lu passent, %s, masques 0x%03lx 0x%03lx\n", nom, n, nbPasse,
+			exact ? "exact" : "faux positifs", cfg.mask[0], cfg.mask[1]);
+	return err;
+}
+
+int main()
+{
+	unsigned long ids[CAN_FILTER_MAX_ID + 1];
+	CanFilterConfig cfg;
+	unsigned char i;
+	int err = 0;
+
+	//les noeuds du projet: le MCP2515 doit jeter tout le reste
+	err += verifie("reception gps/accelero", idsReception, sizeof(idsReception) / sizeof(idsReception[0]),
+			sizeof(idsReception) / sizeof(idsReception[0]));
+	err += verifie("receive_can", idsReceiveCan, sizeof(idsReceiveCan) / sizeof(idsReceiveCan[0]),
+			sizeof(idsReceiveCan) / sizeof(idsReceiveCan[0]));
+	err += verifie("gps", idsGps, sizeof(idsGps) / sizeof(idsGps[0]), sizeof(idsGps) / sizeof(idsGps[0]));
+	err += verifie("seatalk", idsSeatalk, sizeof(idsSeatalk) / sizeof(idsSeatalk[0]),
+			sizeof(idsSeatalk) / sizeof(idsSeatalk[0]));
+
+	//plus d'identifiants que de filtres: des faux positifs, mais le compte annonce doit etre juste
+	err += verifie("parseCan.h complet", idsTous, sizeof(idsTous) / sizeof(idsTous[0]), 0);
+	for(i = 0; i < CAN_FILTER_MAX_ID; i++)
+		ids[i] = i + 1;
+	err += verifie("16 identifiants 0x01-0x10", ids, CAN_FILTER_MAX_ID, 0);
+
+	//doublons: comptes une seule fois
+	ids[0] = ids[1] = MSG_IMU_PHI_THETA_PSI;
+	ids[2] = MSG_GYRO_X_Y_Z;
+	err += verifie("doublons", ids, 3, 2);
+
+	//trop d'identifiants pour la recherche: un seul masque pour tout, 0x7F8 et les filtres 0x100, 0x108
+	//et 0x110 laissent passer 0x100-0x117 (le masque 0x7E0 en laisserait 32, l'ancien solveur 2048)
+	for(i = 0; i <= CAN_FILTER_MAX_ID; i++)
+		ids[i] = 0x100 + i;
+	err += verifie("17 identifiants", ids, CAN_FILTER_MAX_ID + 1, 24);
+	//meme chose avec un doublon: 16 identifiants differents, 0x100-0x10F tiennent dans les 4 filtres de RXB1
+	ids[CAN_FILTER_MAX_ID] = 0x100;
+	err += verifie("17 dont un doublon", ids, CAN_FILTER_MAX_ID + 1, 16);
+
+	//identifiants 29 bits: on ne peut pas tout parcourir, on verifie les demandes et leurs voisins
+	ids[0] = 0x18FEF100UL;
+	ids[1] = 0x18FEF101UL;
+	ids[2] = 0x0CF00400UL;
+	if(!canFilterSolve(ids, 3, CAN_EXTID, cfg) || cfg.accepted != 3)
+	{
+		printf("29 bits: erreur, %lu passent au lieu de 3\n", cfg.accepted);
+		err++;
+	}
+	for(i = 0; i < 3; i++)
+	{
+		if(!canFilterAccept(cfg, ids[i]) || canFilterAccept(cfg, ids[i] ^ 0x10000000UL)
+				|| canFilterAccept(cfg, ids[i] + 2))
+		{
+			printf("29 bits: erreur autour de 0x%lx\n", ids[i]);
+			err++;
+		}
+	}
+
+	printf("%d erreur(s)\n", err);
+	return err != 0;
+}
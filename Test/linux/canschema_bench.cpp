@@ -0,0 +1,145 @@
+//version PC de canSchema_bench: temps de decoupage/reconstruction d'une trame CAN avec les fonctions de
+//ParseCan et avec les descripteurs de canSchema.h, apres verification que les deux donnent les memes octets
+//compilation: g++ -O2 -std=c++11 -I.. -o canschema_bench canschema_bench.cpp ../parseCan.cpp
+//(parseCan.cpp est compile a part comme sur l'arduino: ses fonctions ne sont pas inlinees)
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "parseCan.h"
+#include "canSchema.h"
+
+#define NB_ITERATION 10000000
+
+ParseCan parser(true);
+
+//volatile pour que le compilateur ne supprime pas les calculs
+volatile int phi = 12, theta = -3, psi = 271;
+volatile int heading = 68, rudder = -2;
+volatile float latitude = 48.399500, longitude = -4.508204;
+volatile long sink = 0;
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void result(const char *name, double t0, double tParse)
+{
+	double ns = (nowNs() - t0) / NB_ITERATION;
+	if(tParse > 0)
+		printf("%-24s %6.2fns par trame, x%.1f\n", name, ns, tParse / ns);
+	else
+		printf("%-24s %6.2fns par trame\n", name, ns);
+}
+
+//memes octets sur le bus avec les deux methodes, et memes valeurs relues
+static int check(void)
+{
+	unsigned char a[8], b[8];
+	int h, r, err = 0;
+
+	memset(a, 0, 8);
+	memset(b, 0, 8);
+	parser.intToUChar(a, 0, phi);
+	parser.intToUChar(a, 2, theta);
+	parser.intToUChar(a, 4, psi);
+	CanMsgImu::pack(b, phi, theta, psi);
+	if(memcmp(a, b, CanMsgImu::dlc) != 0 || CanMsgImu::theta::unpack(a) != theta
+			|| (int16_t) parser.ucharToInt(b, 2) != theta)
+	{
+		printf("erreur: trame IMU differente\n");
+		err++;
+	}
+
+	parser.floatToUChar(a, 0, latitude);
+	parser.floatToUChar(a, 4, longitude);
+	CanMsgGprmcLatLong::pack(b, latitude, longitude);
+	if(memcmp(a, b, CanMsgGprmcLatLong::dlc) != 0 || CanMsgGprmcLatLong::longitude::unpack(a) != longitude)
+	{
+		printf("erreur: trame GPS differente\n");
+		err++;
+	}
+
+	parser.set_seatalk_heading_rudder(a, heading, rudder);
+	CanMsgHeadingRudder::pack(b, heading, rudder);
+	parser.get_seatalk_heading_rudder(b, &h, &r);
+	if(memcmp(a, b, CanMsgHeadingRudder::dlc) != 0 || (int16_t) h != heading || (int16_t) r != rudder
+			|| CanMsgHeadingRudder::rudder::unpack(a) != rudder)
+	{
+		printf("erreur: trame cap/barre differente\n");
+		err++;
+	}
+	return err;
+}
+
+int main()
+{
+	unsigned char buff[8];
+	double t0, tParse;
+	int h, r;
+	long i;
+
+	if(check() != 0)
+		return 1;
+	printf("octets identiques avec ParseCan et canSchema.h, %d iterations\n", NB_ITERATION);
+
+	//trame IMU, 3 entiers
+	t0 = nowNs();
+	for(i = 0; i < NB_ITERATION; i++)
+	{
+		parser.intToUChar(buff, 0, phi);
+		parser.intToUChar(buff, 2, theta);
+		parser.intToUChar(buff, 4, psi);
+		sink += parser.ucharToInt(buff, 0) + parser.ucharToInt(buff, 2) + parser.ucharToInt(buff, 4);
+	}
+	tParse = (nowNs() - t0) / NB_ITERATION;
+	result("ParseCan IMU", t0, 0);
+	t0 = nowNs();
+	for(i = 0; i < NB_ITERATION; i++)
+	{
+		CanMsgImu::pack(buff, phi, theta, psi);
+		sink += CanMsgImu::phi::unpack(buff) + CanMsgImu::theta::unpack(buff) + CanMsgImu::psi::unpack(buff);
+	}
+	result("canSchema IMU", t0, tParse);
+
+	//trame GPS, 2 float
+	t0 = nowNs();
+	for(i = 0; i < NB_ITERATION; i++)
+	{
+		parser.floatToUChar(buff, 0, latitude);
+		parser.floatToUChar(buff, 4, longitude);
+		sink += (parser.ucharToFloat(buff, 0) > parser.ucharToFloat(buff, 4));
+	}
+	tParse = (nowNs() - t0) / NB_ITERATION;
+	result("ParseCan GPS", t0, 0);
+	t0 = nowNs();
+	for(i = 0; i < NB_ITERATION; i++)
+	{
+		CanMsgGprmcLatLong::pack(buff, latitude, longitude);
+		sink += (CanMsgGprmcLatLong::latitude::unpack(buff) > CanMsgGprmcLatLong::longitude::unpack(buff));
+	}
+	result("canSchema GPS", t0, tParse);
+
+	//trame cap et barre pour le pilote SeaTalk
+	t0 = nowNs();
+	for(i = 0; i < NB_ITERATION; i++)
+	{
+		parser.set_seatalk_heading_rudder(buff, heading, rudder);
+		parser.get_seatalk_heading_rudder(buff, &h, &r);
+		sink += h + r;
+	}
+	tParse = (nowNs() - t0) / NB_ITERATION;
+	result("ParseCan cap/barre", t0, 0);
+	t0 = nowNs();
+	for(i = 0; i < NB_ITERATION; i++)
+	{
+		CanMsgHeadingRudder::pack(buff, heading, rudder);
+		sink += CanMsgHeadingRudder::heading::unpack(buff) + CanMsgHeadingRudder::rudder::unpack(buff);
+	}
+	result("canSchema cap/barre", t0, tParse);
+	return 0;
+}
@@ -0,0 +1,138 @@
+//verification sur PC de la navigation a l'estime du noeud GPS (deadReckoning.cpp)
+//bateau simule a 6 noeuds: ligne droite, virement de bord a 9 degree/s, ligne droite, puis 20s sans gps
+//pendant une abattee a 2 degree/s
+//gps a 1Hz bruite a 2m, UM6 a 50Hz avec un lacet entier decale de 7 degree par rapport a la route
+//compare a 20Hz l'erreur de la position tenue au dernier fix, de l'estime au cap fond seul et de l'estime
+//avec l'UM6, et le plus grand saut entre deux positions publiees
+//compilation: g++ -O2 -I../send_nmea_GPS_ex -o dead_reckoning dead_reckoning.cpp ../send_nmea_GPS_ex/deadReckoning.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "deadReckoning.h"
+
+#define SIM_PAS_MS 10
+#define SIM_DUREE_MS 100000
+#define SIM_PERTE_DEBUT 60000  //plus de gps de 60s a 80s
+#define SIM_PERTE_FIN 80000
+#define SIM_VITESSE 6.0        //noeud
+#define SIM_BRUIT_M 2.0
+#define SIM_DECALAGE_COMPAS 7  //degree, cap compas - route fond
+
+#define METRE_E7 89.83152
+#define LAT0 48.3995
+#define LON0 -4.5082
+
+struct Erreur
+{
+	double somme2;
+	double max;
+	double sautMax;
+	unsigned long n;
+	long prevLat, prevLon;
+	bool prev;
+};
+
+static double bruit(void)
+{
+	return SIM_BRUIT_M * ((rand() / (double) RAND_MAX) * 2 - 1);
+}
+
+//vitesse de rotation vraie: virement de 045 a 135 entre 30s et 40s, abattee de 135 a 175 entre 65s et 85s
+static double rotationVraie(unsigned long t)
+{
+	if(t >= 30000 && t < 40000)
+		return 9;
+	if(t >= 65000 && t < 85000)
+		return 2;
+	return 0;
+}
+
+static double distance(long lat, long lon, double north, double east)
+{
+	double dn = (lat - LAT0 * 1e7) / METRE_E7 - north;
+	double de = (lon - LON0 * 1e7) / METRE_E7 * cos(LAT0 * M_PI / 180) - east;
+	return sqrt(dn * dn + de * de);
+}
+
+//le saut attendu entre deux sorties est d'environ 0.15m (6 noeuds pendant 50ms)
+static void mesure(Erreur &e, long lat, long lon, double north, double east)
+{
+	double d = distance(lat, lon, north, east);
+	e.somme2 += d * d;
+	e.max = d > e.max ? d : e.max;
+	e.n++;
+	if(e.prev)
+	{
+		double saut = hypot((lat - e.prevLat) / METRE_E7, (lon - e.prevLon) / METRE_E7 * cos(LAT0 * M_PI / 180));
+		e.sautMax = saut > e.sautMax ? saut : e.sautMax;
+	}
+	e.prevLat = lat;
+	e.prevLon = lon;
+	e.prev = true;
+}
+
+static void affiche(const char *nom, const Erreur &e)
+{
+	printf("%-24s erreur rms %6.2fm max %6.2fm, plus grand saut %6.2fm\n", nom, sqrt(e.somme2 / e.n), e.max, e.sautMax);
+}
+
+int main()
+{
+	DeadReckoning avecImu, sansImu;
+	Erreur errFix = Erreur(), errCog = Erreur(), errImu = Erreur(), errPerteCog = Erreur(), errPerteImu = Erreur();
+	double north = 0, east = 0, route = 45, v = SIM_VITESSE * 0.514444;
+	long fixLat = 0, fixLon = 0, lat, lon;
+	bool hasFix = false;
+	unsigned long t;
+	int qualite[4] = { 0, 0, 0, 0 };
+
+	srand(1);
+	for(t = 0; t <= SIM_DUREE_MS; t += SIM_PAS_MS)
+	{
+		route += rotationVraie(t) * SIM_PAS_MS / 1000.0;
+		north += v * SIM_PAS_MS / 1000.0 * cos(route * M_PI / 180);
+		east += v * SIM_PAS_MS / 1000.0 * sin(route * M_PI / 180);
+
+		if(t % 1000 == 0 && (t < SIM_PERTE_DEBUT || t >= SIM_PERTE_FIN))
+		{
+			lat = lround(LAT0 * 1e7 + (north + bruit()) * METRE_E7);
+			lon = lround(LON0 * 1e7 + (east + bruit()) * METRE_E7 / cos(LAT0 * M_PI / 180));
+			//le gps donne la route a 0.1 degree et la vitesse a 0.01 noeud pres
+			avecImu.fix(lat, lon, SIM_VITESSE * 100, lround(route * 10), t);
+			sansImu.fix(lat, lon, SIM_VITESSE * 100, lround(route * 10), t);
+			fixLat = lat;
+			fixLon = lon;
+			hasFix = true;
+		}
+		if(t % 20 == 0)
+		{
+			avecImu.imu((int) lround(route + SIM_DECALAGE_COMPAS) % 360, t);
+			avecImu.gyro(lround(rotationVraie(t)), t);
+		}
+		if(t % DR_PERIODE_MS == 0 && hasFix)
+		{
+			qualite[avecImu.update(t)]++;
+			sansImu.update(t);
+			if(t >= SIM_PERTE_DEBUT && t < SIM_PERTE_FIN)
+			{
+				mesure(errPerteCog, sansImu.latitudeE7(), sansImu.longitudeE7(), north, east);
+				mesure(errPerteImu, avecImu.latitudeE7(), avecImu.longitudeE7(), north, east);
+				errFix.prev = errCog.prev = errImu.prev = false;
+				continue;
+			}
+			mesure(errFix, fixLat, fixLon, north, east);
+			mesure(errCog, sansImu.latitudeE7(), sansImu.longitudeE7(), north, east);
+			mesure(errImu, avecImu.latitudeE7(), avecImu.longitudeE7(), north, east);
+		}
+	}
+
+	affiche("dernier fix tenu", errFix);
+	affiche("estime cap fond seul", errCog);
+	affiche("estime avec l'UM6", errImu);
+	affiche("cap fond seul, sans gps", errPerteCog);
+	affiche("avec l'UM6, sans gps", errPerteImu);
+	printf("qualite: aucune %d, estime %d, gps %d, gps+imu %d\n", qualite[DR_QUALITE_AUCUNE],
+			qualite[DR_QUALITE_ESTIME], qualite[DR_QUALITE_GPS], qualite[DR_QUALITE_GPS_IMU]);
+	return 0;
+}
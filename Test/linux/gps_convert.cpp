@@ -0,0 +1,145 @@
+//verification et mesure sur PC de la conversion sans virgule flottante de gps_parser
+//compare convertPositionE7 a deg + mn / 60 calcule en double sur toutes les minutes a 1e-5 pres,
+//convertFixedPoint a l'arrondi de atof et le temps de la conversion d'origine (atof, float) a
+//convertGprmcFrame / convertGprmcFrameInt / NMEA_STREAM
+//compilation: g++ -O2 -I../emulator -I../send_nmea_GPS_ex -o gps_convert gps_convert.cpp ../send_nmea_GPS_ex/gps_parser.cpp
+//(seul Arduino.h de ../emulator est utilise, pour boolean)
+//retourne 0 si l'ecart de position reste sous MAX_ERR_DEGREE et si toutes les vitesses sont bien arrondies
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "gps_parser.h"
+
+#define NB_ITERATION 1000000
+#define MAX_ERR_DEGREE 1e-6
+
+static const char sentence[] = "$GPRMC,023934.00,A,4823.97002,N,00430.49225,W,0.636,,120615,,,D*64\r\n";
+
+//volatile pour que le compilateur ne supprime pas les calculs
+volatile long sink = 0;
+
+//convertGprmcFrame d'origine, recopiee telle quelle: c'est la reference atof / float des mesures
+static void convertGprmcFrameFloat(GPRMC_frame *frame, GPRMC_data *data)
+{
+	float degree;
+	float minute;
+	//si les donnees ne sont pas valide on quite la fonction, les valeur par defaut de data étant a 0
+	if(! (data->valide = (frame->valide == 'A')))
+		return;
+	
+	degree = atof (frame->latDeg);
+	minute = atof (frame->latMn);
+	data->latitude = (frame->latInd == 'N' ? degree + minute/60.0 : 0 - (degree + minute/60));
+	
+	degree = atof (frame->longDeg);
+	minute = atof (frame->longMn);
+	data->longitude = (frame->longInd == 'E' ? degree + minute/60.0 : 0 - (degree + minute/60)); 
+	//date
+	data->day = ((frame->day[0] - '0') * 10)+(frame->day[1] - '0');
+	data->month = ((frame->month[0] - '0') * 10)+(frame->month[1] - '0');
+	data->year = ((frame->year[0] - '0') * 10)+(frame->year[1] - '0');
+  
+  //time utc
+	data->hour = ((frame->hour[0] - '0')* 10)+(frame->hour[1] - '0');
+	data->minute = ((frame->minute[0] - '0')* 10)+(frame->minute[1] - '0');
+	data->second = ((frame->second[0] - '0')* 10)+(frame->second[1] - '0');
+  //vittesse en noeud
+	data->speed = atof(frame->speed);
+	
+	return;
+}
+
+static double nowNs(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main()
+{
+	char deg[4], mn[9], txt[12];
+	double ref, err, maxErr = 0;
+	long e7, mn5, maxMn5 = 0, speed, nbSpeedErr = 0;
+	int d, k;
+	GPS_PARSER parser(true);
+	GPRMC_frame frame;
+	GPRMC_data data;
+	NMEA_STREAM stream;
+	GPRMC_data rmc;
+	double t;
+
+	//positions: les 6 000 000 valeurs de minute a 1e-5 pres, pour quelques degrees
+	for(d = 0; d <= 180; d += 45)
+	{
+		snprintf(deg, sizeof(deg), "%03d", d);
+		for(mn5 = 0; mn5 < 6000000L; mn5++)
+		{
+			snprintf(mn, sizeof(mn), "%02ld.%05ld", mn5 / 100000, mn5 % 100000);
+			e7 = GPS_PARSER::convertPositionE7(deg, mn, 'N');
+			ref = d + atof(mn) / 60.0;
+			err = fabs(e7 / 1e7 - ref);
+			if(err > maxErr)
+			{
+				maxErr = err;
+				maxMn5 = mn5;
+			}
+		}
+	}
+	printf("position: ecart max %.3g degree (minute %.5f), 1e-7 degree = %.3g\n", maxErr, maxMn5 / 1e5, 1e-7);
+
+	//vitesse: 0.000 a 999.999 noeuds, arrondi au 1/100 noeud
+	for(k = 0; k < 1000000; k++)
+	{
+		snprintf(txt, sizeof(txt), "%d.%03d", k / 1000, k % 1000);
+		speed = GPS_PARSER::convertFixedPoint(txt, 2);
+		if(speed != (long) floor(k / 10.0 + 0.5))
+			nbSpeedErr++;
+	}
+	printf("vitesse: %ld erreurs d'arrondi sur 1000000 valeurs\n", nbSpeedErr);
+
+	parser.parseGPRMC(sentence, &frame);
+	stream.attach(&rmc);
+	t = nowNs();
+	for(k = 0; k < NB_ITERATION; k++)
+	{
+		convertGprmcFrameFloat(&frame, &data);
+		sink += (long) data.latitude + (long) data.speed;
+	}
+	printf("origine (atof, float): %.1fns\n", (nowNs() - t) / NB_ITERATION);
+
+	t = nowNs();
+	for(k = 0; k < NB_ITERATION; k++)
+	{
+		parser.convertGprmcFrame(&frame, &data);
+		sink += data.latitudeE7 + (long) data.speed;
+	}
+	printf("convertGprmcFrame: %.1fns\n", (nowNs() - t) / NB_ITERATION);
+
+	t = nowNs();
+	for(k = 0; k < NB_ITERATION; k++)
+	{
+		parser.convertGprmcFrameInt(&frame, &data);
+		sink += data.latitudeE7 + data.speedCentiKnot;
+	}
+	printf("convertGprmcFrameInt: %.1fns\n", (nowNs() - t) / NB_ITERATION);
+
+	t = nowNs();
+	for(k = 0; k < NB_ITERATION / 10; k++)
+	{
+		const char *p;
+		for(p = sentence; *p != '\0'; p++)
+			if(stream.feed(*p) == NMEA_GPRMC)
+				sink += rmc.latitudeE7;
+	}
+	printf("NMEA_STREAM, phrase complete: %.1fns\n", (nowNs() - t) / (NB_ITERATION / 10));
+
+	if(maxErr > MAX_ERR_DEGREE || nbSpeedErr != 0)
+	{
+		printf("erreur: ecart de position au dela de %.3g degree ou vitesse mal arrondie\n", MAX_ERR_DEGREE);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,500 @@
+/*
+  mcp_can.cpp
+  2012 Copyright (c) Seeed Technology Inc.  All right reserved.
+
+  Author:Loovee
+  Contributor: Cory J. Fowler
+  2014-1-16
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-
+  1301  USA
+*/
+#include "mcp_can.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <linux/can.h>
+#include <linux/can/error.h>
+#include <linux/can/raw.h>
+
+/*********************************************************************************************************
+** Function name:           MCP_CAN
+** Descriptions:            interface from $MCP_CAN_IF, or MCP_CAN_DEFAULT_IF. The CS pin is ignored,
+**                          so the sketches keep their MCP_CAN CAN(SPI_CS_PIN)
+*********************************************************************************************************/
+MCP_CAN::MCP_CAN(INT8U _CS)
+{
+    const char *ifName = getenv("MCP_CAN_IF");
+
+    (void) _CS;
+    strncpy(m_ifName, ifName != NULL ? ifName : MCP_CAN_DEFAULT_IF, sizeof(m_ifName) - 1);
+    m_ifName[sizeof(m_ifName) - 1] = 0;
+    m_nSocket = -1;
+    m_nPending = 0;
+    m_nError = 0;
+    clearFilters();
+}
+
+/*********************************************************************************************************
+** Function name:           MCP_CAN
+** Descriptions:            explicit interface name: "can0", "vcan0"...
+*********************************************************************************************************/
+MCP_CAN::MCP_CAN(const char *ifName)
+{
+    strncpy(m_ifName, ifName, sizeof(m_ifName) - 1);
+    m_ifName[sizeof(m_ifName) - 1] = 0;
+    m_nSocket = -1;
+    m_nPending = 0;
+    m_nError = 0;
+    clearFilters();
+}
+
+/*********************************************************************************************************
+** Function name:           clearFilters
+** Descriptions:            mcp2515 reset state: masks and filters at 0, everything is received
+*********************************************************************************************************/
+void MCP_CAN::clearFilters(void)
+{
+    INT8U i;
+
+    for (i = 0; i < MCP_N_MASKS; i++)
+    {
+        m_maskSid[i] = 0;
+        m_maskEid[i] = 0;
+    }
+    for (i = 0; i < MCP_N_FILTERS; i++)
+    {
+        m_filtSid[i] = 0;
+        m_filtEid[i] = 0;
+        m_filtExt[i] = 0;
+    }
+    m_nFiltersSet = 0;
+}
+
+MCP_CAN::~MCP_CAN()
+{
+    if ( m_nSocket >= 0 )
+    {
+        close(m_nSocket);
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           begin
+** Descriptions:            open a CAN_RAW socket on the interface, speedset is ignored: the bit rate
+**                          is set with ip link
+*********************************************************************************************************/
+INT8U MCP_CAN::begin(INT8U speedset)
+{
+    struct ifreq ifr;
+    struct sockaddr_can addr;
+    can_err_mask_t errMask = CAN_ERR_MASK;
+
+    (void) speedset;
+    if ( m_nSocket >= 0 )
+    {
+        close(m_nSocket);
+    }
+
+    m_nSocket = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if ( m_nSocket < 0 )
+    {
+        return CAN_FAILINIT;
+    }
+
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, m_ifName, IFNAMSIZ - 1);
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    if ( ioctl(m_nSocket, SIOCGIFINDEX, &ifr) < 0 )
+    {
+        close(m_nSocket);
+        m_nSocket = -1;
+        return CAN_FAILINIT;
+    }
+    addr.can_ifindex = ifr.ifr_ifindex;
+
+    if ( bind(m_nSocket, (struct sockaddr *) &addr, sizeof(addr)) < 0 )
+    {
+        close(m_nSocket);
+        m_nSocket = -1;
+        return CAN_FAILINIT;
+    }
+                                                                        /* error frames feed checkError */
+    setsockopt(m_nSocket, SOL_CAN_RAW, CAN_RAW_ERR_FILTER, &errMask, sizeof(errMask));
+    fcntl(m_nSocket, F_SETFL, fcntl(m_nSocket, F_GETFL) | O_NONBLOCK);
+
+    m_nPending = 0;
+    m_nError = 0;
+    if ( m_nFiltersSet )
+    {
+        applyFilters();
+    }
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           applyFilters
+** Descriptions:            translate the mcp2515 masks and filters in CAN_RAW filters
+**                          filter n uses mask 0 (n < 2) or mask 1, a standard filter only matches
+**                          standard frames on SID, an extended one extended frames on SID and EID
+*********************************************************************************************************/
+INT8U MCP_CAN::applyFilters(void)
+{
+    struct can_filter rfilter[MCP_N_FILTERS];
+    INT8U i, m;
+
+    if ( m_nSocket < 0 )
+    {
+        return MCP2515_OK;                                              /* applied by begin()           */
+    }
+
+    for (i = 0; i < MCP_N_FILTERS; i++)
+    {
+        m = (i < 2) ? 0 : 1;
+        if ( m_filtExt[i] )
+        {
+            rfilter[i].can_id   = CAN_EFF_FLAG | (m_filtSid[i] << 18) | m_filtEid[i];
+            rfilter[i].can_mask = CAN_EFF_FLAG | (m_maskSid[m] << 18) | m_maskEid[m];
+        }
+        else
+        {
+            rfilter[i].can_id   = m_filtSid[i];
+            rfilter[i].can_mask = CAN_EFF_FLAG | m_maskSid[m];
+        }
+    }
+
+    if ( setsockopt(m_nSocket, SOL_CAN_RAW, CAN_RAW_FILTER, rfilter, sizeof(rfilter)) < 0 )
+    {
+        return MCP2515_FAIL;
+    }
+    return MCP2515_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           init_Mask
+** Descriptions:            init canid Masks, same register layout as the mcp2515: a standard mask
+**                          only covers the 11 SID bits
+*********************************************************************************************************/
+INT8U MCP_CAN::init_Mask(INT8U num, INT8U ext, INT32U ulData)
+{
+    if ( num >= MCP_N_MASKS )
+    {
+        return MCP2515_FAIL;
+    }
+    m_nFiltersSet = 1;
+
+    if ( ext )
+    {
+        m_maskSid[num] = (ulData >> 18) & 0x7FF;
+        m_maskEid[num] = ulData & 0x3FFFF;
+    }
+    else
+    {
+        m_maskSid[num] = ulData & 0x7FF;
+        m_maskEid[num] = 0;
+    }
+    return applyFilters();
+}
+
+/*********************************************************************************************************
+** Function name:           init_Filt
+** Descriptions:            init canid filters
+*********************************************************************************************************/
+INT8U MCP_CAN::init_Filt(INT8U num, INT8U ext, INT32U ulData)
+{
+    if ( num >= MCP_N_FILTERS )
+    {
+        return MCP2515_FAIL;
+    }
+    m_nFiltersSet = 1;
+
+    m_filtExt[num] = ext ? 1 : 0;
+    if ( ext )
+    {
+        m_filtSid[num] = (ulData >> 18) & 0x7FF;
+        m_filtEid[num] = ulData & 0x3FFFF;
+    }
+    else
+    {
+        m_filtSid[num] = ulData & 0x7FF;
+        m_filtEid[num] = 0;
+    }
+    return applyFilters();
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsgBuf
+** Descriptions:            send buf, waits MCP_CAN_SEND_TIMEOUT ms at most for room in the tx queue
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBuf(INT32U id, INT8U ext, INT8U rtr, INT8U len, INT8U *buf)
+{
+    struct can_frame frame;
+    struct pollfd pfd;
+
+    if ( m_nSocket < 0 )
+    {
+        return CAN_FAILTX;
+    }
+    if ( len > CAN_MAX_CHAR_IN_MESSAGE )
+    {
+        len = CAN_MAX_CHAR_IN_MESSAGE;
+    }
+
+    memset(&frame, 0, sizeof(frame));
+    if ( ext )
+    {
+        frame.can_id = (id & CAN_EFF_MASK) | CAN_EFF_FLAG;
+    }
+    else
+    {
+        frame.can_id = id & CAN_SFF_MASK;
+    }
+    if ( rtr )
+    {
+        frame.can_id |= CAN_RTR_FLAG;
+    }
+    frame.can_dlc = len;
+    memcpy(frame.data, buf, len);
+
+    pfd.fd = m_nSocket;
+    pfd.events = POLLOUT;
+    if ( poll(&pfd, 1, MCP_CAN_SEND_TIMEOUT) <= 0 )
+    {
+        return CAN_GETTXBFTIMEOUT;                                      /* tx queue full                */
+    }
+    if ( write(m_nSocket, &frame, sizeof(frame)) != sizeof(frame) )
+    {
+        return (errno == ENOBUFS || errno == EAGAIN) ? CAN_GETTXBFTIMEOUT : CAN_FAILTX;
+    }
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsgBuf
+** Descriptions:            send buf
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBuf(INT32U id, INT8U ext, INT8U len, INT8U *buf)
+{
+    return sendMsgBuf(id, ext, 0, len, buf);
+}
+
+/*********************************************************************************************************
+** Function name:           fetchFrame
+** Descriptions:            read the next data frame of the socket in the pending frame, error frames
+**                          only set the flag of checkError
+*********************************************************************************************************/
+INT8U MCP_CAN::fetchFrame(void)
+{
+    struct can_frame frame;
+
+    if ( m_nPending )
+    {
+        return CAN_MSGAVAIL;
+    }
+    if ( m_nSocket < 0 )
+    {
+        return CAN_NOMSG;
+    }
+
+    while ( read(m_nSocket, &frame, sizeof(frame)) == sizeof(frame) )
+    {
+        if ( frame.can_id & CAN_ERR_FLAG )
+        {
+            m_nError = 1;
+            continue;
+        }
+        m_pendingId = frame.can_id;
+        m_pendingDlc = frame.can_dlc > CAN_MAX_CHAR_IN_MESSAGE ? CAN_MAX_CHAR_IN_MESSAGE : frame.can_dlc;
+        memcpy(m_pendingDta, frame.data, m_pendingDlc);
+        m_nPending = 1;
+        return CAN_MSGAVAIL;
+    }
+    return CAN_NOMSG;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsg
+** Descriptions:            read message
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsg()
+{
+    if ( fetchFrame() != CAN_MSGAVAIL )
+    {
+        return CAN_NOMSG;
+    }
+
+    m_nExtFlg = (m_pendingId & CAN_EFF_FLAG) ? 1 : 0;
+    m_nRtr    = (m_pendingId & CAN_RTR_FLAG) ? 1 : 0;
+    m_nID     = m_pendingId & (m_nExtFlg ? CAN_EFF_MASK : CAN_SFF_MASK);
+    m_nDlc    = m_pendingDlc;
+    memcpy(m_nDta, m_pendingDta, m_nDlc);
+    m_nPending = 0;
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBuf
+** Descriptions:            read message buf
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBuf(INT8U *len, INT8U buf[])
+{
+    INT8U  rc;
+
+    rc = readMsg();
+
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       for(int i = 0; i<m_nDlc; i++) {
+         buf[i] = m_nDta[i];
+       }
+    } else {
+       *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBufID
+** Descriptions:            read message buf and can bus source ID
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBufID(INT32U *ID, INT8U *len, INT8U buf[])
+{
+    INT8U rc;
+    rc = readMsg();
+
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       *ID  = m_nID;
+       for(int i = 0; i<m_nDlc && i < MAX_CHAR_IN_MESSAGE; i++) {
+          buf[i] = m_nDta[i];
+       }
+    } else {
+       *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBufCh
+** Descriptions:            read message buf return a char *
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBufCh(INT8U *len, char buf[])
+{
+    INT8U  rc;
+
+    rc = readMsg();
+
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       for(int i = 0; i<m_nDlc; i++) {
+         buf[i] = char(m_nDta[i]);
+       }
+    } else {
+       *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBufIDch
+** Descriptions:            read message buf and can bus source ID retrun  a char *
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBufIDCh(INT32U *ID, INT8U *len, char buf[])
+{
+    INT8U rc;
+    rc = readMsg();
+
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       *ID  = m_nID;
+       for(int i = 0; i<m_nDlc && i < MAX_CHAR_IN_MESSAGE; i++) {
+          buf[i] = char(m_nDta[i]);
+       }
+    } else {
+       *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           checkReceive
+** Descriptions:            check if got something, the frame stays for the next readMsgBuf
+*********************************************************************************************************/
+INT8U MCP_CAN::checkReceive(void)
+{
+    return fetchFrame();
+}
+
+/*********************************************************************************************************
+** Function name:           checkError
+** Descriptions:            CAN_CTRLERROR if an error frame was received since the last call
+*********************************************************************************************************/
+INT8U MCP_CAN::checkError(void)
+{
+    fetchFrame();
+    if ( m_nError )
+    {
+        m_nError = 0;
+        return CAN_CTRLERROR;
+    }
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           getCanId
+** Descriptions:            when receive something ,u can get the can id!!
+*********************************************************************************************************/
+INT32U MCP_CAN::getCanId(void)
+{
+    return m_nID;
+}
+
+/*********************************************************************************************************
+** Function name:           isRemoteRequest
+** Descriptions:            when receive something ,u can check if it was a request
+*********************************************************************************************************/
+INT8U MCP_CAN::isRemoteRequest(void)
+{
+    return m_nRtr;
+}
+
+/*********************************************************************************************************
+** Function name:           isExtendedFrame
+** Descriptions:            did we just receive standard 11bit frame or extended 29bit? 0 = std, 1 = ext
+*********************************************************************************************************/
+INT8U MCP_CAN::isExtendedFrame(void)
+{
+    return m_nExtFlg;
+}
+
+/*********************************************************************************************************
+** Function name:           getSocket
+** Descriptions:            file descriptor of the CAN_RAW socket, -1 before begin()
+*********************************************************************************************************/
+int MCP_CAN::getSocket(void)
+{
+    return m_nSocket;
+}
+
+/*********************************************************************************************************
+  END FILE
+*********************************************************************************************************/
@@ -0,0 +1,153 @@
+/*
+  mcp_can.h
+  2012 Copyright (c) Seeed Technology Inc.  All right reserved.
+
+  Author:Loovee
+  Contributor: Cory J. Fowler
+  2014-1-16
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-
+  1301  USA
+*/
+
+/*
+ *   Linux SocketCAN version of the MCP_CAN public api: the code written for the
+ *   shield (ParseCan, canSchema.h, canFilter.h, the loop() of the sketches) runs
+ *   on a PC or a Raspberry Pi against a real adapter (can0) or vcan0
+ *
+ *   the bit rate belongs to the interface:
+ *       ip link set can0 type can bitrate 500000 && ip link set can0 up
+ *   or for tests without hardware:
+ *       modprobe vcan && ip link add dev vcan0 type vcan && ip link set vcan0 up
+ *
+ *   build: g++ -I. -I.. your_main.cpp mcp_can.cpp ../parseCan.cpp
+ */
+#ifndef _MCP2515_H_
+#define _MCP2515_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef INT32U
+#define INT32U uint32_t
+#endif
+
+#ifndef INT8U
+#define INT8U uint8_t
+#endif
+
+#ifndef INT16U
+#define INT16U uint16_t
+#endif
+
+#define MCP2515_OK         (0)
+#define MCP2515_FAIL       (1)
+
+#define CAN_STDID (0)
+#define CAN_EXTID (1)
+
+#define CAN_5KBPS    1
+#define CAN_10KBPS   2
+#define CAN_20KBPS   3
+#define CAN_31K25BPS 4
+#define CAN_33KBPS   5
+#define CAN_40KBPS   6
+#define CAN_50KBPS   7
+#define CAN_80KBPS   8
+#define CAN_83K3BPS  9
+#define CAN_95KBPS   10
+#define CAN_100KBPS  11
+#define CAN_125KBPS  12
+#define CAN_200KBPS  13
+#define CAN_250KBPS  14
+#define CAN_500KBPS  15
+#define CAN_1000KBPS 16
+
+#define CAN_OK                  (0)
+#define CAN_FAILINIT            (1)
+#define CAN_FAILTX              (2)
+#define CAN_MSGAVAIL            (3)
+#define CAN_NOMSG               (4)
+#define CAN_CTRLERROR           (5)
+#define CAN_GETTXBFTIMEOUT      (6)
+#define CAN_SENDMSGTIMEOUT      (7)
+#define CAN_TXPENDING           (8)
+#define CAN_TXFAILED            (9)
+#define CAN_FAIL                (0xff)
+
+#define CAN_MAX_CHAR_IN_MESSAGE (8)
+#define MAX_CHAR_IN_MESSAGE 8
+
+#define MCP_N_MASKS    (2)
+#define MCP_N_FILTERS  (6)
+
+#define MCP_CAN_DEFAULT_IF "can0"                                       /* or $MCP_CAN_IF               */
+#define MCP_CAN_SEND_TIMEOUT (10)                                       /* ms waiting for the tx queue  */
+
+class MCP_CAN
+{
+    private:
+
+    INT8U   m_nExtFlg;                                                  /* identifier xxxID             */
+    INT32U  m_nID;                                                      /* can id                       */
+    INT8U   m_nDlc;                                                     /* data length:                 */
+    INT8U   m_nDta[MAX_CHAR_IN_MESSAGE];                                /* data                         */
+    INT8U   m_nRtr;                                                     /* rtr                          */
+
+    char    m_ifName[16];                                               /* socketcan interface          */
+    int     m_nSocket;
+    INT8U   m_nPending;                                                 /* frame read by checkReceive   */
+    INT8U   m_nError;                                                   /* error frame since checkError */
+    INT32U  m_pendingId;
+    INT8U   m_pendingDlc;
+    INT8U   m_pendingDta[MAX_CHAR_IN_MESSAGE];
+
+    INT8U   m_nFiltersSet;                                              /* 0: receive everything        */
+    INT32U  m_maskSid[MCP_N_MASKS];                                     /* registers as the mcp2515:    */
+    INT32U  m_maskEid[MCP_N_MASKS];                                     /* 11 bit SID, 18 bit EID       */
+    INT32U  m_filtSid[MCP_N_FILTERS];
+    INT32U  m_filtEid[MCP_N_FILTERS];
+    INT8U   m_filtExt[MCP_N_FILTERS];
+
+    void clearFilters(void);                                            /* receive everything           */
+    INT8U fetchFrame(void);                                             /* socket -> pending frame      */
+    INT8U applyFilters(void);                                           /* masks/filters -> CAN_RAW     */
+    INT8U readMsg();                                                    /* read message                 */
+
+public:
+    MCP_CAN(INT8U _CS);                                                 /* interface from $MCP_CAN_IF   */
+    MCP_CAN(const char *ifName);
+    ~MCP_CAN();
+    INT8U begin(INT8U speedset);                                    /* open the interface           */
+    INT8U init_Mask(INT8U num, INT8U ext, INT32U ulData);           /* init Masks                   */
+    INT8U init_Filt(INT8U num, INT8U ext, INT32U ulData);           /* init filters                 */
+    INT8U sendMsgBuf(INT32U id, INT8U ext, INT8U rtr, INT8U len, INT8U *buf);   /* send buf                     */
+    INT8U sendMsgBuf(INT32U id, INT8U ext, INT8U len, INT8U *buf);   /* send buf                     */
+    INT8U readMsgBuf(INT8U *len, INT8U *buf);                       /* read buf                     */
+    INT8U readMsgBufID(INT32U *ID, INT8U *len, INT8U *buf);         /* read buf with object ID      */
+    INT8U readMsgBufCh(INT8U *len, char *buf);                       /* read buf                     */
+    INT8U readMsgBufIDCh(INT32U *ID, INT8U *len, char *buf);         /* read buf with object ID      */
+    INT8U checkReceive(void);                                       /* if something received        */
+    INT8U checkError(void);                                         /* if something error           */
+    INT32U getCanId(void);                                          /* get can id when receive      */
+    INT8U isRemoteRequest(void);                                    /* get RR flag when receive     */
+    INT8U isExtendedFrame(void);                                    /* did we recieve 29bit frame?  */
+
+    int getSocket(void);                                            /* for select()/poll() loops    */
+};
+
+#endif
+/*********************************************************************************************************
+  END FILE
+*********************************************************************************************************/
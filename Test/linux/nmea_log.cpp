@@ -0,0 +1,502 @@
+/**
+	Romain Le Forestier
+ lecture en bloc des journaux NMEA, voir nmea_log.h
+*/
+
+#include "nmea_log.h"
+#include "gps_parser.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define NMEA_LOG_MAX_FIELD 20
+#define NMEA_LOG_ROW_BYTES 140 //un GPRMC et un GPGGA par seconde, pour reserver les colonnes
+
+//une phrase decoupee: champ 0 = identifiant, puis un champ par virgule
+//comme GPS_PARSER seuls les NMEALenght premiers caracteres comptent et le dernier champ va
+//jusqu'a la fin de la ligne (checksum compris)
+struct NmeaLine
+{
+	const char *start;               //'$'
+	const char *star;                //'*' ou NULL
+	const char *end;                 //'\n' ou fin du fichier
+	unsigned nbField;
+	const char *fieldStart[NMEA_LOG_MAX_FIELD];
+	const char *fieldEnd[NMEA_LOG_MAX_FIELD];
+};
+
+//resultat d'un morceau: les GPRMC en colonnes, les GPGGA a part pour la jointure
+struct NmeaChunk
+{
+	NmeaLog rmc;
+	std::vector<size_t> rmcPos;
+	std::vector<size_t> ggaPos;
+	std::vector<int32_t> ggaTime;
+	std::vector<int32_t> ggaAltitude;
+	std::vector<uint8_t> ggaSat;
+};
+
+//recopie les caracteres [skip, skip + width) du champ k, comme le switch(commaCount) de GPS_PARSER
+static void copyField(char *dst, unsigned width, const NmeaLine &line, unsigned k, unsigned skip)
+{
+	const char *p;
+	if(k >= line.nbField)
+		return;
+	for(p = line.fieldStart[k] + skip; p < line.fieldEnd[k] && p < line.fieldStart[k] + skip + width; p++)
+		*dst++ = *p;
+}
+
+static int32_t fieldFixedPoint(const NmeaLine &line, unsigned k, unsigned char decimals)
+{
+	char txt[16] = "";
+	copyField(txt, sizeof(txt) - 1, line, k, 0);
+	return GPS_PARSER::convertFixedPoint(txt, decimals);
+}
+
+//meme remplissage que GPS_PARSER::parseGPRMC
+static void decodeRmc(const NmeaLine &line, GPS_PARSER &parser, GPRMC_data &data)
+{
+	GPRMC_frame frame;
+	frame.valide = 0;
+	frame.latInd = 0;
+	frame.longInd = 0;
+	copyField(frame.hour, 2, line, 1, 0);
+	copyField(frame.minute, 2, line, 1, 2);
+	copyField(frame.second, 2, line, 1, 4);
+	copyField(&frame.valide, 1, line, 2, 0);
+	copyField(frame.latDeg, 2, line, 3, 0);
+	copyField(frame.latMn, 8, line, 3, 2);
+	copyField(&frame.latInd, 1, line, 4, 0);
+	copyField(frame.longDeg, 3, line, 5, 0);
+	copyField(frame.longMn, 8, line, 5, 3);
+	copyField(&frame.longInd, 1, line, 6, 0);
+	copyField(frame.speed, 5, line, 7, 0);
+	copyField(frame.day, 2, line, 9, 0);
+	copyField(frame.month, 2, line, 9, 2);
+	copyField(frame.year, 2, line, 9, 4);
+	parser.convertGprmcFrameInt(&frame, &data);
+}
+
+//meme remplissage que GPS_PARSER::parseGPGGA
+static void decodeGga(const NmeaLine &line, GPS_PARSER &parser, GPGGA_data &data)
+{
+	GPGGA_frame frame;
+	frame.latInd = 0;
+	frame.longInd = 0;
+	copyField(frame.hour, 2, line, 1, 0);
+	copyField(frame.minute, 2, line, 1, 2);
+	copyField(frame.second, 2, line, 1, 4);
+	copyField(frame.latDeg, 2, line, 2, 0);
+	copyField(frame.latMn, 7, line, 2, 2);
+	copyField(&frame.latInd, 1, line, 3, 0);
+	copyField(frame.longDeg, 3, line, 4, 0);
+	copyField(frame.longMn, 7, line, 4, 3);
+	copyField(&frame.longInd, 1, line, 5, 0);
+	copyField(&frame.valide, 1, line, 6, 0);
+	copyField(frame.nbSat, 2, line, 7, 0);
+	copyField(frame.accuracy, 3, line, 8, 0);
+	copyField(frame.altitude, 5, line, 9, 0);
+	parser.convertGpggaFrame(&frame, &data);
+}
+
+static unsigned char hexValue(char c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return 0xFF;
+}
+
+//xor de tous les octets entre '$' et '*', 8 octets a la fois
+static bool checkSum(const NmeaLine &line)
+{
+	const char *p = line.start + 1;
+	uint64_t acc = 0, word;
+	unsigned char sum, hi, lo;
+
+	if(line.star == NULL || line.end - line.star < 3)
+		return false;
+	for(; p + 8 <= line.star; p += 8)
+	{
+		memcpy(&word, p, 8);
+		acc ^= word;
+	}
+	acc ^= acc >> 32;
+	acc ^= acc >> 16;
+	acc ^= acc >> 8;
+	sum = (unsigned char) acc;
+	for(; p < line.star; p++)
+		sum ^= *p;
+	hi = hexValue(line.star[1]);
+	lo = hexValue(line.star[2]);
+	return hi <= 0x0F && lo <= 0x0F && ((hi << 4) | lo) == sum;
+}
+
+enum { LINE_OTHER, LINE_RMC, LINE_GGA };
+
+//isGPRMC/isGPGGA: les 6 premiers caracteres
+static int lineType(const NmeaLine &line)
+{
+	if(line.end - line.start < 6)
+		return LINE_OTHER;
+	if(memcmp(line.start, "$GPRMC", 6) == 0)
+		return LINE_RMC;
+	if(memcmp(line.start, "$GPGGA", 6) == 0)
+		return LINE_GGA;
+	return LINE_OTHER;
+}
+
+static void processLine(const NmeaLine &line, const char *base, GPS_PARSER &parser, NmeaChunk &out)
+{
+	GPRMC_data rmc;
+	GPGGA_data gga;
+	NmeaLog &log = out.rmc;
+	int type = lineType(line);
+
+	if(type == LINE_OTHER)
+		return;
+	if(!checkSum(line))
+	{
+		log.checksumErrors++;
+		return;
+	}
+	if(type == LINE_RMC)
+	{
+		decodeRmc(line, parser, rmc);
+		log.nbRmc++;
+		out.rmcPos.push_back(line.start - base);
+		log.time.push_back(rmc.hour * 3600L + rmc.minute * 60 + rmc.second);
+		log.date.push_back(rmc.year * 10000L + rmc.month * 100 + rmc.day);
+		log.latitude.push_back(rmc.latitudeE7);
+		log.longitude.push_back(rmc.longitudeE7);
+		log.sog.push_back(rmc.speedCentiKnot);
+		log.cog.push_back(rmc.valide ? fieldFixedPoint(line, 8, 1) : 0);
+		log.altitude.push_back(NMEA_LOG_NO_ALTITUDE);
+		log.nbSat.push_back(0);
+		log.valid.push_back(rmc.valide);
+	}
+	else
+	{
+		decodeGga(line, parser, gga);
+		log.nbGga++;
+		if(gga.fix == 0)
+			return;
+		out.ggaPos.push_back(line.start - base);
+		out.ggaTime.push_back(gga.hour * 3600L + gga.minute * 60 + gga.second);
+		out.ggaAltitude.push_back(gga.altitude);
+		out.ggaSat.push_back(gga.nbSat);
+	}
+}
+
+//machine a etat sur les caracteres $ , * et \n
+struct NmeaScanner
+{
+	NmeaLine line;
+	bool inLine;
+
+	NmeaScanner() : inLine(false) {}
+
+	inline bool handle(const char *q, const char *base, GPS_PARSER &parser, NmeaChunk &out)
+	{
+		switch(*q)
+		{
+			case '$':
+				line.start = q;
+				line.star = NULL;
+				line.nbField = 1;
+				line.fieldStart[0] = q + 1;
+				inLine = true;
+			break;
+			case ',':
+				//apres le '*' ou apres NMEALenght caracteres GPS_PARSER ne compte plus les virgules
+				if(inLine && line.star == NULL && q - line.start < NMEALenght && line.nbField < NMEA_LOG_MAX_FIELD)
+				{
+					line.fieldEnd[line.nbField - 1] = q;
+					line.fieldStart[line.nbField++] = q + 1;
+				}
+			break;
+			case '*':
+				if(inLine && line.star == NULL)
+					line.star = q;
+			break;
+			case '\n':
+				if(inLine)
+				{
+					end(q, base, parser, out);
+					return true;
+				}
+			break;
+		}
+		return false;
+	}
+
+	inline void end(const char *q, const char *base, GPS_PARSER &parser, NmeaChunk &out)
+	{
+		line.end = q;
+		line.fieldEnd[line.nbField - 1] = q - line.start < NMEALenght ? q : line.start + NMEALenght;
+		processLine(line, base, parser, out);
+		inLine = false;
+	}
+};
+
+//bits des caracteres $ , * et \n dans 64 octets
+static inline uint64_t structMask(const char *p)
+{
+#ifdef __SSE2__
+	const __m128i nl = _mm_set1_epi8('\n'), comma = _mm_set1_epi8(','), star = _mm_set1_epi8('*'),
+			dollar = _mm_set1_epi8('$');
+	uint64_t mask = 0;
+	int k;
+	for(k = 0; k < 4; k++)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *) (p + 16 * k));
+		__m128i r = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, comma)),
+				_mm_or_si128(_mm_cmpeq_epi8(v, star), _mm_cmpeq_epi8(v, dollar)));
+		mask |= (uint64_t) (uint16_t) _mm_movemask_epi8(r) << (16 * k);
+	}
+	return mask;
+#else
+	uint64_t mask = 0;
+	int k;
+	for(k = 0; k < 64; k++)
+		if(p[k] == '\n' || p[k] == ',' || p[k] == '*' || p[k] == '$')
+			mask |= (uint64_t) 1 << k;
+	return mask;
+#endif
+}
+
+static void parseChunk(const char *base, size_t from, size_t to, bool last, NmeaChunk *out)
+{
+	GPS_PARSER parser(true);
+	NmeaScanner scan;
+	const char *p = base + from;
+	size_t n = to - from, off, nbRow = n / NMEA_LOG_ROW_BYTES;
+	uint64_t mask;
+
+	out->rmc.time.reserve(nbRow);
+	out->rmc.date.reserve(nbRow);
+	out->rmc.latitude.reserve(nbRow);
+	out->rmc.longitude.reserve(nbRow);
+	out->rmc.sog.reserve(nbRow);
+	out->rmc.cog.reserve(nbRow);
+	out->rmc.altitude.reserve(nbRow);
+	out->rmc.nbSat.reserve(nbRow);
+	out->rmc.valid.reserve(nbRow);
+	out->rmcPos.reserve(nbRow);
+	for(off = 0; off + 64 <= n; off += 64)
+	{
+		mask = structMask(p + off);
+		while(mask)
+		{
+			scan.handle(p + off + __builtin_ctzll(mask), base, parser, *out);
+			mask &= mask - 1;
+		}
+	}
+	for(; off < n; off++)
+		scan.handle(p + off, base, parser, *out);
+	//derniere ligne du fichier sans '\n'
+	if(last && scan.inLine)
+		scan.end(base + to, base, parser, *out);
+}
+
+template<class T>
+static void append(std::vector<T> &dst, const std::vector<T> &src)
+{
+	dst.insert(dst.end(), src.begin(), src.end());
+}
+
+bool nmeaLogParse(const char *data, size_t size, unsigned nbThread, NmeaLog &log)
+{
+	std::vector<NmeaChunk> chunks;
+	std::vector<std::thread> threads;
+	std::vector<size_t> bound, rmcPos, ggaPos;
+	std::vector<int32_t> ggaTime, ggaAltitude;
+	std::vector<uint8_t> ggaSat;
+	size_t i, j, b;
+	unsigned t;
+
+	if(nbThread == 0)
+		nbThread = std::thread::hardware_concurrency();
+	if(nbThread == 0)
+		nbThread = 1;
+	if(size < (size_t) nbThread * 4096)
+		nbThread = 1;
+
+	//coupe sur la fin de ligne qui suit chaque part egale
+	bound.push_back(0);
+	for(t = 1; t < nbThread; t++)
+	{
+		b = size / nbThread * t;
+		const char *nl = (const char *) memchr(data + b, '\n', size - b);
+		b = nl != NULL ? (size_t) (nl - data) + 1 : size;
+		if(b < bound.back())
+			b = bound.back();
+		bound.push_back(b);
+	}
+	bound.push_back(size);
+
+	chunks.resize(nbThread);
+	for(t = 0; t < nbThread; t++)
+	{
+		chunks[t].rmc.nbRmc = chunks[t].rmc.nbGga = chunks[t].rmc.checksumErrors = 0;
+		threads.push_back(std::thread(parseChunk, data, bound[t], bound[t + 1], t == nbThread - 1, &chunks[t]));
+	}
+	for(t = 0; t < nbThread; t++)
+		threads[t].join();
+
+	log = NmeaLog();
+	log.nbRmc = log.nbGga = log.checksumErrors = 0;
+	for(t = 0; t < nbThread; t++)
+	{
+		NmeaChunk &c = chunks[t];
+		append(log.time, c.rmc.time);
+		append(log.date, c.rmc.date);
+		append(log.latitude, c.rmc.latitude);
+		append(log.longitude, c.rmc.longitude);
+		append(log.sog, c.rmc.sog);
+		append(log.cog, c.rmc.cog);
+		append(log.altitude, c.rmc.altitude);
+		append(log.nbSat, c.rmc.nbSat);
+		append(log.valid, c.rmc.valid);
+		append(rmcPos, c.rmcPos);
+		append(ggaPos, c.ggaPos);
+		append(ggaTime, c.ggaTime);
+		append(ggaAltitude, c.ggaAltitude);
+		append(ggaSat, c.ggaSat);
+		log.nbRmc += c.rmc.nbRmc;
+		log.nbGga += c.rmc.nbGga;
+		log.checksumErrors += c.rmc.checksumErrors;
+	}
+
+	//jointure dans l'ordre du fichier: le GPGGA juste avant le GPRMC, sinon celui juste apres
+	j = 0;
+	for(i = 0; i < rmcPos.size(); i++)
+	{
+		while(j < ggaPos.size() && ggaPos[j] < rmcPos[i])
+			j++;
+		if(!log.valid[i])
+			continue;
+		if(j > 0 && ggaTime[j - 1] == log.time[i])
+			b = j - 1;
+		else if(j < ggaPos.size() && ggaTime[j] == log.time[i])
+			b = j;
+		else
+			continue;
+		log.altitude[i] = ggaAltitude[b];
+		log.nbSat[i] = ggaSat[b];
+	}
+	return true;
+}
+
+bool nmeaLogParseFile(const char *path, unsigned nbThread, NmeaLog &log)
+{
+	struct stat st;
+	void *map;
+	bool ret;
+	int fd = open(path, O_RDONLY);
+
+	if(fd < 0)
+		return false;
+	if(fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return false;
+	}
+	if(st.st_size == 0)
+	{
+		close(fd);
+		return nmeaLogParse("", 0, 1, log);
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return false;
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+	ret = nmeaLogParse((const char *) map, st.st_size, nbThread, log);
+	munmap(map, st.st_size);
+	return ret;
+}
+
+size_t nmeaLogVerify(const char *data, size_t size, size_t step)
+{
+	GPS_PARSER parser(true);
+	NmeaChunk out;
+	NmeaScanner scan;
+	const char *p = data, *nl;
+	char buffer[NMEALenght + 2];
+	size_t len, n = 0, diff = 0;
+	GPRMC_data rmcRef, rmcFast;
+	GPGGA_data ggaRef, ggaFast;
+	const char *q;
+	int type;
+
+	while(p < data + size)
+	{
+		nl = (const char *) memchr(p, '\n', data + size - p);
+		if(nl == NULL)
+			nl = data + size;
+		len = nl - p;
+		if(len >= 6 && p[0] == '$' && (n++ % step) == 0)
+		{
+			//decoupage du chemin rapide, caractere par caractere
+			scan.inLine = false;
+			for(q = p; q < nl; q++)
+				if(*q == '$' || *q == ',' || *q == '*')
+					scan.handle(q, data, parser, out);
+			scan.line.end = nl;
+			scan.line.fieldEnd[scan.line.nbField - 1] = len < NMEALenght ? nl : p + NMEALenght;
+			type = lineType(scan.line);
+
+			//GPS_PARSER sur une copie de la ligne
+			memcpy(buffer, p, len < NMEALenght ? len : NMEALenght);
+			buffer[len < NMEALenght ? len : NMEALenght] = '\n';
+			buffer[NMEALenght + 1] = '\0';
+			//trames neuves a chaque phrase, comme decodeRmc/decodeGga
+			if(type == LINE_RMC)
+			{
+				GPRMC_frame rmcFrame;
+				rmcFrame.valide = 0;
+				rmcFrame.latInd = 0;
+				rmcFrame.longInd = 0;
+				parser.parseGPRMC(buffer, &rmcFrame);
+				rmcRef = GPRMC_data();
+				parser.convertGprmcFrameInt(&rmcFrame, &rmcRef);
+				rmcFast = GPRMC_data();
+				decodeRmc(scan.line, parser, rmcFast);
+				if(rmcRef.valide != rmcFast.valide || rmcRef.latitudeE7 != rmcFast.latitudeE7
+						|| rmcRef.longitudeE7 != rmcFast.longitudeE7 || rmcRef.speedCentiKnot != rmcFast.speedCentiKnot
+						|| rmcRef.hour != rmcFast.hour || rmcRef.minute != rmcFast.minute || rmcRef.second != rmcFast.second
+						|| rmcRef.day != rmcFast.day || rmcRef.month != rmcFast.month || rmcRef.year != rmcFast.year)
+					diff++;
+			}
+			else if(type == LINE_GGA)
+			{
+				GPGGA_frame ggaFrame;
+				ggaFrame.latInd = 0;
+				ggaFrame.longInd = 0;
+				parser.parseGPGGA(buffer, &ggaFrame);
+				ggaRef = GPGGA_data();
+				parser.convertGpggaFrame(&ggaFrame, &ggaRef);
+				ggaFast = GPGGA_data();
+				decodeGga(scan.line, parser, ggaFast);
+				if(ggaRef.fix != ggaFast.fix || ggaRef.latitudeE7 != ggaFast.latitudeE7
+						|| ggaRef.longitudeE7 != ggaFast.longitudeE7 || ggaRef.altitude != ggaFast.altitude
+						|| ggaRef.nbSat != ggaFast.nbSat || ggaRef.accuracy != ggaFast.accuracy
+						|| ggaRef.hour != ggaFast.hour || ggaRef.minute != ggaFast.minute || ggaRef.second != ggaFast.second)
+					diff++;
+			}
+		}
+		p = nl + 1;
+	}
+	return diff;
+}
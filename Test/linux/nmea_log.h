@@ -0,0 +1,52 @@
+/**
+	Romain Le Forestier
+ lecture en bloc des journaux NMEA enregistres par le noeud GPS, pour l'analyse apres la navigation
+ le fichier est projete en memoire (mmap), coupe en morceaux sur des fins de ligne et chaque morceau
+ est lu par un thread; les caracteres $ , * et \n sont cherches 64 octets a la fois en SSE2
+ les champs GPRMC et GPGGA sont convertis exactement comme GPS_PARSER::parseGPRMC/parseGPGGA suivis de
+ convertGprmcFrameInt/convertGpggaFrame (memes tampons, memes troncatures, memes fonctions de conversion)
+ les phrases dont le checksum *hh est faux sont ignorees
+*/
+
+//exemple d'utilisation:
+//	NmeaLog log;
+//	if(nmeaLogParseFile("voyage.nmea", 4, log))
+//		for(size_t i = 0; i < log.time.size(); i++)
+//			printf("%d %d %d\n", log.time[i], log.latitude[i], log.longitude[i]);
+
+#ifndef _NMEA_LOG_
+#define _NMEA_LOG_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define NMEA_LOG_NO_ALTITUDE INT32_MIN //pas de GPGGA valide pour la meme seconde
+
+//une ligne par phrase GPRMC, dans l'ordre du fichier
+//l'altitude et les satellites viennent du GPGGA de la meme seconde, juste avant ou juste apres
+struct NmeaLog
+{
+	std::vector<int32_t> time;       //secondes depuis minuit utc
+	std::vector<int32_t> date;       //aammjj
+	std::vector<int32_t> latitude;   //1e-7 degree, negatif au sud
+	std::vector<int32_t> longitude;  //1e-7 degree, negatif a l'ouest
+	std::vector<int32_t> sog;        //vitesse fond en 1/100 noeud
+	std::vector<int32_t> cog;        //cap fond vrai en 1/10 degree
+	std::vector<int32_t> altitude;   //decimetre, NMEA_LOG_NO_ALTITUDE sans GPGGA
+	std::vector<uint8_t> nbSat;
+	std::vector<uint8_t> valid;      //A dans la trame, sinon tous les champs sont a 0 comme convertGprmcFrame
+
+	size_t nbRmc;
+	size_t nbGga;
+	size_t checksumErrors;           //phrases GPRMC/GPGGA ignorees
+};
+
+//nbThread = 0: un thread par coeur
+bool nmeaLogParse(const char *data, size_t size, unsigned nbThread, NmeaLog &log);
+bool nmeaLogParseFile(const char *path, unsigned nbThread, NmeaLog &log);
+
+//relit une phrase sur step avec GPS_PARSER et compare, retourne le nombre de differences
+size_t nmeaLogVerify(const char *data, size_t size, size_t step);
+
+#endif
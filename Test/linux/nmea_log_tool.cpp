@@ -0,0 +1,146 @@
+//lecture en bloc d'un journal NMEA (nmea_log.cpp) et mesure du debit
+//	nmea_log_tool --generate voyage.nmea 2000    journal GPRMC + GPGGA synthetique de 2000Mo, une trame par seconde
+//	nmea_log_tool voyage.nmea [thread] [verif]   lit le fichier, affiche Go/s; verif: une phrase sur verif
+//	                                             relue par GPS_PARSER et comparee
+//compilation: g++ -O3 -march=native -pthread -I../emulator -I../send_nmea_GPS_ex -o nmea_log_tool nmea_log_tool.cpp nmea_log.cpp ../send_nmea_GPS_ex/gps_parser.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "nmea_log.h"
+
+static double nowS(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+//ajoute *hh\r\n a la phrase commencant par '$'
+static int finishSentence(char *line, int len)
+{
+	unsigned char sum = 0;
+	int i;
+	for(i = 1; i < len; i++)
+		sum ^= line[i];
+	return len + sprintf(line + len, "*%02X\r\n", sum);
+}
+
+static int generate(const char *path, unsigned long mb)
+{
+	FILE *f = fopen(path, "wb");
+	unsigned long long size = 0, target = (unsigned long long) mb << 20;
+	unsigned long t = 0;
+	char line[128];
+	int len, day, sec;
+	double lat = 48.3995, lon = -4.5082, cog = 0;
+
+	if(f == NULL)
+	{
+		perror(path);
+		return 1;
+	}
+	srand(1);
+	while(size < target)
+	{
+		sec = t % 86400;
+		day = 1 + (t / 86400) % 28;
+		cog += (rand() % 21 - 10) / 10.0;
+		if(cog < 0)
+			cog += 360;
+		if(cog >= 360)
+			cog -= 360;
+		lat += 1e-5 * (rand() % 7 - 3);
+		lon += 1e-5 * (rand() % 7 - 3);
+
+		len = sprintf(line, "$GPGGA,%02d%02d%02d.00,%02d%08.5f,%c,%03d%08.5f,%c,1,%02d,%.1f,%.1f,M,50.2,M,,",
+				sec / 3600, sec / 60 % 60, sec % 60,
+				(int) lat, (lat - (int) lat) * 60, 'N', (int) -lon, (-lon - (int) -lon) * 60, 'W',
+				4 + rand() % 9, 0.8 + (rand() % 20) / 10.0, (rand() % 2000) / 10.0);
+		len = finishSentence(line, len);
+		fwrite(line, 1, len, f);
+		size += len;
+
+		//une trame sur 50 non valide pour que les deux branches soient mesurees
+		len = sprintf(line, "$GPRMC,%02d%02d%02d.00,%c,%02d%08.5f,N,%03d%08.5f,W,%.3f,%.1f,%02d0616,,,D",
+				sec / 3600, sec / 60 % 60, sec % 60, t % 50 ? 'A' : 'V',
+				(int) lat, (lat - (int) lat) * 60, (int) -lon, (-lon - (int) -lon) * 60,
+				(rand() % 12000) / 1000.0, cog, day);
+		len = finishSentence(line, len);
+		fwrite(line, 1, len, f);
+		size += len;
+		t++;
+	}
+	fclose(f);
+	printf("%s: %llu octets, %lu secondes\n", path, size, t);
+	return 0;
+}
+
+static int verify(const char *path, size_t step)
+{
+	struct stat st;
+	void *map;
+	size_t diff;
+	int fd = open(path, O_RDONLY);
+
+	if(fd < 0 || fstat(fd, &st) < 0 || st.st_size == 0)
+		return 1;
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if(map == MAP_FAILED)
+		return 1;
+	diff = nmeaLogVerify((const char *) map, st.st_size, step);
+	munmap(map, st.st_size);
+	printf("verification GPS_PARSER, une phrase sur %lu: %lu differences\n", (unsigned long) step, (unsigned long) diff);
+	return diff != 0;
+}
+
+int main(int argc, char **argv)
+{
+	NmeaLog log;
+	struct stat st;
+	double start, duration;
+	unsigned nbThread = 0;
+	size_t i, nbAltitude = 0;
+
+	if(argc >= 4 && strcmp(argv[1], "--generate") == 0)
+		return generate(argv[2], strtoul(argv[3], NULL, 10));
+	if(argc < 2 || stat(argv[1], &st) < 0)
+	{
+		fprintf(stderr, "usage: %s journal.nmea [thread] [verif] | --generate journal.nmea Mo\n", argv[0]);
+		return 1;
+	}
+	if(argc >= 3)
+		nbThread = strtoul(argv[2], NULL, 10);
+
+	start = nowS();
+	if(!nmeaLogParseFile(argv[1], nbThread, log))
+	{
+		perror(argv[1]);
+		return 1;
+	}
+	duration = nowS() - start;
+	for(i = 0; i < log.altitude.size(); i++)
+		if(log.altitude[i] != NMEA_LOG_NO_ALTITUDE)
+			nbAltitude++;
+
+	printf("%lu GPRMC, %lu GPGGA, %lu checksums faux, %lu lignes avec altitude\n", (unsigned long) log.nbRmc,
+			(unsigned long) log.nbGga, (unsigned long) log.checksumErrors, (unsigned long) nbAltitude);
+	if(!log.time.empty())
+	{
+		i = log.time.size() - 1;
+		printf("derniere ligne: %06d %06d lat %d lon %d sog %d cog %d alt %d sat %d\n", log.time[i], log.date[i],
+				log.latitude[i], log.longitude[i], log.sog[i], log.cog[i], log.altitude[i], log.nbSat[i]);
+	}
+	printf("%.3fs, %.2f Go/s, %.1f M lignes/s\n", duration, st.st_size / duration / 1e9,
+			(log.nbRmc + log.nbGga) / duration / 1e6);
+
+	if(argc >= 4)
+		return verify(argv[1], strtoul(argv[3], NULL, 10));
+	return 0;
+}
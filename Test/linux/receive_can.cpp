@@ -0,0 +1,86 @@
+//version linux de receive_gps_accelero_ex: meme boucle de reception et de decodage,
+//mais directement sur l'interface SocketCAN du PC ou de la raspberry, sans passer par l'arduino et l'usb
+//compilation: g++ -I. -I.. -o receive_can receive_can.cpp mcp_can.cpp ../parseCan.cpp ../canFilter.cpp
+//lancement:   MCP_CAN_IF=vcan0 ./receive_can   (can0 par defaut)
+//test sans materiel: cansend vcan0 050#000CFFFD010F
+
+#include <stdio.h>
+#include <unistd.h>
+#include "mcp_can.h"
+#include "parseCan.h"
+#include "canSchema.h"
+#include "canFilter.h"
+
+const int SPI_CS_PIN = 9; //ignore sous linux, garde pour que le code soit le meme que sur l'arduino
+
+ParseCan parser(true);
+
+MCP_CAN CAN(SPI_CS_PIN);
+
+//identifiants traites, le noyau jette les autres
+const unsigned long canIds[] = { MSG_GPRMC_LAT_LONG, MSG_GPRMC_LAT_LONG_E7, MSG_GPRMC_VIT_DATE,
+                                 MSG_GYRO_X_Y_Z, MSG_IMU_PHI_THETA_PSI, MSG_SERIAL_DIAG };
+
+int main()
+{
+    unsigned char len = 0;
+    unsigned char buf[8];
+    CanFilterConfig filterCfg;
+
+    while(CAN_OK != CAN.begin(CAN_500KBPS))
+    {
+        printf("CAN BUS init fail\n");
+        printf("Init CAN BUS again\n");
+        sleep(1);
+    }
+    printf("CAN BUS init ok!\n");
+
+    canFilterSolve(canIds, sizeof(canIds) / sizeof(canIds[0]), CAN_STDID, filterCfg);
+    canFilterApply(CAN, filterCfg);
+
+    while(1)
+    {
+        if(CAN_MSGAVAIL != CAN.checkReceive())
+        {
+            usleep(1000);
+            continue;
+        }
+        CAN.readMsgBuf(&len, buf);
+
+        switch(CAN.getCanId())
+        {
+          case MSG_GPRMC_LAT_LONG :
+                printf("MSG_GPRMC_LAT_LONG\nlat:%.6f long:%.6f\n",
+                       CanMsgGprmcLatLong::latitude::unpack(buf), CanMsgGprmcLatLong::longitude::unpack(buf));
+            break;
+          case MSG_GPRMC_LAT_LONG_E7 :
+                printf("MSG_GPRMC_LAT_LONG_E7\nlat(1e-7 deg):%ld long(1e-7 deg):%ld\n",
+                       CanMsgGprmcLatLongE7::latitude::unpack(buf), CanMsgGprmcLatLongE7::longitude::unpack(buf));
+            break;
+          case MSG_GPRMC_VIT_DATE :
+                printf("MSG_GPRMC_VIT_DATE\nvitesse:%.4fnoeud, date:%d/%d/%d\n",
+                       CanMsgGprmcVitDate::speed::unpack(buf), CanMsgGprmcVitDate::day::unpack(buf),
+                       CanMsgGprmcVitDate::month::unpack(buf), CanMsgGprmcVitDate::year::unpack(buf));
+            break;
+          case MSG_GYRO_X_Y_Z :
+                printf("MSG_GYRO_X_Y_Z\nGYRO x:%d y:%d z:%d\n",
+                       CanMsgGyro::x::unpack(buf), CanMsgGyro::y::unpack(buf), CanMsgGyro::z::unpack(buf));
+            break;
+          case MSG_IMU_PHI_THETA_PSI :
+                printf("MSG_IMU_PHI_THETA_PSI\nIMU phi:%d theta:%d psi:%d\n",
+                       CanMsgImu::phi::unpack(buf), CanMsgImu::theta::unpack(buf), CanMsgImu::psi::unpack(buf));
+            break;
+          case MSG_SERIAL_DIAG :
+                printf("MSG_SERIAL_DIAG\nport:%d remplissage max:%d perdus buffer:%u perdus usart:%u bit de stop:%d parite:%d\n",
+                       CanMsgSerialDiag::port::unpack(buf), CanMsgSerialDiag::highWater::unpack(buf),
+                       CanMsgSerialDiag::overflows::unpack(buf), CanMsgSerialDiag::overruns::unpack(buf),
+                       CanMsgSerialDiag::framing::unpack(buf), CanMsgSerialDiag::parity::unpack(buf));
+            break;
+          default: //par defaut on affiche le code hexa que l'on a reçus
+                printf("recus id: %lX\n", (unsigned long) CAN.getCanId());
+            break;
+        }
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,1627 @@
+/*
+  mcp_can.cpp
+  2012 Copyright (c) Seeed Technology Inc.  All right reserved.
+
+  Author:Loovee
+  Contributor: Cory J. Fowler
+  2014-1-16
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-
+  1301  USA
+*/
+#include "mcp_can.h"
+
+#if MCP_SPI_ACCOUNTING
+#define spi_readwrite(b) (MCP_SPI_COUNT_BYTE(), SPI.transfer(b))
+#else
+#define spi_readwrite SPI.transfer
+#endif
+#define spi_read() spi_readwrite(0x00)
+
+MCP_CAN *MCP_CAN::m_pIntInstance = NULL;
+
+/*********************************************************************************************************
+** Function name:           mcp2515_reset
+** Descriptions:            reset the device
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_reset(void)
+{
+    MCP2515_SELECT();
+    spi_readwrite(MCP_RESET);
+    MCP2515_UNSELECT();
+    delay(10);
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_readRegister
+** Descriptions:            read register
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_readRegister(const INT8U address)                                                                     
+{
+    INT8U ret;
+
+    MCP2515_SELECT();
+    spi_readwrite(MCP_READ);
+    spi_readwrite(address);
+    ret = spi_read();
+    MCP2515_UNSELECT();
+
+    return ret;
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_readRegisterS
+** Descriptions:            read registerS
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_readRegisterS(const INT8U address, INT8U values[], const INT8U n)
+{
+	INT8U i;
+	MCP2515_SELECT();
+	spi_readwrite(MCP_READ);
+	spi_readwrite(address);
+	// mcp2515 has auto-increment of address-pointer
+	for (i=0; i<n && i<CAN_MAX_CHAR_IN_MESSAGE; i++) {
+		values[i] = spi_read();
+	}
+	MCP2515_UNSELECT();
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_setRegister
+** Descriptions:            set register
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_setRegister(const INT8U address, const INT8U value)
+{
+    MCP2515_SELECT();
+    spi_readwrite(MCP_WRITE);
+    spi_readwrite(address);
+    spi_readwrite(value);
+    MCP2515_UNSELECT();
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_setRegisterS
+** Descriptions:            set registerS
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_setRegisterS(const INT8U address, const INT8U values[], const INT8U n)
+{
+    INT8U i;
+    MCP2515_SELECT();
+    spi_readwrite(MCP_WRITE);
+    spi_readwrite(address);
+       
+    for (i=0; i<n; i++) 
+    {
+        spi_readwrite(values[i]);
+    }
+    MCP2515_UNSELECT();
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_modifyRegister
+** Descriptions:            set bit of one register
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_modifyRegister(const INT8U address, const INT8U mask, const INT8U data)
+{
+    MCP2515_SELECT();
+    spi_readwrite(MCP_BITMOD);
+    spi_readwrite(address);
+    spi_readwrite(mask);
+    spi_readwrite(data);
+    MCP2515_UNSELECT();
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_readStatus
+** Descriptions:            read mcp2515's Status
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_readStatus(void)                             
+{
+	INT8U i;
+	MCP2515_SELECT();
+	spi_readwrite(MCP_READ_STATUS);
+	i = spi_read();
+	MCP2515_UNSELECT();
+	
+	return i;
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_setCANCTRL_Mode
+** Descriptions:            set control mode
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_setCANCTRL_Mode(const INT8U newmode)
+{
+    INT8U i;
+
+    mcp2515_modifyRegister(MCP_CANCTRL, MODE_MASK, newmode);
+
+    i = mcp2515_readRegister(MCP_CANCTRL);
+    i &= MODE_MASK;
+
+    if ( i == newmode ) 
+    {
+        return MCP2515_OK;
+    }
+
+    return MCP2515_FAIL;
+
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_configRate
+** Descriptions:            set boadrate
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_configRate(const INT8U canSpeed)            
+{
+    INT8U set, cfg1, cfg2, cfg3;
+    set = 1;
+    switch (canSpeed) 
+    {
+        case (CAN_5KBPS):
+        cfg1 = MCP_16MHz_5kBPS_CFG1;
+        cfg2 = MCP_16MHz_5kBPS_CFG2;
+        cfg3 = MCP_16MHz_5kBPS_CFG3;
+        break;
+
+        case (CAN_10KBPS):
+        cfg1 = MCP_16MHz_10kBPS_CFG1;
+        cfg2 = MCP_16MHz_10kBPS_CFG2;
+        cfg3 = MCP_16MHz_10kBPS_CFG3;
+        break;
+
+        case (CAN_20KBPS):
+        cfg1 = MCP_16MHz_20kBPS_CFG1;
+        cfg2 = MCP_16MHz_20kBPS_CFG2;
+        cfg3 = MCP_16MHz_20kBPS_CFG3;
+        break;
+        
+        case (CAN_31K25BPS):
+        cfg1 = MCP_16MHz_31k25BPS_CFG1;
+        cfg2 = MCP_16MHz_31k25BPS_CFG2;
+        cfg3 = MCP_16MHz_31k25BPS_CFG3;
+        break;
+
+        case (CAN_33KBPS):
+        cfg1 = MCP_16MHz_33kBPS_CFG1;
+        cfg2 = MCP_16MHz_33kBPS_CFG2;
+        cfg3 = MCP_16MHz_33kBPS_CFG3;
+        break;
+
+        case (CAN_40KBPS):
+        cfg1 = MCP_16MHz_40kBPS_CFG1;
+        cfg2 = MCP_16MHz_40kBPS_CFG2;
+        cfg3 = MCP_16MHz_40kBPS_CFG3;
+        break;
+
+        case (CAN_50KBPS):
+        cfg1 = MCP_16MHz_50kBPS_CFG1;
+        cfg2 = MCP_16MHz_50kBPS_CFG2;
+        cfg3 = MCP_16MHz_50kBPS_CFG3;
+        break;
+
+        case (CAN_80KBPS):
+        cfg1 = MCP_16MHz_80kBPS_CFG1;
+        cfg2 = MCP_16MHz_80kBPS_CFG2;
+        cfg3 = MCP_16MHz_80kBPS_CFG3;
+        break;
+
+        case (CAN_83K3BPS):
+        cfg1 = MCP_16MHz_83k3BPS_CFG1;
+        cfg2 = MCP_16MHz_83k3BPS_CFG2;
+        cfg3 = MCP_16MHz_83k3BPS_CFG3;
+        break;  
+
+        case (CAN_95KBPS):
+        cfg1 = MCP_16MHz_95kBPS_CFG1;
+        cfg2 = MCP_16MHz_95kBPS_CFG2;
+        cfg3 = MCP_16MHz_95kBPS_CFG3;
+        break;
+
+        case (CAN_100KBPS):                                             /* 100KBPS                  */
+        cfg1 = MCP_16MHz_100kBPS_CFG1;
+        cfg2 = MCP_16MHz_100kBPS_CFG2;
+        cfg3 = MCP_16MHz_100kBPS_CFG3;
+        break;
+
+        case (CAN_125KBPS):
+        cfg1 = MCP_16MHz_125kBPS_CFG1;
+        cfg2 = MCP_16MHz_125kBPS_CFG2;
+        cfg3 = MCP_16MHz_125kBPS_CFG3;
+        break;
+
+        case (CAN_200KBPS):
+        cfg1 = MCP_16MHz_200kBPS_CFG1;
+        cfg2 = MCP_16MHz_200kBPS_CFG2;
+        cfg3 = MCP_16MHz_200kBPS_CFG3;
+        break;
+
+        case (CAN_250KBPS):
+        cfg1 = MCP_16MHz_250kBPS_CFG1;
+        cfg2 = MCP_16MHz_250kBPS_CFG2;
+        cfg3 = MCP_16MHz_250kBPS_CFG3;
+        break;
+
+        case (CAN_500KBPS):
+        cfg1 = MCP_16MHz_500kBPS_CFG1;
+        cfg2 = MCP_16MHz_500kBPS_CFG2;
+        cfg3 = MCP_16MHz_500kBPS_CFG3;
+        break;
+        
+        case (CAN_1000KBPS):
+        cfg1 = MCP_16MHz_1000kBPS_CFG1;
+        cfg2 = MCP_16MHz_1000kBPS_CFG2;
+        cfg3 = MCP_16MHz_1000kBPS_CFG3;
+        break;  
+
+        default:
+        set = 0;
+        break;
+    }
+
+    if (set) {
+        mcp2515_setRegister(MCP_CNF1, cfg1);
+        mcp2515_setRegister(MCP_CNF2, cfg2);
+        mcp2515_setRegister(MCP_CNF3, cfg3);
+        return MCP2515_OK;
+    }
+    else {
+        return MCP2515_FAIL;
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_initCANBuffers
+** Descriptions:            init canbuffers
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_initCANBuffers(void)
+{
+    INT8U i, a1, a2, a3;
+    
+    INT8U std = 0;               
+    INT8U ext = 1;
+    INT32U ulMask = 0x00, ulFilt = 0x00;
+
+
+    //mcp2515_write_id(MCP_RXM0SIDH, ext, ulMask);			/*Set both masks to 0           */
+    //mcp2515_write_id(MCP_RXM1SIDH, ext, ulMask);			/*Mask register ignores ext bit */
+    
+                                                            /* Set all filters to 0         */
+    //mcp2515_write_id(MCP_RXF0SIDH, ext, ulFilt);			/* RXB0: extended               */
+    //mcp2515_write_id(MCP_RXF1SIDH, std, ulFilt);			/* RXB1: standard               */
+    //mcp2515_write_id(MCP_RXF2SIDH, ext, ulFilt);			/* RXB2: extended               */
+    //mcp2515_write_id(MCP_RXF3SIDH, std, ulFilt);			/* RXB3: standard               */
+    //mcp2515_write_id(MCP_RXF4SIDH, ext, ulFilt);
+    //mcp2515_write_id(MCP_RXF5SIDH, std, ulFilt);
+
+                                                                        /* Clear, deactivate the three  */
+                                                                        /* transmit buffers             */
+                                                                        /* TXBnCTRL -> TXBnD7           */
+    a1 = MCP_TXB0CTRL;
+    a2 = MCP_TXB1CTRL;
+    a3 = MCP_TXB2CTRL;
+    for (i = 0; i < 14; i++) {                                          /* in-buffer loop               */
+        mcp2515_setRegister(a1, 0);
+        mcp2515_setRegister(a2, 0);
+        mcp2515_setRegister(a3, 0);
+        a1++;
+        a2++;
+        a3++;
+    }
+    mcp2515_setRegister(MCP_RXB0CTRL, 0);
+    mcp2515_setRegister(MCP_RXB1CTRL, 0);
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_init
+** Descriptions:            init the device
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_init(const INT8U canSpeed)                       /* mcp2515init                  */
+{
+
+  INT8U res;
+
+    mcp2515_reset();
+
+    res = mcp2515_setCANCTRL_Mode(MODE_CONFIG);
+    if(res > 0)
+    {
+#if DEBUG_MODE
+      Serial.print("Enter setting mode fall\r\n"); 
+#else
+      delay(10);
+#endif
+      return res;
+    }
+#if DEBUG_MODE
+    Serial.print("Enter setting mode success \r\n");
+#else
+    delay(10);
+#endif
+
+                                                                        /* set boadrate                 */
+    if(mcp2515_configRate(canSpeed))
+    {
+#if DEBUG_MODE
+      Serial.print("set rate fall!!\r\n");
+#else
+      delay(10);
+#endif
+      return res;
+    }
+#if DEBUG_MODE
+    Serial.print("set rate success!!\r\n");
+#else
+    delay(10);
+#endif
+
+    if ( res == MCP2515_OK ) {
+
+                                                                        /* init canbuffers              */
+        mcp2515_initCANBuffers();
+
+                                                                        /* interrupt mode               */
+        mcp2515_setRegister(MCP_CANINTE, MCP_RX0IF | MCP_RX1IF);
+
+#if (DEBUG_RXANY==1)
+                                                                        /* enable both receive-buffers  */
+                                                                        /* to receive any message       */
+                                                                        /* and enable rollover          */
+        mcp2515_modifyRegister(MCP_RXB0CTRL,
+        MCP_RXB_RX_MASK | MCP_RXB_BUKT_MASK,
+        MCP_RXB_RX_ANY | MCP_RXB_BUKT_MASK);
+        mcp2515_modifyRegister(MCP_RXB1CTRL, MCP_RXB_RX_MASK,
+        MCP_RXB_RX_ANY);
+#else
+                                                                        /* enable both receive-buffers  */
+                                                                        /* to receive messages          */
+                                                                        /* with std. and ext. identifie */
+                                                                        /* rs                           */
+                                                                        /* and enable rollover          */
+        mcp2515_modifyRegister(MCP_RXB0CTRL,
+        MCP_RXB_RX_MASK | MCP_RXB_BUKT_MASK,
+        MCP_RXB_RX_STDEXT | MCP_RXB_BUKT_MASK );
+        mcp2515_modifyRegister(MCP_RXB1CTRL, MCP_RXB_RX_MASK,
+        MCP_RXB_RX_STDEXT);
+#endif
+                                                                        /* enter normal mode            */
+        res = mcp2515_setCANCTRL_Mode(MODE_NORMAL);                                                                
+        if(res)
+        {
+#if DEBUG_MODE        
+          Serial.print("Enter Normal Mode Fall!!\r\n");
+#else
+            delay(10);
+#endif           
+          return res;
+        }
+
+
+#if DEBUG_MODE
+          Serial.print("Enter Normal Mode Success!!\r\n");
+#else
+            delay(10);
+#endif
+
+    }
+    return res;
+
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_id_to_buf
+** Descriptions:            encode a can id in the SIDH, SIDL, EID8, EID0 registers layout
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_id_to_buf( const INT8U ext, const INT32U id, INT8U tbufdata[] )
+{
+    uint16_t canid;
+
+    canid = (uint16_t)(id & 0x0FFFF);
+
+    if ( ext == 1) 
+    {
+        tbufdata[MCP_EID0] = (INT8U) (canid & 0xFF);
+        tbufdata[MCP_EID8] = (INT8U) (canid >> 8);
+        canid = (uint16_t)(id >> 16);
+        tbufdata[MCP_SIDL] = (INT8U) (canid & 0x03);
+        tbufdata[MCP_SIDL] += (INT8U) ((canid & 0x1C) << 3);
+        tbufdata[MCP_SIDL] |= MCP_TXB_EXIDE_M;
+        tbufdata[MCP_SIDH] = (INT8U) (canid >> 5 );
+    }
+    else 
+    {
+        tbufdata[MCP_SIDH] = (INT8U) (canid >> 3 );
+        tbufdata[MCP_SIDL] = (INT8U) ((canid & 0x07 ) << 5);
+        tbufdata[MCP_EID0] = 0;
+        tbufdata[MCP_EID8] = 0;
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_buf_to_id
+** Descriptions:            decode a can id from the SIDH, SIDL, EID8, EID0 registers layout
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_buf_to_id( const INT8U tbufdata[], INT8U* ext, INT32U* id )
+{
+    *ext = 0;
+    *id = (tbufdata[MCP_SIDH]<<3) + (tbufdata[MCP_SIDL]>>5);
+
+    if ( (tbufdata[MCP_SIDL] & MCP_TXB_EXIDE_M) ==  MCP_TXB_EXIDE_M ) 
+    {
+                                                                        /* extended id                  */
+        *id = (*id<<2) + (tbufdata[MCP_SIDL] & 0x03);
+        *id = (*id<<8) + tbufdata[MCP_EID8];
+        *id = (*id<<8) + tbufdata[MCP_EID0];
+        *ext = 1;
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_write_id
+** Descriptions:            write can id
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_write_id( const INT8U mcp_addr, const INT8U ext, const INT32U id )
+{
+    INT8U tbufdata[4];
+
+    mcp2515_id_to_buf( ext, id, tbufdata );
+    mcp2515_setRegisterS( mcp_addr, tbufdata, 4 );
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_read_id
+** Descriptions:            read can id
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_read_id( const INT8U mcp_addr, INT8U* ext, INT32U* id )
+{
+    INT8U tbufdata[4];
+
+    mcp2515_readRegisterS( mcp_addr, tbufdata, 4 );
+    mcp2515_buf_to_id( tbufdata, ext, id );
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_read_frame
+** Descriptions:            read message into a frame
+**                          fast spi: one READ RX BUFFER instruction, the mcp2515 clears RXnIF itself
+**                          when CS goes high
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_read_frame( const INT8U buffer_sidh_addr, CAN_FRAME *frame)
+{
+    INT8U ctrl, i;
+    INT8U tbufdata[5];
+
+    MCP_SPI_COUNT_FRAME(rxFrames);
+    if ( m_nFastSpi )
+    {
+        MCP2515_SELECT();
+        spi_readwrite( buffer_sidh_addr == MCP_RXBUF_0 ? MCP_READ_RX0 : MCP_READ_RX1 );
+        for (i=0; i<5; i++) {                                           /* SIDH SIDL EID8 EID0 DLC      */
+            tbufdata[i] = spi_read();
+        }
+        mcp2515_buf_to_id( tbufdata, &frame->ext, &frame->id );
+        frame->dlc = tbufdata[4] & MCP_DLC_MASK;
+        if ( frame->dlc > CAN_MAX_CHAR_IN_MESSAGE )
+        {
+            frame->dlc = CAN_MAX_CHAR_IN_MESSAGE;
+        }
+        if ( frame->ext )
+        {
+            frame->rtr = (tbufdata[4] & MCP_RXB_RTR_M) ? 1 : 0;
+        }
+        else
+        {
+            frame->rtr = (tbufdata[MCP_SIDL] & MCP_RXB_SRR_M) ? 1 : 0;
+        }
+        for (i=0; i<frame->dlc; i++) {
+            frame->data[i] = spi_read();
+        }
+        MCP2515_UNSELECT();
+        return;
+    }
+
+    mcp2515_read_id( buffer_sidh_addr, &frame->ext, &frame->id );
+
+    ctrl = mcp2515_readRegister( buffer_sidh_addr-1 );
+    frame->dlc = mcp2515_readRegister( buffer_sidh_addr+4 ) & MCP_DLC_MASK;
+    frame->rtr = (ctrl & 0x08) ? 1 : 0;
+
+    mcp2515_readRegisterS( buffer_sidh_addr+5, frame->data, frame->dlc );
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_write_frame
+** Descriptions:            write a frame in a tx buffer
+**                          fast spi: one LOAD TX BUFFER instruction for id, dlc and data
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_write_frame( const INT8U buffer_sidh_addr, const CAN_FRAME *frame)
+{
+    INT8U dlc = frame->dlc;
+    INT8U i;
+    INT8U tbufdata[4];
+
+    MCP_SPI_COUNT_FRAME(txFrames);
+    if ( frame->rtr == 1 )
+    {
+        dlc |= MCP_RTR_MASK;
+    }
+    if ( m_nFastSpi )
+    {
+        mcp2515_id_to_buf( frame->ext, frame->id, tbufdata );
+        MCP2515_SELECT();
+                                                                        /* 0x40, 0x42, 0x44: from SIDH  */
+        spi_readwrite( MCP_LOAD_TX0 + (((buffer_sidh_addr - MCP_TXB0CTRL) >> 4) << 1) );
+        for (i=0; i<4; i++) {
+            spi_readwrite( tbufdata[i] );
+        }
+        spi_readwrite( dlc );
+        for (i=0; i<frame->dlc; i++) {
+            spi_readwrite( frame->data[i] );
+        }
+        MCP2515_UNSELECT();
+        return;
+    }
+
+    mcp2515_setRegisterS( buffer_sidh_addr+5, frame->data, frame->dlc ); /* write data bytes            */
+    mcp2515_setRegister( buffer_sidh_addr+4, dlc );                     /* write the RTR and DLC        */
+    mcp2515_write_id( buffer_sidh_addr, frame->ext, frame->id );        /* write CAN id                 */
+}
+
+/*********************************************************************************************************
+** Function name:           loadTxBuffers
+** Descriptions:            move queued frames into every tx buffer not owned by a pending frame
+**                          called by the isr, or by queueFrame with interrupts off
+*********************************************************************************************************/
+void MCP_CAN::loadTxBuffers(void)
+{
+    INT8U i, tail;
+    INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+
+    tail = m_txTail;
+    for (i=0; i<MCP_N_TXBUFFERS && tail != m_txHead; i++) {
+        if ( m_txBusy & (1<<i) ) {
+            continue;
+        }
+        mcp2515_write_frame( ctrlregs[i]+1, &m_txQueue[tail] );
+        m_txBufTicket[i] = m_txQueueTicket[tail];
+        m_txBufStart[i] = m_txQueueTime[tail];
+        m_txBusy |= (1<<i);
+        mcp2515_start_transmit( ctrlregs[i]+1 );
+        tail = (tail + 1) & MCP_TX_QUEUE_MASK;
+    }
+    m_txTail = tail;
+}
+
+/*********************************************************************************************************
+** Function name:           abortStaleTx
+** Descriptions:            give up the frames queued for more than MCP_TX_TIMEOUT_MS (nobody acknowledges,
+**                          bus-off, or always losing arbitration): clear TXREQ of the loaded ones, drop
+**                          the others from the queue, mark their tickets CAN_TXFAILED, interrupts off
+*********************************************************************************************************/
+void MCP_CAN::abortStaleTx(void)
+{
+    INT8U i, tail, freed = 0;
+    INT32U now = millis();
+    const INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+    const INT8U txflag[MCP_N_TXBUFFERS] = { MCP_TX0IF, MCP_TX1IF, MCP_TX2IF };
+
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        if ( !(m_txBusy & (1<<i)) || now - m_txBufStart[i] < MCP_TX_TIMEOUT_MS ) {
+            continue;
+        }
+        mcp2515_modifyRegister( ctrlregs[i], MCP_TXB_TXREQ_M, 0 );
+        if ( mcp2515_readRegister( ctrlregs[i] ) & MCP_TXB_TXREQ_M ) {  /* on the bus now: TXnIF or     */
+            continue;                                                   /* ABTF on the next call        */
+        }
+        if ( mcp2515_readRegister( MCP_CANINTF ) & txflag[i] ) {        /* sent just before the abort,  */
+            continue;                                                   /* the isr gives CAN_OK         */
+        }
+        m_txStatus[m_txBufTicket[i] & MCP_TX_STATUS_MASK] = CAN_TXFAILED;
+        m_txBusy &= ~(1<<i);
+        m_txAborted++;
+        freed = 1;
+    }
+    tail = m_txTail;                                                    /* oldest first: stop at the    */
+    while ( tail != m_txHead && now - m_txQueueTime[tail] >= MCP_TX_TIMEOUT_MS ) {  /* first recent   */
+        m_txStatus[m_txQueueTicket[tail] & MCP_TX_STATUS_MASK] = CAN_TXFAILED;
+        m_txAborted++;
+        tail = (tail + 1) & MCP_TX_QUEUE_MASK;
+    }
+    m_txTail = tail;
+    if ( freed ) {
+        loadTxBuffers();
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           serviceTxError
+** Descriptions:            isr: MERRF, count the buffers with TXERR and stop the MERRF interrupt until a
+**                          frame goes out, a lone node would get one per retry
+*********************************************************************************************************/
+void MCP_CAN::serviceTxError(void)
+{
+    INT8U i;
+    const INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        if ( (m_txBusy & (1<<i)) && (mcp2515_readRegister( ctrlregs[i] ) & MCP_TXB_TXERR_M) ) {
+            m_txErrors++;
+            break;
+        }
+    }
+    mcp2515_modifyRegister(MCP_CANINTE, MCP_MERRF, 0);                  /* MERRE: same bit as MERRF     */
+    mcp2515_modifyRegister(MCP_CANINTF, MCP_MERRF, 0);
+    m_txErrOff = 1;
+    abortStaleTx();
+}
+
+/*********************************************************************************************************
+** Function name:           serviceInterrupt
+** Descriptions:            isr: move RXB0/RXB1 into the receive ring and refill the tx buffers,
+**                          loop until no enabled flag is left so INT goes high again
+*********************************************************************************************************/
+void MCP_CAN::serviceInterrupt(void)
+{
+    INT8U stat, mask, addr, flag, next, eflg, i;
+    INT32U now = micros();
+    const INT8U txstat[MCP_N_TXBUFFERS] = { MCP_STAT_TX0IF, MCP_STAT_TX1IF, MCP_STAT_TX2IF };
+    const INT8U txflag[MCP_N_TXBUFFERS] = { MCP_TX0IF, MCP_TX1IF, MCP_TX2IF };
+
+    mask = 0;
+    if ( m_nIntMode & MCP_INTMODE_RX )
+    {
+        mask |= MCP_STAT_RXIF_MASK;
+    }
+    if ( m_nIntMode & MCP_INTMODE_TX )
+    {
+        mask |= MCP_STAT_TXIF_MASK;
+    }
+
+    stat = mcp2515_readStatus();
+    for (;;)
+    {
+        while ( stat & mask )
+        {
+            if ( stat & mask & MCP_STAT_RXIF_MASK )
+            {
+                if ( stat & MCP_STAT_RX0IF )
+                {
+                    addr = MCP_RXBUF_0;
+                    flag = MCP_RX0IF;
+                }
+                else
+                {
+                    addr = MCP_RXBUF_1;
+                    flag = MCP_RX1IF;
+                }
+
+                next = (m_rxHead + 1) & MCP_RX_RING_MASK;
+                if ( next != m_rxTail )
+                {
+                    mcp2515_read_frame( addr, &m_rxRing[m_rxHead] );
+                    m_rxRing[m_rxHead].timestamp = now;
+                    m_rxHead = next;
+                }
+                else
+                {
+                    m_rxOverflow++;                                     /* ring full: drop the frame    */
+                }
+                                                                        /* always release the buffer,   */
+                                                                        /* or INT stays low for ever    */
+                if ( !m_nFastSpi || next == m_rxTail )                  /* READ RX already cleared it   */
+                {
+                    mcp2515_modifyRegister(MCP_CANINTF, flag, 0);
+                }
+            }
+
+            if ( stat & mask & MCP_STAT_TXIF_MASK )
+            {
+                flag = 0;
+                for (i=0; i<MCP_N_TXBUFFERS; i++) {
+                    if ( stat & txstat[i] ) {
+                        flag |= txflag[i];
+                        if ( m_txBusy & (1<<i) ) {                      /* frame is on the bus          */
+                            m_txStatus[m_txBufTicket[i] & MCP_TX_STATUS_MASK] = CAN_OK;
+                            m_txBusy &= ~(1<<i);
+                        }
+                    }
+                }
+                if ( m_txErrOff )                                       /* the bus works again: watch   */
+                {                                                       /* the errors again             */
+                    flag |= MCP_MERRF;
+                    m_txErrOff = 0;
+                }
+                mcp2515_modifyRegister(MCP_CANINTF, flag, 0);
+                if ( flag & MCP_MERRF )
+                {
+                    mcp2515_modifyRegister(MCP_CANINTE, MCP_MERRF, MCP_MERRF);
+                }
+                loadTxBuffers();
+            }
+            stat = mcp2515_readStatus();
+        }
+                                                                        /* READ STATUS does not show    */
+                                                                        /* MERRF, it would keep INT low */
+        if ( !(m_nIntMode & MCP_INTMODE_TX) || m_txErrOff
+             || !(mcp2515_readRegister(MCP_CANINTF) & MCP_MERRF) )
+        {
+            break;
+        }
+        serviceTxError();
+        stat = mcp2515_readStatus();
+    }
+
+    if ( m_nIntMode & MCP_INTMODE_RX )
+    {
+        eflg = mcp2515_readRegister(MCP_EFLG);
+        if ( eflg & (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR) )
+        {
+            m_hwOverflow++;
+            mcp2515_modifyRegister(MCP_EFLG, MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR, 0);
+        }
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           isrInt
+** Descriptions:            INT pin interrupt handler
+*********************************************************************************************************/
+void MCP_CAN::isrInt(void)
+{
+    if ( m_pIntInstance != NULL )
+    {
+        m_pIntInstance->serviceInterrupt();
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsg
+** Descriptions:            send message
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_start_transmit(const INT8U mcp_addr)              /* start transmit               */
+{
+    const INT8U rts[MCP_N_TXBUFFERS] = { MCP_RTS_TX0, MCP_RTS_TX1, MCP_RTS_TX2 };
+
+    if ( m_nFastSpi )                                                   /* REQUEST TO SEND: 1 byte      */
+    {
+        MCP2515_SELECT();
+        spi_readwrite( rts[(mcp_addr - MCP_TXB0CTRL) >> 4] );
+        MCP2515_UNSELECT();
+        return;
+    }
+    mcp2515_modifyRegister( mcp_addr-1 , MCP_TXB_TXREQ_M, MCP_TXB_TXREQ_M );
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsg
+** Descriptions:            send message
+*********************************************************************************************************/
+INT8U MCP_CAN::mcp2515_getNextFreeTXBuf(INT8U *txbuf_n)                 /* get Next free txbuf          */
+{
+    INT8U res, i, ctrlval;
+    INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+
+    res = MCP_ALLTXBUSY;
+    *txbuf_n = 0x00;
+
+                                                                        /* check all 3 TX-Buffers       */
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        ctrlval = mcp2515_readRegister( ctrlregs[i] );
+        if ( (ctrlval & MCP_TXB_TXREQ_M) == 0 ) {
+            *txbuf_n = ctrlregs[i]+1;                                   /* return SIDH-address of Buffe */
+                                                                        /* r                            */
+            res = MCP2515_OK;
+            return res;                                                 /* ! function exit              */
+        }
+    }
+    return res;
+}
+
+/*********************************************************************************************************
+** Function name:           set CS
+** Descriptions:            init CS pin and set UNSELECTED
+*********************************************************************************************************/
+MCP_CAN::MCP_CAN(INT8U _CS)
+{
+    SPICS = _CS;
+    m_nIntMode = 0;
+    m_rxHead = 0;
+    m_rxTail = 0;
+    m_rxOverflow = 0;
+    m_hwOverflow = 0;
+    m_txHead = 0;
+    m_txTail = 0;
+    m_txBusy = 0;
+    m_txNextTicket = 0;
+    m_txErrOff = 0;
+    m_txErrors = 0;
+    m_txAborted = 0;
+    m_nFastSpi = 1;
+#if MCP_SPI_ACCOUNTING
+    resetSpiStats();
+#endif
+    pinMode(SPICS, OUTPUT);
+    MCP2515_UNSELECT();
+}
+
+/*********************************************************************************************************
+** Function name:           init
+** Descriptions:            init can and set speed
+*********************************************************************************************************/
+INT8U MCP_CAN::begin(INT8U speedset)
+{
+    INT8U res;
+
+    SPI.begin();
+    res = mcp2515_init(speedset);
+    if (res == MCP2515_OK) return CAN_OK;
+    else return CAN_FAILINIT;
+}
+
+/*********************************************************************************************************
+** Function name:           init_Mask
+** Descriptions:            init canid Masks
+*********************************************************************************************************/
+INT8U MCP_CAN::init_Mask(INT8U num, INT8U ext, INT32U ulData)
+{
+    INT8U res = MCP2515_OK;
+#if DEBUG_MODE
+    Serial.print("Begin to set Mask!!\r\n");
+#else
+    delay(10);
+#endif
+    res = mcp2515_setCANCTRL_Mode(MODE_CONFIG);
+    if(res > 0){
+#if DEBUG_MODE
+    Serial.print("Enter setting mode fall\r\n"); 
+#else
+    delay(10);
+#endif
+    return res;
+    }
+    
+    if (num == 0){
+        mcp2515_write_id(MCP_RXM0SIDH, ext, ulData);
+
+    }
+    else if(num == 1){
+        mcp2515_write_id(MCP_RXM1SIDH, ext, ulData);
+    }
+    else res =  MCP2515_FAIL;
+    
+    res = mcp2515_setCANCTRL_Mode(MODE_NORMAL);
+    if(res > 0){
+#if DEBUG_MODE
+    Serial.print("Enter normal mode fall\r\n"); 
+#else
+    delay(10);
+#endif
+    return res;
+  }
+#if DEBUG_MODE
+    Serial.print("set Mask success!!\r\n");
+#else
+    delay(10);
+#endif
+    return res;
+}
+
+/*********************************************************************************************************
+** Function name:           init_Filt
+** Descriptions:            init canid filters
+*********************************************************************************************************/
+INT8U MCP_CAN::init_Filt(INT8U num, INT8U ext, INT32U ulData)
+{
+    INT8U res = MCP2515_OK;
+#if DEBUG_MODE
+    Serial.print("Begin to set Filter!!\r\n");
+#else
+    delay(10);
+#endif
+    res = mcp2515_setCANCTRL_Mode(MODE_CONFIG);
+    if(res > 0)
+    {
+#if DEBUG_MODE
+      Serial.print("Enter setting mode fall\r\n"); 
+#else
+      delay(10);
+#endif
+      return res;
+    }
+    
+    switch( num )
+    {
+        case 0:
+        mcp2515_write_id(MCP_RXF0SIDH, ext, ulData);
+        break;
+
+        case 1:
+        mcp2515_write_id(MCP_RXF1SIDH, ext, ulData);
+        break;
+
+        case 2:
+        mcp2515_write_id(MCP_RXF2SIDH, ext, ulData);
+        break;
+
+        case 3:
+        mcp2515_write_id(MCP_RXF3SIDH, ext, ulData);
+        break;
+
+        case 4:
+        mcp2515_write_id(MCP_RXF4SIDH, ext, ulData);
+        break;
+
+        case 5:
+        mcp2515_write_id(MCP_RXF5SIDH, ext, ulData);
+        break;
+
+        default:
+        res = MCP2515_FAIL;
+    }
+    
+    res = mcp2515_setCANCTRL_Mode(MODE_NORMAL);
+    if(res > 0)
+    {
+#if DEBUG_MODE
+      Serial.print("Enter normal mode fall\r\nSet filter fail!!\r\n"); 
+#else
+      delay(10);
+#endif
+      return res;
+    }
+#if DEBUG_MODE
+    Serial.print("set Filter success!!\r\n");
+#else
+    delay(10);
+#endif
+    
+    return res;
+}
+
+/*********************************************************************************************************
+** Function name:           setMsg
+** Descriptions:            set can message, such as dlc, id, dta[] and so on
+*********************************************************************************************************/
+INT8U MCP_CAN::setMsg(INT32U id, INT8U ext, INT8U len, INT8U rtr, INT8U *pData)
+{
+    int i = 0;
+    m_nExtFlg = ext;
+    m_nID     = id;
+    m_nDlc    = len;
+    m_nRtr    = rtr;
+    for(i = 0; i<MAX_CHAR_IN_MESSAGE; i++)
+    {
+        m_nDta[i] = *(pData+i);
+    }
+    return MCP2515_OK;
+}
+
+
+/*********************************************************************************************************
+** Function name:           setMsg
+** Descriptions:            set can message, such as dlc, id, dta[] and so on
+*********************************************************************************************************/
+INT8U MCP_CAN::setMsg(INT32U id, INT8U ext, INT8U len, INT8U *pData)
+{
+    int i = 0;
+    m_nExtFlg = ext;
+    m_nID     = id;
+    m_nDlc    = len;
+    for(i = 0; i<MAX_CHAR_IN_MESSAGE; i++)
+    {
+        m_nDta[i] = *(pData+i);
+    }
+    return MCP2515_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           clearMsg
+** Descriptions:            set all message to zero
+*********************************************************************************************************/
+INT8U MCP_CAN::clearMsg()
+{
+    m_nID       = 0;
+    m_nDlc      = 0;
+    m_nExtFlg   = 0;
+    m_nRtr      = 0;
+    m_nfilhit   = 0;
+    for(int i = 0; i<m_nDlc; i++ )
+      m_nDta[i] = 0x00;
+
+    return MCP2515_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsg
+** Descriptions:            send message
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsg()
+{
+    INT8U res, res1, txbuf_n;
+    uint16_t uiTimeOut = 0;
+    CAN_FRAME frame;
+
+    frame.id  = m_nID;
+    frame.ext = m_nExtFlg;
+    frame.rtr = m_nRtr;
+    frame.dlc = m_nDlc;
+    for(int i = 0; i<m_nDlc; i++)
+    {
+        frame.data[i] = m_nDta[i];
+    }
+
+    if ( m_nIntMode & MCP_INTMODE_TX )                                  /* the isr owns the tx buffers  */
+    {
+        return queueFrame(&frame, NULL);
+    }
+
+    do {
+        res = mcp2515_getNextFreeTXBuf(&txbuf_n);                       /* info = addr.                 */
+        uiTimeOut++;
+    } while (res == MCP_ALLTXBUSY && (uiTimeOut < TIMEOUTVALUE));
+
+    if(uiTimeOut == TIMEOUTVALUE) 
+    {   
+        return CAN_GETTXBFTIMEOUT;                                      /* get tx buff time out         */
+    }
+    uiTimeOut = 0;
+    mcp2515_write_frame( txbuf_n, &frame );
+    mcp2515_start_transmit( txbuf_n );
+    do
+    {
+        uiTimeOut++;        
+        res1= mcp2515_readRegister(txbuf_n);  			                /* read send buff ctrl reg 	*/
+        res1 = res1 & 0x08;                               		
+    }while(res1 && (uiTimeOut < TIMEOUTVALUE));   
+    if(uiTimeOut == TIMEOUTVALUE)                                       /* send msg timeout             */	
+    {
+        return CAN_SENDMSGTIMEOUT;
+    }
+    return CAN_OK;
+
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsgBuf
+** Descriptions:            send buf
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBuf(INT32U id, INT8U ext, INT8U rtr, INT8U len, INT8U *buf)
+{
+    setMsg(id, ext, len, rtr, buf);
+    return sendMsg();
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsgBuf
+** Descriptions:            send buf
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBuf(INT32U id, INT8U ext, INT8U len, INT8U *buf)
+{
+    setMsg(id, ext, len, buf);
+    return sendMsg();
+}
+
+
+/*********************************************************************************************************
+** Function name:           readMsg
+** Descriptions:            read message
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsg()
+{
+    INT8U stat, res;
+    CAN_FRAME frame;
+
+    if ( m_nIntMode & MCP_INTMODE_RX )                                  /* frames are already in ram    */
+    {
+        res = popFrame(&frame);
+    }
+    else
+    {
+        stat = mcp2515_readStatus();
+
+        if ( stat & MCP_STAT_RX0IF )                                    /* Msg in Buffer 0              */
+        {
+            mcp2515_read_frame( MCP_RXBUF_0, &frame );
+            if ( !m_nFastSpi )
+            {
+                mcp2515_modifyRegister(MCP_CANINTF, MCP_RX0IF, 0);
+            }
+            res = CAN_OK;
+        }
+        else if ( stat & MCP_STAT_RX1IF )                               /* Msg in Buffer 1              */
+        {
+            mcp2515_read_frame( MCP_RXBUF_1, &frame );
+            if ( !m_nFastSpi )
+            {
+                mcp2515_modifyRegister(MCP_CANINTF, MCP_RX1IF, 0);
+            }
+            res = CAN_OK;
+        }
+        else 
+        {
+            res = CAN_NOMSG;
+        }
+    }
+
+    if ( res == CAN_OK )
+    {
+        m_nID     = frame.id;
+        m_nExtFlg = frame.ext;
+        m_nRtr    = frame.rtr;
+        m_nDlc    = frame.dlc;
+        for(int i = 0; i<m_nDlc; i++)
+        {
+            m_nDta[i] = frame.data[i];
+        }
+    }
+    return res;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBuf
+** Descriptions:            read message buf
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBuf(INT8U *len, INT8U buf[])
+{
+    INT8U  rc;
+    
+    rc = readMsg();
+    
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       for(int i = 0; i<m_nDlc; i++) {
+         buf[i] = m_nDta[i];
+       } 
+    } else {
+       	 *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBufID
+** Descriptions:            read message buf and can bus source ID
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBufID(INT32U *ID, INT8U *len, INT8U buf[])
+{
+    INT8U rc;
+    rc = readMsg();
+
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       *ID  = m_nID;
+       for(int i = 0; i<m_nDlc && i < MAX_CHAR_IN_MESSAGE; i++) {
+          buf[i] = m_nDta[i];
+       }
+    } else {
+       *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBufCh
+** Descriptions:            read message buf return a char *
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBufCh(INT8U *len, char buf[])
+{
+    INT8U  rc;
+    
+    rc = readMsg();
+    
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       for(int i = 0; i<m_nDlc; i++) {
+         buf[i] = char(m_nDta[i]);
+       } 
+    } else {
+       	 *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           readMsgBufIDch
+** Descriptions:            read message buf and can bus source ID retrun  a char *
+*********************************************************************************************************/
+INT8U MCP_CAN::readMsgBufIDCh(INT32U *ID, INT8U *len, char buf[])
+{
+    INT8U rc;
+    rc = readMsg();
+
+    if (rc == CAN_OK) {
+       *len = m_nDlc;
+       *ID  = m_nID;
+       for(int i = 0; i<m_nDlc && i < MAX_CHAR_IN_MESSAGE; i++) {
+          buf[i] = char(m_nDta[i]);
+       }
+    } else {
+       *len = 0;
+    }
+    return rc;
+}
+
+/*********************************************************************************************************
+** Function name:           checkReceive
+** Descriptions:            check if got something
+*********************************************************************************************************/
+INT8U MCP_CAN::checkReceive(void)
+{
+    INT8U res;
+    if ( m_nIntMode & MCP_INTMODE_RX )                                  /* no spi traffic in int mode   */
+    {
+        return (m_rxHead != m_rxTail) ? CAN_MSGAVAIL : CAN_NOMSG;
+    }
+    res = mcp2515_readStatus();                                         /* RXnIF in Bit 1 and 0         */
+    if ( res & MCP_STAT_RXIF_MASK ) 
+    {
+        return CAN_MSGAVAIL;
+    }
+    else 
+    {
+        return CAN_NOMSG;
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           checkError
+** Descriptions:            if something error
+*********************************************************************************************************/
+INT8U MCP_CAN::checkError(void)
+{
+    INT8U eflg = mcp2515_readRegister(MCP_EFLG);
+
+    if ( eflg & MCP_EFLG_ERRORMASK ) 
+    {
+        return CAN_CTRLERROR;
+    }
+    else 
+    {
+        return CAN_OK;
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           getCanId
+** Descriptions:            when receive something ,u can get the can id!!
+*********************************************************************************************************/
+INT32U MCP_CAN::getCanId(void)
+{
+    return m_nID;
+} 
+
+/*********************************************************************************************************
+** Function name:           isRemoteRequest
+** Descriptions:            when receive something ,u can check if it was a request
+*********************************************************************************************************/
+INT8U MCP_CAN::isRemoteRequest(void)
+{
+    return m_nRtr;
+} 
+
+/*********************************************************************************************************
+** Function name:           isExtendedFrame
+** Descriptions:            did we just receive standard 11bit frame or extended 29bit? 0 = std, 1 = ext
+*********************************************************************************************************/
+INT8U MCP_CAN::isExtendedFrame(void)
+{
+    return m_nExtFlg;
+} 
+
+/*********************************************************************************************************
+** Function name:           attachIntPin
+** Descriptions:            serve the mcp2515 from the INT pin interrupt, mode: MCP_INTMODE_RX/TX
+*********************************************************************************************************/
+INT8U MCP_CAN::attachIntPin(INT8U intPin, INT8U mode)
+{
+    INT8U inte = 0;
+    int irq = digitalPinToInterrupt(intPin);
+    if ( irq < 0 )
+    {
+        return CAN_FAIL;
+    }
+
+    m_pIntInstance = this;
+    pinMode(intPin, INPUT);
+#ifdef SPI_HAS_TRANSACTION
+    SPI.usingInterrupt(irq);
+#endif
+
+    noInterrupts();
+    if ( (mode & MCP_INTMODE_TX) && !(m_nIntMode & MCP_INTMODE_TX) )
+    {
+                                                                        /* forget the TXnIF left by     */
+                                                                        /* the polling sendMsg          */
+        mcp2515_modifyRegister(MCP_CANINTF, MCP_TX0IF | MCP_TX1IF | MCP_TX2IF, 0);
+        m_txBusy = 0;
+    }
+    m_nIntMode |= mode;
+                                                                        /* only the flags the isr       */
+                                                                        /* clears may pull INT low      */
+    if ( m_nIntMode & MCP_INTMODE_RX )
+    {
+        inte |= MCP_RX0IF | MCP_RX1IF;
+    }
+    if ( m_nIntMode & MCP_INTMODE_TX )
+    {
+        inte |= MCP_TX0IF | MCP_TX1IF | MCP_TX2IF | MCP_MERRF;        /* MERRE: same bit as MERRF     */
+        m_txErrOff = 0;
+    }
+    mcp2515_setRegister(MCP_CANINTE, inte);
+    interrupts();
+
+    attachInterrupt(irq, isrInt, FALLING);
+
+                                                                        /* a flag already set keeps INT */
+                                                                        /* low: no edge will come,      */
+                                                                        /* serve it now                 */
+    noInterrupts();
+    serviceInterrupt();
+    interrupts();
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           enableRxInterrupt
+** Descriptions:            receive frames from the INT pin interrupt into the ring, see popFrame
+*********************************************************************************************************/
+INT8U MCP_CAN::enableRxInterrupt(INT8U intPin)
+{
+    return attachIntPin(intPin, MCP_INTMODE_RX);
+}
+
+/*********************************************************************************************************
+** Function name:           enableTxInterrupt
+** Descriptions:            send the frames of sendMsgBufAsync/sendMsgBuf from the TXnIF interrupts
+*********************************************************************************************************/
+INT8U MCP_CAN::enableTxInterrupt(INT8U intPin)
+{
+    return attachIntPin(intPin, MCP_INTMODE_TX);
+}
+
+/*********************************************************************************************************
+** Function name:           popFrame
+** Descriptions:            read the oldest received frame, CAN_NOMSG if the ring is empty
+*********************************************************************************************************/
+INT8U MCP_CAN::popFrame(CAN_FRAME *frame)
+{
+    INT8U tail = m_rxTail;
+
+    if ( tail == m_rxHead )
+    {
+        return CAN_NOMSG;
+    }
+    *frame = m_rxRing[tail];
+    m_rxTail = (tail + 1) & MCP_RX_RING_MASK;                           /* release the slot after copy  */
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           getRxOverflow
+** Descriptions:            number of frames dropped because the ring was full
+*********************************************************************************************************/
+INT16U MCP_CAN::getRxOverflow(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_rxOverflow;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           getHwOverflow
+** Descriptions:            number of RX0OVR/RX1OVR seen: frames lost before the isr could read them
+*********************************************************************************************************/
+INT16U MCP_CAN::getHwOverflow(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_hwOverflow;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           queueFrame
+** Descriptions:            add a frame to the transmit queue and start it if a tx buffer is free
+*********************************************************************************************************/
+INT8U MCP_CAN::queueFrame(const CAN_FRAME *frame, INT8U *ticket)
+{
+    INT8U head, next, t;
+    uint8_t oldSREG = SREG;
+
+    cli();
+    abortStaleTx();                                                     /* a stuck frame must not fill  */
+    SREG = oldSREG;                                                     /* the queue for ever           */
+
+    head = m_txHead;
+    next = (head + 1) & MCP_TX_QUEUE_MASK;
+    if ( next == m_txTail )
+    {
+        return CAN_FAILTX;                                              /* queue full                   */
+    }
+
+    t = m_txNextTicket++;
+    m_txQueue[head] = *frame;
+    m_txQueueTicket[head] = t;
+    m_txQueueTime[head] = millis();
+    m_txStatus[t & MCP_TX_STATUS_MASK] = CAN_TXPENDING;
+    if ( ticket != NULL )
+    {
+        *ticket = t;
+    }
+
+    oldSREG = SREG;
+    cli();
+    m_txHead = next;
+    if ( m_txBusy != (1<<MCP_N_TXBUFFERS) - 1 )                         /* no TXnIF will come to load   */
+    {                                                                   /* an idle buffer: do it here   */
+        loadTxBuffers();
+    }
+    SREG = oldSREG;
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsgBufAsync
+** Descriptions:            queue a frame and return at once, needs enableTxInterrupt
+**                          the three tx buffers are kept loaded: the mcp2515 sends the highest buffer
+**                          first, so frames queued together may reach the bus out of order
+**                          ticket: see getTxStatus
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBufAsync(INT32U id, INT8U ext, INT8U len, INT8U *buf, INT8U *ticket)
+{
+    CAN_FRAME frame;
+
+    if ( !(m_nIntMode & MCP_INTMODE_TX) )
+    {
+        return CAN_FAIL;
+    }
+    if ( len > CAN_MAX_CHAR_IN_MESSAGE )
+    {
+        len = CAN_MAX_CHAR_IN_MESSAGE;
+    }
+    frame.id  = id;
+    frame.ext = ext;
+    frame.rtr = 0;
+    frame.dlc = len;
+    for(int i = 0; i<len; i++)
+    {
+        frame.data[i] = buf[i];
+    }
+    return queueFrame(&frame, ticket);
+}
+
+/*********************************************************************************************************
+** Function name:           getTxStatus
+** Descriptions:            CAN_TXPENDING until the frame of the ticket is acknowledged, then CAN_OK,
+**                          or CAN_TXFAILED if it was not on the bus after MCP_TX_TIMEOUT_MS
+**                          only the last MCP_TX_STATUS_SIZE tickets are remembered
+*********************************************************************************************************/
+INT8U MCP_CAN::getTxStatus(INT8U ticket)
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    abortStaleTx();
+    SREG = oldSREG;
+    return m_txStatus[ticket & MCP_TX_STATUS_MASK];
+}
+
+/*********************************************************************************************************
+** Function name:           getTxPending
+** Descriptions:            number of frames queued or loaded in a tx buffer and not yet sent
+*********************************************************************************************************/
+INT8U MCP_CAN::getTxPending(void)
+{
+    INT8U n, i;
+    uint8_t oldSREG = SREG;
+    cli();
+    abortStaleTx();
+    n = (m_txHead - m_txTail) & MCP_TX_QUEUE_MASK;
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        if ( m_txBusy & (1<<i) ) {
+            n++;
+        }
+    }
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           getTxErrors
+** Descriptions:            number of MERRF interrupts with a frame in error (no acknowledge, bus error),
+**                          one per error burst: the interrupt is off until a frame goes out
+*********************************************************************************************************/
+INT16U MCP_CAN::getTxErrors(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_txErrors;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           getTxAborted
+** Descriptions:            number of frames given up after MCP_TX_TIMEOUT_MS, tickets in CAN_TXFAILED
+*********************************************************************************************************/
+INT16U MCP_CAN::getTxAborted(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_txAborted;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           setFastSpi
+** Descriptions:            1 (default): READ RX BUFFER, LOAD TX BUFFER and RTS instructions
+**                          0: generic READ, WRITE and BIT MODIFY, to compare with getSpiStats
+*********************************************************************************************************/
+void MCP_CAN::setFastSpi(INT8U on)
+{
+    m_nFastSpi = on ? 1 : 0;
+}
+
+/*********************************************************************************************************
+** Function name:           getSpiStats
+** Descriptions:            spi bytes and chip selects since resetSpiStats, all zero without
+**                          MCP_SPI_ACCOUNTING
+*********************************************************************************************************/
+void MCP_CAN::getSpiStats(CAN_SPI_STATS *stats)
+{
+#if MCP_SPI_ACCOUNTING
+    uint8_t oldSREG = SREG;
+    cli();
+    stats->bytes    = m_spiStats.bytes;
+    stats->selects  = m_spiStats.selects;
+    stats->rxFrames = m_spiStats.rxFrames;
+    stats->txFrames = m_spiStats.txFrames;
+    SREG = oldSREG;
+#else
+    stats->bytes    = 0;
+    stats->selects  = 0;
+    stats->rxFrames = 0;
+    stats->txFrames = 0;
+#endif
+}
+
+/*********************************************************************************************************
+** Function name:           resetSpiStats
+** Descriptions:            clear the spi counters
+*********************************************************************************************************/
+void MCP_CAN::resetSpiStats(void)
+{
+#if MCP_SPI_ACCOUNTING
+    uint8_t oldSREG = SREG;
+    cli();
+    m_spiStats.bytes    = 0;
+    m_spiStats.selects  = 0;
+    m_spiStats.rxFrames = 0;
+    m_spiStats.txFrames = 0;
+    SREG = oldSREG;
+#endif
+}
+
+/*********************************************************************************************************
+  END FILE
+*********************************************************************************************************/
+
+
@@ -0,0 +1,192 @@
+/*
+  mcp_can.h
+  2012 Copyright (c) Seeed Technology Inc.  All right reserved.
+
+  Author:Loovee
+  Contributor: Cory J. Fowler
+  2014-1-16
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-
+  1301  USA
+*/
+#ifndef _MCP2515_H_
+#define _MCP2515_H_
+
+#include "mcp_can_dfs.h"
+
+#define MAX_CHAR_IN_MESSAGE 8
+
+typedef struct
+{
+    INT32U  id;                                                         /* can id                       */
+    INT8U   ext;                                                        /* 1 = 29 bit id                */
+    INT8U   rtr;                                                        /* remote request               */
+    INT8U   dlc;                                                        /* data length                  */
+    INT8U   data[MAX_CHAR_IN_MESSAGE];                                  /* data                         */
+    INT32U  timestamp;                                                  /* micros() at reception        */
+} CAN_FRAME;
+
+typedef struct
+{
+    INT32U  bytes;                                                      /* spi bytes transferred        */
+    INT32U  selects;                                                    /* chip select cycles           */
+    INT32U  rxFrames;                                                   /* frames read from RXBn        */
+    INT32U  txFrames;                                                   /* frames loaded in TXBn        */
+} CAN_SPI_STATS;
+
+class MCP_CAN
+{
+    private:
+    
+    INT8U   m_nExtFlg;                                                  /* identifier xxxID             */
+                                                                        /* either extended (the 29 LSB) */
+                                                                        /* or standard (the 11 LSB)     */
+    INT32U  m_nID;                                                      /* can id                       */
+    INT8U   m_nDlc;                                                     /* data length:                 */
+    INT8U   m_nDta[MAX_CHAR_IN_MESSAGE];                            	/* data                         */
+    INT8U   m_nRtr;                                                     /* rtr                          */
+    INT8U   m_nfilhit;
+    INT8U   SPICS;
+
+    INT8U   m_nIntMode;                                                 /* MCP_INTMODE_RX/TX            */
+    CAN_FRAME m_rxRing[MCP_RX_RING_SIZE];                               /* filled by the isr            */
+    volatile INT8U  m_rxHead;                                           /* written by the isr only      */
+    volatile INT8U  m_rxTail;                                           /* written by popFrame only     */
+    volatile INT16U m_rxOverflow;                                       /* frames lost, ring full       */
+    volatile INT16U m_hwOverflow;                                       /* frames lost by the mcp2515   */
+
+    CAN_FRAME m_txQueue[MCP_TX_QUEUE_SIZE];                             /* waiting for a tx buffer      */
+    INT8U   m_txQueueTicket[MCP_TX_QUEUE_SIZE];
+    INT32U  m_txQueueTime[MCP_TX_QUEUE_SIZE];                           /* millis() when queued         */
+    volatile INT8U  m_txHead;                                           /* written by sendMsgBufAsync   */
+    volatile INT8U  m_txTail;                                           /* written by loadTxBuffers     */
+    INT8U   m_txBusy;                                                   /* bit n: TXBn loaded by us     */
+    INT8U   m_txBufTicket[MCP_N_TXBUFFERS];                             /* ticket loaded in each TXBn   */
+    INT8U   m_txNextTicket;
+    volatile INT8U  m_txStatus[MCP_TX_STATUS_SIZE];                     /* CAN_TXPENDING, OK or TXFAILED*/
+    INT32U  m_txBufStart[MCP_N_TXBUFFERS];                              /* millis() when queued, TXBn   */
+    INT8U   m_txErrOff;                                                 /* MERRF interrupt off          */
+    volatile INT16U m_txErrors;                                         /* MERRF with TXERR             */
+    volatile INT16U m_txAborted;                                        /* frames given up, timeout     */
+
+    INT8U   m_nFastSpi;                                                 /* READ RX / LOAD TX / RTS      */
+#if MCP_SPI_ACCOUNTING
+    volatile CAN_SPI_STATS m_spiStats;
+#endif
+
+    static MCP_CAN *m_pIntInstance;                                     /* instance served by the isr   */
+    static void isrInt(void);
+
+/*
+*  mcp2515 driver function 
+*/
+   // private:
+private:
+
+    void mcp2515_reset(void);                                           /* reset mcp2515                */
+
+    INT8U mcp2515_readRegister(const INT8U address);                    /* read mcp2515's register      */
+    
+    void mcp2515_readRegisterS(const INT8U address, 
+	                       INT8U values[], 
+                               const INT8U n);
+    void mcp2515_setRegister(const INT8U address,                       /* set mcp2515's register       */
+                             const INT8U value);
+
+    void mcp2515_setRegisterS(const INT8U address,                      /* set mcp2515's registers      */
+                              const INT8U values[],
+                              const INT8U n);
+    
+    void mcp2515_initCANBuffers(void);
+    
+    void mcp2515_modifyRegister(const INT8U address,                    /* set bit of one register      */
+                                const INT8U mask,
+                                const INT8U data);
+
+    INT8U mcp2515_readStatus(void);                                     /* read mcp2515's Status        */
+    INT8U mcp2515_setCANCTRL_Mode(const INT8U newmode);                 /* set mode                     */
+    INT8U mcp2515_configRate(const INT8U canSpeed);                     /* set boadrate                 */
+    INT8U mcp2515_init(const INT8U canSpeed);                           /* mcp2515init                  */
+
+    void mcp2515_write_id( const INT8U mcp_addr,                        /* write can id                 */
+                               const INT8U ext,
+                               const INT32U id );
+
+    void mcp2515_read_id( const INT8U mcp_addr,                         /* read can id                  */
+                                    INT8U* ext,
+                                    INT32U* id );
+
+    void mcp2515_start_transmit(const INT8U mcp_addr);                  /* start transmit               */
+    INT8U mcp2515_getNextFreeTXBuf(INT8U *txbuf_n);                     /* get Next free txbuf          */
+    void mcp2515_id_to_buf(const INT8U ext, const INT32U id, INT8U tbufdata[]); /* id -> SIDH..EID0 */
+    void mcp2515_buf_to_id(const INT8U tbufdata[], INT8U* ext, INT32U* id);     /* SIDH..EID0 -> id */
+    void mcp2515_read_frame(const INT8U buffer_sidh_addr, CAN_FRAME *frame); /* read can msg in a frame */
+    void mcp2515_write_frame(const INT8U buffer_sidh_addr, const CAN_FRAME *frame); /* write a frame     */
+    INT8U attachIntPin(INT8U intPin, INT8U mode);                       /* set up the INT pin isr       */
+    void serviceInterrupt(void);                                        /* isr: rx ring and tx queue    */
+    void loadTxBuffers(void);                                           /* tx queue -> free TXBn        */
+    void abortStaleTx(void);                                            /* free TXBn after timeout      */
+    void serviceTxError(void);                                          /* isr: MERRF                   */
+    INT8U queueFrame(const CAN_FRAME *frame, INT8U *ticket);            /* add a frame to the tx queue  */
+
+/*
+*  can operator function
+*/    
+
+    INT8U setMsg(INT32U id, INT8U ext, INT8U len, INT8U rtr, INT8U *pData); /* set message                  */  
+    INT8U setMsg(INT32U id, INT8U ext, INT8U len, INT8U *pData); /* set message                  */  
+    INT8U clearMsg();                                               /* clear all message to zero    */
+    INT8U readMsg();                                                /* read message                 */
+    INT8U sendMsg();                                                /* send message                 */
+
+public:
+    MCP_CAN(INT8U _CS);
+    INT8U begin(INT8U speedset);                                    /* init can                     */
+    INT8U init_Mask(INT8U num, INT8U ext, INT32U ulData);           /* init Masks                   */
+    INT8U init_Filt(INT8U num, INT8U ext, INT32U ulData);           /* init filters                 */
+    INT8U sendMsgBuf(INT32U id, INT8U ext, INT8U rtr, INT8U len, INT8U *buf);   /* send buf                     */
+    INT8U sendMsgBuf(INT32U id, INT8U ext, INT8U len, INT8U *buf);   /* send buf                     */
+    INT8U readMsgBuf(INT8U *len, INT8U *buf);                       /* read buf                     */
+    INT8U readMsgBufID(INT32U *ID, INT8U *len, INT8U *buf);         /* read buf with object ID      */
+    INT8U readMsgBufCh(INT8U *len, char *buf);                       /* read buf                     */
+    INT8U readMsgBufIDCh(INT32U *ID, INT8U *len, char *buf);         /* read buf with object ID      */
+    INT8U checkReceive(void);                                       /* if something received        */
+    INT8U checkError(void);                                         /* if something error           */
+    INT32U getCanId(void);                                          /* get can id when receive      */
+    INT8U isRemoteRequest(void);                                    /* get RR flag when receive     */
+    INT8U isExtendedFrame(void);                                    /* did we recieve 29bit frame?  */
+
+    INT8U enableRxInterrupt(INT8U intPin);                          /* rx by INT pin into the ring  */
+    INT8U popFrame(CAN_FRAME *frame);                               /* read a frame from the ring   */
+    INT16U getRxOverflow(void);                                     /* frames lost, ring full       */
+    INT16U getHwOverflow(void);                                     /* frames lost by the mcp2515   */
+
+    INT8U enableTxInterrupt(INT8U intPin);                          /* tx completion by INT pin     */
+    INT8U sendMsgBufAsync(INT32U id, INT8U ext, INT8U len, INT8U *buf, INT8U *ticket = NULL); /* queue a frame */
+    INT8U getTxStatus(INT8U ticket);                                /* CAN_TXPENDING, OK, TXFAILED  */
+    INT8U getTxPending(void);                                       /* frames not yet on the bus    */
+    INT16U getTxErrors(void);                                       /* transmit error bursts        */
+    INT16U getTxAborted(void);                                      /* frames given up, timeout     */
+
+    void setFastSpi(INT8U on);                                      /* 0: READ/WRITE/BITMOD only    */
+    void getSpiStats(CAN_SPI_STATS *stats);                         /* needs MCP_SPI_ACCOUNTING     */
+    void resetSpiStats(void);
+};
+
+#endif
+/*********************************************************************************************************
+  END FILE
+*********************************************************************************************************/
+
+
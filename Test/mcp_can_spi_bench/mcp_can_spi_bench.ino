@@ -0,0 +1,101 @@
+//mesure du cout SPI d'une trame CAN avec et sans les instructions rapides du MCP2515
+//(READ RX BUFFER, LOAD TX BUFFER, RTS) : octets SPI et cycles de chip select par trame
+//mcp_can_dfs.h de ce dossier est compile avec MCP_SPI_ACCOUNTING a 1
+//il faut un autre noeud sur le bus pour acquitter les trames et en envoyer (ex: UM6_CAN_ex)
+//le resultat est affiche sur Serial1
+
+#include "mcp_can.h"
+#include <SPI.h>
+
+#define NB_TRAME 100
+#define DUREE_RECEPTION 1000 //ms
+
+const int SPI_CS_PIN = 9;
+
+MCP_CAN CAN(SPI_CS_PIN);
+
+void print_result(const char* name, CAN_SPI_STATS &stats, unsigned long nbTrame, unsigned long t)
+{
+  Serial1.print(name);
+  Serial1.print(": ");
+  Serial1.print(nbTrame);
+  Serial1.print(" trames, ");
+  if (nbTrame == 0)
+  {
+    Serial1.println("rien a mesurer");
+    return;
+  }
+  Serial1.print((float) stats.bytes / nbTrame);
+  Serial1.print(" octets/trame, ");
+  Serial1.print((float) stats.selects / nbTrame);
+  Serial1.print(" CS/trame, ");
+  Serial1.print(t / nbTrame);
+  Serial1.println("us/trame");
+}
+
+void bench(const char* name, unsigned char fast)
+{
+  CAN_SPI_STATS stats;
+  unsigned char buff[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+  unsigned char len;
+  unsigned long t, debut;
+  int i;
+
+  CAN.setFastSpi(fast);
+  Serial1.println(name);
+
+  //emission, sendMsgBuf attend la fin de l'emission comme avant
+  CAN.resetSpiStats();
+  t = micros();
+  for(i = 0; i < NB_TRAME; i++)
+  {
+    CAN.sendMsgBuf(0x7F0, 0, 8, buff);
+  }
+  t = micros() - t;
+  CAN.getSpiStats(&stats);
+  print_result("  emission", stats, stats.txFrames, t);
+
+  //reception de ce que les autres noeuds envoient pendant DUREE_RECEPTION
+  //on ne compte que readMsgBuf, pas les READ STATUS de checkReceive
+  CAN_SPI_STATS avant, apres;
+  stats.bytes = stats.selects = stats.rxFrames = 0;
+  t = 0;
+  debut = millis();
+  while (millis() - debut < DUREE_RECEPTION)
+  {
+    if (CAN_MSGAVAIL == CAN.checkReceive())
+    {
+      CAN.getSpiStats(&avant);
+      unsigned long t0 = micros();
+      CAN.readMsgBuf(&len, buff);
+      t += micros() - t0;
+      CAN.getSpiStats(&apres);
+      stats.bytes += apres.bytes - avant.bytes;
+      stats.selects += apres.selects - avant.selects;
+      stats.rxFrames += apres.rxFrames - avant.rxFrames;
+    }
+  }
+  print_result("  reception", stats, stats.rxFrames, t);
+}
+
+void setup()
+{
+  Serial1.begin(115200);
+  while (!Serial1) {
+    ; // wait for Serial1 port to connect. Needed for Leonardo only
+  }
+START_INIT:
+  if(CAN_OK != CAN.begin(CAN_500KBPS))
+  {
+    delay(100);
+    goto START_INIT;
+  }
+}
+
+void loop()
+{
+  bench("READ/WRITE/BIT MODIFY", 0);
+  bench("READ RX/LOAD TX/RTS", 1);
+  Serial1.println("");
+  delay(2000);
+}
@@ -124,9 +124,9 @@ void ParseCan::set_byte_GYRO(int x, int y, int z)
 	int_gyro[0] = x;
 	intToUChar(byte_gyro,0,x);
 	int_gyro[1] = y;
-	intToUChar(byte_gyro,1,y);
+	intToUChar(byte_gyro,2,y);
 	int_gyro[2] = z;
-	intToUChar(byte_gyro,2,z);
+	intToUChar(byte_gyro,4,z);
 }
 
 //l'entier peux ne pas correspondre a une touche la conversion sera faite par la carte gérant la connection seatalk
@@ -71,7 +71,7 @@ GPS_PARSER::GPS_PARSER(boolean init)
 					}
 					else
 					{
-						if(fieldPos < 9)
+						if(fieldPos < 10)
 						{
 							gprmc->latMn[fieldPos-2]= buffer[sentencePos];
 						}
@@ -90,7 +90,7 @@ GPS_PARSER::GPS_PARSER(boolean init)
 					}
 					else
 					{
-						if(fieldPos < 10)
+						if(fieldPos < 11)
 						{
 							gprmc->longMn[fieldPos-3]= buffer[sentencePos];
 						}
@@ -225,6 +225,12 @@ GPS_PARSER::GPS_PARSER(boolean init)
 						gpgga->longInd = buffer[sentencePos];
 					}
 				break;
+				case 6: //qualification du fix
+					if(fieldPos < 1)
+					{
+						gpgga->valide = buffer[sentencePos];
+					}
+				break;
 				case 7: //Nombre de satellites
 					if(fieldPos < 2)
 					{
@@ -312,21 +318,110 @@ GPS_PARSER::GPS_PARSER(boolean init)
 		return (strcmp(temp,"$GPGGA")==0);
 	}
 
-void GPS_PARSER::convertGprmcFrame(GPRMC_frame *frame, GPRMC_data *data)
+//convertie la position directement a partir des chiffres de la trame nmea, sans atof
+//les minutes sont lues en 1e-5 minute (5 decimales max) puis convertie en 1e-7 degree:
+//1e-5 mn * 100 / 60 = 1e-7 degree, on arrondi au plus proche
+long GPS_PARSER::convertPositionE7(const char deg[], const char mn[], char ind)
+{
+	long degree = 0;
+	long minute = 0; //en 1e-5 minute
+	unsigned char nbDecimal = 0;
+	bool decimal = false;
+	unsigned char i;
+	
+	for(i = 0; deg[i] >= '0' && deg[i] <= '9'; i++)
+	{
+		degree = degree * 10 + (deg[i] - '0');
+	}
+	for(i = 0; mn[i] != '\0' && nbDecimal < 5; i++)
+	{
+		if(mn[i] == '.')
+		{
+			decimal = true;
+		}
+		else if(mn[i] >= '0' && mn[i] <= '9')
+		{
+			minute = minute * 10 + (mn[i] - '0');
+			if(decimal)
+			{
+				nbDecimal++;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+	for(; nbDecimal < 5; nbDecimal++)
+	{
+		minute = minute * 10;
+	}
+	
+	degree = degree * 10000000L + (minute * 10 + 3) / 6;
+	return ((ind == 'S' || ind == 'W') ? -degree : degree);
+}
+
+//nombre decimal de la trame en virgule fixe, sans atof: "0.636" avec 2 decimales -> 64
+//le premier chiffre ignore sert a l'arrondi
+long GPS_PARSER::convertFixedPoint(const char txt[], unsigned char decimals)
+{
+	long val = 0;
+	unsigned char nbDecimal = 0;
+	bool decimal = false;
+	bool negative = false;
+	bool roundUp = false;
+	unsigned char i;
+	
+	for(i = 0; txt[i] != '\0'; i++)
+	{
+		if(txt[i] == '-' && i == 0)
+		{
+			negative = true;
+		}
+		else if(txt[i] == '.' && !decimal)
+		{
+			decimal = true;
+		}
+		else if(txt[i] >= '0' && txt[i] <= '9')
+		{
+			if(!decimal || nbDecimal < decimals)
+			{
+				val = val * 10 + (txt[i] - '0');
+				if(decimal)
+				{
+					nbDecimal++;
+				}
+			}
+			else
+			{
+				roundUp = (txt[i] >= '5');
+				break;
+			}
+		}
+		else
+		{
+			break;
+		}
+	}
+	for(; nbDecimal < decimals; nbDecimal++)
+	{
+		val = val * 10;
+	}
+	if(roundUp)
+	{
+		val++;
+	}
+	return (negative ? -val : val);
+}
+
+void GPS_PARSER::convertGprmcFrameInt(GPRMC_frame *frame, GPRMC_data *data)
 {
-	float degree;
-	float minute;
 	//si les donnees ne sont pas valide on quite la fonction, les valeur par defaut de data étant a 0
 	if(! (data->valide = (frame->valide == 'A')))
 		return;
 	
-	degree = atof (frame->latDeg);
-	minute = atof (frame->latMn);
-	data->latitude = (frame->latInd == 'N' ? degree + minute/60.0 : 0 - (degree + minute/60));
-	
-	degree = atof (frame->longDeg);
-	minute = atof (frame->longMn);
-	data->longitude = (frame->longInd == 'E' ? degree + minute/60.0 : 0 - (degree + minute/60)); 
+	data->latitudeE7 = convertPositionE7(frame->latDeg, frame->latMn, frame->latInd);
+	data->longitudeE7 = convertPositionE7(frame->longDeg, frame->longMn, frame->longInd);
 	//date
 	data->day = ((frame->day[0] - '0') * 10)+(frame->day[1] - '0');
 	data->month = ((frame->month[0] - '0') * 10)+(frame->month[1] - '0');
@@ -336,8 +431,526 @@ void GPS_PARSER::convertGprmcFrame(GPRMC_frame *frame, GPRMC_data *data)
 	data->hour = ((frame->hour[0] - '0')* 10)+(frame->hour[1] - '0');
 	data->minute = ((frame->minute[0] - '0')* 10)+(frame->minute[1] - '0');
 	data->second = ((frame->second[0] - '0')* 10)+(frame->second[1] - '0');
-  //vittesse en noeud
-	data->speed = atof(frame->speed);
+  //vittesse en 1/100 noeud
+	data->speedCentiKnot = convertFixedPoint(frame->speed, 2);
+	
+	return;
+}
+
+void GPS_PARSER::convertGprmcFrame(GPRMC_frame *frame, GPRMC_data *data)
+{
+	convertGprmcFrameInt(frame, data);
+	if(!data->valide)
+		return;
+	
+	data->latitude = data->latitudeE7 / 10000000.0;
+	data->longitude = data->longitudeE7 / 10000000.0;
+  //vittesse en noeud, deja convertie au 1/100 par convertGprmcFrameInt
+	data->speed = data->speedCentiKnot / 100.0;
+	
+	return;
+}
+
+void GPS_PARSER::convertGpggaFrame(GPGGA_frame *frame, GPGGA_data *data)
+{
+	data->fix = (frame->valide >= '0' && frame->valide <= '9') ? frame->valide - '0' : 0;
+	if(data->fix == 0)
+		return;
+	
+	data->latitudeE7 = convertPositionE7(frame->latDeg, frame->latMn, frame->latInd);
+	data->longitudeE7 = convertPositionE7(frame->longDeg, frame->longMn, frame->longInd);
+	
+	data->hour = ((frame->hour[0] - '0')* 10)+(frame->hour[1] - '0');
+	data->minute = ((frame->minute[0] - '0')* 10)+(frame->minute[1] - '0');
+	data->second = ((frame->second[0] - '0')* 10)+(frame->second[1] - '0');
+	
+	data->nbSat = convertFixedPoint(frame->nbSat, 0);
+	data->accuracy = convertFixedPoint(frame->accuracy, 1);
+	data->altitude = convertFixedPoint(frame->altitude, 1);
 	
 	return;
 }
+
+//etats de NMEA_STREAM
+#define NMEA_ST_WAIT 0     //attente du '$'
+#define NMEA_ST_HEAD 1     //identifiant, jusqu'a la premiere virgule
+#define NMEA_ST_FIELD 2    //champs d'une phrase reconnue
+#define NMEA_ST_SKIP 3     //phrase ignoree, on attend le '$' suivant
+#define NMEA_ST_CKS_HI 4   //premier chiffre du checksum
+#define NMEA_ST_CKS_LO 5   //second chiffre du checksum
+
+#define NMEA_TYPE(c, d, e) NMEA_ID(0, 0, c, d, e)
+
+//description des phrases, une ligne par champ utilise, dans l'ordre des champs
+static const NmeaField fieldsRMC[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_HMS, 0, GPRMC_data, hour),
+	NMEA_FIELD(2, NMEA_K_BOOL, 'A', GPRMC_data, valide),
+	NMEA_FIELD(3, NMEA_K_LAT, 0, GPRMC_data, latitudeE7),
+	NMEA_FIELD(4, NMEA_K_SIGN, 'S', GPRMC_data, latitudeE7),
+	NMEA_FIELD(5, NMEA_K_LON, 0, GPRMC_data, longitudeE7),
+	NMEA_FIELD(6, NMEA_K_SIGN, 'W', GPRMC_data, longitudeE7),
+	NMEA_FIELD(7, NMEA_K_FIX, 2, GPRMC_data, speedCentiKnot),
+	NMEA_FIELD(8, NMEA_K_FIX, 1, GPRMC_data, course),
+	NMEA_FIELD(9, NMEA_K_DMY, 0, GPRMC_data, day)
+};
+
+static const NmeaField fieldsGGA[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_HMS, 0, GPGGA_data, hour),
+	NMEA_FIELD(2, NMEA_K_LAT, 0, GPGGA_data, latitudeE7),
+	NMEA_FIELD(3, NMEA_K_SIGN, 'S', GPGGA_data, latitudeE7),
+	NMEA_FIELD(4, NMEA_K_LON, 0, GPGGA_data, longitudeE7),
+	NMEA_FIELD(5, NMEA_K_SIGN, 'W', GPGGA_data, longitudeE7),
+	NMEA_FIELD(6, NMEA_K_FIX, 0, GPGGA_data, fix),
+	NMEA_FIELD(7, NMEA_K_FIX, 0, GPGGA_data, nbSat),
+	NMEA_FIELD(8, NMEA_K_FIX, 1, GPGGA_data, accuracy),
+	NMEA_FIELD(9, NMEA_K_FIX, 1, GPGGA_data, altitude)
+};
+
+static const NmeaField fieldsVTG[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_FIX, 1, VTG_data, courseTrue),
+	NMEA_FIELD(3, NMEA_K_FIX, 1, VTG_data, courseMag),
+	NMEA_FIELD(5, NMEA_K_FIX, 2, VTG_data, speedCentiKnot),
+	NMEA_FIELD(7, NMEA_K_FIX, 1, VTG_data, speedKmh)
+};
+
+static const NmeaField fieldsGSA[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_CHAR, 0, GSA_data, mode),
+	NMEA_FIELD(2, NMEA_K_FIX, 0, GSA_data, fixType),
+	NMEA_FIELD(3, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(4, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(5, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(6, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(7, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(8, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(9, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(10, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(11, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(12, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(13, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(14, NMEA_K_COUNT, 0, GSA_data, nbSat),
+	NMEA_FIELD(15, NMEA_K_FIX, 1, GSA_data, pdop),
+	NMEA_FIELD(16, NMEA_K_FIX, 1, GSA_data, hdop),
+	NMEA_FIELD(17, NMEA_K_FIX, 1, GSA_data, vdop)
+};
+
+#define NMEA_GSV_SAT(n) \
+	NMEA_FIELD(4 + 4 * n, NMEA_K_FIX, 0, GSV_data, sat[n].prn), \
+	NMEA_FIELD(5 + 4 * n, NMEA_K_FIX, 0, GSV_data, sat[n].elevation), \
+	NMEA_FIELD(6 + 4 * n, NMEA_K_FIX, 0, GSV_data, sat[n].azimuth), \
+	NMEA_FIELD(7 + 4 * n, NMEA_K_FIX, 0, GSV_data, sat[n].snr)
+
+static const NmeaField fieldsGSV[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_FIX, 0, GSV_data, nbMsg),
+	NMEA_FIELD(2, NMEA_K_FIX, 0, GSV_data, msgNb),
+	NMEA_FIELD(3, NMEA_K_FIX, 0, GSV_data, nbSatView),
+	NMEA_GSV_SAT(0),
+	NMEA_GSV_SAT(1),
+	NMEA_GSV_SAT(2),
+	NMEA_GSV_SAT(3)
+};
+
+static const NmeaField fieldsHDG[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_FIX, 1, HDG_data, heading),
+	NMEA_FIELD(2, NMEA_K_FIX, 1, HDG_data, deviation),
+	NMEA_FIELD(3, NMEA_K_SIGN, 'W', HDG_data, deviation),
+	NMEA_FIELD(4, NMEA_K_FIX, 1, HDG_data, variation),
+	NMEA_FIELD(5, NMEA_K_SIGN, 'W', HDG_data, variation)
+};
+
+static const NmeaField fieldsMWV[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_FIX, 1, MWV_data, angle),
+	NMEA_FIELD(2, NMEA_K_CHAR, 0, MWV_data, reference),
+	NMEA_FIELD(3, NMEA_K_FIX, 1, MWV_data, speed),
+	NMEA_FIELD(4, NMEA_K_CHAR, 0, MWV_data, unit),
+	NMEA_FIELD(5, NMEA_K_BOOL, 'A', MWV_data, valide)
+};
+
+static const NmeaField fieldsDPT[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_FIX, 2, DPT_data, depth),
+	NMEA_FIELD(2, NMEA_K_FIX, 2, DPT_data, offset),
+	NMEA_FIELD(3, NMEA_K_FIX, 0, DPT_data, range)
+};
+
+static const NmeaField fieldsZDA[] PROGMEM = {
+	NMEA_FIELD(1, NMEA_K_HMS, 0, ZDA_data, hour),
+	NMEA_FIELD(2, NMEA_K_FIX, 0, ZDA_data, day),
+	NMEA_FIELD(3, NMEA_K_FIX, 0, ZDA_data, month),
+	NMEA_FIELD(4, NMEA_K_FIX, 0, ZDA_data, year),
+	NMEA_FIELD(5, NMEA_K_FIX, 0, ZDA_data, zoneHour),
+	NMEA_FIELD(6, NMEA_K_FIX, 0, ZDA_data, zoneMinute)
+};
+
+#define NMEA_SENTENCE(c, d, e, fields, type) \
+	{ NMEA_TYPE(c, d, e), fields, sizeof(fields) / sizeof(NmeaField), sizeof(type) }
+
+//meme ordre que NMEA_GPRMC, NMEA_GPGGA...
+static const NmeaSentence sentences[NMEA_NB_SENTENCE] PROGMEM = {
+	NMEA_SENTENCE('R', 'M', 'C', fieldsRMC, GPRMC_data),
+	NMEA_SENTENCE('G', 'G', 'A', fieldsGGA, GPGGA_data),
+	NMEA_SENTENCE('V', 'T', 'G', fieldsVTG, VTG_data),
+	NMEA_SENTENCE('G', 'S', 'A', fieldsGSA, GSA_data),
+	NMEA_SENTENCE('G', 'S', 'V', fieldsGSV, GSV_data),
+	NMEA_SENTENCE('H', 'D', 'G', fieldsHDG, HDG_data),
+	NMEA_SENTENCE('M', 'W', 'V', fieldsMWV, MWV_data),
+	NMEA_SENTENCE('D', 'P', 'T', fieldsDPT, DPT_data),
+	NMEA_SENTENCE('Z', 'D', 'A', fieldsZDA, ZDA_data)
+};
+
+static unsigned char hexValue(char c)
+{
+	if(c >= '0' && c <= '9')
+		return c - '0';
+	if(c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if(c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return 0xFF;
+}
+
+//ecrit un entier dans la destination d'un champ, selon sa taille (long fait 8 octets sur PC)
+static void storeInt(unsigned char *p, unsigned char size, long val)
+{
+	switch(size)
+	{
+		case 1: { int8_t v = val; memcpy(p, &v, 1); } break;
+		case 2: { int16_t v = val; memcpy(p, &v, 2); } break;
+		case 4: { int32_t v = val; memcpy(p, &v, 4); } break;
+		default: memcpy(p, &val, sizeof(long)); break;
+	}
+}
+
+static long loadInt(const unsigned char *p, unsigned char size)
+{
+	switch(size)
+	{
+		case 1: { int8_t v; memcpy(&v, p, 1); return v; }
+		case 2: { int16_t v; memcpy(&v, p, 2); return v; }
+		case 4: { int32_t v; memcpy(&v, p, 4); return v; }
+		default: { long v; memcpy(&v, p, sizeof(long)); return v; }
+	}
+}
+
+NMEA_STREAM::NMEA_STREAM()
+{
+	unsigned char i;
+	checksumErrors = 0;
+	state = NMEA_ST_WAIT;
+	sentence = NMEA_NONE;
+	id = 0;
+	for(i = 0; i < NMEA_NB_SENTENCE; i++)
+	{
+		dest[i] = NULL;
+	}
+}
+
+void NMEA_STREAM::detach(unsigned char s)
+{
+	if(s >= 1 && s <= NMEA_NB_SENTENCE)
+	{
+		dest[s - 1] = NULL;
+		if(sentence == s)
+		{
+			state = NMEA_ST_WAIT;
+		}
+	}
+}
+
+unsigned char NMEA_STREAM::feed(char c)
+{
+	unsigned char hex;
+	GPRMC_data *rmc;
+	
+	//un '$' recommence toujours une phrase, meme si la precedente est coupee
+	if(c == '$')
+	{
+		if(state == NMEA_ST_FIELD || state == NMEA_ST_CKS_HI || state == NMEA_ST_CKS_LO)
+			checksumErrors++;
+		startSentence();
+		return NMEA_NONE;
+	}
+	
+	switch(state)
+	{
+		case NMEA_ST_HEAD:
+			if(c == ',')
+			{
+				checksum ^= c;
+				if(fieldPos != 5 || !findSentence())
+				{
+					state = NMEA_ST_SKIP;
+					break;
+				}
+				state = NMEA_ST_FIELD;
+				fieldEnd(); //remise a zero du champ numerique
+				field = 1;
+				nextDesc();
+			}
+			else if(c == '\r' || c == '\n' || c == '*')
+			{
+				state = NMEA_ST_WAIT;
+			}
+			else
+			{
+				checksum ^= c;
+				id = (id << 6) | (c & 0x3F);
+				fieldPos++;
+			}
+		break;
+		case NMEA_ST_FIELD:
+			if(c == '*')
+			{
+				fieldEnd();
+				state = NMEA_ST_CKS_HI;
+			}
+			else if(c == ',')
+			{
+				checksum ^= c;
+				fieldEnd();
+				field++;
+				nextDesc();
+			}
+			else if(c == '\r' || c == '\n')
+			{
+				checksumErrors++; //phrase sans checksum
+				state = NMEA_ST_WAIT;
+			}
+			else
+			{
+				checksum ^= c;
+				fieldChar(c);
+				fieldPos++;
+			}
+		break;
+		case NMEA_ST_CKS_HI:
+			hex = hexValue(c);
+			if(hex > 0x0F)
+			{
+				checksumErrors++;
+				state = NMEA_ST_WAIT;
+				break;
+			}
+			checksumRx = hex << 4;
+			state = NMEA_ST_CKS_LO;
+		break;
+		case NMEA_ST_CKS_LO:
+			state = NMEA_ST_WAIT;
+			hex = hexValue(c);
+			if(hex > 0x0F || (checksumRx | hex) != checksum)
+			{
+				checksumErrors++;
+				break;
+			}
+			//comme convertGprmcFrame: tout a 0 si le fix n'est pas valide, et les anciens champs en float
+			if(sentence == NMEA_GPRMC)
+			{
+				rmc = (GPRMC_data *) data;
+				if(!rmc->valide)
+				{
+					*rmc = GPRMC_data();
+				}
+				rmc->latitude = rmc->latitudeE7 / 10000000.0;
+				rmc->longitude = rmc->longitudeE7 / 10000000.0;
+				rmc->speed = rmc->speedCentiKnot / 100.0;
+			}
+			return sentence;
+		default:
+		break;
+	}
+	return NMEA_NONE;
+}
+
+void NMEA_STREAM::startSentence(void)
+{
+	state = NMEA_ST_HEAD;
+	sentence = NMEA_NONE;
+	checksum = 0;
+	id = 0;
+	field = 0;
+	fieldPos = 0;
+	desc.kind = 0;
+}
+
+//cherche l'identifiant dans la table, seulement parmi les phrases attachees
+bool NMEA_STREAM::findSentence(void)
+{
+	unsigned char i;
+	NmeaSentence desc;
+	
+	for(i = 0; i < NMEA_NB_SENTENCE; i++)
+	{
+		if(dest[i] == NULL)
+			continue;
+		memcpy_P(&desc, &sentences[i], sizeof(NmeaSentence));
+		if((id & ~NMEA_TALKER_MASK) != desc.id)
+			continue;
+		sentence = i + 1;
+		data = (unsigned char *) dest[i];
+		memset(data, 0, desc.size);
+		nextField = desc.fields;
+		nbFieldLeft = desc.nbFields;
+		return true;
+	}
+	return false;
+}
+
+//copie la description du champ en cours, ou rien si la table ne l'utilise pas
+void NMEA_STREAM::nextDesc(void)
+{
+	desc.kind = 0;
+	if(nbFieldLeft > 0 && pgm_read_byte(&nextField->index) == field)
+	{
+		memcpy_P(&desc, nextField, sizeof(NmeaField));
+		nextField++;
+		nbFieldLeft--;
+	}
+}
+
+//un caractere du champ en cours, converti directement dans la structure attachee
+void NMEA_STREAM::fieldChar(char c)
+{
+	unsigned char size = desc.kind & 0x0F;
+	
+	switch(desc.kind & 0xF0)
+	{
+		case NMEA_K_HMS:
+		case NMEA_K_DMY:
+			//deux chiffres par valeur, le premier a une position paire dans le champ
+			if(fieldPos < 6 && c >= '0' && c <= '9')
+			{
+				if(fieldPos & 1)
+					data[desc.offset + (fieldPos >> 1)] += c - '0';
+				else
+					data[desc.offset + (fieldPos >> 1)] = (c - '0') * 10;
+			}
+		break;
+		case NMEA_K_LAT:
+			position(c, 2);
+		break;
+		case NMEA_K_LON:
+			position(c, 3);
+		break;
+		case NMEA_K_CHAR:
+			if(fieldPos == 0)
+				data[desc.offset] = c;
+		break;
+		case NMEA_K_BOOL:
+			if(fieldPos == 0)
+				data[desc.offset] = (c == (char) desc.param);
+		break;
+		case NMEA_K_FIX:
+			number(c, desc.param);
+		break;
+		case NMEA_K_SIGN:
+			if(fieldPos == 0 && c == (char) desc.param)
+				storeInt(data + desc.offset, size, -loadInt(data + desc.offset, size));
+		break;
+		default:break;
+	}
+}
+
+//fin du champ: on range la valeur numerique et on prepare le champ suivant
+void NMEA_STREAM::fieldEnd(void)
+{
+	unsigned char size = desc.kind & 0x0F;
+	
+	switch(desc.kind & 0xF0)
+	{
+		case NMEA_K_LAT:
+		case NMEA_K_LON:
+			storeInt(data + desc.offset, size, positionE7());
+		break;
+		case NMEA_K_FIX:
+			if(fieldPos > 0)
+				storeInt(data + desc.offset, size, fixedPoint(desc.param));
+		break;
+		case NMEA_K_COUNT:
+			if(fieldPos > 0)
+				data[desc.offset]++;
+		break;
+		default:break;
+	}
+	desc.kind = 0;
+	fieldPos = 0;
+	value = 0;
+	degree = 0;
+	nbDecimal = 0;
+	decimal = false;
+	negative = false;
+	roundUp = false;
+}
+
+//degree sur degDigits chiffres puis minutes en 1e-5 minute, comme convertPositionE7
+void NMEA_STREAM::position(char c, unsigned char degDigits)
+{
+	if(c == '.')
+	{
+		decimal = true;
+	}
+	else if(c >= '0' && c <= '9')
+	{
+		if(fieldPos < degDigits)
+		{
+			degree = degree * 10 + (c - '0');
+		}
+		else if(nbDecimal < 5)
+		{
+			value = value * 10 + (c - '0');
+			if(decimal)
+			{
+				nbDecimal++;
+			}
+		}
+	}
+}
+
+//nombre a virgule fixe arrondi a decimals chiffres, comme convertFixedPoint
+void NMEA_STREAM::number(char c, unsigned char decimals)
+{
+	if(c == '-')
+	{
+		negative = true;
+	}
+	else if(c == '.')
+	{
+		decimal = true;
+	}
+	else if(c >= '0' && c <= '9' && value < 100000000L)
+	{
+		if(!decimal)
+		{
+			value = value * 10 + (c - '0');
+		}
+		else if(nbDecimal < decimals)
+		{
+			value = value * 10 + (c - '0');
+			nbDecimal++;
+		}
+		else if(nbDecimal == decimals)
+		{
+			roundUp = (c >= '5'); //seul le premier chiffre ignore compte
+			nbDecimal++;
+		}
+	}
+}
+
+long NMEA_STREAM::positionE7(void)
+{
+	for(; nbDecimal < 5; nbDecimal++)
+	{
+		value = value * 10;
+	}
+	return degree * 10000000L + (value * 10 + 3) / 6;
+}
+
+long NMEA_STREAM::fixedPoint(unsigned char decimals)
+{
+	for(; nbDecimal < decimals; nbDecimal++)
+	{
+		value = value * 10;
+	}
+	if(roundUp)
+	{
+		value++;
+	}
+	return negative ? -value : value;
+}
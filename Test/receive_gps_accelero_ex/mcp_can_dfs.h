@@ -36,6 +36,10 @@
 #define INT8U byte
 #endif
 
+#ifndef INT16U
+#define INT16U uint16_t
+#endif
+
 // if print debug information
 #define DEBUG_MODE 0
 
@@ -73,10 +77,15 @@
 #define MCP_TXB_RTR_M       0x40                                        /* In TXBnDLC                   */
 #define MCP_RXB_IDE_M       0x08                                        /* In RXBnSIDL                  */
 #define MCP_RXB_RTR_M       0x40                                        /* In RXBnDLC                   */
+#define MCP_RXB_SRR_M       0x10                                        /* In RXBnSIDL, std remote req  */
 
 #define MCP_STAT_RXIF_MASK   (0x03)
 #define MCP_STAT_RX0IF (1<<0)
 #define MCP_STAT_RX1IF (1<<1)
+#define MCP_STAT_TX0IF (1<<3)
+#define MCP_STAT_TX1IF (1<<5)
+#define MCP_STAT_TX2IF (1<<7)
+#define MCP_STAT_TXIF_MASK   (MCP_STAT_TX0IF | MCP_STAT_TX1IF | MCP_STAT_TX2IF)
 
 #define MCP_EFLG_RX1OVR (1<<7)
 #define MCP_EFLG_RX0OVR (1<<6)
@@ -327,8 +336,61 @@
 #define MCP_RXBUF_1 (MCP_RXB1SIDH)
 
 //#define SPICS 10
-#define MCP2515_SELECT()   digitalWrite(SPICS, LOW)
+/*
+ *   set to 1 to count spi bytes, chip selects and frames, see getSpiStats
+ */
+#ifndef MCP_SPI_ACCOUNTING
+#define MCP_SPI_ACCOUNTING 0
+#endif
+#if MCP_SPI_ACCOUNTING
+#define MCP_SPI_COUNT_SELECT() (m_spiStats.selects++)
+#define MCP_SPI_COUNT_BYTE()   (m_spiStats.bytes++)
+#define MCP_SPI_COUNT_FRAME(n) (m_spiStats.n++)
+#else
+#define MCP_SPI_COUNT_SELECT()
+#define MCP_SPI_COUNT_BYTE()
+#define MCP_SPI_COUNT_FRAME(n)
+#endif
+
+#ifdef SPI_HAS_TRANSACTION
+/*
+ *   SPI transactions mask the INT pin interrupt registered with
+ *   SPI.usingInterrupt(), so the RX interrupt can not break a transfer
+ *   started from loop()
+ */
+#define MCP2515_SPI_SETTINGS SPISettings(4000000, MSBFIRST, SPI_MODE0)
+#define MCP2515_SELECT()   do { MCP_SPI_COUNT_SELECT(); SPI.beginTransaction(MCP2515_SPI_SETTINGS); digitalWrite(SPICS, LOW); } while (0)
+#define MCP2515_UNSELECT() do { digitalWrite(SPICS, HIGH); SPI.endTransaction(); } while (0)
+#else
+#define MCP2515_SELECT()   do { MCP_SPI_COUNT_SELECT(); digitalWrite(SPICS, LOW); } while (0)
 #define MCP2515_UNSELECT() digitalWrite(SPICS, HIGH)
+#endif
+
+/*
+ *   software receive ring filled by the INT pin interrupt
+ *   size must be a power of two
+ */
+#ifndef MCP_RX_RING_SIZE
+#define MCP_RX_RING_SIZE   (8)
+#endif
+#define MCP_RX_RING_MASK   (MCP_RX_RING_SIZE - 1)
+
+/*
+ *   software transmit queue emptied by the TXnIF interrupts
+ *   sizes must be powers of two
+ */
+#ifndef MCP_TX_QUEUE_SIZE
+#define MCP_TX_QUEUE_SIZE  (8)
+#endif
+#define MCP_TX_QUEUE_MASK  (MCP_TX_QUEUE_SIZE - 1)
+#define MCP_TX_STATUS_SIZE (16)                                         /* tickets remembered           */
+#define MCP_TX_STATUS_MASK (MCP_TX_STATUS_SIZE - 1)
+#ifndef MCP_TX_TIMEOUT_MS
+#define MCP_TX_TIMEOUT_MS  (200)                                        /* loaded frame given up after  */
+#endif
+
+#define MCP_INTMODE_RX     (1<<0)
+#define MCP_INTMODE_TX     (1<<1)
 
 #define MCP2515_OK         (0)
 #define MCP2515_FAIL       (1)
@@ -378,6 +440,8 @@
 #define CAN_CTRLERROR           (5)
 #define CAN_GETTXBFTIMEOUT      (6)
 #define CAN_SENDMSGTIMEOUT      (7)
+#define CAN_TXPENDING           (8)
+#define CAN_TXFAILED            (9)
 #define CAN_FAIL                (0xff)
 
 #define CAN_MAX_CHAR_IN_MESSAGE (8)
@@ -124,20 +124,33 @@ void ParseCan::set_byte_GYRO(int x, int y, int z)
 	int_gyro[0] = x;
 	intToUChar(byte_gyro,0,x);
 	int_gyro[1] = y;
-	intToUChar(byte_gyro,1,y);
+	intToUChar(byte_gyro,2,y);
 	int_gyro[2] = z;
-	intToUChar(byte_gyro,2,z);
+	intToUChar(byte_gyro,4,z);
 }
 
 //l'entier peux ne pas correspondre a une touche la conversion sera faite par la carte gérant la connection seatalk
 //recupere la valur du bouton a partir des donnees du bus can
-int get_seatalk_bouton_value(unsigned char buff[])
+int ParseCan::get_seatalk_bouton_value(unsigned char buff[])
 {
-	return ucharToInt(buff[], 0);
+	return ucharToInt(buff, 0);
 }
 
 //convertie l'entier  pour l'envoyer sur le bus can
-void set_seatalk_bouton_value(int value)
+void ParseCan::set_seatalk_bouton_value(int value)
 {
 	intToUChar(byte_seatalkButton, 0, value);
+}
+
+
+void ParseCan::set_seatalk_heading_rudder(unsigned char buff[], int heading, int rudder)
+{
+	intToUChar(buff,0,heading);
+	intToUChar(buff,2,rudder);
+}
+
+void ParseCan::get_seatalk_heading_rudder(unsigned char buff[], int* heading, int* rudder)
+{
+	*heading = ucharToInt(buff, 0);
+	*rudder = ucharToInt(buff, 2);
 }
\ No newline at end of file
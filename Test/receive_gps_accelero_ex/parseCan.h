@@ -18,6 +18,14 @@ permet d'envoyer des donner numérique sur le bus can
 #define MSG_GPRMC_LAT_LONG		0x40 //identifiant pour une tram avec la latitude et la longitude
 #define MSG_GPRMC_VIT_DATE		0x41 //identifiant pour une trame avec la vitesse et la date_order
 #define MSG_GPGGA_ALT_PREC		0x42 //identifiant pour une trame avec l'altitude et la precision
+#define MSG_GPRMC_LAT_LONG_E7	0x43 //version 2 de MSG_GPRMC_LAT_LONG: latitude et longitude en entier 32bits (1e-7 degree), octet de poid fort en premier
+#define MSG_ESTIME_LAT_LONG		0x47 //position estimee entre deux fix (navigation a l'estime), meme format que MSG_GPRMC_LAT_LONG_E7
+#define MSG_ESTIME_QUALITE		0x48 //qualite de la position estimee, envoyee juste apres MSG_ESTIME_LAT_LONG
+
+//Tram instruments (phrases NMEA des autres capteurs, relayees par le noeud GPS)
+#define MSG_HDG_CAP				0x44 //cap magnetique du compas, deviation et declinaison
+#define MSG_MWV_VENT			0x45 //angle et vitesse du vent
+#define MSG_DPT_PROFONDEUR		0x46 //profondeur sous le capteur et decalage du sondeur
 
 //Tram IMU (accelerometre)
 #define MSG_IMU_PHI_THETA_PSI 	0x50 //identifiant pour une trame avec Roll, pitch and yaw
@@ -25,6 +33,10 @@ permet d'envoyer des donner numérique sur le bus can
 
 //Tram Seatalk
 #define MSG_SETALK_BOUTON		0x30 //Identifiant pour une tram contenant une valeur pour un bouton
+#define MSG_HEADING_RUDDER		0x31 // identifiant pour émettre une valeur de heading et ruder en seatalk
+
+//Tram diagnostic (identifiants les moins prioritaires)
+#define MSG_SERIAL_DIAG			0x60 //compteurs d'erreur de reception d'un port serie (HardwareSerial9bit), envoyee periodiquement
 
 class ParseCan
 {
@@ -64,6 +76,9 @@ class ParseCan
 		int get_seatalk_bouton_value(unsigned char buff[]);
 		//convertie l'entier correpondant a un bouton pour l'envoyer sur le bus can
 		void set_seatalk_bouton_value(int value);
+		
+		void set_seatalk_heading_rudder(unsigned char buff[], int heading, int rudder);
+		void get_seatalk_heading_rudder(unsigned char buff[], int* heading, int* rudder);
 };
 
 #endif
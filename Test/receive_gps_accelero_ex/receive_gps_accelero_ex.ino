@@ -7,14 +7,21 @@
 #include "mcp_can.h"
 //#include "gps_parser.h" //non utilise dans l'exemple
 #include "parseCan.h"
+#include "canSchema.h"
+#include "canFilter.h"
 
 
 const int SPI_CS_PIN = 9;
+const int CAN_INT_PIN = 2; //broche INT du mcp2515 sur le shield
 const int led = 13;
 boolean state = false;
 
 ParseCan parser(true);
 
+//identifiants traites dans loop(), le mcp2515 jette les autres sans interruption
+const unsigned long canIds[] = { MSG_GPRMC_LAT_LONG, MSG_GPRMC_LAT_LONG_E7, MSG_GPRMC_VIT_DATE,
+                                 MSG_GYRO_X_Y_Z, MSG_IMU_PHI_THETA_PSI };
+
 MCP_CAN CAN(SPI_CS_PIN);                                    // Set CS pin
 
 void setup()
@@ -42,6 +49,16 @@ START_INIT:
         delay(100);
         goto START_INIT;
     }
+    CanFilterConfig filterCfg;
+    if(!canFilterSolve(canIds, sizeof(canIds) / sizeof(canIds[0]), CAN_STDID, filterCfg))
+    {
+        Serial1.print("filtres CAN non exacts, faux positifs: ");
+        Serial1.println(filterCfg.falsePositive);
+    }
+    canFilterApply(CAN, filterCfg);
+    //les trames sont lues par interruption, le mcp2515 n'a que 2 buffer de reception
+    //et les Serial1.print de loop() sont trop long pour ne pas en perdre
+    CAN.enableRxInterrupt(CAN_INT_PIN);
 }
 
 void loop()
@@ -62,20 +79,27 @@ void loop()
           case MSG_GPRMC_LAT_LONG : 
                 Serial1.println("MSG_GPRMC_LAT_LONG");
                 Serial1.print("lat:");
-                Serial1.print(parser.ucharToFloat((unsigned char *)buf,0),6);
+                Serial1.print(CanMsgGprmcLatLong::latitude::unpack((unsigned char *)buf),6);
                 Serial1.print(" long:");
-                Serial1.println(parser.ucharToFloat((unsigned char *)buf,4),6);
+                Serial1.println(CanMsgGprmcLatLong::longitude::unpack((unsigned char *)buf),6);
+            break;
+          case MSG_GPRMC_LAT_LONG_E7 :
+                Serial1.println("MSG_GPRMC_LAT_LONG_E7");
+                Serial1.print("lat(1e-7 deg):");
+                Serial1.print(CanMsgGprmcLatLongE7::latitude::unpack((unsigned char *)buf));
+                Serial1.print(" long(1e-7 deg):");
+                Serial1.println(CanMsgGprmcLatLongE7::longitude::unpack((unsigned char *)buf));
             break;
           case MSG_GPRMC_VIT_DATE : 
                 Serial1.println("MSG_GPRMC_VIT_DATE");
                 Serial1.print("vitesse:");
-                Serial1.print(parser.ucharToFloat((unsigned char *)buf,0),4);
+                Serial1.print(CanMsgGprmcVitDate::speed::unpack((unsigned char *)buf),4);
                 Serial1.print("noeud, date:");
-                Serial1.print((unsigned char)buf[4],DEC);
+                Serial1.print(CanMsgGprmcVitDate::day::unpack((unsigned char *)buf),DEC);
                 Serial1.print("/");
-                Serial1.print((unsigned char)buf[5],DEC);
+                Serial1.print(CanMsgGprmcVitDate::month::unpack((unsigned char *)buf),DEC);
                 Serial1.print("/");
-                Serial1.println((unsigned char)buf[6],DEC);
+                Serial1.println(CanMsgGprmcVitDate::year::unpack((unsigned char *)buf),DEC);
             break;
           case MSG_GYRO_X_Y_Z :
                 parser.set_int_GYRO((unsigned char *) buf);
@@ -90,11 +114,11 @@ void loop()
           case MSG_IMU_PHI_THETA_PSI :
                 Serial1.println("MSG_IMU_PHI_THETA_PSI");
                 Serial1.print("IMU phi:");
-                Serial1.print(parser.ucharToInt((unsigned char *) buf,0));
+                Serial1.print(CanMsgImu::phi::unpack((unsigned char *) buf));
                 Serial1.print(" theta:");
-                Serial1.print(parser.ucharToInt((unsigned char *) buf,2));
+                Serial1.print(CanMsgImu::theta::unpack((unsigned char *) buf));
                 Serial1.print(" psi:");
-                Serial1.println(parser.ucharToInt((unsigned char *) buf,4));
+                Serial1.println(CanMsgImu::psi::unpack((unsigned char *) buf));
             break;
             default: //par defaut on affiche le code hexa que l'on a reçus
               Serial1.print("recus id: ");
@@ -106,6 +130,17 @@ void loop()
     time2 = millis();
     if(time2 > time )
     {
+      static unsigned int lost = 0;
+      unsigned int lostNow = CAN.getRxOverflow() + CAN.getHwOverflow();
+      if(lostNow != lost)
+      {
+        lost = lostNow;
+        Serial1.print("trames perdues: ");
+        Serial1.print(CAN.getRxOverflow());
+        Serial1.print(" (buffer) ");
+        Serial1.print(CAN.getHwOverflow());
+        Serial1.println(" (mcp2515)");
+      }
       //creer un clignotement asynchrone pour avoir une information visuel de debogage
       state = !state;
       digitalWrite(led, (state ? HIGH : LOW));
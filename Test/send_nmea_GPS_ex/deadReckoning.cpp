@@ -0,0 +1,167 @@
+//navigation a l'estime, voir deadReckoning.h
+//la position du fix reste en entier 1e-7 degree, seul le deplacement depuis le fix est en float (en metre):
+//les float 32 bits de l'AVR n'ont pas assez de chiffres pour une latitude a 1e-7 pres
+
+#include <math.h>
+#include "deadReckoning.h"
+
+#define DR_METRE_E7 89.83152f  //1e7 / 111319.49 metre par degree de latitude
+#define DR_DEG_RAD 0.01745329f
+#define DR_NOEUD_MS 0.514444f
+#define DR_COS_MIN 0.01f       //pres des poles la longitude n'a plus de sens
+
+static float wrap180(float angle)
+{
+	while(angle >= 180.0f)
+		angle -= 360.0f;
+	while(angle < -180.0f)
+		angle += 360.0f;
+	return angle;
+}
+
+DeadReckoning::DeadReckoning()
+	: hasFix(false), hasImu(false), hasGyro(false), headingValid(false), qual(DR_QUALITE_AUCUNE),
+	  fixMs(0), lastMs(0), imuMs(0), gyroMs(0), baseLat(0), baseLon(0), cosLat(1.0f), north(0), east(0),
+	  corrNorth(0), corrEast(0), speed(0), speedKnot(0), fixCourse(0), courseDeg(0), imuHeading(0),
+	  headingAtFix(0), gyroRate(0)
+{
+}
+
+void DeadReckoning::fix(long latE7, long lonE7, unsigned int speedCentiKnot, unsigned int course, unsigned long now)
+{
+	float errNorth = 0, errEast = 0;
+
+	//ecart entre la position publiee juste avant et le fix, pour ne pas faire sauter la sortie
+	if(hasFix && qual != DR_QUALITE_AUCUNE)
+	{
+		errNorth = (latitudeE7() - latE7) / DR_METRE_E7;
+		errEast = (longitudeE7() - lonE7) / DR_METRE_E7 * cosLat;
+		if(errNorth * errNorth + errEast * errEast > DR_SAUT_MAX_M * DR_SAUT_MAX_M)
+			errNorth = errEast = 0;
+	}
+	corrNorth = errNorth;
+	corrEast = errEast;
+
+	baseLat = latE7;
+	baseLon = lonE7;
+	cosLat = cos(latE7 * (DR_DEG_RAD / 10000000.0f));
+	if(cosLat < DR_COS_MIN)
+		cosLat = DR_COS_MIN;
+	north = east = 0;
+
+	speedKnot = speedCentiKnot;
+	if(speedCentiKnot < DR_VITESSE_MIN)
+	{
+		//a l'arret on garde la route estimee, le cap fond du gps tourne au hasard
+		speed = 0;
+		fixCourse = courseDeg;
+	}
+	else
+	{
+		speed = speedCentiKnot * (DR_NOEUD_MS / 100.0f);
+		fixCourse = course / 10.0f;
+	}
+	courseDeg = fixCourse;
+
+	headingValid = hasImu && now - imuMs < DR_IMU_PERIME_MS;
+	headingAtFix = imuHeading;
+	hasFix = true;
+	fixMs = now;
+	lastMs = now;
+}
+
+void DeadReckoning::imu(int psi, unsigned long now)
+{
+	imuHeading = psi;
+	imuMs = now;
+	hasImu = true;
+	//premier lacet apres le fix: on part de la route courante pour ne pas la faire sauter
+	if(hasFix && !headingValid)
+	{
+		headingAtFix = imuHeading - wrap180(courseDeg - fixCourse);
+		headingValid = true;
+	}
+}
+
+void DeadReckoning::gyro(int z, unsigned long now)
+{
+	gyroRate = z;
+	gyroMs = now;
+	hasGyro = true;
+}
+
+unsigned char DeadReckoning::update(unsigned long now)
+{
+	float dt, k;
+	bool imuFresh, gyroFresh;
+
+	if(!hasFix)
+		return qual = DR_QUALITE_AUCUNE;
+	if(now - fixMs > DR_PERTE_MS)
+	{
+		hasFix = false;
+		return qual = DR_QUALITE_AUCUNE;
+	}
+	dt = (now - lastMs) / 1000.0f;
+	lastMs = now;
+
+	imuFresh = headingValid && now - imuMs < DR_IMU_PERIME_MS;
+	gyroFresh = hasGyro && now - gyroMs < DR_IMU_PERIME_MS;
+	if(imuFresh)
+	{
+		courseDeg = fixCourse + wrap180(imuHeading - headingAtFix);
+	}
+	else if(gyroFresh)
+	{
+		courseDeg += gyroRate * dt;
+	}
+	courseDeg = wrap180(courseDeg);
+	if(courseDeg < 0)
+		courseDeg += 360.0f;
+
+	north += speed * dt * cos(courseDeg * DR_DEG_RAD);
+	east += speed * dt * sin(courseDeg * DR_DEG_RAD);
+
+	//decroissance exponentielle de l'ecart, stable quel que soit dt
+	k = DR_LISSAGE_MS / (DR_LISSAGE_MS + dt * 1000.0f);
+	corrNorth *= k;
+	corrEast *= k;
+
+	if(now - fixMs > DR_FIX_PERIME_MS)
+		qual = DR_QUALITE_ESTIME;
+	else
+		qual = imuFresh || gyroFresh ? DR_QUALITE_GPS_IMU : DR_QUALITE_GPS;
+	return qual;
+}
+
+long DeadReckoning::latitudeE7() const
+{
+	return baseLat + lround((north + corrNorth) * DR_METRE_E7);
+}
+
+long DeadReckoning::longitudeE7() const
+{
+	return baseLon + lround((east + corrEast) * DR_METRE_E7 / cosLat);
+}
+
+int DeadReckoning::course() const
+{
+	int deci = (int) (courseDeg * 10.0f + 0.5f);
+	return deci >= 3600 ? deci - 3600 : deci;
+}
+
+unsigned int DeadReckoning::speedCentiKnot() const
+{
+	return speedKnot;
+}
+
+unsigned char DeadReckoning::fixAge(unsigned long now) const
+{
+	unsigned long age = (now - fixMs) / 100;
+	return age > 255 ? 255 : (unsigned char) age;
+}
+
+float DeadReckoning::correction() const
+{
+	return sqrt(corrNorth * corrNorth + corrEast * corrEast);
+}
@@ -0,0 +1,88 @@
+/**
+	Romain Le Forestier
+ navigation a l'estime entre deux fix du gps
+ le gps donne une position par seconde, le pilote la voit donc en escalier: entre deux fix la position
+ est propagee avec la vitesse fond du dernier GPRMC et une route qui suit le lacet de l'UM6
+ (MSG_IMU_PHI_THETA_PSI), ou a defaut l'integrale du gyro z (MSG_GYRO_X_Y_Z), ou a defaut le cap fond
+ le cap compas et le cap fond ne sont pas egaux (derive, courant, deviation): seule la variation du
+ lacet depuis le fix est ajoutee au cap fond
+ a chaque nouveau fix l'ecart entre l'estime et le fix est resorbe en DR_LISSAGE_MS au lieu de sauter
+ ne depend pas d'arduino: se compile aussi sur PC (voir Test/linux/dead_reckoning.cpp)
+*/
+
+//exemple d'utilisation:
+//	DeadReckoning estime;
+//	estime.fix(rmc.latitudeE7, rmc.longitudeE7, rmc.speedCentiKnot, rmc.course, millis()); //a chaque GPRMC valide
+//	estime.imu(CanMsgImu::psi::unpack(frame.data), millis());                           //a chaque trame de l'UM6
+//	if(estime.update(millis()) != DR_QUALITE_AUCUNE)                                     //toutes les DR_PERIODE_MS
+//		CanMsgEstimeLatLong::pack(buff, estime.latitudeE7(), estime.longitudeE7());
+
+#ifndef _DEADRECKONING_
+#define _DEADRECKONING_
+
+#define DR_QUALITE_AUCUNE	0 //pas de fix depuis DR_PERTE_MS, la position ne doit pas etre utilisee
+#define DR_QUALITE_ESTIME	1 //plus de fix depuis DR_FIX_PERIME_MS: estime seule, l'erreur grandit
+#define DR_QUALITE_GPS		2 //fix recent, route propagee avec le cap fond du gps seulement
+#define DR_QUALITE_GPS_IMU	3 //fix recent, route corrigee par le lacet ou le gyro de l'UM6
+
+#define DR_PERIODE_MS		50    //publication a 20Hz
+#define DR_FIX_PERIME_MS	2500  //le gps envoie un GPRMC par seconde, on tolere un fix perdu
+#define DR_PERTE_MS			30000
+#define DR_IMU_PERIME_MS	500   //l'UM6 envoie ses trames a plus de 20Hz
+#define DR_LISSAGE_MS		1000  //constante de temps du retour vers le fix
+#define DR_SAUT_MAX_M		50.0  //ecart au fix au dela duquel on saute sans lisser
+#define DR_VITESSE_MIN		30    //1/100 noeud, en dessous le cap fond du gps n'a pas de sens
+
+class DeadReckoning
+{
+	public:
+		DeadReckoning();
+
+		//GPRMC valide: vitesse en 1/100 noeud, cap fond vrai en 1/10 degree, now en ms (millis())
+		void fix(long latE7, long lonE7, unsigned int speedCentiKnot, unsigned int course, unsigned long now);
+		//lacet de l'UM6 en degree
+		void imu(int psi, unsigned long now);
+		//vitesse de rotation autour de z en degree par seconde
+		void gyro(int z, unsigned long now);
+
+		//propage la position jusqu'a now, retourne DR_QUALITE_xxx
+		unsigned char update(unsigned long now);
+
+		long latitudeE7() const;
+		long longitudeE7() const;
+		int course() const;                      //1/10 degree, 0 a 3599
+		unsigned int speedCentiKnot() const;
+		unsigned char fixAge(unsigned long now) const; //1/10 seconde, 255 au dela
+		float correction() const;                //metre restant a resorber vers le fix
+		unsigned char quality() const { return qual; }
+
+	private:
+		bool hasFix;
+		bool hasImu;
+		bool hasGyro;
+		bool headingValid;       //headingAtFix renseigne pour ce fix
+		unsigned char qual;
+
+		unsigned long fixMs;
+		unsigned long lastMs;
+		unsigned long imuMs;
+		unsigned long gyroMs;
+
+		long baseLat;            //dernier fix, 1e-7 degree
+		long baseLon;
+		float cosLat;
+		float north;             //deplacement depuis le fix en metre
+		float east;
+		float corrNorth;         //ecart estime - fix au moment du fix, resorbe par update
+		float corrEast;
+
+		float speed;             //metre par seconde
+		unsigned int speedKnot;  //1/100 noeud, pour la trame
+		float fixCourse;         //cap fond du fix en degree
+		float courseDeg;         //route propagee en degree
+		float imuHeading;
+		float headingAtFix;      //lacet de l'UM6 au moment du fix
+		float gyroRate;
+};
+
+#endif
@@ -22,9 +22,15 @@
 */
 #include "mcp_can.h"
 
+#if MCP_SPI_ACCOUNTING
+#define spi_readwrite(b) (MCP_SPI_COUNT_BYTE(), SPI.transfer(b))
+#else
 #define spi_readwrite SPI.transfer
+#endif
 #define spi_read() spi_readwrite(0x00)
 
+MCP_CAN *MCP_CAN::m_pIntInstance = NULL;
+
 /*********************************************************************************************************
 ** Function name:           mcp2515_reset
 ** Descriptions:            reset the device
@@ -414,13 +420,12 @@ INT8U MCP_CAN::mcp2515_init(const INT8U canSpeed)                       /* mcp25
 }
 
 /*********************************************************************************************************
-** Function name:           mcp2515_write_id
-** Descriptions:            write can id
+** Function name:           mcp2515_id_to_buf
+** Descriptions:            encode a can id in the SIDH, SIDL, EID8, EID0 registers layout
 *********************************************************************************************************/
-void MCP_CAN::mcp2515_write_id( const INT8U mcp_addr, const INT8U ext, const INT32U id )
+void MCP_CAN::mcp2515_id_to_buf( const INT8U ext, const INT32U id, INT8U tbufdata[] )
 {
     uint16_t canid;
-    INT8U tbufdata[4];
 
     canid = (uint16_t)(id & 0x0FFFF);
 
@@ -441,22 +446,15 @@ void MCP_CAN::mcp2515_write_id( const INT8U mcp_addr, const INT8U ext, const INT
         tbufdata[MCP_EID0] = 0;
         tbufdata[MCP_EID8] = 0;
     }
-    mcp2515_setRegisterS( mcp_addr, tbufdata, 4 );
 }
 
 /*********************************************************************************************************
-** Function name:           mcp2515_read_id
-** Descriptions:            read can id
+** Function name:           mcp2515_buf_to_id
+** Descriptions:            decode a can id from the SIDH, SIDL, EID8, EID0 registers layout
 *********************************************************************************************************/
-void MCP_CAN::mcp2515_read_id( const INT8U mcp_addr, INT8U* ext, INT32U* id )
+void MCP_CAN::mcp2515_buf_to_id( const INT8U tbufdata[], INT8U* ext, INT32U* id )
 {
-    INT8U tbufdata[4];
-
     *ext = 0;
-    *id = 0;
-
-    mcp2515_readRegisterS( mcp_addr, tbufdata, 4 );
-
     *id = (tbufdata[MCP_SIDH]<<3) + (tbufdata[MCP_SIDL]>>5);
 
     if ( (tbufdata[MCP_SIDL] & MCP_TXB_EXIDE_M) ==  MCP_TXB_EXIDE_M ) 
@@ -470,47 +468,321 @@ void MCP_CAN::mcp2515_read_id( const INT8U mcp_addr, INT8U* ext, INT32U* id )
 }
 
 /*********************************************************************************************************
-** Function name:           mcp2515_write_canMsg
-** Descriptions:            write msg
+** Function name:           mcp2515_write_id
+** Descriptions:            write can id
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_write_id( const INT8U mcp_addr, const INT8U ext, const INT32U id )
+{
+    INT8U tbufdata[4];
+
+    mcp2515_id_to_buf( ext, id, tbufdata );
+    mcp2515_setRegisterS( mcp_addr, tbufdata, 4 );
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_read_id
+** Descriptions:            read can id
 *********************************************************************************************************/
-void MCP_CAN::mcp2515_write_canMsg( const INT8U buffer_sidh_addr)
+void MCP_CAN::mcp2515_read_id( const INT8U mcp_addr, INT8U* ext, INT32U* id )
 {
-    INT8U mcp_addr;
-    mcp_addr = buffer_sidh_addr;
-    mcp2515_setRegisterS(mcp_addr+5, m_nDta, m_nDlc );                  /* write data bytes             */
-    if ( m_nRtr == 1)                                                   /* if RTR set bit in byte       */
+    INT8U tbufdata[4];
+
+    mcp2515_readRegisterS( mcp_addr, tbufdata, 4 );
+    mcp2515_buf_to_id( tbufdata, ext, id );
+}
+
+/*********************************************************************************************************
+** Function name:           mcp2515_read_frame
+** Descriptions:            read message into a frame
+**                          fast spi: one READ RX BUFFER instruction, the mcp2515 clears RXnIF itself
+**                          when CS goes high
+*********************************************************************************************************/
+void MCP_CAN::mcp2515_read_frame( const INT8U buffer_sidh_addr, CAN_FRAME *frame)
+{
+    INT8U ctrl, i;
+    INT8U tbufdata[5];
+
+    MCP_SPI_COUNT_FRAME(rxFrames);
+    if ( m_nFastSpi )
     {
-        m_nDlc |= MCP_RTR_MASK;  
+        MCP2515_SELECT();
+        spi_readwrite( buffer_sidh_addr == MCP_RXBUF_0 ? MCP_READ_RX0 : MCP_READ_RX1 );
+        for (i=0; i<5; i++) {                                           /* SIDH SIDL EID8 EID0 DLC      */
+            tbufdata[i] = spi_read();
+        }
+        mcp2515_buf_to_id( tbufdata, &frame->ext, &frame->id );
+        frame->dlc = tbufdata[4] & MCP_DLC_MASK;
+        if ( frame->dlc > CAN_MAX_CHAR_IN_MESSAGE )
+        {
+            frame->dlc = CAN_MAX_CHAR_IN_MESSAGE;
+        }
+        if ( frame->ext )
+        {
+            frame->rtr = (tbufdata[4] & MCP_RXB_RTR_M) ? 1 : 0;
+        }
+        else
+        {
+            frame->rtr = (tbufdata[MCP_SIDL] & MCP_RXB_SRR_M) ? 1 : 0;
+        }
+        for (i=0; i<frame->dlc; i++) {
+            frame->data[i] = spi_read();
+        }
+        MCP2515_UNSELECT();
+        return;
     }
-    mcp2515_setRegister((mcp_addr+4), m_nDlc );                        /* write the RTR and DLC        */
-    mcp2515_write_id(mcp_addr, m_nExtFlg, m_nID );                     /* write CAN id                 */
 
+    mcp2515_read_id( buffer_sidh_addr, &frame->ext, &frame->id );
+
+    ctrl = mcp2515_readRegister( buffer_sidh_addr-1 );
+    frame->dlc = mcp2515_readRegister( buffer_sidh_addr+4 ) & MCP_DLC_MASK;
+    frame->rtr = (ctrl & 0x08) ? 1 : 0;
+
+    mcp2515_readRegisterS( buffer_sidh_addr+5, frame->data, frame->dlc );
 }
 
 /*********************************************************************************************************
-** Function name:           mcp2515_read_canMsg
-** Descriptions:            read message
+** Function name:           mcp2515_write_frame
+** Descriptions:            write a frame in a tx buffer
+**                          fast spi: one LOAD TX BUFFER instruction for id, dlc and data
 *********************************************************************************************************/
-void MCP_CAN::mcp2515_read_canMsg( const INT8U buffer_sidh_addr)        /* read can msg                 */
+void MCP_CAN::mcp2515_write_frame( const INT8U buffer_sidh_addr, const CAN_FRAME *frame)
 {
-    INT8U mcp_addr, ctrl;
+    INT8U dlc = frame->dlc;
+    INT8U i;
+    INT8U tbufdata[4];
 
-    mcp_addr = buffer_sidh_addr;
+    MCP_SPI_COUNT_FRAME(txFrames);
+    if ( frame->rtr == 1 )
+    {
+        dlc |= MCP_RTR_MASK;
+    }
+    if ( m_nFastSpi )
+    {
+        mcp2515_id_to_buf( frame->ext, frame->id, tbufdata );
+        MCP2515_SELECT();
+                                                                        /* 0x40, 0x42, 0x44: from SIDH  */
+        spi_readwrite( MCP_LOAD_TX0 + (((buffer_sidh_addr - MCP_TXB0CTRL) >> 4) << 1) );
+        for (i=0; i<4; i++) {
+            spi_readwrite( tbufdata[i] );
+        }
+        spi_readwrite( dlc );
+        for (i=0; i<frame->dlc; i++) {
+            spi_readwrite( frame->data[i] );
+        }
+        MCP2515_UNSELECT();
+        return;
+    }
 
-    mcp2515_read_id( mcp_addr, &m_nExtFlg,&m_nID );
+    mcp2515_setRegisterS( buffer_sidh_addr+5, frame->data, frame->dlc ); /* write data bytes            */
+    mcp2515_setRegister( buffer_sidh_addr+4, dlc );                     /* write the RTR and DLC        */
+    mcp2515_write_id( buffer_sidh_addr, frame->ext, frame->id );        /* write CAN id                 */
+}
 
-    ctrl = mcp2515_readRegister( mcp_addr-1 );
-    m_nDlc = mcp2515_readRegister( mcp_addr+4 );
+/*********************************************************************************************************
+** Function name:           loadTxBuffers
+** Descriptions:            move queued frames into every tx buffer not owned by a pending frame
+**                          called by the isr, or by queueFrame with interrupts off
+*********************************************************************************************************/
+void MCP_CAN::loadTxBuffers(void)
+{
+    INT8U i, tail;
+    INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
 
-    if ((ctrl & 0x08)) {
-        m_nRtr = 1;
+    tail = m_txTail;
+    for (i=0; i<MCP_N_TXBUFFERS && tail != m_txHead; i++) {
+        if ( m_txBusy & (1<<i) ) {
+            continue;
+        }
+        mcp2515_write_frame( ctrlregs[i]+1, &m_txQueue[tail] );
+        m_txBufTicket[i] = m_txQueueTicket[tail];
+        m_txBufStart[i] = m_txQueueTime[tail];
+        m_txBusy |= (1<<i);
+        mcp2515_start_transmit( ctrlregs[i]+1 );
+        tail = (tail + 1) & MCP_TX_QUEUE_MASK;
     }
-    else {
-        m_nRtr = 0;
+    m_txTail = tail;
+}
+
+/*********************************************************************************************************
+** Function name:           abortStaleTx
+** Descriptions:            give up the frames queued for more than MCP_TX_TIMEOUT_MS (nobody acknowledges,
+**                          bus-off, or always losing arbitration): clear TXREQ of the loaded ones, drop
+**                          the others from the queue, mark their tickets CAN_TXFAILED, interrupts off
+*********************************************************************************************************/
+void MCP_CAN::abortStaleTx(void)
+{
+    INT8U i, tail, freed = 0;
+    INT32U now = millis();
+    const INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+    const INT8U txflag[MCP_N_TXBUFFERS] = { MCP_TX0IF, MCP_TX1IF, MCP_TX2IF };
+
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        if ( !(m_txBusy & (1<<i)) || now - m_txBufStart[i] < MCP_TX_TIMEOUT_MS ) {
+            continue;
+        }
+        mcp2515_modifyRegister( ctrlregs[i], MCP_TXB_TXREQ_M, 0 );
+        if ( mcp2515_readRegister( ctrlregs[i] ) & MCP_TXB_TXREQ_M ) {  /* on the bus now: TXnIF or     */
+            continue;                                                   /* ABTF on the next call        */
+        }
+        if ( mcp2515_readRegister( MCP_CANINTF ) & txflag[i] ) {        /* sent just before the abort,  */
+            continue;                                                   /* the isr gives CAN_OK         */
+        }
+        m_txStatus[m_txBufTicket[i] & MCP_TX_STATUS_MASK] = CAN_TXFAILED;
+        m_txBusy &= ~(1<<i);
+        m_txAborted++;
+        freed = 1;
+    }
+    tail = m_txTail;                                                    /* oldest first: stop at the    */
+    while ( tail != m_txHead && now - m_txQueueTime[tail] >= MCP_TX_TIMEOUT_MS ) {  /* first recent   */
+        m_txStatus[m_txQueueTicket[tail] & MCP_TX_STATUS_MASK] = CAN_TXFAILED;
+        m_txAborted++;
+        tail = (tail + 1) & MCP_TX_QUEUE_MASK;
+    }
+    m_txTail = tail;
+    if ( freed ) {
+        loadTxBuffers();
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           serviceTxError
+** Descriptions:            isr: MERRF, count the buffers with TXERR and stop the MERRF interrupt until a
+**                          frame goes out, a lone node would get one per retry
+*********************************************************************************************************/
+void MCP_CAN::serviceTxError(void)
+{
+    INT8U i;
+    const INT8U ctrlregs[MCP_N_TXBUFFERS] = { MCP_TXB0CTRL, MCP_TXB1CTRL, MCP_TXB2CTRL };
+
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        if ( (m_txBusy & (1<<i)) && (mcp2515_readRegister( ctrlregs[i] ) & MCP_TXB_TXERR_M) ) {
+            m_txErrors++;
+            break;
+        }
+    }
+    mcp2515_modifyRegister(MCP_CANINTE, MCP_MERRF, 0);                  /* MERRE: same bit as MERRF     */
+    mcp2515_modifyRegister(MCP_CANINTF, MCP_MERRF, 0);
+    m_txErrOff = 1;
+    abortStaleTx();
+}
+
+/*********************************************************************************************************
+** Function name:           serviceInterrupt
+** Descriptions:            isr: move RXB0/RXB1 into the receive ring and refill the tx buffers,
+**                          loop until no enabled flag is left so INT goes high again
+*********************************************************************************************************/
+void MCP_CAN::serviceInterrupt(void)
+{
+    INT8U stat, mask, addr, flag, next, eflg, i;
+    INT32U now = micros();
+    const INT8U txstat[MCP_N_TXBUFFERS] = { MCP_STAT_TX0IF, MCP_STAT_TX1IF, MCP_STAT_TX2IF };
+    const INT8U txflag[MCP_N_TXBUFFERS] = { MCP_TX0IF, MCP_TX1IF, MCP_TX2IF };
+
+    mask = 0;
+    if ( m_nIntMode & MCP_INTMODE_RX )
+    {
+        mask |= MCP_STAT_RXIF_MASK;
+    }
+    if ( m_nIntMode & MCP_INTMODE_TX )
+    {
+        mask |= MCP_STAT_TXIF_MASK;
     }
 
-    m_nDlc &= MCP_DLC_MASK;
-    mcp2515_readRegisterS( mcp_addr+5, &(m_nDta[0]), m_nDlc );
+    stat = mcp2515_readStatus();
+    for (;;)
+    {
+        while ( stat & mask )
+        {
+            if ( stat & mask & MCP_STAT_RXIF_MASK )
+            {
+                if ( stat & MCP_STAT_RX0IF )
+                {
+                    addr = MCP_RXBUF_0;
+                    flag = MCP_RX0IF;
+                }
+                else
+                {
+                    addr = MCP_RXBUF_1;
+                    flag = MCP_RX1IF;
+                }
+
+                next = (m_rxHead + 1) & MCP_RX_RING_MASK;
+                if ( next != m_rxTail )
+                {
+                    mcp2515_read_frame( addr, &m_rxRing[m_rxHead] );
+                    m_rxRing[m_rxHead].timestamp = now;
+                    m_rxHead = next;
+                }
+                else
+                {
+                    m_rxOverflow++;                                     /* ring full: drop the frame    */
+                }
+                                                                        /* always release the buffer,   */
+                                                                        /* or INT stays low for ever    */
+                if ( !m_nFastSpi || next == m_rxTail )                  /* READ RX already cleared it   */
+                {
+                    mcp2515_modifyRegister(MCP_CANINTF, flag, 0);
+                }
+            }
+
+            if ( stat & mask & MCP_STAT_TXIF_MASK )
+            {
+                flag = 0;
+                for (i=0; i<MCP_N_TXBUFFERS; i++) {
+                    if ( stat & txstat[i] ) {
+                        flag |= txflag[i];
+                        if ( m_txBusy & (1<<i) ) {                      /* frame is on the bus          */
+                            m_txStatus[m_txBufTicket[i] & MCP_TX_STATUS_MASK] = CAN_OK;
+                            m_txBusy &= ~(1<<i);
+                        }
+                    }
+                }
+                if ( m_txErrOff )                                       /* the bus works again: watch   */
+                {                                                       /* the errors again             */
+                    flag |= MCP_MERRF;
+                    m_txErrOff = 0;
+                }
+                mcp2515_modifyRegister(MCP_CANINTF, flag, 0);
+                if ( flag & MCP_MERRF )
+                {
+                    mcp2515_modifyRegister(MCP_CANINTE, MCP_MERRF, MCP_MERRF);
+                }
+                loadTxBuffers();
+            }
+            stat = mcp2515_readStatus();
+        }
+                                                                        /* READ STATUS does not show    */
+                                                                        /* MERRF, it would keep INT low */
+        if ( !(m_nIntMode & MCP_INTMODE_TX) || m_txErrOff
+             || !(mcp2515_readRegister(MCP_CANINTF) & MCP_MERRF) )
+        {
+            break;
+        }
+        serviceTxError();
+        stat = mcp2515_readStatus();
+    }
+
+    if ( m_nIntMode & MCP_INTMODE_RX )
+    {
+        eflg = mcp2515_readRegister(MCP_EFLG);
+        if ( eflg & (MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR) )
+        {
+            m_hwOverflow++;
+            mcp2515_modifyRegister(MCP_EFLG, MCP_EFLG_RX0OVR | MCP_EFLG_RX1OVR, 0);
+        }
+    }
+}
+
+/*********************************************************************************************************
+** Function name:           isrInt
+** Descriptions:            INT pin interrupt handler
+*********************************************************************************************************/
+void MCP_CAN::isrInt(void)
+{
+    if ( m_pIntInstance != NULL )
+    {
+        m_pIntInstance->serviceInterrupt();
+    }
 }
 
 /*********************************************************************************************************
@@ -519,6 +791,15 @@ void MCP_CAN::mcp2515_read_canMsg( const INT8U buffer_sidh_addr)        /* read
 *********************************************************************************************************/
 void MCP_CAN::mcp2515_start_transmit(const INT8U mcp_addr)              /* start transmit               */
 {
+    const INT8U rts[MCP_N_TXBUFFERS] = { MCP_RTS_TX0, MCP_RTS_TX1, MCP_RTS_TX2 };
+
+    if ( m_nFastSpi )                                                   /* REQUEST TO SEND: 1 byte      */
+    {
+        MCP2515_SELECT();
+        spi_readwrite( rts[(mcp_addr - MCP_TXB0CTRL) >> 4] );
+        MCP2515_UNSELECT();
+        return;
+    }
     mcp2515_modifyRegister( mcp_addr-1 , MCP_TXB_TXREQ_M, MCP_TXB_TXREQ_M );
 }
 
@@ -554,6 +835,22 @@ INT8U MCP_CAN::mcp2515_getNextFreeTXBuf(INT8U *txbuf_n)                 /* get N
 MCP_CAN::MCP_CAN(INT8U _CS)
 {
     SPICS = _CS;
+    m_nIntMode = 0;
+    m_rxHead = 0;
+    m_rxTail = 0;
+    m_rxOverflow = 0;
+    m_hwOverflow = 0;
+    m_txHead = 0;
+    m_txTail = 0;
+    m_txBusy = 0;
+    m_txNextTicket = 0;
+    m_txErrOff = 0;
+    m_txErrors = 0;
+    m_txAborted = 0;
+    m_nFastSpi = 1;
+#if MCP_SPI_ACCOUNTING
+    resetSpiStats();
+#endif
     pinMode(SPICS, OUTPUT);
     MCP2515_UNSELECT();
 }
@@ -753,6 +1050,21 @@ INT8U MCP_CAN::sendMsg()
 {
     INT8U res, res1, txbuf_n;
     uint16_t uiTimeOut = 0;
+    CAN_FRAME frame;
+
+    frame.id  = m_nID;
+    frame.ext = m_nExtFlg;
+    frame.rtr = m_nRtr;
+    frame.dlc = m_nDlc;
+    for(int i = 0; i<m_nDlc; i++)
+    {
+        frame.data[i] = m_nDta[i];
+    }
+
+    if ( m_nIntMode & MCP_INTMODE_TX )                                  /* the isr owns the tx buffers  */
+    {
+        return queueFrame(&frame, NULL);
+    }
 
     do {
         res = mcp2515_getNextFreeTXBuf(&txbuf_n);                       /* info = addr.                 */
@@ -764,7 +1076,7 @@ INT8U MCP_CAN::sendMsg()
         return CAN_GETTXBFTIMEOUT;                                      /* get tx buff time out         */
     }
     uiTimeOut = 0;
-    mcp2515_write_canMsg( txbuf_n);
+    mcp2515_write_frame( txbuf_n, &frame );
     mcp2515_start_transmit( txbuf_n );
     do
     {
@@ -808,24 +1120,50 @@ INT8U MCP_CAN::sendMsgBuf(INT32U id, INT8U ext, INT8U len, INT8U *buf)
 INT8U MCP_CAN::readMsg()
 {
     INT8U stat, res;
+    CAN_FRAME frame;
 
-    stat = mcp2515_readStatus();
-
-    if ( stat & MCP_STAT_RX0IF )                                        /* Msg in Buffer 0              */
+    if ( m_nIntMode & MCP_INTMODE_RX )                                  /* frames are already in ram    */
     {
-        mcp2515_read_canMsg( MCP_RXBUF_0);
-        mcp2515_modifyRegister(MCP_CANINTF, MCP_RX0IF, 0);
-        res = CAN_OK;
+        res = popFrame(&frame);
     }
-    else if ( stat & MCP_STAT_RX1IF )                                   /* Msg in Buffer 1              */
+    else
     {
-        mcp2515_read_canMsg( MCP_RXBUF_1);
-        mcp2515_modifyRegister(MCP_CANINTF, MCP_RX1IF, 0);
-        res = CAN_OK;
+        stat = mcp2515_readStatus();
+
+        if ( stat & MCP_STAT_RX0IF )                                    /* Msg in Buffer 0              */
+        {
+            mcp2515_read_frame( MCP_RXBUF_0, &frame );
+            if ( !m_nFastSpi )
+            {
+                mcp2515_modifyRegister(MCP_CANINTF, MCP_RX0IF, 0);
+            }
+            res = CAN_OK;
+        }
+        else if ( stat & MCP_STAT_RX1IF )                               /* Msg in Buffer 1              */
+        {
+            mcp2515_read_frame( MCP_RXBUF_1, &frame );
+            if ( !m_nFastSpi )
+            {
+                mcp2515_modifyRegister(MCP_CANINTF, MCP_RX1IF, 0);
+            }
+            res = CAN_OK;
+        }
+        else 
+        {
+            res = CAN_NOMSG;
+        }
     }
-    else 
+
+    if ( res == CAN_OK )
     {
-        res = CAN_NOMSG;
+        m_nID     = frame.id;
+        m_nExtFlg = frame.ext;
+        m_nRtr    = frame.rtr;
+        m_nDlc    = frame.dlc;
+        for(int i = 0; i<m_nDlc; i++)
+        {
+            m_nDta[i] = frame.data[i];
+        }
     }
     return res;
 }
@@ -921,6 +1259,10 @@ INT8U MCP_CAN::readMsgBufIDCh(INT32U *ID, INT8U *len, char buf[])
 INT8U MCP_CAN::checkReceive(void)
 {
     INT8U res;
+    if ( m_nIntMode & MCP_INTMODE_RX )                                  /* no spi traffic in int mode   */
+    {
+        return (m_rxHead != m_rxTail) ? CAN_MSGAVAIL : CAN_NOMSG;
+    }
     res = mcp2515_readStatus();                                         /* RXnIF in Bit 1 and 0         */
     if ( res & MCP_STAT_RXIF_MASK ) 
     {
@@ -977,6 +1319,307 @@ INT8U MCP_CAN::isExtendedFrame(void)
     return m_nExtFlg;
 } 
 
+/*********************************************************************************************************
+** Function name:           attachIntPin
+** Descriptions:            serve the mcp2515 from the INT pin interrupt, mode: MCP_INTMODE_RX/TX
+*********************************************************************************************************/
+INT8U MCP_CAN::attachIntPin(INT8U intPin, INT8U mode)
+{
+    INT8U inte = 0;
+    int irq = digitalPinToInterrupt(intPin);
+    if ( irq < 0 )
+    {
+        return CAN_FAIL;
+    }
+
+    m_pIntInstance = this;
+    pinMode(intPin, INPUT);
+#ifdef SPI_HAS_TRANSACTION
+    SPI.usingInterrupt(irq);
+#endif
+
+    noInterrupts();
+    if ( (mode & MCP_INTMODE_TX) && !(m_nIntMode & MCP_INTMODE_TX) )
+    {
+                                                                        /* forget the TXnIF left by     */
+                                                                        /* the polling sendMsg          */
+        mcp2515_modifyRegister(MCP_CANINTF, MCP_TX0IF | MCP_TX1IF | MCP_TX2IF, 0);
+        m_txBusy = 0;
+    }
+    m_nIntMode |= mode;
+                                                                        /* only the flags the isr       */
+                                                                        /* clears may pull INT low      */
+    if ( m_nIntMode & MCP_INTMODE_RX )
+    {
+        inte |= MCP_RX0IF | MCP_RX1IF;
+    }
+    if ( m_nIntMode & MCP_INTMODE_TX )
+    {
+        inte |= MCP_TX0IF | MCP_TX1IF | MCP_TX2IF | MCP_MERRF;        /* MERRE: same bit as MERRF     */
+        m_txErrOff = 0;
+    }
+    mcp2515_setRegister(MCP_CANINTE, inte);
+    interrupts();
+
+    attachInterrupt(irq, isrInt, FALLING);
+
+                                                                        /* a flag already set keeps INT */
+                                                                        /* low: no edge will come,      */
+                                                                        /* serve it now                 */
+    noInterrupts();
+    serviceInterrupt();
+    interrupts();
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           enableRxInterrupt
+** Descriptions:            receive frames from the INT pin interrupt into the ring, see popFrame
+*********************************************************************************************************/
+INT8U MCP_CAN::enableRxInterrupt(INT8U intPin)
+{
+    return attachIntPin(intPin, MCP_INTMODE_RX);
+}
+
+/*********************************************************************************************************
+** Function name:           enableTxInterrupt
+** Descriptions:            send the frames of sendMsgBufAsync/sendMsgBuf from the TXnIF interrupts
+*********************************************************************************************************/
+INT8U MCP_CAN::enableTxInterrupt(INT8U intPin)
+{
+    return attachIntPin(intPin, MCP_INTMODE_TX);
+}
+
+/*********************************************************************************************************
+** Function name:           popFrame
+** Descriptions:            read the oldest received frame, CAN_NOMSG if the ring is empty
+*********************************************************************************************************/
+INT8U MCP_CAN::popFrame(CAN_FRAME *frame)
+{
+    INT8U tail = m_rxTail;
+
+    if ( tail == m_rxHead )
+    {
+        return CAN_NOMSG;
+    }
+    *frame = m_rxRing[tail];
+    m_rxTail = (tail + 1) & MCP_RX_RING_MASK;                           /* release the slot after copy  */
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           getRxOverflow
+** Descriptions:            number of frames dropped because the ring was full
+*********************************************************************************************************/
+INT16U MCP_CAN::getRxOverflow(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_rxOverflow;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           getHwOverflow
+** Descriptions:            number of RX0OVR/RX1OVR seen: frames lost before the isr could read them
+*********************************************************************************************************/
+INT16U MCP_CAN::getHwOverflow(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_hwOverflow;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           queueFrame
+** Descriptions:            add a frame to the transmit queue and start it if a tx buffer is free
+*********************************************************************************************************/
+INT8U MCP_CAN::queueFrame(const CAN_FRAME *frame, INT8U *ticket)
+{
+    INT8U head, next, t;
+    uint8_t oldSREG = SREG;
+
+    cli();
+    abortStaleTx();                                                     /* a stuck frame must not fill  */
+    SREG = oldSREG;                                                     /* the queue for ever           */
+
+    head = m_txHead;
+    next = (head + 1) & MCP_TX_QUEUE_MASK;
+    if ( next == m_txTail )
+    {
+        return CAN_FAILTX;                                              /* queue full                   */
+    }
+
+    t = m_txNextTicket++;
+    m_txQueue[head] = *frame;
+    m_txQueueTicket[head] = t;
+    m_txQueueTime[head] = millis();
+    m_txStatus[t & MCP_TX_STATUS_MASK] = CAN_TXPENDING;
+    if ( ticket != NULL )
+    {
+        *ticket = t;
+    }
+
+    oldSREG = SREG;
+    cli();
+    m_txHead = next;
+    if ( m_txBusy != (1<<MCP_N_TXBUFFERS) - 1 )                         /* no TXnIF will come to load   */
+    {                                                                   /* an idle buffer: do it here   */
+        loadTxBuffers();
+    }
+    SREG = oldSREG;
+    return CAN_OK;
+}
+
+/*********************************************************************************************************
+** Function name:           sendMsgBufAsync
+** Descriptions:            queue a frame and return at once, needs enableTxInterrupt
+**                          the three tx buffers are kept loaded: the mcp2515 sends the highest buffer
+**                          first, so frames queued together may reach the bus out of order
+**                          ticket: see getTxStatus
+*********************************************************************************************************/
+INT8U MCP_CAN::sendMsgBufAsync(INT32U id, INT8U ext, INT8U len, INT8U *buf, INT8U *ticket)
+{
+    CAN_FRAME frame;
+
+    if ( !(m_nIntMode & MCP_INTMODE_TX) )
+    {
+        return CAN_FAIL;
+    }
+    if ( len > CAN_MAX_CHAR_IN_MESSAGE )
+    {
+        len = CAN_MAX_CHAR_IN_MESSAGE;
+    }
+    frame.id  = id;
+    frame.ext = ext;
+    frame.rtr = 0;
+    frame.dlc = len;
+    for(int i = 0; i<len; i++)
+    {
+        frame.data[i] = buf[i];
+    }
+    return queueFrame(&frame, ticket);
+}
+
+/*********************************************************************************************************
+** Function name:           getTxStatus
+** Descriptions:            CAN_TXPENDING until the frame of the ticket is acknowledged, then CAN_OK,
+**                          or CAN_TXFAILED if it was not on the bus after MCP_TX_TIMEOUT_MS
+**                          only the last MCP_TX_STATUS_SIZE tickets are remembered
+*********************************************************************************************************/
+INT8U MCP_CAN::getTxStatus(INT8U ticket)
+{
+    uint8_t oldSREG = SREG;
+    cli();
+    abortStaleTx();
+    SREG = oldSREG;
+    return m_txStatus[ticket & MCP_TX_STATUS_MASK];
+}
+
+/*********************************************************************************************************
+** Function name:           getTxPending
+** Descriptions:            number of frames queued or loaded in a tx buffer and not yet sent
+*********************************************************************************************************/
+INT8U MCP_CAN::getTxPending(void)
+{
+    INT8U n, i;
+    uint8_t oldSREG = SREG;
+    cli();
+    abortStaleTx();
+    n = (m_txHead - m_txTail) & MCP_TX_QUEUE_MASK;
+    for (i=0; i<MCP_N_TXBUFFERS; i++) {
+        if ( m_txBusy & (1<<i) ) {
+            n++;
+        }
+    }
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           getTxErrors
+** Descriptions:            number of MERRF interrupts with a frame in error (no acknowledge, bus error),
+**                          one per error burst: the interrupt is off until a frame goes out
+*********************************************************************************************************/
+INT16U MCP_CAN::getTxErrors(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_txErrors;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           getTxAborted
+** Descriptions:            number of frames given up after MCP_TX_TIMEOUT_MS, tickets in CAN_TXFAILED
+*********************************************************************************************************/
+INT16U MCP_CAN::getTxAborted(void)
+{
+    INT16U n;
+    uint8_t oldSREG = SREG;
+    cli();
+    n = m_txAborted;
+    SREG = oldSREG;
+    return n;
+}
+
+/*********************************************************************************************************
+** Function name:           setFastSpi
+** Descriptions:            1 (default): READ RX BUFFER, LOAD TX BUFFER and RTS instructions
+**                          0: generic READ, WRITE and BIT MODIFY, to compare with getSpiStats
+*********************************************************************************************************/
+void MCP_CAN::setFastSpi(INT8U on)
+{
+    m_nFastSpi = on ? 1 : 0;
+}
+
+/*********************************************************************************************************
+** Function name:           getSpiStats
+** Descriptions:            spi bytes and chip selects since resetSpiStats, all zero without
+**                          MCP_SPI_ACCOUNTING
+*********************************************************************************************************/
+void MCP_CAN::getSpiStats(CAN_SPI_STATS *stats)
+{
+#if MCP_SPI_ACCOUNTING
+    uint8_t oldSREG = SREG;
+    cli();
+    stats->bytes    = m_spiStats.bytes;
+    stats->selects  = m_spiStats.selects;
+    stats->rxFrames = m_spiStats.rxFrames;
+    stats->txFrames = m_spiStats.txFrames;
+    SREG = oldSREG;
+#else
+    stats->bytes    = 0;
+    stats->selects  = 0;
+    stats->rxFrames = 0;
+    stats->txFrames = 0;
+#endif
+}
+
+/*********************************************************************************************************
+** Function name:           resetSpiStats
+** Descriptions:            clear the spi counters
+*********************************************************************************************************/
+void MCP_CAN::resetSpiStats(void)
+{
+#if MCP_SPI_ACCOUNTING
+    uint8_t oldSREG = SREG;
+    cli();
+    m_spiStats.bytes    = 0;
+    m_spiStats.selects  = 0;
+    m_spiStats.rxFrames = 0;
+    m_spiStats.txFrames = 0;
+    SREG = oldSREG;
+#endif
+}
+
 /*********************************************************************************************************
   END FILE
 *********************************************************************************************************/
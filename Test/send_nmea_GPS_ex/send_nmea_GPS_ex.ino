@@ -2,22 +2,42 @@
 #include <SPI.h>
 #include "gps_parser.h"
 #include "parseCan.h"
+#include "canSchema.h"
+#include "canFilter.h"
+#include "deadReckoning.h"
 
 // the cs pin of the version after v1.1 is default to D9
 // v0.9b and v1.0 is default D10
 const int SPI_CS_PIN = 9;
+const int CAN_INT_PIN = 2; //broche INT du mcp2515 sur le shield
 const int led = 13;
 boolean state = false;
 
-const int sentenceSize = 80;
+//1: rejoue staticGPRMC toutes les 500ms a la place de Serial1, pour tester sans gps branche
+//les deux sources sont exclusives: Serial1 n'est pas lu pendant le rejeu
+#define GPS_TRAME_ENREGISTREE 0
 
-unsigned char staticGPRMC[] = "$GPRMC,023934.00,A,4823.97002,N,00430.49225,W,0.636,,120615,,,D*64";
+#if GPS_TRAME_ENREGISTREE
+const char staticGPRMC[] = "$GPRMC,023934.00,A,4823.97002,N,00430.49225,W,0.636,,120615,,,D*64\r\n";
+NMEA_STREAM streamTest;
+GPRMC_data testRmc;
+#endif
 
-unsigned char sentence[sentenceSize];
-
-GPS_PARSER parserGps(true);
+//les octets du gps et des instruments (multiplexeur NMEA sur Serial1) sont parses au fil de l'eau,
+//pas de tampon de 80 caracteres; seules les phrases attachees sont decodees
+NMEA_STREAM streamGps;
+GPRMC_data gpsRmc;
+GPGGA_data gpsGga;
+HDG_data hdg;
+MWV_data mwv;
+DPT_data dpt;
 ParseCan parserCan(true);
 
+//position a l'estime entre deux fix, avec le lacet et le gyro de l'UM6 recus sur le bus
+DeadReckoning estime;
+unsigned char estimeSequence = 0;
+const unsigned long canIds[] = { MSG_IMU_PHI_THETA_PSI, MSG_GYRO_X_Y_Z };
+
 MCP_CAN CAN(SPI_CS_PIN); // Set CS pin
 
 void setup()
@@ -29,12 +49,22 @@ void setup()
         ; // wait for Serial1 port to connect. Needed for Leonardo only
     }
     */
+#if GPS_TRAME_ENREGISTREE
+  streamTest.attach(&testRmc);
+#else
     Serial1.begin(9600);
     
     while (!Serial1) {
         ; // wait for Serial1 port to connect. Needed for Leonardo only
     }
     
+  streamGps.attach(&gpsRmc);
+  streamGps.attach(&gpsGga);
+  streamGps.attach(&hdg);
+  streamGps.attach(&mwv);
+  streamGps.attach(&dpt);
+#endif
+    
   //set the test signal led
   pinMode(led, OUTPUT);
   digitalWrite(led, LOW);
@@ -55,43 +85,142 @@ START_INIT:
         delay(150);
         goto START_INIT;
     }
+    //seules les trames de l'UM6 sont lues, le mcp2515 jette le reste du trafic
+    CanFilterConfig filterCfg;
+    canFilterSolve(canIds, sizeof(canIds) / sizeof(canIds[0]), CAN_STDID, filterCfg);
+    canFilterApply(CAN, filterCfg);
+    CAN.enableRxInterrupt(CAN_INT_PIN);
+}
+
+void sendGprmc(const GPRMC_data &data)
+{
+    unsigned char buff1[8];
+    unsigned char buff2[8];
+    
+    if(!data.valide)
+    {
+      //Serial.println("mauvais signal");
+      return;
+    }
+    CanMsgGprmcLatLong::pack(buff1, data.latitude, data.longitude);
+    CAN.sendMsgBuf(CanMsgGprmcLatLong::id, 0, CanMsgGprmcLatLong::dlc, buff1);
+    //trame en 1e-7 degree, l'ancienne trame en float est conservee pour les noeuds pas encore mis a jour
+    CanMsgGprmcLatLongE7::pack(buff1, data.latitudeE7, data.longitudeE7);
+    CAN.sendMsgBuf(CanMsgGprmcLatLongE7::id, 0, CanMsgGprmcLatLongE7::dlc, buff1);
+    CanMsgGprmcVitDate::pack(buff2, data.speed, data.day, data.month, data.year);
+    CAN.sendMsgBuf(CanMsgGprmcVitDate::id, 0, CanMsgGprmcVitDate::dlc, buff2);
+}
+
+//relai sur le bus CAN de la phrase qui vient d'etre lue
+void sendSentence(unsigned char sentence)
+{
+    unsigned char buff[8];
+    
+    switch(sentence)
+    {
+      case NMEA_GPRMC:
+        //seul le gps recale l'estime, jamais la trame rejouee (GPS_TRAME_ENREGISTREE)
+        if(gpsRmc.valide)
+          estime.fix(gpsRmc.latitudeE7, gpsRmc.longitudeE7, gpsRmc.speedCentiKnot, gpsRmc.course, millis());
+        sendGprmc(gpsRmc);
+      break;
+      case NMEA_GPGGA:
+        if(gpsGga.fix == 0)
+          break;
+        CanMsgGpggaAltPrec::pack(buff, gpsGga.altitude / 10.0, gpsGga.accuracy, gpsGga.nbSat);
+        CAN.sendMsgBuf(CanMsgGpggaAltPrec::id, 0, CanMsgGpggaAltPrec::dlc, buff);
+      break;
+      case NMEA_HDG:
+        CanMsgHdgCap::pack(buff, hdg.heading, hdg.deviation, hdg.variation);
+        CAN.sendMsgBuf(CanMsgHdgCap::id, 0, CanMsgHdgCap::dlc, buff);
+      break;
+      case NMEA_MWV:
+        if(!mwv.valide)
+          break;
+        CanMsgMwvVent::pack(buff, mwv.angle, mwv.speed, mwv.reference, mwv.unit);
+        CAN.sendMsgBuf(CanMsgMwvVent::id, 0, CanMsgMwvVent::dlc, buff);
+      break;
+      case NMEA_DPT:
+        CanMsgDptProfondeur::pack(buff, dpt.depth, dpt.offset);
+        CAN.sendMsgBuf(CanMsgDptProfondeur::id, 0, CanMsgDptProfondeur::dlc, buff);
+      break;
+      default:break;
+    }
+}
+
+//trames de l'UM6 lues par interruption
+void readCan()
+{
+    CAN_FRAME frame;
+    
+    while(CAN.popFrame(&frame) == CAN_OK)
+    {
+      switch(frame.id)
+      {
+        case MSG_IMU_PHI_THETA_PSI:
+          estime.imu(CanMsgImu::psi::unpack(frame.data), millis());
+        break;
+        case MSG_GYRO_X_Y_Z:
+          estime.gyro(CanMsgGyro::z::unpack(frame.data), millis());
+        break;
+        default:break;
+      }
+    }
+}
+
+//position estimee et sa qualite, les deux trames portent le meme numero de sequence
+void sendEstime(unsigned long now)
+{
+    unsigned char buff[8];
+    unsigned char quality = estime.update(now);
+    float correction;
+    
+    if(quality == DR_QUALITE_AUCUNE)
+      return;
+    correction = estime.correction() * 10;
+    estimeSequence++;
+    CanMsgEstimeLatLong::pack(buff, estime.latitudeE7(), estime.longitudeE7());
+    CAN.sendMsgBuf(CanMsgEstimeLatLong::id, 0, CanMsgEstimeLatLong::dlc, buff);
+    CanMsgEstimeQualite::pack(buff, estimeSequence, quality, estime.fixAge(now), estime.course(),
+                              estime.speedCentiKnot(), correction > 255 ? 255 : (unsigned char) correction);
+    CAN.sendMsgBuf(CanMsgEstimeQualite::id, 0, CanMsgEstimeQualite::dlc, buff);
 }
 
 void loop()
 {
     static unsigned long time1 = 0;
-    static unsigned long time2 = 0;
     volatile unsigned long time3 = millis();
-    static int i = 0;
     
-    //if (Serial1.available()>0) //commenter car on utilise une trame deja enregistrer
+#if !GPS_TRAME_ENREGISTREE
+    //chaque octet recu est consomme tout de suite, la trame part des que le checksum est verifie
+    while (Serial1.available() > 0)
+    {
+      sendSentence(streamGps.feed(Serial1.read()));
+    }
+#endif
+    readCan();
+    
+    static unsigned long timeEstime = 0;
+    if(time3 > timeEstime)
+    {
+      timeEstime = time3 + DR_PERIODE_MS;
+      sendEstime(time3);
+    }
+    
+#if GPS_TRAME_ENREGISTREE
+    static unsigned long time2 = 0;
     if(time3 > time2)
     {
-      time2 += 500;
-         GPRMC_frame frame;
-          GPRMC_data data;
-	  unsigned char buff1[8];
-	  unsigned char buff2[8];
-          
-         //  parserGps.parseGPRMC((char *) sentence, &frame);
-         parserGps.parseGPRMC((char *) staticGPRMC, &frame);
-		 parserGps.convertGprmcFrame(&frame, &data);
-          if(frame.valide == 'A')
-          {
-		 parserCan.floatToUChar(buff1,0,data.latitude);
-		 parserCan.floatToUChar(buff1,4,data.longitude);
-		 CAN.sendMsgBuf(MSG_GPRMC_LAT_LONG, 0, 8, buff1);
-		 parserCan.floatToUChar(buff2,0,data.speed);
-		 buff2[4] = data.day;
-		 buff2[5] = data.month;
-		 buff2[6] = data.year;
-		 CAN.sendMsgBuf(MSG_GPRMC_VIT_DATE, 0, 8, buff2);
-          } 
-          else
-          {
-            //Serial.println("mauvais signal");
-          }
+      time2 = time3 + 500;
+      for(int i = 0; staticGPRMC[i] != '\0'; i++)
+      {
+        if(streamTest.feed(staticGPRMC[i]) == NMEA_GPRMC)
+        {
+          sendGprmc(testRmc);
+        }
+      }
     }
+#endif
           
     if(time3 > time1 )
     {